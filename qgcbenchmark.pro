@@ -0,0 +1,9 @@
+# Benchmark of the telemetry ingest pipeline
+#
+# Built from the same sources as the unit tests, see qgcunittest.pro,
+# but as a separate binary, because it replaces the allocation functions
+# of the C library to count allocations. Run it with QGC_BENCHMARK=1.
+
+CONFIG += benchmark
+
+include(qgcunittest.pro)
@@ -17,6 +17,14 @@ BASEDIR = $$IN_PWD
 TESTDIR = $$BASEDIR/qgcunittest
 TARGETDIR = $$OUT_PWD
 BUILDDIR = $$TARGETDIR/build
+
+# The benchmark (qgcbenchmark.pro) builds the same code with the
+# benchmarks instead of the unit tests into its own binary
+benchmark {
+    TARGET = qgcbenchmark
+    BUILDDIR = $$TARGETDIR/build-benchmark
+}
+
 LANGUAGE = C++
 
 CONFIG   += console
@@ -96,12 +104,31 @@ INCLUDEPATH += . \
     $$BASEDIR/src/comm \
     $$BASEDIR/src/ \
     $$BASEDIR/src/ui/RadioCalibration \
+    $$BASEDIR/src/ui/linechart \
     $$BASEDIR/src/ui/ \
 
 
 SOURCES +=  src/uas/UAS.cc \
             src/comm/MAVLinkProtocol.cc \
+            src/comm/MAVLinkMessageBus.cc \
+            src/comm/MAVLinkSender.cc \
+            src/comm/MAVLinkLogWriter.cc \
+            src/comm/MAVLinkStatistics.cc \
+            src/comm/MAVLinkParser.cc \
+            src/comm/TelemetryChannelRegistry.cc \
+            src/comm/TelemetryAggregator.cc \
+            src/comm/MAVLinkLogReader.cc \
+            src/comm/MAVLinkSimulationLink.cc \
+            src/comm/MAVLinkSimulationMAV.cc \
+            src/comm/MAVLinkSimulationWaypointPlanner.cc \
+            src/comm/MAVLinkSwarmSimulationLink.cc \
+            src/ui/MAVLinkDecoder.cc \
+            src/ui/linechart/LinechartPlot.cc \
+            src/ui/linechart/Scrollbar.cc \
+            src/ui/linechart/ScrollZoomer.cc \
             src/uas/UASWaypointManager.cc \
+            src/uas/QGCUASParamSync.cc \
+            src/uas/QGCUASParamCache.cc \
             src/Waypoint.cc \
             src/ui/RadioCalibration/RadioCalibrationData.cc \
             src/uas/SlugsMAV.cc \
@@ -112,17 +139,33 @@ SOURCES +=  src/uas/UAS.cc \
             src/comm/LinkManager.cc \
             src/QGC.cc \
             src/comm/SerialLink.cc \
-            $$TESTDIR/SlugsMavUnitTest.cc \
             $$TESTDIR/testSuite.cc \
-            $$TESTDIR/UASUnitTest.cc \
     src/uas/QGCMAVLinkUASFactory.cc
 
 
 HEADERS += src/uas/UASInterface.h \
             src/uas/UAS.h \
             src/comm/MAVLinkProtocol.h \
+            src/comm/MAVLinkMessageBus.h \
+            src/comm/MAVLinkSender.h \
+            src/comm/MAVLinkLogWriter.h \
+            src/comm/MAVLinkStatistics.h \
+            src/comm/MAVLinkParser.h \
+            src/comm/TelemetryChannelRegistry.h \
+            src/comm/TelemetryAggregator.h \
+            src/comm/MAVLinkLogReader.h \
+            src/comm/MAVLinkSimulationLink.h \
+            src/comm/MAVLinkSimulationMAV.h \
+            src/comm/MAVLinkSimulationWaypointPlanner.h \
+            src/comm/MAVLinkSwarmSimulationLink.h \
+            src/ui/MAVLinkDecoder.h \
+            src/ui/linechart/LinechartPlot.h \
+            src/ui/linechart/Scrollbar.h \
+            src/ui/linechart/ScrollZoomer.h \
             src/comm/ProtocolInterface.h \
             src/uas/UASWaypointManager.h \
+            src/uas/QGCUASParamSync.h \
+            src/uas/QGCUASParamCache.h \
             src/Waypoint.h \
             src/ui/RadioCalibration/RadioCalibrationData.h \
             src/uas/SlugsMAV.h \
@@ -132,14 +175,46 @@ HEADERS += src/uas/UASInterface.h \
             src/uas/UASManager.h \
             src/comm/LinkManager.h \
             src/comm/LinkInterface.h \
+            src/comm/LinkBuffer.h \
             src/QGC.h \
             src/comm/SerialLinkInterface.h \
             src/comm/SerialLink.h \
-            $$TESTDIR//SlugsMavUnitTest.h \
             $$TESTDIR/AutoTest.h \
-            $$TESTDIR/UASUnitTest.h \
     src/uas/QGCMAVLinkUASFactory.h
 
+benchmark {
+    # Takes over malloc() and friends to count allocations, which
+    # must not leak into the unit tests
+    SOURCES += $$TESTDIR/IngestBenchmark.cc
+    HEADERS += $$TESTDIR/IngestBenchmark.h
+} else {
+    # OPMapControl library (from OpenPilot), for the tile pack test
+    QT += opengl \
+          xml \
+          sql
+    include(src/libs/utils/utils_external.pri)
+    include(src/libs/opmapcontrol/opmapcontrol_external.pri)
+    DEPENDPATH += src/libs/utils \
+                  src/libs/utils/src \
+                  src/libs/opmapcontrol \
+                  src/libs/opmapcontrol/src \
+                  src/libs/opmapcontrol/src/mapwidget
+    INCLUDEPATH += src/libs/utils \
+                   src/libs \
+                   src/libs/opmapcontrol
+
+    SOURCES += $$TESTDIR/SlugsMavUnitTest.cc \
+               $$TESTDIR/UASUnitTest.cc \
+               $$TESTDIR/MAVLinkParserTest.cc \
+               $$TESTDIR/LinkBufferTest.cc \
+               $$TESTDIR/TilePackTest.cc
+    HEADERS += $$TESTDIR//SlugsMavUnitTest.h \
+               $$TESTDIR/UASUnitTest.h \
+               $$TESTDIR/MAVLinkParserTest.h \
+               $$TESTDIR/LinkBufferTest.h \
+               $$TESTDIR/TilePackTest.h
+}
+
 
 
 
@@ -0,0 +1,444 @@
+#include <QElapsedTimer>
+#include <QAtomicInt>
+#include <QtAlgorithms>
+#include <QSettings>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QCoreApplication>
+#include <stdlib.h>
+
+#include "IngestBenchmark.h"
+#include "MAVLinkParser.h"
+#include "MAVLinkLogReader.h"
+#include "UASManager.h"
+#include "LinechartPlot.h"
+
+/*
+ * Allocations are counted by taking over the allocation functions of the
+ * C library, which also covers Qt and operator new. Only the allocations
+ * of the measuring thread between startCounting() and stopCounting() are
+ * counted. This is only possible with glibc, elsewhere the allocation
+ * count is reported as unknown.
+ */
+#if defined(__GLIBC__)
+#include <errno.h>
+#include <pthread.h>
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+extern "C" void* __libc_valloc(size_t size);
+extern "C" void* __libc_pvalloc(size_t size);
+
+static QAtomicInt allocationCounting;
+static pthread_t allocationThread;
+static qint64 allocationCount;
+
+static inline void countAllocation()
+{
+    if (allocationCounting && pthread_equal(pthread_self(), allocationThread))
+    {
+        allocationCount++;
+    }
+}
+
+extern "C" void* malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size)
+{
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** pointer, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    countAllocation();
+    void* result = __libc_memalign(alignment, size);
+    if (!result) return ENOMEM;
+    *pointer = result;
+    return 0;
+}
+
+extern "C" void* valloc(size_t size)
+{
+    countAllocation();
+    return __libc_valloc(size);
+}
+
+extern "C" void* pvalloc(size_t size)
+{
+    countAllocation();
+    return __libc_pvalloc(size);
+}
+
+/** @brief Count the allocations of the calling thread from now on */
+static void startCounting()
+{
+    allocationThread = pthread_self();
+    allocationCount = 0;
+    allocationCounting.fetchAndStoreOrdered(1);
+}
+
+/** @return The allocations since startCounting() */
+static qint64 stopCounting()
+{
+    allocationCounting.fetchAndStoreOrdered(0);
+    return allocationCount;
+}
+#else
+static void startCounting()
+{
+}
+
+static qint64 stopCounting()
+{
+    return -1;
+}
+#endif
+
+IngestBenchmark::IngestBenchmark() :
+    mav(NULL),
+    link(NULL),
+    decoder(NULL),
+    collecting(NULL),
+    settingsFormat(QSettings::NativeFormat)
+{
+    for (int i = 0; i < 256; ++i)
+    {
+        systems[i] = NULL;
+    }
+}
+
+/**
+ * The benchmark takes a while and is only run on request, with the
+ * environment variable QGC_BENCHMARK set. The systems it creates store
+ * their settings in a scratch file instead of the settings of the user.
+ */
+void IngestBenchmark::initTestCase()
+{
+    if (qgetenv("QGC_BENCHMARK").isEmpty())
+    {
+        QSKIP("Set QGC_BENCHMARK=1 to run the ingest benchmark", SkipAll);
+    }
+
+    settingsFormat = QSettings::defaultFormat();
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope,
+                       QDir::temp().absoluteFilePath(QString("qgc-ingest-benchmark-%1").arg(QCoreApplication::applicationPid())));
+
+    mav = new MAVLinkProtocol();
+    mav->enableLogging(false);
+    mav->enableMultiplexing(false);
+
+    // The simulation link is only used as source of the bytes
+    link = new MAVLinkSwarmSimulationLink();
+    link->setVehicleCount(100);
+    link->setSeed(42);
+    link->reset();
+    QByteArray synthetic;
+    link->generate(10000, &synthetic);
+
+    // The decoder is fed directly, not through the bus of the protocol
+    decoder = new MAVLinkDecoder(mav);
+    mav->getMessageBus()->unsubscribe(decoder);
+    connect(decoder, SIGNAL(samplesReceived(TelemetrySampleList)), this, SLOT(collectSamples(TelemetrySampleList)));
+
+    addInput("synthetic", synthetic);
+
+    const QString logName = QString::fromLocal8Bit(qgetenv("QGC_BENCHMARK_LOG"));
+    if (!logName.isEmpty())
+    {
+        MAVLinkLogReader reader;
+        if (reader.open(logName))
+        {
+            QByteArray recorded;
+            reader.appendPackets(0, reader.getPacketCount(), &recorded);
+            addInput("log", recorded);
+        }
+        else
+        {
+            qWarning() << "Could not open" << logName << "for replay";
+        }
+    }
+
+    QObject::disconnect(decoder, SIGNAL(samplesReceived(TelemetrySampleList)), this, SLOT(collectSamples(TelemetrySampleList)));
+}
+
+void IngestBenchmark::cleanupTestCase()
+{
+    // Skipped
+    if (!mav) return;
+
+    for (int i = 0; i < 256; ++i)
+    {
+        delete systems[i];
+        systems[i] = NULL;
+    }
+    delete decoder;
+    delete link;
+    delete mav;
+    decoder = NULL;
+    link = NULL;
+    mav = NULL;
+
+    // Remove the scratch settings written by the systems
+    const QString settingsFile = QSettings().fileName();
+    QFile::remove(settingsFile);
+    QDir().rmpath(QFileInfo(settingsFile).absolutePath());
+    QSettings::setDefaultFormat(settingsFormat);
+}
+
+void IngestBenchmark::collectSamples(const TelemetrySampleList& samples)
+{
+    if (collecting) *collecting += samples;
+}
+
+/**
+ * The systems of the stream are created up front, so the protocol
+ * dispatches their messages like in a running ground station. They
+ * are not subscribed to the bus, which keeps the stages apart.
+ */
+void IngestBenchmark::addInput(const QString& name, const QByteArray& bytes)
+{
+    Input input;
+    input.bytes = bytes;
+
+    MAVLinkParser parser;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(bytes.constData());
+    int position = 0;
+    while (position < bytes.size())
+    {
+        int consumed;
+        const mavlink_message_t* message = parser.parse(data + position, bytes.size() - position, &consumed);
+        position += consumed;
+        if (!message) continue;
+        input.packetEnds.append(position);
+        input.messages.append(MAVLinkMessagePtr(new mavlink_message_t(*message)));
+
+        if (!systems[message->sysid])
+        {
+            systems[message->sysid] = new UAS(mav, message->sysid);
+            UASManager::instance()->addUAS(systems[message->sysid]);
+        }
+    }
+
+    collecting = &input.samples;
+    for (int i = 0; i < input.messages.size(); ++i)
+    {
+        decoder->receiveMessage(link->getId(), input.messages.at(i));
+    }
+    collecting = NULL;
+
+    inputs.insert(name, input);
+}
+
+void IngestBenchmark::addInputRows()
+{
+    QTest::addColumn<QString>("input");
+    foreach (const QString& name, inputs.keys())
+    {
+        QTest::newRow(name.toLatin1().constData()) << name;
+    }
+}
+
+void IngestBenchmark::report(const QString& stage, const QString& input, const char* unit, int count,
+                             qint64 totalTime, qint64 allocations, QVector<qint64>& latencies)
+{
+    qSort(latencies);
+    const int n = latencies.size();
+    const double seconds = totalTime / 1E9;
+    const QString allocationsPer = (allocations < 0) ? QString("unknown") : QString::number(static_cast<double>(allocations) / count, 'f', 2);
+
+    qDebug("BENCHMARK %s %s: %d %ss, %.0f %ss/s, %.1f ns/%s, %s allocations/%s, latency ns p50 %lld p90 %lld p99 %lld p99.9 %lld max %lld",
+           qPrintable(stage), qPrintable(input), count, unit, count / seconds, unit,
+           static_cast<double>(totalTime) / count, unit, qPrintable(allocationsPer), unit,
+           latencies.at(n / 2), latencies.at(n * 9 / 10), latencies.at(n * 99 / 100),
+           latencies.at(n * 999 / 1000), latencies.last());
+}
+
+void IngestBenchmark::protocolReceiveBytes_benchmark_data()
+{
+    addInputRows();
+}
+
+void IngestBenchmark::protocolReceiveBytes_benchmark()
+{
+    QFETCH(QString, input);
+    const Input& in = inputs[input];
+    const char* data = in.bytes.constData();
+    QElapsedTimer timer;
+
+    // Chunks as drained from the receive buffer of a link
+    const int chunkSize = 4096;
+    startCounting();
+    timer.start();
+    for (int offset = 0; offset < in.bytes.size(); offset += chunkSize)
+    {
+        mav->receiveBytes(link, QByteArray::fromRawData(data + offset, qMin(chunkSize, in.bytes.size() - offset)));
+    }
+    const qint64 totalTime = timer.nsecsElapsed();
+    const qint64 allocationsUsed = stopCounting();
+
+    // One packet at a time
+    QVector<qint64> latencies(in.packetEnds.size());
+    int start = 0;
+    for (int i = 0; i < in.packetEnds.size(); ++i)
+    {
+        const int end = in.packetEnds.at(i);
+        timer.start();
+        mav->receiveBytes(link, QByteArray::fromRawData(data + start, end - start));
+        latencies[i] = timer.nsecsElapsed();
+        start = end;
+    }
+
+    QVERIFY(in.packetEnds.size() > 0);
+    report("MAVLinkProtocol::receiveBytes", input, "message", in.packetEnds.size(),
+           totalTime, allocationsUsed, latencies);
+}
+
+void IngestBenchmark::uasReceiveMessage_benchmark_data()
+{
+    addInputRows();
+}
+
+void IngestBenchmark::uasReceiveMessage_benchmark()
+{
+    QFETCH(QString, input);
+    const Input& in = inputs[input];
+    const int count = in.messages.size();
+    QElapsedTimer timer;
+
+    startCounting();
+    timer.start();
+    for (int i = 0; i < count; ++i)
+    {
+        const mavlink_message_t& message = *in.messages.at(i);
+        systems[message.sysid]->receiveMessage(link, message);
+    }
+    const qint64 totalTime = timer.nsecsElapsed();
+    const qint64 allocationsUsed = stopCounting();
+
+    QVector<qint64> latencies(count);
+    for (int i = 0; i < count; ++i)
+    {
+        const mavlink_message_t& message = *in.messages.at(i);
+        timer.start();
+        systems[message.sysid]->receiveMessage(link, message);
+        latencies[i] = timer.nsecsElapsed();
+    }
+
+    QVERIFY(count > 0);
+    report("UAS::receiveMessage", input, "message", count,
+           totalTime, allocationsUsed, latencies);
+}
+
+void IngestBenchmark::decoderReceiveMessage_benchmark_data()
+{
+    addInputRows();
+}
+
+void IngestBenchmark::decoderReceiveMessage_benchmark()
+{
+    QFETCH(QString, input);
+    const Input& in = inputs[input];
+    const int count = in.messages.size();
+    QElapsedTimer timer;
+
+    startCounting();
+    timer.start();
+    for (int i = 0; i < count; ++i)
+    {
+        decoder->receiveMessage(link->getId(), in.messages.at(i));
+    }
+    const qint64 totalTime = timer.nsecsElapsed();
+    const qint64 allocationsUsed = stopCounting();
+
+    QVector<qint64> latencies(count);
+    for (int i = 0; i < count; ++i)
+    {
+        timer.start();
+        decoder->receiveMessage(link->getId(), in.messages.at(i));
+        latencies[i] = timer.nsecsElapsed();
+    }
+
+    QVERIFY(count > 0);
+    report("MAVLinkDecoder::receiveMessage", input, "message", count,
+           totalTime, allocationsUsed, latencies);
+}
+
+void IngestBenchmark::timeSeriesAppend_benchmark_data()
+{
+    addInputRows();
+}
+
+/**
+ * Each pass appends to fresh data sets, one per channel like in the
+ * plot, created before the measurement.
+ */
+void IngestBenchmark::timeSeriesAppend_benchmark()
+{
+    QFETCH(QString, input);
+    const Input& in = inputs[input];
+    const int count = in.samples.size();
+    const int channelCount = TelemetryChannelRegistry::instance()->getChannelCount();
+    QElapsedTimer timer;
+
+    QVector<TimeSeriesData*> data(channelCount);
+    for (int i = 0; i < channelCount; ++i)
+    {
+        data[i] = new TimeSeriesData(NULL, QString::number(i));
+    }
+    startCounting();
+    timer.start();
+    for (int i = 0; i < count; ++i)
+    {
+        const TelemetrySample& sample = in.samples.at(i);
+        data[sample.channel]->append(sample.time, sample.value);
+    }
+    const qint64 totalTime = timer.nsecsElapsed();
+    const qint64 allocationsUsed = stopCounting();
+    qDeleteAll(data);
+
+    QVector<qint64> latencies(count);
+    for (int i = 0; i < channelCount; ++i)
+    {
+        data[i] = new TimeSeriesData(NULL, QString::number(i));
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        const TelemetrySample& sample = in.samples.at(i);
+        timer.start();
+        data[sample.channel]->append(sample.time, sample.value);
+        latencies[i] = timer.nsecsElapsed();
+    }
+    qDeleteAll(data);
+
+    QVERIFY(count > 0);
+    report("TimeSeriesData::append", input, "sample", count,
+           totalTime, allocationsUsed, latencies);
+}
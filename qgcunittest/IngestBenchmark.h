@@ -0,0 +1,91 @@
+#ifndef INGESTBENCHMARK_H
+#define INGESTBENCHMARK_H
+
+#include <QObject>
+#include <QMap>
+#include <QVector>
+#include <QByteArray>
+#include <QSettings>
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+
+#include "UAS.h"
+#include "MAVLinkProtocol.h"
+#include "MAVLinkSwarmSimulationLink.h"
+#include "MAVLinkDecoder.h"
+#include "TelemetryChannelRegistry.h"
+#include "AutoTest.h"
+
+/**
+ * @brief Throughput and latency of the telemetry ingest pipeline
+ *
+ * Every stage is measured on its own with input prepared beforehand:
+ * MAVLinkProtocol::receiveBytes() with the raw bytes, UAS::receiveMessage()
+ * and MAVLinkDecoder::receiveMessage() with the parsed messages and
+ * TimeSeriesData::append() with the decoded samples.
+ *
+ * Each stage runs once in one go, for messages/s, ns/message and
+ * allocations/message, and once timing every single message, for the
+ * latency percentiles. The results are printed as one "BENCHMARK" line
+ * per stage and input, so they can be compared across releases.
+ *
+ * The synthetic input is deterministic swarm traffic. If the environment
+ * variable QGC_BENCHMARK_LOG names a MAVLink log file, it is replayed as
+ * second input.
+ *
+ * Only runs if the environment variable QGC_BENCHMARK is set. It is built
+ * as its own binary with qgcbenchmark.pro, as it replaces the allocation
+ * functions of the whole process.
+ */
+class IngestBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    IngestBenchmark();
+
+public slots:
+    /** @brief Collect the output of the decoder while preparing the input */
+    void collectSamples(const TelemetrySampleList& samples);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void protocolReceiveBytes_benchmark_data();
+    void protocolReceiveBytes_benchmark();
+    void uasReceiveMessage_benchmark_data();
+    void uasReceiveMessage_benchmark();
+    void decoderReceiveMessage_benchmark_data();
+    void decoderReceiveMessage_benchmark();
+    void timeSeriesAppend_benchmark_data();
+    void timeSeriesAppend_benchmark();
+
+protected:
+    /** @brief Prepared input of all stages */
+    struct Input
+    {
+        QByteArray bytes;                      ///< Raw stream
+        QVector<int> packetEnds;               ///< Offset after each packet in the stream
+        QVector<MAVLinkMessagePtr> messages;   ///< Parsed packets
+        TelemetrySampleList samples;           ///< Decoded values
+    };
+
+    /** @brief Parse and decode a stream, creating the systems it contains */
+    void addInput(const QString& name, const QByteArray& bytes);
+    /** @brief Add one row per prepared input to the current data-driven test */
+    void addInputRows();
+    /** @brief Print the results of one stage, count has to be positive */
+    void report(const QString& stage, const QString& input, const char* unit, int count,
+                qint64 totalTime, qint64 allocations, QVector<qint64>& latencies);
+
+    MAVLinkProtocol* mav;
+    MAVLinkSwarmSimulationLink* link;
+    MAVLinkDecoder* decoder;
+    UAS* systems[256];                         ///< Systems by id, 0 if not in any input
+    QMap<QString, Input> inputs;
+    TelemetrySampleList* collecting;           ///< Target of collectSamples(), 0 if not collecting
+    QSettings::Format settingsFormat;          ///< Default settings format before the benchmark
+};
+
+DECLARE_TEST(IngestBenchmark)
+
+#endif // INGESTBENCHMARK_H
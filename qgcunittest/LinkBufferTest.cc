@@ -0,0 +1,125 @@
+#include <QThread>
+
+#include "LinkBufferTest.h"
+
+namespace
+{
+const int producedBytes = 1 << 20;
+typedef LinkBuffer<4096> ThreadedBuffer;
+
+/** @brief Writes a counting byte sequence, only as fast as the ring has space */
+class Producer : public QThread
+{
+public:
+    Producer(ThreadedBuffer* buffer) : buffer(buffer) {}
+
+protected:
+    void run()
+    {
+        char chunk[777];
+        int written = 0;
+        int round = 0;
+        while (written < producedBytes)
+        {
+            // Varying chunk sizes, so writes wrap at every position of the ring
+            int length = qMin(1 + (round++ * 131) % static_cast<int>(sizeof(chunk)), producedBytes - written);
+            length = qMin(length, buffer->space());
+            if (length == 0)
+            {
+                yieldCurrentThread();
+                continue;
+            }
+            for (int i = 0; i < length; ++i) chunk[i] = static_cast<char>(written + i);
+            written += buffer->write(chunk, length);
+        }
+    }
+
+    ThreadedBuffer* buffer;
+};
+}
+
+LinkBufferTest::LinkBufferTest()
+{
+}
+
+void LinkBufferTest::wrapAround_test()
+{
+    LinkBuffer<16> buffer;
+    char in[16];
+    char out[16];
+    int written = 0;
+    int read = 0;
+
+    for (int round = 0; round < 100; ++round)
+    {
+        const int length = 1 + round % 11;
+        for (int i = 0; i < length; ++i) in[i] = static_cast<char>(written + i);
+        QCOMPARE(buffer.write(in, length), length);
+        written += length;
+        QCOMPARE(buffer.size(), written - read);
+
+        // Leave some bytes behind, the next write wraps around the end
+        const int count = buffer.read(out, 1 + round % 7);
+        for (int i = 0; i < count; ++i) QCOMPARE(out[i], static_cast<char>(read + i));
+        read += count;
+        if (buffer.size() > 4)
+        {
+            const int more = buffer.read(out, buffer.size());
+            for (int i = 0; i < more; ++i) QCOMPARE(out[i], static_cast<char>(read + i));
+            read += more;
+        }
+    }
+    QCOMPARE(buffer.droppedBytes(), 0);
+}
+
+void LinkBufferTest::overflow_test()
+{
+    LinkBuffer<16> buffer;
+    char in[20];
+    char out[20];
+    for (int i = 0; i < 20; ++i) in[i] = static_cast<char>(i);
+
+    // Whatever does not fit is dropped, the oldest bytes are kept
+    QCOMPARE(buffer.write(in, 20), 16);
+    QCOMPARE(buffer.droppedBytes(), 4);
+    QCOMPARE(buffer.size(), 16);
+    QCOMPARE(buffer.space(), 0);
+    QCOMPARE(buffer.write(in, 1), 0);
+    QCOMPARE(buffer.droppedBytes(), 5);
+
+    QCOMPARE(buffer.read(out, 20), 16);
+    for (int i = 0; i < 16; ++i) QCOMPARE(out[i], in[i]);
+    QCOMPARE(buffer.size(), 0);
+    QCOMPARE(buffer.read(out, 20), 0);
+}
+
+void LinkBufferTest::producerConsumer_test()
+{
+    ThreadedBuffer buffer;
+    Producer producer(&buffer);
+    producer.start();
+
+    char out[1000];
+    int read = 0;
+    int mismatches = 0;
+    while (read < producedBytes)
+    {
+        const int count = buffer.read(out, sizeof(out));
+        if (count == 0)
+        {
+            QVERIFY(!producer.isFinished() || buffer.size() > 0);
+            continue;
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            if (out[i] != static_cast<char>(read + i)) mismatches++;
+        }
+        read += count;
+    }
+    QVERIFY(producer.wait(10000));
+
+    QCOMPARE(mismatches, 0);
+    QCOMPARE(read, producedBytes);
+    QCOMPARE(buffer.droppedBytes(), 0);
+    QCOMPARE(buffer.size(), 0);
+}
@@ -0,0 +1,28 @@
+#ifndef LINKBUFFERTEST_H
+#define LINKBUFFERTEST_H
+
+#include <QObject>
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+
+#include "LinkBuffer.h"
+#include "AutoTest.h"
+
+/**
+ * @brief Receive ring of the links, single threaded and with a producer thread
+ */
+class LinkBufferTest : public QObject
+{
+    Q_OBJECT
+public:
+    LinkBufferTest();
+
+private slots:
+    void wrapAround_test();
+    void overflow_test();
+    void producerConsumer_test();
+};
+
+DECLARE_TEST(LinkBufferTest)
+
+#endif // LINKBUFFERTEST_H
@@ -0,0 +1,172 @@
+#include <string.h>
+
+#include "MAVLinkParserTest.h"
+
+const int MAVLinkParserTest::chunkSizes[] = { 1, 2, 3, 5, 17, 64, 263, 4096, 0 };
+
+MAVLinkParserTest::MAVLinkParserTest()
+{
+}
+
+QByteArray MAVLinkParserTest::buildStream(bool corrupt)
+{
+    QByteArray stream;
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    mavlink_message_t msg;
+    char text[50];
+
+    for (int i = 0; i < 120; ++i)
+    {
+        const uint8_t sysid = 1 + i % 3;
+        const uint8_t compid = 200 + i % 2;
+        switch (i % 3)
+        {
+        case 0:
+            mavlink_msg_heartbeat_pack(sysid, compid, &msg, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_GENERIC, MAV_MODE_FLAG_SAFETY_ARMED, i, MAV_STATE_ACTIVE);
+            break;
+        case 1:
+            mavlink_msg_attitude_pack(sysid, compid, &msg, i * 20, 0.1f * i, -0.2f * i, 0.3f, 0.01f, 0.02f, 0.03f);
+            break;
+        default:
+            // The whole field is copied, also behind the terminating zero
+            memset(text, 0, sizeof(text));
+            qsnprintf(text, sizeof(text), "Status text %d", i);
+            mavlink_msg_statustext_pack(sysid, compid, &msg, i % 8, text);
+            break;
+        }
+        QByteArray packet(reinterpret_cast<const char*>(buffer), mavlink_msg_to_send_buffer(buffer, &msg));
+
+        if (corrupt)
+        {
+            // Noise between packets, including a start byte of a packet which never completes
+            if (i % 7 == 1) stream.append("\x00\x11\xFE\x03", 4);
+            // Checksum errors in the payload and in both checksum bytes
+            if (i % 7 == 3) packet[MAVLINK_NUM_HEADER_BYTES + 2] = packet.at(MAVLINK_NUM_HEADER_BYTES + 2) ^ 0x40;
+            if (i % 7 == 5) packet[packet.size() - 1] = packet.at(packet.size() - 1) ^ 0x01;
+            // A wrong checksum byte, which is the start of the next packet
+            if (i % 13 == 6 && static_cast<uint8_t>(packet.at(packet.size() - 2)) != MAVLINK_STX)
+            {
+                packet[packet.size() - 2] = static_cast<char>(MAVLINK_STX);
+            }
+            // Truncated packet, the next packet is read as its remainder
+            if (i % 11 == 4) packet.chop(4);
+        }
+        stream.append(packet);
+    }
+    return stream;
+}
+
+MAVLinkParserTest::ParseResult MAVLinkParserTest::parseReference(const QByteArray& stream)
+{
+    ParseResult result;
+    result.errors = 0;
+
+    // The reference keeps its state per channel in static memory, start clean
+    const uint8_t chan = MAVLINK_COMM_3;
+    mavlink_status_t* channelStatus = mavlink_get_channel_status(chan);
+    memset(channelStatus, 0, sizeof(mavlink_status_t));
+    channelStatus->parse_state = MAVLINK_PARSE_STATE_IDLE;
+
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    mavlink_message_t msg;
+    mavlink_status_t status;
+    for (int i = 0; i < stream.size(); ++i)
+    {
+        const bool complete = mavlink_parse_char(chan, static_cast<uint8_t>(stream.at(i)), &msg, &status);
+        // Errors of this call only, the channel counter is reset
+        result.errors += status.packet_rx_drop_count;
+        if (complete)
+        {
+            result.messages.append(QByteArray(reinterpret_cast<const char*>(buffer), mavlink_msg_to_send_buffer(buffer, &msg)));
+        }
+    }
+    return result;
+}
+
+MAVLinkParserTest::ParseResult MAVLinkParserTest::parseChunks(const QByteArray& stream, int chunkSize)
+{
+    ParseResult result;
+    MAVLinkParser parser;
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(stream.constData());
+    int position = 0;
+    int chunk = 0;
+
+    while (position < stream.size())
+    {
+        // Varying sizes split packets at every position sooner or later
+        int length = (chunkSize > 0) ? chunkSize : 1 + (chunk * 37) % 300;
+        length = qMin(length, stream.size() - position);
+
+        int offset = 0;
+        while (offset < length)
+        {
+            int consumed;
+            const mavlink_message_t* msg = parser.parse(data + position + offset, length - offset, &consumed);
+            offset += consumed;
+            if (msg)
+            {
+                result.messages.append(QByteArray(reinterpret_cast<const char*>(buffer), mavlink_msg_to_send_buffer(buffer, msg)));
+            }
+        }
+        position += length;
+        chunk++;
+    }
+    result.errors = parser.getErrorCount();
+    return result;
+}
+
+void MAVLinkParserTest::splitStream_test()
+{
+    const QByteArray stream = buildStream(false);
+    const ParseResult reference = parseReference(stream);
+    QCOMPARE(reference.messages.size(), 120);
+    QCOMPARE(reference.errors, 0u);
+
+    for (int i = 0; i < static_cast<int>(sizeof(chunkSizes) / sizeof(chunkSizes[0])); ++i)
+    {
+        const ParseResult result = parseChunks(stream, chunkSizes[i]);
+        QCOMPARE(result.messages.size(), reference.messages.size());
+        QVERIFY(result.messages == reference.messages);
+        QCOMPARE(result.errors, reference.errors);
+    }
+}
+
+void MAVLinkParserTest::corruptedStream_test()
+{
+    const QByteArray stream = buildStream(true);
+    const ParseResult reference = parseReference(stream);
+    // The stream has to exercise both, delivered and dropped packets
+    QVERIFY(reference.messages.size() > 0);
+    QVERIFY(reference.messages.size() < 120);
+    QVERIFY(reference.errors > 0);
+
+    for (int i = 0; i < static_cast<int>(sizeof(chunkSizes) / sizeof(chunkSizes[0])); ++i)
+    {
+        const ParseResult result = parseChunks(stream, chunkSizes[i]);
+        QCOMPARE(result.messages.size(), reference.messages.size());
+        QVERIFY(result.messages == reference.messages);
+        QCOMPARE(result.errors, reference.errors);
+    }
+}
+
+void MAVLinkParserTest::parseChar_test()
+{
+    const QByteArray stream = buildStream(true);
+    const ParseResult reference = parseReference(stream);
+
+    MAVLinkParser parser;
+    QList<QByteArray> messages;
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    mavlink_message_t msg;
+    for (int i = 0; i < stream.size(); ++i)
+    {
+        if (parser.parseChar(static_cast<uint8_t>(stream.at(i)), &msg))
+        {
+            messages.append(QByteArray(reinterpret_cast<const char*>(buffer), mavlink_msg_to_send_buffer(buffer, &msg)));
+        }
+    }
+    QVERIFY(messages == reference.messages);
+    QCOMPARE(parser.getErrorCount(), reference.errors);
+    QCOMPARE(parser.getReceivedCount(), static_cast<quint32>(reference.messages.size()));
+}
@@ -0,0 +1,51 @@
+#ifndef MAVLINKPARSERTEST_H
+#define MAVLINKPARSERTEST_H
+
+#include <QObject>
+#include <QList>
+#include <QByteArray>
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+
+#include "MAVLinkParser.h"
+#include "AutoTest.h"
+
+/**
+ * @brief Compares MAVLinkParser with the reference mavlink_parse_char()
+ *
+ * The same byte stream is fed to both parsers, to MAVLinkParser in chunks
+ * of different sizes. Both have to deliver the same messages, byte for
+ * byte, and count the same number of errors.
+ */
+class MAVLinkParserTest : public QObject
+{
+    Q_OBJECT
+public:
+    MAVLinkParserTest();
+
+private slots:
+    void splitStream_test();
+    void corruptedStream_test();
+    void parseChar_test();
+
+protected:
+    /** @brief Messages, as sent on the wire, and errors found in a stream */
+    struct ParseResult
+    {
+        QList<QByteArray> messages;
+        quint32 errors;
+    };
+
+    /** @brief Stream of valid packets, with garbage and broken packets in between if corrupt is set */
+    static QByteArray buildStream(bool corrupt);
+    /** @brief Parse a stream byte by byte with mavlink_parse_char() */
+    static ParseResult parseReference(const QByteArray& stream);
+    /** @brief Parse a stream with MAVLinkParser::parse(), chunkSize 0 varies the chunk size */
+    static ParseResult parseChunks(const QByteArray& stream, int chunkSize);
+
+    static const int chunkSizes[];    ///< Chunk sizes the stream is split into, 0 varies the size per chunk
+};
+
+DECLARE_TEST(MAVLinkParserTest)
+
+#endif // MAVLINKPARSERTEST_H
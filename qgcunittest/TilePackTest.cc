@@ -0,0 +1,118 @@
+#include <QDir>
+#include <QFile>
+#include <QCoreApplication>
+#include <QScopedPointer>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+#include "TilePackTest.h"
+#include "src/core/pureimagecache.h"
+#include "src/internals/core.h"
+
+Q_DECLARE_METATYPE(core::MapType::Types)
+
+TilePackTest::TilePackTest() :
+    connectionName("TilePackTest")
+{
+}
+
+void TilePackTest::initTestCase()
+{
+    directory = QDir::temp().absoluteFilePath(QString("qgc-tilepack-test-%1").arg(QCoreApplication::applicationPid()));
+    QVERIFY(QDir().mkpath(directory));
+    const QString databaseFile = QDir(directory).filePath("Data.qmdb");
+    QVERIFY(core::PureImageCache::CreateEmptyDB(databaseFile));
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(databaseFile);
+    QVERIFY(db.open());
+}
+
+void TilePackTest::cleanupTestCase()
+{
+    QSqlDatabase::database(connectionName, false).close();
+    QSqlDatabase::removeDatabase(connectionName);
+    QDir dir(directory);
+    foreach (const QString& name, dir.entryList(QDir::Files))
+    {
+        dir.remove(name);
+    }
+    QDir().rmdir(directory);
+}
+
+QByteArray TilePackTest::image(int x, int y, int zoom)
+{
+    return QString("tile %1 %2 %3").arg(x).arg(y).arg(zoom).toLatin1();
+}
+
+bool TilePackTest::addTile(core::MapType::Types type, int x, int y, int zoom)
+{
+    QSqlQuery query(QSqlDatabase::database(connectionName));
+    query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type, Date) VALUES(?, ?, ?, ?, ?)");
+    query.addBindValue(x);
+    query.addBindValue(y);
+    query.addBindValue(zoom);
+    query.addBindValue(static_cast<int>(type));
+    query.addBindValue(QString());
+    if (!query.exec()) return false;
+    query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
+    query.addBindValue(image(x, y, zoom));
+    return query.exec();
+}
+
+void TilePackTest::roundTrip_test_data()
+{
+    QTest::addColumn<core::MapType::Types>("type");
+    QTest::newRow("Mercator") << core::MapType::GoogleMap;
+    QTest::newRow("PlateCarree") << core::MapType::ArcGIS_Map;
+}
+
+/**
+ * Every tile of the tile matrix of some zoom levels is stored, plus one
+ * beyond the last row and column, which have to be left out of the pack.
+ */
+void TilePackTest::roundTrip_test()
+{
+    QFETCH(core::MapType::Types, type);
+    int typeMaxZoom;
+    QScopedPointer<internals::PureProjection> projection(internals::Core::NewProjection(type, typeMaxZoom));
+
+    int inside = 0;
+    for (int zoom = 0; zoom <= 4; ++zoom)
+    {
+        const core::Size maxXY = projection->GetTileMatrixMaxXY(zoom);
+        for (int x = 0; x <= maxXY.Width(); ++x)
+        {
+            for (int y = 0; y <= maxXY.Height(); ++y)
+            {
+                QVERIFY(addTile(type, x, y, zoom));
+                inside++;
+            }
+        }
+        QVERIFY(addTile(type, maxXY.Width() + 1, 0, zoom));
+        QVERIFY(addTile(type, 0, maxXY.Height() + 1, zoom));
+    }
+
+    const QString fileName = QDir(directory).filePath(QString("%1.tilepack").arg(static_cast<int>(type)));
+    QSqlDatabase db = QSqlDatabase::database(connectionName);
+    QVERIFY(core::TilePack::Write(db, type, fileName));
+
+    core::TilePack pack;
+    QVERIFY(pack.Open(fileName));
+    QCOMPARE(pack.Type(), type);
+    QCOMPARE(pack.Count(), inside);
+    for (int zoom = 0; zoom <= 4; ++zoom)
+    {
+        const core::Size maxXY = projection->GetTileMatrixMaxXY(zoom);
+        for (int x = 0; x <= maxXY.Width(); ++x)
+        {
+            for (int y = 0; y <= maxXY.Height(); ++y)
+            {
+                QCOMPARE(pack.GetImage(core::Point(x, y), zoom), image(x, y, zoom));
+            }
+        }
+        QVERIFY(!pack.HasImage(core::Point(maxXY.Width() + 1, 0), zoom));
+        QVERIFY(!pack.HasImage(core::Point(0, maxXY.Height() + 1), zoom));
+    }
+    pack.Close();
+}
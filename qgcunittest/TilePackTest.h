@@ -0,0 +1,41 @@
+#ifndef TILEPACKTEST_H
+#define TILEPACKTEST_H
+
+#include <QObject>
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+
+#include "src/core/tilepack.h"
+#include "AutoTest.h"
+
+/**
+ * @brief Writes tile packs from a tile cache database and reads them back
+ *
+ * Covers a projection with a square tile matrix, Mercator, and one with
+ * twice as many columns as rows, PlateCarree.
+ */
+class TilePackTest : public QObject
+{
+    Q_OBJECT
+public:
+    TilePackTest();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void roundTrip_test_data();
+    void roundTrip_test();
+
+protected:
+    /** @brief Image stored for a tile, unique per position and zoom */
+    static QByteArray image(int x, int y, int zoom);
+    /** @brief Add a tile to the database of the test */
+    bool addTile(core::MapType::Types type, int x, int y, int zoom);
+
+    QString directory;              ///< Scratch directory of the database and the packs
+    QString connectionName;
+};
+
+DECLARE_TEST(TilePackTest)
+
+#endif // TILEPACKTEST_H
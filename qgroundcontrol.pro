@@ -253,10 +253,19 @@ HEADERS += src/MG.h \
     src/uas/UASManager.h \
     src/comm/LinkManager.h \
     src/comm/LinkInterface.h \
+    src/comm/LinkBuffer.h \
     src/comm/SerialLinkInterface.h \
     src/comm/SerialLink.h \
     src/comm/ProtocolInterface.h \
     src/comm/MAVLinkProtocol.h \
+    src/comm/MAVLinkMessageBus.h \
+    src/comm/MAVLinkSender.h \
+    src/comm/MAVLinkLogWriter.h \
+    src/comm/MAVLinkStatistics.h \
+    src/comm/MAVLinkParser.h \
+    src/comm/TelemetryChannelRegistry.h \
+    src/comm/TelemetryAggregator.h \
+    src/comm/MAVLinkLogReader.h \
     src/comm/QGCFlightGearLink.h \
     src/ui/CommConfigurationWindow.h \
     src/ui/SerialConfigurationWindow.h \
@@ -334,6 +343,8 @@ HEADERS += src/MG.h \
     src/ui/mission/QGCMissionDoWidget.h \
     src/ui/mission/QGCMissionConditionWidget.h \
     src/uas/QGCUASParamManager.h \
+    src/uas/QGCUASParamSync.h \
+    src/uas/QGCUASParamCache.h \
     src/ui/map/QGCMapWidget.h \
     src/ui/map/MAV2DIcon.h \
     src/ui/map/Waypoint2DIcon.h \
@@ -394,6 +405,14 @@ SOURCES += src/main.cc \
     src/comm/LinkInterface.cpp \
     src/comm/SerialLink.cc \
     src/comm/MAVLinkProtocol.cc \
+    src/comm/MAVLinkMessageBus.cc \
+    src/comm/MAVLinkSender.cc \
+    src/comm/MAVLinkLogWriter.cc \
+    src/comm/MAVLinkStatistics.cc \
+    src/comm/MAVLinkParser.cc \
+    src/comm/TelemetryChannelRegistry.cc \
+    src/comm/TelemetryAggregator.cc \
+    src/comm/MAVLinkLogReader.cc \
     src/comm/QGCFlightGearLink.cc \
     src/ui/CommConfigurationWindow.cc \
     src/ui/SerialConfigurationWindow.cc \
@@ -469,6 +488,8 @@ SOURCES += src/main.cc \
     src/ui/mission/QGCMissionDoWidget.cc \
     src/ui/mission/QGCMissionConditionWidget.cc \
     src/uas/QGCUASParamManager.cc \
+    src/uas/QGCUASParamSync.cc \
+    src/uas/QGCUASParamCache.cc \
     src/ui/map/QGCMapWidget.cc \
     src/ui/map/MAV2DIcon.cc \
     src/ui/map/Waypoint2DIcon.cc \
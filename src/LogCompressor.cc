@@ -28,14 +28,118 @@ This file is part of the QGROUNDCONTROL project
  */
 
 #include <QFile>
-#include <QTextStream>
 #include <QStringList>
 #include <QFileInfo>
 #include <QList>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QtAlgorithms>
+#include <string.h>
+#include <limits>
 #include "LogCompressor.h"
 
 #include <QDebug>
 
+/**
+ * @brief One value of the raw log: time, column and position of the value text in the logfile
+ */
+struct LogCompressorRecord
+{
+    quint64 time;
+    int key;
+    int valueLength;
+    qint64 valueOffset;
+};
+
+/**
+ * @brief Parses one newline-aligned chunk of the raw logfile
+ *
+ * Keys are numbered locally in the order of appearance, the compressor
+ * maps them to the global (sorted) columns after all chunks are done.
+ */
+class LogCompressorChunkParser : public QRunnable
+{
+public:
+    LogCompressorChunkParser(const char* data, qint64 begin, qint64 end) :
+        data(data),
+        begin(begin),
+        end(end),
+        lines(0)
+    {
+        setAutoDelete(false);
+    }
+
+    void run()
+    {
+        const char separator = '\t';
+        qint64 pos = begin;
+        while (pos < end)
+        {
+            const char* lineStart = data + pos;
+            const char* lineEnd = static_cast<const char*>(memchr(lineStart, '\n', end - pos));
+            if (!lineEnd) lineEnd = data + end;
+            pos = (lineEnd - data) + 1;
+            // Text mode: tolerate CRLF line endings
+            if (lineEnd > lineStart && *(lineEnd-1) == '\r') lineEnd--;
+            lines++;
+
+            // Fields: time, uas id, key, value
+            const char* fields[4];
+            int fieldLengths[4];
+            const char* field = lineStart;
+            int fieldCount = 0;
+            while (fieldCount < 4)
+            {
+                const char* next = static_cast<const char*>(memchr(field, separator, lineEnd - field));
+                if (!next) next = lineEnd;
+                fields[fieldCount] = field;
+                fieldLengths[fieldCount] = next - field;
+                fieldCount++;
+                if (next == lineEnd) break;
+                field = next + 1;
+            }
+            if (fieldCount < 4) continue;
+
+            bool ok;
+            quint64 time = QByteArray::fromRawData(fields[0], fieldLengths[0]).toULongLong(&ok);
+            if (!ok) continue;
+
+            // Lookup without copying, only new keys are stored
+            const QByteArray key = QByteArray::fromRawData(fields[2], fieldLengths[2]);
+            QHash<QByteArray, int>::const_iterator it = keyIndex.constFind(key);
+            int keyId;
+            if (it == keyIndex.constEnd())
+            {
+                keyId = keys.size();
+                keys.append(QByteArray(fields[2], fieldLengths[2]));
+                keyIndex.insert(keys.last(), keyId);
+            }
+            else
+            {
+                keyId = it.value();
+            }
+
+            LogCompressorRecord record;
+            record.time = time;
+            record.key = keyId;
+            record.valueOffset = fields[3] - data;
+            record.valueLength = fieldLengths[3];
+            records.append(record);
+        }
+    }
+
+    const char* data;
+    qint64 begin;
+    qint64 end;
+    int lines;
+    QHash<QByteArray, int> keyIndex;
+    QList<QByteArray> keys;
+    QVector<LogCompressorRecord> records;
+};
+
 /**
  * It will only get active upon calling startCompression()
  */
@@ -50,254 +154,243 @@ LogCompressor::LogCompressor(QString logFileName, QString outFileName, int uasid
 {
 }
 
+/**
+ * The raw log is processed in a single streaming pass: the file is mapped,
+ * split into newline-aligned chunks which are parsed in parallel, and the
+ * values are sorted into a columnar table (one column per key, one row per
+ * distinct timestamp) through a timestamp-to-row hash. The CSV file is
+ * written once from this table at the end. Values are never copied, the
+ * table only references them inside the mapped logfile.
+ */
 void LogCompressor::run()
 {
-    QString separator = "\t";
+    const char separator = '\t';
     QString fileName = logFileName;
     QFile file(fileName);
-    QFile outfile(outFileName);
-    QStringList* keys = new QStringList();
-    QList<quint64> times;// = new QList<quint64>();
-    QList<quint64> finalTimes;
-
-    //qDebug() << "LOG COMPRESSOR: Starting" << fileName;
 
-    if (!file.exists() || !file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        //qDebug() << "LOG COMPRESSOR: INPUT FILE DOES NOT EXIST";
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
         emit logProcessingStatusChanged(tr("Log Compressor: Cannot start/compress log file, since input file %1 is not readable").arg(QFileInfo(fileName).absoluteFilePath()));
+        running = false;
         return;
     }
 
     // Check if file is writeable
-    if (outFileName == ""/* || !QFileInfo(outfile).isWritable()*/) {
-        //qDebug() << "LOG COMPRESSOR: OUTPUT FILE DOES NOT EXIST" << outFileName;
+    if (outFileName == "") {
         emit logProcessingStatusChanged(tr("Log Compressor: Cannot start/compress log file, since output file %1 is not writable").arg(QFileInfo(outFileName).absoluteFilePath()));
+        running = false;
         return;
     }
 
-    // Find all keys
-    QTextStream in(&file);
-
-    // Search only a certain region, assuming that not more
-    // than N dimensions at H Hertz can be send
-    const unsigned int keySearchLimit = 15000;
-    // e.g. 500 Hz * 30 values or
-    // e.g. 100 Hz * 150 values
-
-    unsigned int keyCounter = 0;
-    while (!in.atEnd() && keyCounter < keySearchLimit) {
-        QString line = in.readLine();
-        // Accumulate map of keys
-        // Data field name is at position 2
-        QString key = line.split(separator).at(2);
-        if (!keys->contains(key))
-        {
-            keys->append(key);
-        }
-        keyCounter++;
+    const qint64 size = file.size();
+    const char* data = NULL;
+    QByteArray fileContent;
+    if (size > 0)
+    {
+        data = reinterpret_cast<const char*>(file.map(0, size));
+    }
+    const bool mapped = (data != NULL);
+    if (!mapped)
+    {
+        // Mapping not supported, fall back to reading the whole file
+        fileContent = file.readAll();
+        data = fileContent.constData();
     }
-    keys->sort();
 
-    QString header = "";
-    QString spacer = "";
-    for (int i = 0; i < keys->length(); i++) {
-        header += keys->at(i) + separator;
-        spacer += separator;
+    // Split into chunks at line boundaries, one per core, but not smaller than 1 MB
+    const qint64 minChunkSize = 1 << 20;
+    int chunkCount = qMax(1, qMin(QThread::idealThreadCount(), static_cast<int>(size / minChunkSize)));
+    QList<LogCompressorChunkParser*> parsers;
+    qint64 begin = 0;
+    for (int i = 0; i < chunkCount && begin < size; ++i)
+    {
+        qint64 end = (i == chunkCount - 1) ? size : (size / chunkCount) * (i + 1);
+        if (end < begin) end = begin;
+        // Extend the chunk to the end of its last line
+        const char* newline = (end < size) ? static_cast<const char*>(memchr(data + end, '\n', size - end)) : NULL;
+        end = newline ? (newline - data) + 1 : size;
+        parsers.append(new LogCompressorChunkParser(data, begin, end));
+        begin = end;
     }
 
-    emit logProcessingStatusChanged(tr("Log compressor: Dataset contains dimension: ") + header);
+    QThreadPool pool;
+    foreach (LogCompressorChunkParser* parser, parsers)
+    {
+        pool.start(parser);
+    }
+    pool.waitForDone();
 
-    // Find all times
-    //in.reset();
-    file.reset();
-    in.reset();
-    in.resetStatus();
-    bool ok;
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        // Accumulate map of keys
-        // Data field name is at position 2b
-        quint64 time = static_cast<QString>(line.split(separator).at(0)).toLongLong(&ok);
-        if (ok) {
-            times.append(time);
+    // Build the global, sorted column index
+    QMap<QByteArray, int> keyColumns;
+    foreach (LogCompressorChunkParser* parser, parsers)
+    {
+        foreach (const QByteArray& key, parser->keys)
+        {
+            keyColumns.insert(key, 0);
         }
     }
+    QList<QByteArray> keys = keyColumns.keys();
+    for (int i = 0; i < keys.size(); ++i)
+    {
+        keyColumns[keys.at(i)] = i;
+    }
 
-    qSort(times);
-
-    qint64 lastTime = -1;
-
-    // Create lines
-    QStringList* outLines = new QStringList();
-    for (int i = 0; i < times.length(); i++) {
-        // Cast to signed on purpose, 64 bit timestamp still long enough
-        if (static_cast<qint64>(times.at(i)) != lastTime) {
-            outLines->append(QString("%1").arg(times.at(i)) + separator + spacer);
-            lastTime = static_cast<qint64>(times.at(i));
-            finalTimes.append(times.at(i));
-            //qDebug() << "ADDED:" << outLines->last();
-        }
+    QString header = "";
+    for (int i = 0; i < keys.size(); i++) {
+        header += QString::fromLatin1(keys.at(i)) + separator;
     }
+    emit logProcessingStatusChanged(tr("Log compressor: Dataset contains dimension: ") + header);
 
-    dataLines = finalTimes.length();
-
-    emit logProcessingStatusChanged(tr("Log compressor: Now processing %1 log lines").arg(finalTimes.length()));
-
-    // Fill in the values for all keys
-    file.reset();
-    QTextStream data(&file);
-    int linecounter = 0;
-    quint64 lastTimeIndex = 0;
-    bool failed = false;
-
-    while (!data.atEnd()) {
-        linecounter++;
-        currentDataLine = linecounter;
-        QString line = data.readLine();
-        QStringList parts = line.split(separator);
-        // Get time
-        quint64 time = static_cast<QString>(parts.first()).toLongLong(&ok);
-        QString field = parts.at(2);
-        int fieldIndex = keys->indexOf(field);
-        QString value = parts.at(3);
-//        // Enforce NaN if no value is present
-//        if (value.length() == 0 || value == "" || value == " " || value == "\t" || value == "\n") {
-//            // Hole filling disabled, fill with NaN
-//            value = "NaN";
-//        }
-        // Get matching output line
-
-        // Constraining the search area might result in not finding a key,
-        // but it significantly reduces the time needed for the search
-        // setting a window of 100 entries means that a 1 Hz data point
-        // can still be located
-        quint64 offsetLimit = 100;
-        quint64 offset;
-        qint64 index = -1;
-        failed = false;
-
-        // Search the index until it is valid (!= -1)
-        // or the start of the list has been reached (failed)
-        while (index == -1 && !failed) {
-            if (lastTimeIndex > offsetLimit) {
-                offset = lastTimeIndex - offsetLimit;
-            } else {
-                offset = 0;
-            }
+    // Merge the records in file order, mapping local keys to columns
+    // and collecting the distinct timestamps
+    QVector<LogCompressorRecord> records;
+    int recordCount = 0;
+    foreach (LogCompressorChunkParser* parser, parsers)
+    {
+        recordCount += parser->records.size();
+    }
+    records.reserve(recordCount);
 
-            index = finalTimes.indexOf(time, offset);
-            if (index == -1) {
-                if (offset == 0) {
-                    emit logProcessingStatusChanged(tr("Log compressor: Timestamp %1 not found in dataset, ignoring log line %2").arg(time).arg(linecounter));
-                    qDebug() << "Completely failed finding value";
-                    //continue;
-                    failed = true;
-                } else {
-                    emit logProcessingStatusChanged(tr("Log compressor: Timestamp %1 not found in dataset, restarting search.").arg(time));
-                    offsetLimit*=2;
-                }
-            }
+    QHash<quint64, int> rowOfTime;
+    QVector<quint64> times;
+    foreach (LogCompressorChunkParser* parser, parsers)
+    {
+        QVector<int> columnOfKey(parser->keys.size());
+        for (int i = 0; i < parser->keys.size(); ++i)
+        {
+            columnOfKey[i] = keyColumns.value(parser->keys.at(i));
         }
-
-        if (dataLines > 100) if (index % (dataLines/100) == 0) emit logProcessingStatusChanged(tr("Log compressor: Processed %1% of %2 lines").arg(index/(float)dataLines*100, 0, 'f', 2).arg(dataLines));
-
-        if (!failed) {
-            // When the algorithm reaches here the correct index was found
-            lastTimeIndex = index;
-            QString outLine = outLines->at(index);
-            QStringList outParts = outLine.split(separator);
-            // Replace measurement placeholder with current value
-            outParts.replace(fieldIndex+1, value);
-            outLine = outParts.join(separator);
-            outLines->replace(index, outLine);
+        for (int i = 0; i < parser->records.size(); ++i)
+        {
+            LogCompressorRecord record = parser->records.at(i);
+            record.key = columnOfKey.at(record.key);
+            records.append(record);
+            if (!rowOfTime.contains(record.time))
+            {
+                rowOfTime.insert(record.time, 0);
+                times.append(record.time);
+            }
         }
+        delete parser;
     }
+    parsers.clear();
 
-    ///////////////////////////
-    // HOLE FILLING
+    qSort(times);
+    for (int i = 0; i < times.size(); ++i)
+    {
+        rowOfTime[times.at(i)] = i;
+    }
 
-    // If hole filling is enabled, run again through the whole file and replace holes
-    if (holeFillingEnabled)
+    const int rows = times.size();
+    const int columns = keys.size();
+    dataLines = qMax(1, rows);
+    emit logProcessingStatusChanged(tr("Log compressor: Now processing %1 log lines").arg(rows));
+
+    // Columnar table of record numbers, -1 for holes. Later values
+    // for the same timestamp and key overwrite earlier ones. The size is
+    // computed in 64 bit, QVector allocates its bytes with an int
+    const qint64 cells = static_cast<qint64>(rows) * columns;
+    const qint64 maxCells = std::numeric_limits<int>::max() / static_cast<qint64>(sizeof(int)) - 64;
+    if (cells > maxCells) {
+        emit logProcessingStatusChanged(tr("Log Compressor: Cannot compress log file, %1 lines with %2 columns exceed the maximum table size of %3 values").arg(rows).arg(columns).arg(maxCells));
+        currentDataLine = 0;
+        dataLines = 1;
+        running = false;
+        return;
+    }
+    QVector<int> table(static_cast<int>(cells), -1);
+    for (int i = 0; i < records.size(); ++i)
     {
-        // Build up the fill values - initialize to NaN
-        QStringList fillValues;
-        int fillCount = keys->count();
-        for (int i = 0; i< fillCount; ++i)
-        {
-            fillValues.append("NaN");
-        }
+        const LogCompressorRecord& record = records.at(i);
+        table[static_cast<qint64>(record.key) * rows + rowOfTime.value(record.time)] = i;
+    }
+    rowOfTime.clear();
 
-        // Run through all lines and replace with fill values
-        for (int index = 0; index < outLines->count(); ++index)
+    // Write the table to a temporary file first if the input is replaced,
+    // the values still point into the input file
+    QString targetName = outFileName;
+    if (QFileInfo(outFileName).absoluteFilePath() == QFileInfo(logFileName).absoluteFilePath()) {
+        targetName = outFileName + ".compressed";
+    }
+    QFile outfile(targetName);
+    if (!outfile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        emit logProcessingStatusChanged(tr("Log Compressor: Cannot start/compress log file, since output file %1 is not writable").arg(QFileInfo(targetName).absoluteFilePath()));
+        running = false;
+        return;
+    }
+    outfile.write(QString(QString("timestamp_ms") + separator + header.replace(" ", "_") + QString("\n")).toLatin1());
+    emit logProcessingStatusChanged(tr("Log Compressor: Writing output to file %1").arg(QFileInfo(outFileName).absoluteFilePath()));
+
+    // Hole filling: zero order hold of the last value of the same column,
+    // NaN if there was none yet
+    const QByteArray nan("NaN");
+    QVector<int> lastRecord(columns, -1);
+    QByteArray out;
+    const int blockSize = 1 << 16;
+    out.reserve(blockSize + 1024);
+    for (int row = 0; row < rows; ++row)
+    {
+        currentDataLine = row;
+        out.append(QByteArray::number(times.at(row)));
+        out.append(separator);
+        for (int column = 0; column < columns; ++column)
         {
-            QString line = outLines->at(index);
-            //qDebug() << "LINE" << line;
-            QStringList fields = line.split(separator, QString::SkipEmptyParts);
-            // The fields line contains the timestamp
-            // index of the data fields therefore runs from 1 to n-1
-            int fieldCount = fields.count();
-            for (int i = 1; i < fillCount+1; ++i)
+            int recordIndex = table.at(static_cast<qint64>(column) * rows + row);
+            if (recordIndex >= 0)
             {
-                if (fieldCount <= i) fields.append("");
-
-                // Allow input data to be screwed up
-                if (fields.at(i) == "\t" || fields.at(i) == " " || fields.at(i) == "\n")
+                const LogCompressorRecord& record = records.at(recordIndex);
+                // Whitespace-only values count as holes
+                QByteArray value = QByteArray::fromRawData(data + record.valueOffset, record.valueLength).trimmed();
+                if (value.isEmpty())
                 {
-                    // Remove invalid data
-                    if (fieldCount > fillCount+1)
-                    {
-                        // This field has a seperator value and is too much
-                        //qDebug() << "REMOVED INVALID INPUT DATA";
-                        fields.removeAt(i);
-                    }
-                    // Continue on invalid data
-                    continue;
+                    recordIndex = -1;
                 }
-
-                // Check if this is NaN
-                if (fields.at(i) == 0 || fields.at(i) == "")
+                else
+                {
+                    out.append(value);
+                    lastRecord[column] = recordIndex;
+                }
+            }
+            if (recordIndex < 0 && holeFillingEnabled)
+            {
+                if (lastRecord.at(column) >= 0)
                 {
-                    // Value was empty, replace it
-                    fields.replace(i, fillValues[i-1]);
-                    //qDebug() << "FILL" << fillValues.at(i-1);
+                    const LogCompressorRecord& record = records.at(lastRecord.at(column));
+                    out.append(QByteArray::fromRawData(data + record.valueOffset, record.valueLength).trimmed());
                 }
                 else
                 {
-                    // Value was not NaN, use it as
-                    // new fill value
-                    fillValues.replace(i-1, fields[i]);
+                    out.append(nan);
                 }
             }
-            outLines->replace(index, fields.join(separator));
+            out.append(separator);
         }
-    }
-
-    // Add header, write out file
-    file.close();
-
-    if (outFileName == logFileName) {
-        QFile::remove(file.fileName());
-        outfile.setFileName(file.fileName());
+        out.append('\n');
 
+        if (out.size() >= blockSize)
+        {
+            outfile.write(out);
+            out.resize(0);
+            out.reserve(blockSize + 1024);
+        }
+        if (rows > 100 && row % (rows/10) == 0) emit logProcessingStatusChanged(tr("Log compressor: Processed %1% of %2 lines").arg(row/(float)rows*100, 0, 'f', 2).arg(rows));
     }
-    if (!outfile.open(QIODevice::WriteOnly | QIODevice::Text))
-        return;
-    outfile.write(QString(QString("timestamp_ms") + separator + header.replace(" ", "_") + QString("\n")).toLatin1());
-    emit logProcessingStatusChanged(tr("Log Compressor: Writing output to file %1").arg(QFileInfo(outFileName).absoluteFilePath()));
+    outfile.write(out);
+    outfile.close();
 
-    // File output
-    for (int i = 0; i < outLines->length(); i++) {
-        //qDebug() << outLines->at(i);
-        outfile.write(QString(outLines->at(i) + "\n").toLatin1());
+    // Release the input before it might get replaced
+    if (mapped) file.unmap(reinterpret_cast<uchar*>(const_cast<char*>(data)));
+    file.close();
 
+    if (targetName != outFileName) {
+        QFile::remove(outFileName);
+        QFile::rename(targetName, outFileName);
     }
 
     currentDataLine = 0;
     dataLines = 1;
-    delete keys;
-    emit logProcessingStatusChanged(tr("Log compressor: Finished processing file: %1").arg(outfile.fileName()));
+    emit logProcessingStatusChanged(tr("Log compressor: Finished processing file: %1").arg(outFileName));
     qDebug() << "Done with logfile processing";
-    emit finishedFile(outfile.fileName());
+    emit finishedFile(outFileName);
     running = false;
 }
 
@@ -0,0 +1,148 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Single-producer / single-consumer byte ring buffer for links
+ *
+ */
+
+#ifndef _LINKBUFFER_H_
+#define _LINKBUFFER_H_
+
+#include <QAtomicInt>
+#include <QtGlobal>
+#include <string.h>
+
+/**
+ * @brief Lock-free byte ring shared between a link thread and its protocol.
+ *
+ * Exactly one thread may write (the link reading from its device) and exactly
+ * one thread may read (the protocol decoding the stream). The write and read
+ * positions are free-running counters, the capacity has to be a power of two.
+ * If the consumer falls behind, bytes that do not fit anymore are dropped and
+ * counted, as the protocol layer will detect the loss on its own.
+ */
+template <int Capacity>
+class LinkBuffer
+{
+public:
+    LinkBuffer() :
+        head(0),
+        tail(0),
+        dropped(0)
+    {
+        Q_ASSERT((Capacity & (Capacity - 1)) == 0);
+    }
+
+    /** @brief Number of bytes ready to be read, callable from both sides */
+    int size() const
+    {
+        return distance(load(tail), load(head));
+    }
+
+    /** @brief Number of bytes which can be written without dropping, producer side only */
+    int space() const
+    {
+        return Capacity - size();
+    }
+
+    /** @brief Total number of bytes dropped because the buffer was full */
+    int droppedBytes() const
+    {
+        return load(dropped);
+    }
+
+    /**
+     * @brief Append bytes, producer side only
+     *
+     * @return The number of bytes actually stored
+     */
+    int write(const char* data, int length)
+    {
+        const int w = load(head);
+        const int space = Capacity - distance(load(tail), w);
+        if (length > space)
+        {
+            dropped.fetchAndAddRelaxed(length - space);
+            length = space;
+        }
+        copyIn(w, data, length);
+        head.fetchAndStoreRelease(advance(w, length));
+        return length;
+    }
+
+    /**
+     * @brief Remove up to maxLength bytes, consumer side only
+     *
+     * @return The number of bytes copied into data
+     */
+    int read(char* data, int maxLength)
+    {
+        const int r = load(tail);
+        const int length = qMin(maxLength, distance(r, load(head)));
+        copyOut(r, data, length);
+        tail.fetchAndStoreRelease(advance(r, length));
+        return length;
+    }
+
+protected:
+    static int load(const QAtomicInt& value)
+    {
+        return const_cast<QAtomicInt&>(value).fetchAndAddAcquire(0);
+    }
+
+    /** @brief Wrap-safe difference of two free-running positions */
+    static int distance(int from, int to)
+    {
+        return static_cast<int>(static_cast<unsigned int>(to) - static_cast<unsigned int>(from));
+    }
+
+    static int advance(int position, int length)
+    {
+        return static_cast<int>(static_cast<unsigned int>(position) + static_cast<unsigned int>(length));
+    }
+
+    void copyIn(int position, const char* data, int length)
+    {
+        const int offset = position & (Capacity - 1);
+        const int first = qMin(length, Capacity - offset);
+        memcpy(buffer + offset, data, first);
+        memcpy(buffer, data + first, length - first);
+    }
+
+    void copyOut(int position, char* data, int length) const
+    {
+        const int offset = position & (Capacity - 1);
+        const int first = qMin(length, Capacity - offset);
+        memcpy(data, buffer + offset, first);
+        memcpy(data + first, buffer, length - first);
+    }
+
+    QAtomicInt head;     ///< Free-running write position, owned by the producer
+    QAtomicInt tail;     ///< Free-running read position, owned by the consumer
+    QAtomicInt dropped;  ///< Bytes discarded on overflow
+    char buffer[Capacity];
+};
+
+#endif // _LINKBUFFER_H_
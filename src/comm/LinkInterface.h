@@ -33,6 +33,10 @@ along with PIXHAWK. If not, see <http://www.gnu.org/licenses/>.
 #define _LINKINTERFACE_H_
 
 #include <QThread>
+#include <QByteArray>
+#include <QAtomicInt>
+#include "LinkBuffer.h"
+#include "MAVLinkParser.h"
 
 /**
 * The link interface defines the interface for all links used to communicate
@@ -43,7 +47,7 @@ class LinkInterface : public QThread
 {
     Q_OBJECT
 public:
-    LinkInterface(QObject* parent = 0) : QThread(parent) {}
+    LinkInterface(QObject* parent = 0) : QThread(parent), receivePending(0) {}
     virtual ~LinkInterface() { emit this->deleteLink(this); }
 
     /* Connection management */
@@ -181,6 +185,34 @@ public:
      **/
     virtual qint64 bytesAvailable() = 0;
 
+    /**
+     * @brief Drain bytes received by this link, consumer side of the receive buffer
+     *
+     * Only the one protocol attached through bytesBuffered() may call this method,
+     * while it holds LinkManager::getLinkLock() for reading.
+     * It never allocates, the caller provides the memory the bytes are copied to.
+     *
+     * @param data The pointer to write the bytes to
+     * @param maxLength The maximum length which can be written
+     * @return The number of bytes copied, 0 once the buffer is empty
+     **/
+    qint64 readBufferedBytes(char* data, qint64 maxLength) {
+        // Re-arm the notification before draining, so bytes pushed while
+        // the consumer is busy trigger exactly one further wakeup
+        receivePending.fetchAndStoreOrdered(0);
+        return receiveRing.read(data, static_cast<int>(qMin(maxLength, static_cast<qint64>(receiveRingSize))));
+    }
+
+    /** @brief Parser state of the received bytes, only used by the protocol draining the receive buffer */
+    MAVLinkParser* getReceiveParser() {
+        return &receiveParser;
+    }
+
+    /** @brief Number of received bytes dropped because the protocol could not keep up */
+    int getDroppedBytes() const {
+        return receiveRing.droppedBytes();
+    }
+
 public slots:
 
     /**
@@ -209,6 +241,17 @@ signals:
      */
     void bytesReceived(LinkInterface* link, QByteArray data);
 
+    /**
+     * @brief New data is waiting in the receive buffer
+     *
+     * Emitted once when the receive buffer turns non-empty. The receiver is
+     * expected to drain it completely with readBufferedBytes(), any bytes
+     * arriving in the meantime do not cause additional signals. Only the id
+     * of the link is passed, the receiver looks it up with
+     * LinkManager::getLinkForId() once it handles the notification.
+     */
+    void bytesBuffered(int linkId);
+
     /**
      * @brief This signal is emitted instantly when the link is connected
      **/
@@ -241,6 +284,32 @@ protected:
         return nextId++;
     }
 
+    /**
+     * @brief Hand received bytes to the protocol, producer side of the receive buffer
+     *
+     * Links call this from their reading thread instead of emitting bytesReceived()
+     * directly. The copying bytesReceived() signal is only emitted if someone
+     * (e.g. the debug console) is still connected to it.
+     *
+     * @param data The received bytes
+     * @param length The number of received bytes
+     **/
+    void pushReceivedBytes(const char* data, qint64 length) {
+        if (length <= 0) return;
+        receiveRing.write(data, static_cast<int>(length));
+        if (receivePending.testAndSetOrdered(0, 1)) {
+            emit bytesBuffered(getId());
+        }
+        if (receivers(SIGNAL(bytesReceived(LinkInterface*,QByteArray))) > 0) {
+            emit bytesReceived(this, QByteArray(data, static_cast<int>(length)));
+        }
+    }
+
+    static const int receiveRingSize = 65536; ///< Receive buffer capacity in bytes, power of two
+    LinkBuffer<receiveRingSize> receiveRing; ///< Bytes received, waiting for the protocol
+    MAVLinkParser receiveParser; ///< Packet parsed from the received bytes so far
+    QAtomicInt receivePending;  ///< Set while a bytesBuffered() notification is outstanding
+
 protected slots:
 
     /**
@@ -70,7 +70,12 @@ void LinkManager::add(LinkInterface* link)
     if (!links.contains(link)) {
         if(!link) return;
         connect(link, SIGNAL(destroyed(QObject*)), this, SLOT(removeLink(QObject*)));
+        // Remove the link while its receive buffer is still intact, even if
+        // it is deleted without being removed first
+        connect(link, SIGNAL(deleteLink(LinkInterface* const)), this, SLOT(linkDeleted(LinkInterface* const)), Qt::DirectConnection);
+        linkLock.lockForWrite();
         links.append(link);
+        linkLock.unlock();
         emit newLink(link);
     }
 }
@@ -87,7 +92,13 @@ void LinkManager::addProtocol(LinkInterface* link, ProtocolInterface* protocol)
     // OR if link has not been added to protocol, add
     if ((linkList.length() > 0 && !linkList.contains(link)) || linkList.length() == 0) {
         // Protocol is new, add
-        connect(link, SIGNAL(bytesReceived(LinkInterface*, QByteArray)), protocol, SLOT(receiveBytes(LinkInterface*, QByteArray)));
+        if (protocolLinks.keys(link).isEmpty()) {
+            // The receive buffer of a link has a single consumer, hand
+            // it to the first protocol attached to this link
+            connect(link, SIGNAL(bytesBuffered(int)), protocol, SLOT(receiveBytes(int)));
+        } else {
+            connect(link, SIGNAL(bytesReceived(LinkInterface*, QByteArray)), protocol, SLOT(receiveBytes(LinkInterface*, QByteArray)));
+        }
         // Store the connection information in the protocol links map
         protocolLinks.insertMulti(protocol, link);
     }
@@ -145,9 +156,19 @@ void LinkManager::removeLink(QObject* link)
     }
 }
 
+void LinkManager::linkDeleted(LinkInterface* const link)
+{
+    removeLink(link);
+}
+
+/**
+ * Waits until no other thread uses a link resolved by id, once this
+ * method returns the link can be deleted safely.
+ */
 bool LinkManager::removeLink(LinkInterface* link)
 {
     if(link) {
+        QWriteLocker locker(&linkLock);
         for (int i=0; i < QList<LinkInterface*>(links).size(); i++) {
             if(link==links.at(i)) {
                 links.removeAt(i); //remove from link list
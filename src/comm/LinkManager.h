@@ -35,6 +35,7 @@ This file is part of the PIXHAWK project
 #include <QThread>
 #include <QList>
 #include <QMultiMap>
+#include <QReadWriteLock>
 #include <LinkInterface.h>
 #include <ProtocolInterface.h>
 
@@ -56,9 +57,25 @@ public:
 
     QList<LinkInterface*> getLinksForProtocol(ProtocolInterface* protocol);
 
-    /** @brief Get the link for this id */
+    /**
+     * @brief Get the link for this id
+     *
+     * Threads other than the GUI thread have to hold getLinkLock() for
+     * reading while they call this method and use the returned link.
+     */
     LinkInterface* getLinkForId(int id);
 
+    /**
+     * @brief Lock guarding the link list against the protocol thread
+     *
+     * The list is only changed in the GUI thread, which takes the lock for
+     * writing. A link is removed under this lock before it is deleted, so a
+     * reader holding it can use any link it resolved by id.
+     */
+    QReadWriteLock* getLinkLock() {
+        return &linkLock;
+    }
+
     /** @brief Get a list of all links */
     const QList<LinkInterface*> getLinks();
 
@@ -85,6 +102,11 @@ protected:
     LinkManager();
     QList<LinkInterface*> links;
     QMultiMap<ProtocolInterface*,LinkInterface*> protocolLinks;
+    QReadWriteLock linkLock;
+
+protected slots:
+    /** @brief Remove a link which is being deleted, called from its destructor */
+    void linkDeleted(LinkInterface* const link);
 
 private:
     static LinkManager* _instance;
@@ -0,0 +1,352 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of class MAVLinkLogReader
+ *
+ */
+
+#include <QDebug>
+#include <QMetaObject>
+#include <QtAlgorithms>
+#include <string.h>
+
+#include "MAVLinkLogReader.h"
+#include "MAVLinkLogWriter.h"
+#include "QGCMAVLink.h"
+
+const char MAVLinkLogReader::indexMagic[8] = {'Q', 'G', 'C', 'L', 'I', 'D', 'X', '\x01'};
+
+MAVLinkLogReader::MAVLinkLogReader(QObject* parent) :
+    QThread(parent),
+    data(NULL),
+    size(0),
+    compact(false),
+    replayProtocol(NULL),
+    replayLinkId(0),
+    replayIndex(0),
+    replayRunning(false),
+    indexing(false),
+    indexed(false)
+{
+}
+
+MAVLinkLogReader::~MAVLinkLogReader()
+{
+    close();
+}
+
+bool MAVLinkLogReader::open(const QString& fileName)
+{
+    close();
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    size = file.size();
+    if (size == 0)
+    {
+        // Nothing to map, a log without packets
+        compact = false;
+        indexed = true;
+        // Same order of events as for a log indexed in the background
+        QMetaObject::invokeMethod(this, "indexReady", Qt::QueuedConnection);
+        return true;
+    }
+    data = file.map(0, size);
+    if (data == NULL)
+    {
+        qDebug() << __FILE__ << __LINE__ << "Could not map logfile" << fileName << file.errorString();
+        file.close();
+        return false;
+    }
+
+    const int magicLen = sizeof(MAVLinkLogWriter::fileMagic);
+    compact = (size >= magicLen && memcmp(data, MAVLinkLogWriter::fileMagic, magicLen) == 0);
+
+    // Multi-GB logs take a while, the index is built in the reader thread
+    indexing = true;
+    start(QThread::LowPriority);
+    return true;
+}
+
+void MAVLinkLogReader::loadOrBuildIndex()
+{
+    const QString indexFileName = file.fileName() + ".idx";
+    if (!loadIndex(indexFileName))
+    {
+        if (!buildIndex()) return;
+        storeIndex(indexFileName);
+    }
+    indexed = true;
+    emit indexReady();
+}
+
+void MAVLinkLogReader::close()
+{
+    // Cancels the indexing, stopFastReplay() waits for the thread
+    indexing = false;
+    stopFastReplay();
+    indexed = false;
+    times.clear();
+    offsets.clear();
+    if (data)
+    {
+        file.unmap(const_cast<uchar*>(data));
+        data = NULL;
+    }
+    size = 0;
+    if (file.isOpen()) file.close();
+}
+
+bool MAVLinkLogReader::buildIndex()
+{
+    const int timeLen = MAVLinkLogWriter::timeLen;
+    const int lengthLen = MAVLinkLogWriter::lengthLen;
+
+    times.clear();
+    offsets.clear();
+
+    if (compact)
+    {
+        qint64 pos = sizeof(MAVLinkLogWriter::fileMagic);
+        // Reserve for the typical packet mix, avoids most reallocations
+        times.reserve(size / 40);
+        offsets.reserve(size / 40);
+        int lastPercent = 0;
+        while (pos + timeLen + lengthLen <= size)
+        {
+            if ((times.size() & 0xFFFF) == 0)
+            {
+                if (!indexing) return false;
+                const int percent = pos * 100 / size;
+                if (percent != lastPercent) emit indexProgress(percent);
+                lastPercent = percent;
+            }
+            quint64 time;
+            quint16 length;
+            memcpy(&time, data+pos, timeLen);
+            memcpy(&length, data+pos+timeLen, lengthLen);
+            // Ignore a truncated last record
+            if (pos + timeLen + lengthLen + length > size) break;
+            times.append(time);
+            offsets.append(pos);
+            pos += timeLen + lengthLen + length;
+        }
+    }
+    else
+    {
+        const int recordLen = timeLen + MAVLINK_MAX_PACKET_LEN;
+        const int count = size / recordLen;
+        times.resize(count);
+        offsets.resize(count);
+        for (int i = 0; i < count; ++i)
+        {
+            if ((i & 0xFFFF) == 0)
+            {
+                if (!indexing) return false;
+                emit indexProgress(static_cast<qint64>(i) * 100 / count);
+            }
+            offsets[i] = static_cast<qint64>(i) * recordLen;
+            memcpy(&times[i], data+offsets[i], timeLen);
+        }
+    }
+    return true;
+}
+
+bool MAVLinkLogReader::loadIndex(const QString& indexFileName)
+{
+    QFile indexFile(indexFileName);
+    if (!indexFile.open(QIODevice::ReadOnly)) return false;
+
+    char magic[sizeof(indexMagic)];
+    qint64 logSize;
+    qint32 count;
+    if (indexFile.read(magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, indexMagic, sizeof(magic)) != 0) return false;
+    if (indexFile.read(reinterpret_cast<char*>(&logSize), sizeof(logSize)) != sizeof(logSize) || logSize != size) return false;
+    if (indexFile.read(reinterpret_cast<char*>(&count), sizeof(count)) != sizeof(count) || count < 0) return false;
+
+    times.resize(count);
+    offsets.resize(count);
+    const qint64 timesLen = count * static_cast<qint64>(sizeof(quint64));
+    const qint64 offsetsLen = count * static_cast<qint64>(sizeof(qint64));
+    if (indexFile.read(reinterpret_cast<char*>(times.data()), timesLen) != timesLen ||
+        indexFile.read(reinterpret_cast<char*>(offsets.data()), offsetsLen) != offsetsLen ||
+        !validateIndex())
+    {
+        // Rebuilt from the log by the caller
+        times.clear();
+        offsets.clear();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * A stale or corrupted index file can carry the right log size, getPacket()
+ * relies on each record being complete, so every offset is checked once.
+ */
+bool MAVLinkLogReader::validateIndex() const
+{
+    const int timeLen = MAVLinkLogWriter::timeLen;
+    const int lengthLen = MAVLinkLogWriter::lengthLen;
+    const int recordLen = timeLen + MAVLINK_MAX_PACKET_LEN;
+
+    // Records do not overlap, each starts behind the end of the previous one
+    qint64 end = compact ? sizeof(MAVLinkLogWriter::fileMagic) : 0;
+    for (int i = 0; i < offsets.size(); ++i)
+    {
+        const qint64 offset = offsets.at(i);
+        if (offset < end) return false;
+        if (compact)
+        {
+            if (offset + timeLen + lengthLen > size) return false;
+            quint16 length;
+            memcpy(&length, data+offset+timeLen, lengthLen);
+            end = offset + timeLen + lengthLen + length;
+        }
+        else
+        {
+            end = offset + recordLen;
+        }
+        if (end > size) return false;
+    }
+    return true;
+}
+
+void MAVLinkLogReader::storeIndex(const QString& indexFileName)
+{
+    // The index is only a cache, failing to write it is not an error
+    QFile indexFile(indexFileName);
+    if (!indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+
+    qint64 logSize = size;
+    qint32 count = times.size();
+    indexFile.write(indexMagic, sizeof(indexMagic));
+    indexFile.write(reinterpret_cast<const char*>(&logSize), sizeof(logSize));
+    indexFile.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    indexFile.write(reinterpret_cast<const char*>(times.constData()), count * sizeof(quint64));
+    indexFile.write(reinterpret_cast<const char*>(offsets.constData()), count * sizeof(qint64));
+}
+
+int MAVLinkLogReader::getIndexForTime(quint64 time) const
+{
+    // Timestamps are monotonic within a log
+    return qLowerBound(times.constBegin(), times.constEnd(), time) - times.constBegin();
+}
+
+const char* MAVLinkLogReader::getPacket(int index, int* length) const
+{
+    const int timeLen = MAVLinkLogWriter::timeLen;
+    const uchar* record = data + offsets.at(index);
+
+    if (compact)
+    {
+        quint16 packetLen;
+        memcpy(&packetLen, record+timeLen, MAVLinkLogWriter::lengthLen);
+        *length = packetLen;
+        return reinterpret_cast<const char*>(record+timeLen+MAVLinkLogWriter::lengthLen);
+    }
+    else
+    {
+        // Fixed-size records are padded, only hand out the packet itself
+        const uchar* packet = record+timeLen;
+        if (packet[0] == MAVLINK_STX)
+        {
+            *length = qMin(packet[1] + MAVLINK_NUM_NON_PAYLOAD_BYTES, MAVLINK_MAX_PACKET_LEN);
+        }
+        else
+        {
+            *length = MAVLINK_MAX_PACKET_LEN;
+        }
+        return reinterpret_cast<const char*>(packet);
+    }
+}
+
+int MAVLinkLogReader::appendPackets(int from, int to, QByteArray* buffer) const
+{
+    int total = 0;
+    for (int i = from; i < to && i < times.size(); ++i)
+    {
+        int length;
+        const char* packet = getPacket(i, &length);
+        buffer->append(packet, length);
+        total += length;
+    }
+    return total;
+}
+
+void MAVLinkLogReader::startFastReplay(ProtocolInterface* protocol, int linkId, int fromIndex)
+{
+    stopFastReplay();
+    if (!isIndexed() || !protocol) return;
+    replayProtocol = protocol;
+    replayLinkId = linkId;
+    replayIndex = fromIndex;
+    replayRunning = true;
+    start();
+}
+
+void MAVLinkLogReader::stopFastReplay()
+{
+    replayRunning = false;
+    wait();
+}
+
+/**
+ * Builds the index after opening, afterwards pushes the fast replay.
+ * Each batch is handed over with a blocking call, so the reader never
+ * gets ahead of the protocol by more than one batch.
+ */
+void MAVLinkLogReader::run()
+{
+    if (indexing)
+    {
+        loadOrBuildIndex();
+        indexing = false;
+        return;
+    }
+
+    const int count = times.size();
+    int index = replayIndex;
+
+    while (replayRunning && index < count)
+    {
+        QByteArray batch;
+        batch.reserve(batchSize + MAVLINK_MAX_PACKET_LEN);
+        while (index < count && batch.size() < batchSize)
+        {
+            appendPackets(index, index+1, &batch);
+            index++;
+        }
+        QMetaObject::invokeMethod(replayProtocol, "receiveBytes", Qt::BlockingQueuedConnection,
+                                  Q_ARG(int, replayLinkId), Q_ARG(QByteArray, batch));
+        emit fastReplayProgress(index);
+    }
+
+    replayIndex = index;
+    if (index >= count) emit fastReplayFinished();
+}
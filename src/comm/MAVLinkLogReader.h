@@ -0,0 +1,170 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Definition of class MAVLinkLogReader
+ *
+ */
+
+#ifndef MAVLINKLOGREADER_H
+#define MAVLINKLOGREADER_H
+
+#include <QThread>
+#include <QFile>
+#include <QVector>
+#include <QByteArray>
+#include <QString>
+#include "LinkInterface.h"
+#include "ProtocolInterface.h"
+
+/**
+ * @brief Random access to MAVLink packet logs
+ *
+ * The logfile is memory-mapped and a timestamp / offset index of all
+ * records is built on opening, so any packet or point in time can be
+ * reached without reading the file up to it. The index is loaded or
+ * built in the thread of the reader, indexReady() is emitted once it can
+ * be used. The index is stored next to the log as sidecar file (logfile
+ * name + ".idx") and reused as long as the log did not change. An empty
+ * logfile is a valid log without packets.
+ *
+ * Both the compact format written by MAVLinkLogWriter and the old
+ * fixed-size record format are supported.
+ *
+ * The reader can also push the log into a protocol as fast as the
+ * protocol is able to parse it, in batches of packets and without any
+ * timer involved. This runs in the thread of the reader.
+ */
+class MAVLinkLogReader : public QThread
+{
+    Q_OBJECT
+public:
+    MAVLinkLogReader(QObject* parent = 0);
+    ~MAVLinkLogReader();
+
+    /** @brief Map the logfile and start loading or building its index in the background */
+    bool open(const QString& fileName);
+    /** @brief Stop indexing or replay and unmap the logfile */
+    void close();
+    bool isOpen() const {
+        return file.isOpen();
+    }
+    /**
+     * @brief Check if the index is complete
+     *
+     * None of the packet and time accessors may be used before.
+     */
+    bool isIndexed() const {
+        return indexed;
+    }
+    /** @brief Check if the log uses the compact record format */
+    bool isCompact() const {
+        return compact;
+    }
+
+    /** @brief Number of packets in the log */
+    int getPacketCount() const {
+        return times.size();
+    }
+    /** @brief Timestamp of the first packet in microseconds */
+    quint64 getStartTime() const {
+        return times.isEmpty() ? 0 : times.first();
+    }
+    /** @brief Timestamp of the last packet in microseconds */
+    quint64 getEndTime() const {
+        return times.isEmpty() ? 0 : times.last();
+    }
+    /** @brief Timestamp of one packet in microseconds */
+    quint64 getTime(int index) const {
+        return times.at(index);
+    }
+    /** @brief Index of the first packet logged at or after this time */
+    int getIndexForTime(quint64 time) const;
+
+    /**
+     * @brief Direct access to one packet inside the mapped file
+     *
+     * @param index The index of the packet
+     * @param length Set to the length of the packet
+     * @return Pointer to the packet, valid until the log is closed
+     */
+    const char* getPacket(int index, int* length) const;
+    /** @brief Append the packets [from, to) to a buffer, returns the number of bytes appended */
+    int appendPackets(int from, int to, QByteArray* buffer) const;
+
+    /** @brief Push the log starting at this packet into the protocol as fast as possible */
+    void startFastReplay(ProtocolInterface* protocol, int linkId, int fromIndex);
+    /** @brief Stop the fast replay, returns once the reader thread has stopped */
+    void stopFastReplay();
+    /** @brief Check if the fast replay is pushing packets, false while indexing */
+    bool isFastReplayRunning() const {
+        return replayRunning && isRunning();
+    }
+    /** @brief Index of the next packet the fast replay would have pushed */
+    int getFastReplayIndex() const {
+        return replayIndex;
+    }
+
+    /** @brief Identifies index sidecar files */
+    static const char indexMagic[8];
+
+signals:
+    /** @brief Emitted once the index of the opened log is complete */
+    void indexReady();
+    /** @brief Emitted regularly while building the index, in percent of the file */
+    void indexProgress(int percent);
+    /** @brief Emitted regularly during the fast replay with the next packet to replay */
+    void fastReplayProgress(int index);
+    /** @brief Emitted once the fast replay reached the end of the log */
+    void fastReplayFinished();
+
+protected:
+    void run();
+    /** @brief Load the sidecar index or build and store it, runs in the reader thread */
+    void loadOrBuildIndex();
+    /** @brief Scan the mapped file and record time and offset of each packet, returns false if cancelled */
+    bool buildIndex();
+    bool loadIndex(const QString& indexFileName);
+    /** @brief Check that every indexed record lies within the log, in file order */
+    bool validateIndex() const;
+    void storeIndex(const QString& indexFileName);
+
+    static const int batchSize = 1 << 16;  ///< Bytes handed to the protocol at once during fast replay
+
+    QFile file;
+    const uchar* data;        ///< Mapped logfile
+    qint64 size;              ///< Size of the mapped logfile
+    bool compact;             ///< Compact or fixed-size records
+    QVector<quint64> times;   ///< Timestamp of each packet
+    QVector<qint64> offsets;  ///< File offset of each record
+
+    ProtocolInterface* replayProtocol;
+    int replayLinkId;         ///< Link the replayed packets are attributed to
+    int replayIndex;
+    volatile bool replayRunning;
+    volatile bool indexing;   ///< The thread builds the index, cleared to cancel
+    volatile bool indexed;    ///< The index is complete
+};
+
+#endif // MAVLINKLOGREADER_H
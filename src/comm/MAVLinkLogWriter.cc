@@ -0,0 +1,200 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of class MAVLinkLogWriter
+ *
+ */
+
+#include <QTime>
+#include <QDebug>
+#include <string.h>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "MAVLinkLogWriter.h"
+
+const char MAVLinkLogWriter::fileMagic[8] = {'Q', 'G', 'C', 'M', 'A', 'V', 'L', '\x02'};
+
+MAVLinkLogWriter::MAVLinkLogWriter(QObject* parent) :
+    QThread(parent),
+    compact(true),
+    running(false),
+    syncInterval(0),
+    droppedRecords(0)
+{
+}
+
+MAVLinkLogWriter::~MAVLinkLogWriter()
+{
+    close();
+}
+
+bool MAVLinkLogWriter::open(const QString& fileName)
+{
+    close();
+    file.setFileName(fileName);
+
+    // Continue existing logs in the format they were started with
+    compact = true;
+    if (file.exists() && file.size() > 0)
+    {
+        if (file.open(QIODevice::ReadOnly))
+        {
+            compact = (file.read(sizeof(fileMagic)) == QByteArray(fileMagic, sizeof(fileMagic)));
+            file.close();
+        }
+    }
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        return false;
+    }
+    if (compact && file.size() == 0)
+    {
+        file.write(fileMagic, sizeof(fileMagic));
+    }
+
+    droppedRecords.fetchAndStoreRelaxed(0);
+    running = true;
+    start(QThread::LowPriority);
+    return true;
+}
+
+void MAVLinkLogWriter::close()
+{
+    if (isRunning())
+    {
+        running = false;
+        wakeMutex.lock();
+        wakeCondition.wakeOne();
+        wakeMutex.unlock();
+        wait();
+    }
+    running = false;
+
+    if (file.isOpen())
+    {
+        // The writer thread is gone, this thread is the only consumer now
+        writePending();
+        syncToDisk();
+        file.close();
+    }
+}
+
+bool MAVLinkLogWriter::logMessage(quint64 time, const mavlink_message_t& message)
+{
+    uint8_t buf[timeLen+lengthLen+MAVLINK_MAX_PACKET_LEN];
+    int len;
+
+    memcpy(buf, &time, timeLen);
+    if (compact)
+    {
+        // Store only the bytes actually used by the packet
+        quint16 packetLen = mavlink_msg_to_send_buffer(buf+timeLen+lengthLen, &message);
+        memcpy(buf+timeLen, &packetLen, lengthLen);
+        len = timeLen+lengthLen+packetLen;
+    }
+    else
+    {
+        memset(buf+timeLen, 0, MAVLINK_MAX_PACKET_LEN);
+        mavlink_msg_to_send_buffer(buf+timeLen, &message);
+        len = timeLen+MAVLINK_MAX_PACKET_LEN;
+    }
+
+    // Never write partial records
+    if (queue.space() < len)
+    {
+        droppedRecords.fetchAndAddRelaxed(1);
+        return false;
+    }
+    queue.write(reinterpret_cast<const char*>(buf), len);
+
+    // Only wake the writer early if a full block is waiting,
+    // otherwise it picks the records up after flushInterval
+    if (queue.size() >= blockSize)
+    {
+        wakeCondition.wakeOne();
+    }
+    return true;
+}
+
+void MAVLinkLogWriter::run()
+{
+    QTime lastSync;
+    lastSync.start();
+
+    while (running)
+    {
+        wakeMutex.lock();
+        if (running && queue.size() < blockSize)
+        {
+            wakeCondition.wait(&wakeMutex, flushInterval);
+        }
+        wakeMutex.unlock();
+
+        if (!writePending())
+        {
+            qDebug() << __FILE__ << __LINE__ << "Writing to MAVLink logfile failed:" << file.errorString();
+            running = false;
+            emit writeFailed(file.fileName());
+            return;
+        }
+
+        if (syncInterval > 0 && lastSync.elapsed() >= syncInterval)
+        {
+            syncToDisk();
+            lastSync.restart();
+        }
+    }
+}
+
+bool MAVLinkLogWriter::writePending()
+{
+    char block[blockSize];
+    int length;
+    while ((length = queue.read(block, blockSize)) > 0)
+    {
+        if (file.write(block, length) < length)
+        {
+            return false;
+        }
+    }
+    return file.flush();
+}
+
+void MAVLinkLogWriter::syncToDisk()
+{
+    if (!file.isOpen()) return;
+    file.flush();
+#ifdef Q_OS_WIN
+    _commit(file.handle());
+#else
+    fsync(file.handle());
+#endif
+}
@@ -0,0 +1,129 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Definition of class MAVLinkLogWriter
+ *
+ */
+
+#ifndef MAVLINKLOGWRITER_H
+#define MAVLINKLOGWRITER_H
+
+#include <QThread>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QString>
+#include "LinkBuffer.h"
+#include "QGCMAVLink.h"
+
+/**
+ * @brief Background writer for binary MAVLink packet logs
+ *
+ * The protocol thread only serializes each packet into a lock-free ring,
+ * the writer thread drains the ring in large blocks to disk. A slow disk
+ * therefore never stalls packet intake, records are dropped instead if
+ * the writer falls behind by more than the ring size.
+ *
+ * New logs use the compact format: the file starts with the 8 byte
+ * fileMagic, followed by one record per packet:
+ *
+ * - quint64 ground time in microseconds (host byte order)
+ * - quint16 packet length (host byte order)
+ * - the packet exactly as sent on the wire
+ *
+ * Files which already contain a log in the old fixed-size format (time
+ * followed by MAVLINK_MAX_PACKET_LEN bytes) are continued in that format.
+ */
+class MAVLinkLogWriter : public QThread
+{
+    Q_OBJECT
+public:
+    MAVLinkLogWriter(QObject* parent = 0);
+    ~MAVLinkLogWriter();
+
+    /** @brief Open a logfile for appending and start the writer thread */
+    bool open(const QString& fileName);
+    /** @brief Flush all pending records and close the logfile */
+    void close();
+    /** @brief Check if a logfile is open */
+    bool isOpen() const {
+        return running;
+    }
+    /** @brief Check if the compact record format is written */
+    bool isCompact() const {
+        return compact;
+    }
+
+    /**
+     * @brief Queue one packet for logging, never blocks
+     *
+     * Has to be called from one thread only (the protocol thread).
+     * @return false if the record was dropped because the writer fell behind
+     */
+    bool logMessage(quint64 time, const mavlink_message_t& message);
+
+    /** @brief Set the interval in milliseconds to sync the logfile to disk, 0 to never sync */
+    void setSyncInterval(int ms) {
+        syncInterval = ms;
+    }
+    int getSyncInterval() const {
+        return syncInterval;
+    }
+    /** @brief Number of records dropped since the logfile was opened */
+    int getDroppedRecords() const {
+        return const_cast<QAtomicInt&>(droppedRecords).fetchAndAddRelaxed(0);
+    }
+
+    /** @brief Identifies logfiles in the compact format */
+    static const char fileMagic[8];
+    static const int timeLen = sizeof(quint64);
+    static const int lengthLen = sizeof(quint16);
+
+signals:
+    /** @brief Writing to the logfile failed, logging stopped */
+    void writeFailed(const QString& fileName);
+
+protected:
+    void run();
+    /** @brief Write all queued records, returns false on write errors */
+    bool writePending();
+    void syncToDisk();
+
+    static const int queueSize = 1 << 20;  ///< Queue capacity in bytes, absorbs disk stalls
+    static const int blockSize = 1 << 16;  ///< Bytes written to disk per write call
+    static const int flushInterval = 100;  ///< Maximum time in milliseconds records wait in the queue
+
+    QFile file;
+    LinkBuffer<queueSize> queue;  ///< Serialized records, filled by the protocol thread
+    bool compact;                 ///< Write the compact record format
+    volatile bool running;        ///< Writer thread should keep running
+    int syncInterval;             ///< Interval to sync to disk, 0 if disabled
+    QAtomicInt droppedRecords;    ///< Records dropped since opening
+    QMutex wakeMutex;
+    QWaitCondition wakeCondition; ///< Wakes the writer early if the queue fills up
+};
+
+#endif // MAVLINKLOGWRITER_H
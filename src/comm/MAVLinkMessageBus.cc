@@ -0,0 +1,134 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of class MAVLinkMessageBus
+ *
+ */
+
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QDebug>
+#include <string.h>
+
+#include "MAVLinkMessageBus.h"
+
+MAVLinkMessageBus::MAVLinkMessageBus(QObject* parent) :
+    QObject(parent)
+{
+    qRegisterMetaType<MAVLinkMessagePtr>("MAVLinkMessagePtr");
+    // Queued from the link threads by bytesReceived(), e.g. to the debug console
+    qRegisterMetaType<LinkInterface*>("LinkInterface*");
+}
+
+void MAVLinkMessageBus::subscribe(QObject* receiver, const char* member, int systemId)
+{
+    quint32 mask[8];
+    memset(mask, 0xFF, sizeof(mask));
+    addSubscription(receiver, member, mask, systemId);
+}
+
+void MAVLinkMessageBus::subscribe(QObject* receiver, const char* member, const QList<int>& messageIds, int systemId)
+{
+    quint32 mask[8];
+    memset(mask, 0, sizeof(mask));
+    foreach (int msgid, messageIds)
+    {
+        if (msgid >= 0 && msgid < 256) mask[msgid >> 5] |= (1u << (msgid & 31));
+    }
+    addSubscription(receiver, member, mask, systemId);
+}
+
+void MAVLinkMessageBus::addSubscription(QObject* receiver, const char* member, const quint32* mask, int systemId)
+{
+    if (!receiver || !member) return;
+
+    // Skip the code prepended by the SLOT() macro
+    const QByteArray signature = QMetaObject::normalizedSignature(member + 1);
+    const int methodIndex = receiver->metaObject()->indexOfMethod(signature.constData());
+    if (methodIndex < 0)
+    {
+        qDebug() << __FILE__ << __LINE__ << "No such slot" << signature << "on" << receiver->metaObject()->className();
+        return;
+    }
+
+    Subscription subscription;
+    subscription.receiver = receiver;
+    subscription.method = receiver->metaObject()->method(methodIndex);
+    subscription.systemId = systemId;
+    memcpy(subscription.mask, mask, sizeof(subscription.mask));
+
+    QWriteLocker locker(&subscriptionLock);
+    subscriptions.append(subscription);
+    // Fallback for receivers which do not unsubscribe themselves. Direct
+    // connection: the subscription has to be gone before the receiver is,
+    // independent of the thread the bus and the receiver live in
+    connect(receiver, SIGNAL(destroyed(QObject*)), this, SLOT(receiverDestroyed(QObject*)), Qt::DirectConnection);
+}
+
+void MAVLinkMessageBus::unsubscribe(QObject* receiver)
+{
+    QWriteLocker locker(&subscriptionLock);
+    for (int i = subscriptions.size() - 1; i >= 0; --i)
+    {
+        if (subscriptions.at(i).receiver == receiver) subscriptions.removeAt(i);
+    }
+    disconnect(receiver, SIGNAL(destroyed(QObject*)), this, SLOT(receiverDestroyed(QObject*)));
+}
+
+void MAVLinkMessageBus::receiverDestroyed(QObject* receiver)
+{
+    QWriteLocker locker(&subscriptionLock);
+    for (int i = subscriptions.size() - 1; i >= 0; --i)
+    {
+        if (subscriptions.at(i).receiver == receiver) subscriptions.removeAt(i);
+    }
+}
+
+bool MAVLinkMessageBus::hasSubscribers(int systemId, int messageId)
+{
+    QReadLocker locker(&subscriptionLock);
+    foreach (const Subscription& subscription, subscriptions)
+    {
+        if (subscription.matches(systemId, messageId)) return true;
+    }
+    return false;
+}
+
+/**
+ * Subscribers living in other threads get a queued call, which only
+ * copies the shared pointer, subscribers in the publishing thread are
+ * called directly.
+ */
+void MAVLinkMessageBus::publish(int linkId, const MAVLinkMessagePtr& message)
+{
+    QReadLocker locker(&subscriptionLock);
+    foreach (const Subscription& subscription, subscriptions)
+    {
+        if (subscription.matches(message->sysid, message->msgid))
+        {
+            subscription.method.invoke(subscription.receiver, Qt::AutoConnection, Q_ARG(int, linkId), Q_ARG(MAVLinkMessagePtr, message));
+        }
+    }
+}
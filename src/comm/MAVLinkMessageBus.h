@@ -0,0 +1,121 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Definition of class MAVLinkMessageBus
+ *
+ */
+
+#ifndef MAVLINKMESSAGEBUS_H
+#define MAVLINKMESSAGEBUS_H
+
+#include <QObject>
+#include <QList>
+#include <QByteArray>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QMetaType>
+#include <QMetaMethod>
+#include "LinkInterface.h"
+#include "QGCMAVLink.h"
+
+/** @brief Parsed message shared read-only between all subscribers */
+typedef QSharedPointer<const mavlink_message_t> MAVLinkMessagePtr;
+Q_DECLARE_METATYPE(MAVLinkMessagePtr)
+
+/**
+ * @brief Fan-out of parsed MAVLink messages to their consumers
+ *
+ * The protocol thread publishes every parsed message exactly once. Each
+ * subscriber is invoked in its own thread with a reference to the same
+ * message, the message itself is never copied. Subscribers can restrict
+ * delivery to a set of message ids and to a single system, so they only
+ * get woken up for messages they actually handle.
+ *
+ * The subscribed slot has to have the signature (int, MAVLinkMessagePtr).
+ * The link a message was received on is passed by its id, since it may be
+ * deleted while the call is queued. Subscribers which need the link look
+ * it up with LinkManager::getLinkForId() in the GUI thread.
+ */
+class MAVLinkMessageBus : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MAVLinkMessageBus(QObject* parent = 0);
+
+    /**
+     * @brief Subscribe a slot to all message ids
+     *
+     * @param receiver The object to deliver the messages to
+     * @param member The slot, as returned by the SLOT() macro
+     * @param systemId Only deliver messages from this system, -1 for all systems
+     */
+    void subscribe(QObject* receiver, const char* member, int systemId = -1);
+    /**
+     * @brief Subscribe a slot to a set of message ids
+     *
+     * @param receiver The object to deliver the messages to
+     * @param member The slot, as returned by the SLOT() macro
+     * @param messageIds The message ids to deliver
+     * @param systemId Only deliver messages from this system, -1 for all systems
+     */
+    void subscribe(QObject* receiver, const char* member, const QList<int>& messageIds, int systemId = -1);
+    /**
+     * @brief Remove all subscriptions of this receiver
+     *
+     * Receivers have to call this in their destructor, the bus only notices
+     * destroyed() once the derived parts of the receiver are gone already.
+     */
+    void unsubscribe(QObject* receiver);
+
+    /** @brief Hand a message to all matching subscribers, callable from any thread */
+    void publish(int linkId, const MAVLinkMessagePtr& message);
+
+    /** @brief Check if anyone is subscribed to this message, callable from any thread */
+    bool hasSubscribers(int systemId, int messageId);
+
+protected slots:
+    void receiverDestroyed(QObject* receiver);
+
+protected:
+    struct Subscription
+    {
+        QObject* receiver;
+        QMetaMethod method;  ///< Resolved once, publish() never calls into the receiver
+        int systemId;
+        quint32 mask[8];  ///< One bit per message id
+
+        bool matches(int sysid, int msgid) const
+        {
+            return (systemId == -1 || systemId == sysid) && (mask[msgid >> 5] & (1u << (msgid & 31)));
+        }
+    };
+
+    void addSubscription(QObject* receiver, const char* member, const quint32* mask, int systemId);
+
+    QList<Subscription> subscriptions;
+    QReadWriteLock subscriptionLock; ///< Protects subscriptions, publish() only takes the read lock
+};
+
+#endif // MAVLINKMESSAGEBUS_H
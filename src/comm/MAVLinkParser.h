@@ -0,0 +1,106 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Definition of class MAVLinkParser
+ *
+ */
+
+#ifndef MAVLINKPARSER_H
+#define MAVLINKPARSER_H
+
+#include <QtGlobal>
+#include "QGCMAVLink.h"
+
+/**
+ * @brief MAVLink packet parser for one byte stream
+ *
+ * Unlike mavlink_parse_char(), which keeps the state of a fixed number of
+ * channels in static arrays, each parser object holds the state of exactly
+ * one stream, so any number of links can be parsed at the same time.
+ *
+ * Whole buffers are parsed at once: the start byte is searched with
+ * memchr(), the payload is copied in one piece and the checksum is
+ * computed with a lookup table once the packet is complete.
+ */
+class MAVLinkParser
+{
+public:
+    MAVLinkParser();
+
+    /** @brief Drop any partially parsed packet */
+    void reset();
+
+    /**
+     * @brief Parse bytes until the next complete packet or the end of the data
+     *
+     * @param data The bytes to parse
+     * @param length The number of bytes to parse
+     * @param consumed Set to the number of bytes used, parsing continues after them
+     * @return The complete message, valid until the next call, NULL if all bytes were used without completing one
+     */
+    const mavlink_message_t* parse(const uint8_t* data, int length, int* consumed);
+
+    /** @brief Parse one byte, returns true and copies the message once it is complete */
+    bool parseChar(uint8_t c, mavlink_message_t* message);
+
+    /** @brief Number of successfully parsed packets */
+    quint32 getReceivedCount() const {
+        return received;
+    }
+    /** @brief Number of checksum and length errors */
+    quint32 getErrorCount() const {
+        return errors;
+    }
+
+    /** @brief Continue an X.25 checksum over a buffer */
+    static uint16_t crcAccumulate(const uint8_t* data, int length, uint16_t crc);
+    /** @brief X.25 checksum of a buffer, the same as crc_calculate() */
+    static uint16_t crcCalculate(const uint8_t* data, int length) {
+        return crcAccumulate(data, length, X25_INIT_CRC);
+    }
+
+protected:
+    enum State {
+        StateIdle,     ///< Searching the start byte
+        StateHeader,   ///< Reading length, sequence, system, component and message id
+        StatePayload,
+        StateCrc1,
+        StateCrc2
+    };
+
+    static const int headerLen = 5;  ///< Header bytes after the start byte
+    static const uint16_t crcTable[256];
+
+    /** @brief Restart after a checksum error, the failed byte may start the next packet */
+    void checksumFailed(uint8_t c);
+
+    mavlink_message_t rxmsg;  ///< Packet being parsed
+    State state;
+    int index;                ///< Position within the header or payload
+    quint32 received;
+    quint32 errors;
+};
+
+#endif // MAVLINKPARSER_H
@@ -34,44 +34,52 @@
 
 /**
  * The default constructor will create a new MAVLink object sending heartbeats at
- * the MAVLINK_HEARTBEAT_DEFAULT_RATE to all connected links.
+ * the MAVLINK_HEARTBEAT_DEFAULT_RATE to all connected links. The object moves
+ * itself to a dedicated protocol thread, it must not have a parent. It has to
+ * be created in the GUI thread, which owns the links and writes all messages.
  */
 MAVLinkProtocol::MAVLinkProtocol() :
+    protocolThread(new QThread()),
+    messageBus(new MAVLinkMessageBus(this)),
+    uasFactory(new QGCMAVLinkUASFactory(this)),
+    sender(new MAVLinkSender(this)),
     heartbeatTimer(new QTimer(this)),
     heartbeatRate(MAVLINK_HEARTBEAT_DEFAULT_RATE),
     m_heartbeatsEnabled(false),
     m_multiplexingEnabled(false),
     m_authEnabled(false),
     m_loggingEnabled(false),
-    m_logfile(NULL),
+    m_logWriter(new MAVLinkLogWriter(this)),
     m_enable_version_check(true),
     m_paramRetransmissionTimeout(350),
     m_paramRewriteTimeout(500),
     m_paramGuardEnabled(true),
     m_actionGuardEnabled(false),
     m_actionRetransmissionTimeout(100),
+    receiveMutex(QMutex::Recursive),
     versionMismatchIgnore(false),
     systemId(QGC::defaultSystemId)
 {
     m_authKey = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx";
+    connect(m_logWriter, SIGNAL(writeFailed(QString)), this, SLOT(logWriteFailed(QString)));
+    connect(uasFactory, SIGNAL(uasCreationFailed(int)), this, SLOT(uasCreationFailed(int)), Qt::QueuedConnection);
     loadSettings();
     //start(QThread::LowPriority);
     // Start heartbeat timer, emitting a heartbeat at the configured rate
     connect(heartbeatTimer, SIGNAL(timeout()), this, SLOT(sendHeartbeat()));
     heartbeatTimer->start(1000/heartbeatRate);
-    totalReceiveCounter = 0;
-    totalLossCounter = 0;
-    currReceiveCounter = 0;
-    currLossCounter = 0;
     for (int i = 0; i < 256; i++)
     {
-        for (int j = 0; j < 256; j++)
-        {
-            lastIndex[i][j] = -1;
-        }
+        uasPending[i] = false;
+        lastLossUpdate[i] = 0;
     }
 
     emit versionCheckChanged(m_enable_version_check);
+
+    // Parse in the protocol thread from now on, the heartbeat
+    // timer moves along as child of this object
+    moveToThread(protocolThread);
+    protocolThread->start(QThread::HighPriority);
 }
 
 void MAVLinkProtocol::loadSettings()
@@ -85,14 +93,15 @@ void MAVLinkProtocol::loadSettings()
     enableMultiplexing(settings.value("MULTIPLEXING_ENABLED", m_multiplexingEnabled).toBool());
 
     // Only set logfile if there is a name present in settings
-    if (settings.contains("LOGFILE_NAME") && m_logfile == NULL)
+    if (settings.contains("LOGFILE_NAME") && m_logfileName.isEmpty())
     {
-        m_logfile = new QFile(settings.value("LOGFILE_NAME").toString());
+        m_logfileName = settings.value("LOGFILE_NAME").toString();
     }
-    else if (m_logfile == NULL)
+    else if (m_logfileName.isEmpty())
     {
-        m_logfile = new QFile(QDesktopServices::storageLocation(QDesktopServices::HomeLocation) + "/qgroundcontrol_packetlog.mavlink");
+        m_logfileName = QDesktopServices::storageLocation(QDesktopServices::HomeLocation) + "/qgroundcontrol_packetlog.mavlink";
     }
+    m_logWriter->setSyncInterval(settings.value("LOGFILE_SYNC_INTERVAL", m_logWriter->getSyncInterval()).toInt());
     // Enable logging
     enableLogging(settings.value("LOGGING_ENABLED", m_loggingEnabled).toBool());
 
@@ -129,11 +138,12 @@ void MAVLinkProtocol::storeSettings()
     settings.setValue("GCS_SYSTEM_ID", systemId);
     settings.setValue("GCS_AUTH_KEY", m_authKey);
     settings.setValue("GCS_AUTH_ENABLED", m_authEnabled);
-    if (m_logfile)
+    if (!m_logfileName.isEmpty())
     {
         // Logfile exists, store the name
-        settings.setValue("LOGFILE_NAME", m_logfile->fileName());
+        settings.setValue("LOGFILE_NAME", m_logfileName);
     }
+    settings.setValue("LOGFILE_SYNC_INTERVAL", m_logWriter->getSyncInterval());
     // Parameter interface settings
     settings.setValue("PARAMETER_RETRANSMISSION_TIMEOUT", m_paramRetransmissionTimeout);
     settings.setValue("PARAMETER_REWRITE_TIMEOUT", m_paramRewriteTimeout);
@@ -145,24 +155,25 @@ void MAVLinkProtocol::storeSettings()
 
 MAVLinkProtocol::~MAVLinkProtocol()
 {
+    // Stop the protocol thread, the timer has to be stopped in its own thread
+    QMetaObject::invokeMethod(heartbeatTimer, "stop", Qt::BlockingQueuedConnection);
+    protocolThread->quit();
+    protocolThread->wait();
+    delete protocolThread;
+    delete uasFactory;
+    delete sender;
+
     storeSettings();
-    if (m_logfile)
-    {
-        if (m_logfile->isOpen())
-        {
-            m_logfile->flush();
-            m_logfile->close();
-        }
-        delete m_logfile;
-        m_logfile = NULL;
-    }
+    QMutexLocker locker(&receiveMutex);
+    // Flushes all queued packets to disk
+    m_logWriter->close();
 }
 
 QString MAVLinkProtocol::getLogfileName()
 {
-    if (m_logfile)
+    if (!m_logfileName.isEmpty())
     {
-        return m_logfile->fileName();
+        return m_logfileName;
     }
     else
     {
@@ -179,16 +190,69 @@ QString MAVLinkProtocol::getLogfileName()
  * @see LinkInterface
  **/
 void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
+{
+    parseBytes(link, link->getId(), reinterpret_cast<const uint8_t*>(b.constData()), b.size());
+}
+
+/**
+ * Used by the log player, which queues the bytes of its replay link. The
+ * bytes are dropped if the link was removed in the meantime.
+ * @param linkId The id of the interface the bytes belong to
+ **/
+void MAVLinkProtocol::receiveBytes(int linkId, QByteArray b)
+{
+    QReadLocker locker(LinkManager::instance()->getLinkLock());
+    LinkInterface* link = LinkManager::instance()->getLinkForId(linkId);
+    if (!link) return;
+    parseBytes(link, linkId, reinterpret_cast<const uint8_t*>(b.constData()), b.size());
+}
+
+/**
+ * Called once per burst of received data. The whole receive buffer of the
+ * link is drained in chunks into a local buffer, no heap memory is touched.
+ * The link list stays locked meanwhile, a removed link is not drained anymore.
+ * @param linkId The id of the interface to read from
+ * @see LinkInterface::readBufferedBytes()
+ **/
+void MAVLinkProtocol::receiveBytes(int linkId)
+{
+    QReadLocker locker(LinkManager::instance()->getLinkLock());
+    LinkInterface* link = LinkManager::instance()->getLinkForId(linkId);
+    if (!link) return;
+
+    uint8_t buffer[4096];
+    qint64 length;
+    while ((length = link->readBufferedBytes(reinterpret_cast<char*>(buffer), sizeof(buffer))) > 0)
+    {
+        parseBytes(link, linkId, buffer, static_cast<int>(length));
+    }
+}
+
+void MAVLinkProtocol::uasCreationFailed(int sysid)
+{
+    uasPending[sysid & 0xFF] = false;
+}
+
+/**
+ * Only non-virtual members of the link are used, the link may be in its
+ * destructor and wait in LinkManager::removeLink() for this method to return.
+ **/
+void MAVLinkProtocol::parseBytes(LinkInterface* link, int linkId, const uint8_t* data, int length)
 {
 //    receiveMutex.lock();
-    mavlink_message_t message;
-    mavlink_status_t status;
+    // Each link carries its own parser state, any number of links can be parsed
+    MAVLinkParser* parser = link->getReceiveParser();
+    int position = 0;
 
-    for (int position = 0; position < b.size(); position++) {
-        unsigned int decodeState = mavlink_parse_char(link->getId(), (uint8_t)(b.at(position)), &message, &status);
+    while (position < length) {
+        int consumed;
+        const mavlink_message_t* parsed = parser->parse(data + position, length - position, &consumed);
+        position += consumed;
 
-        if (decodeState == 1)
+        if (parsed)
         {
+            // Valid until the parser is called again
+            const mavlink_message_t& message = *parsed;
 //#ifdef MAVLINK_MESSAGE_LENGTHS
 //	    const uint8_t message_lengths[] = MAVLINK_MESSAGE_LENGTHS;
 //	    if (message.msgid >= sizeof(message_lengths) ||
@@ -208,7 +272,7 @@ void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
                 uint8_t* payload = reinterpret_cast<uint8_t*>(message.payload64);
                 memcpy(&extended_message.extended_payload_len, payload + 3, 4);
 
-                const uint8_t* extended_payload = reinterpret_cast<const uint8_t*>(b.constData()) + MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_EXTENDED_HEADER_LEN;
+                const uint8_t* extended_payload = data + MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_EXTENDED_HEADER_LEN;
 
                 // copy extended payload data
                 memcpy(extended_message.extended_payload, extended_payload, extended_message.extended_payload_len);
@@ -229,23 +293,16 @@ void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
             }
 #endif
 
-            // Log data
-            if (m_loggingEnabled && m_logfile)
+            // Log data, only queued here and written by the log writer thread
+            receiveMutex.lock();
+            if (m_loggingEnabled)
             {
-                const int len = MAVLINK_MAX_PACKET_LEN+sizeof(quint64);
-                uint8_t buf[len];
-                quint64 time = QGC::groundTimeUsecs();
-                memcpy(buf, (void*)&time, sizeof(quint64));
-                // Write message to buffer
-                mavlink_msg_to_send_buffer(buf+sizeof(quint64), &message);
-                QByteArray b((const char*)buf, len);
-                if(m_logfile->write(b) < static_cast<qint64>(MAVLINK_MAX_PACKET_LEN+sizeof(quint64)))
-                {
-                    emit protocolStatusMessage(tr("MAVLink Logging failed"), tr("Could not write to file %1, disabling logging.").arg(m_logfile->fileName()));
-                    // Stop logging
-                    enableLogging(false);
-                }
+                m_logWriter->logMessage(QGC::groundTimeUsecs(), message);
             }
+            receiveMutex.unlock();
+
+            // Account every packet, also of systems which do not exist yet
+            statistics.update(linkId, message);
 
             // ORDER MATTERS HERE!
             // If the matching UAS object does not yet exist, it has to be created
@@ -254,7 +311,7 @@ void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
             UASInterface* uas = UASManager::instance()->getUASForId(message.sysid);
 
             // Check and (if necessary) create UAS object
-            if (uas == NULL && message.msgid == MAVLINK_MSG_ID_HEARTBEAT)
+            if (uas == NULL && message.msgid == MAVLINK_MSG_ID_HEARTBEAT && !uasPending[message.sysid])
             {
                 // ORDER MATTERS HERE!
                 // The UAS object has first to be created and connected,
@@ -294,91 +351,38 @@ void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
                     continue;
                 }
 
-                // Create a new UAS object
-                uas = QGCMAVLinkUASFactory::createUAS(this, link, message.sysid, &heartbeat);
+                // Create a new UAS object. This has to happen in the GUI thread,
+                // the messages of this system are dropped until it exists. The
+                // factory hands this heartbeat to the new system.
+                uasPending[message.sysid] = true;
+                QMetaObject::invokeMethod(uasFactory, "createUAS", Qt::QueuedConnection,
+                                          Q_ARG(int, linkId),
+                                          Q_ARG(MAVLinkMessagePtr, MAVLinkMessagePtr(new mavlink_message_t(message))));
             }
 
-            // Only count message if UAS exists for this message
+            // Only dispatch message if UAS exists for this message
             if (uas != NULL)
             {
-                // Increase receive counter
-                totalReceiveCounter++;
-                currReceiveCounter++;
-                qint64 lastLoss = totalLossCounter;
-                // Update last packet index
-                if (lastIndex[message.sysid][message.compid] == -1)
-                {
-                    lastIndex[message.sysid][message.compid] = message.seq;
-                }
-                else
-                {
-                    // TODO: This if-else block can (should) be greatly simplified
-                    if (lastIndex[message.sysid][message.compid] == 255)
-                    {
-                        lastIndex[message.sysid][message.compid] = 0;
-                    }
-                    else
-                    {
-                        lastIndex[message.sysid][message.compid]++;
-                    }
+                uasPending[message.sysid] = false;
 
-                    int safeguard = 0;
-                    //qDebug() << "SYSID" << message.sysid << "COMPID" << message.compid << "MSGID" << message.msgid << "LASTINDEX" << lastIndex[message.sysid][message.compid] << "SEQ" << message.seq;
-                    while(lastIndex[message.sysid][message.compid] != message.seq && safeguard < 255)
-                    {
-                        if (lastIndex[message.sysid][message.compid] == 255)
-                        {
-                            lastIndex[message.sysid][message.compid] = 0;
-                        }
-                        else
-                        {
-                            lastIndex[message.sysid][message.compid]++;
-                        }
-                        totalLossCounter++;
-                        currLossCounter++;
-                        safeguard++;
-                    }
-                }
-                //            if (lastIndex.contains(message.sysid))
-                //            {
-                //                QMap<int, int>* lastCompIndex = lastIndex.value(message.sysid);
-                //                if (lastCompIndex->contains(message.compid))
-                //                while (lastCompIndex->value(message.compid, 0)+1 )
-                //            }
-                //if ()
-
-                // If a new loss was detected or we just hit one 128th packet step
-                if (lastLoss != totalLossCounter || (totalReceiveCounter % 64 == 0))
+                // Emit the loss over the statistics window at most once per second
+                qint64 now = QGC::groundTimeMilliseconds();
+                if (now - lastLossUpdate[message.sysid] >= 1000)
                 {
-                    // Calculate new loss ratio
-                    // Receive loss
-                    float receiveLoss = (double)currLossCounter/(double)(currReceiveCounter+currLossCounter);
-                    receiveLoss *= 100.0f;
-                    // qDebug() << "LOSSCHANGED" << receiveLoss;
-                    currLossCounter = 0;
-                    currReceiveCounter = 0;
-                    emit receiveLossChanged(message.sysid, receiveLoss);
-                    //qDebug() << "LOSSCHANGED" << message.sysid<<" "<<receiveLoss;
+                    lastLossUpdate[message.sysid] = now;
+                    emit receiveLossChanged(message.sysid, statistics.getSystemSnapshot(message.sysid).loss);
                 }
 
-                // The packet is emitted as a whole, as it is only 255 - 261 bytes short
-                // kind of inefficient, but no issue for a groundstation pc.
-                // It buys as reentrancy for the whole code over all threads
-                emit messageReceived(link, message);
+                // The packet is shared read-only by all subscribers of the bus,
+                // it is allocated once and never copied per listener
+                messageBus->publish(linkId, MAVLinkMessagePtr(new mavlink_message_t(message)));
 
-                // Multiplex message if enabled
+                // Multiplex message if enabled, the links are written
+                // in the GUI thread, except the one it was received on
                 if (m_multiplexingEnabled)
                 {
-                    // Get all links connected to this unit
-                    QList<LinkInterface*> links = LinkManager::instance()->getLinksForProtocol(this);
-
-                    // Emit message on all links that are currently connected
-                    foreach (LinkInterface* currLink, links)
-                    {
-                        // Only forward this message to the other links,
-                        // not the link the message was received on
-                        if (currLink != link) sendMessage(currLink, message);
-                    }
+                    QMetaObject::invokeMethod(sender, "forwardMessage", Qt::QueuedConnection,
+                                              Q_ARG(int, linkId), Q_ARG(mavlink_message_t, message));
                 }
             }
         }
@@ -416,6 +420,12 @@ int MAVLinkProtocol::getComponentId()
  */
 void MAVLinkProtocol::sendMessage(mavlink_message_t message)
 {
+    if (QThread::currentThread() != sender->thread())
+    {
+        QMetaObject::invokeMethod(sender, "sendMessage", Qt::QueuedConnection, Q_ARG(mavlink_message_t, message));
+        return;
+    }
+
     // Get all links connected to this unit
     QList<LinkInterface*> links = LinkManager::instance()->getLinksForProtocol(this);
 
@@ -429,11 +439,20 @@ void MAVLinkProtocol::sendMessage(mavlink_message_t message)
 }
 
 /**
+ * Called from another thread, the link is looked up again by id in the
+ * GUI thread, the message is dropped if it has been deleted meanwhile.
  * @param link the link to send the message over
  * @param message message to send
  */
 void MAVLinkProtocol::sendMessage(LinkInterface* link, mavlink_message_t message)
 {
+    // The links and their channel sequence numbers are only touched in the GUI thread
+    if (QThread::currentThread() != sender->thread())
+    {
+        QMetaObject::invokeMethod(sender, "sendMessage", Qt::QueuedConnection,
+                                  Q_ARG(int, link->getId()), Q_ARG(mavlink_message_t, message));
+        return;
+    }
     // Create buffer
     uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
     // Rewriting header to ensure correct link ID is set
@@ -539,23 +558,19 @@ void MAVLinkProtocol::setActionRetransmissionTimeout(int ms)
 
 void MAVLinkProtocol::enableLogging(bool enabled)
 {
+    QMutexLocker locker(&receiveMutex);
     bool changed = false;
     if (enabled != m_loggingEnabled) changed = true;
 
     if (enabled)
     {
-        if (m_logfile && m_logfile->isOpen())
-        {
-            m_logfile->flush();
-            m_logfile->close();
-        }
-
-        if (m_logfile)
+        if (!m_logfileName.isEmpty())
         {
-            if (!m_logfile->open(QIODevice::WriteOnly | QIODevice::Append))
+            // Re-opening flushes all records queued for a previous file
+            if (!m_logWriter->open(m_logfileName))
             {
-                emit protocolStatusMessage(tr("Opening MAVLink logfile for writing failed"), tr("MAVLink cannot log to the file %1, please choose a different file. Stopping logging.").arg(m_logfile->fileName()));
-                m_loggingEnabled = false;
+                emit protocolStatusMessage(tr("Opening MAVLink logfile for writing failed"), tr("MAVLink cannot log to the file %1, please choose a different file. Stopping logging.").arg(m_logfileName));
+                enabled = false;
             }
         }
         else
@@ -565,31 +580,24 @@ void MAVLinkProtocol::enableLogging(bool enabled)
     }
     else if (!enabled)
     {
-        if (m_logfile)
-        {
-            if (m_logfile->isOpen())
-            {
-                m_logfile->flush();
-                m_logfile->close();
-            }
-        }
+        m_logWriter->close();
     }
     m_loggingEnabled = enabled;
     if (changed) emit loggingChanged(enabled);
 }
 
+void MAVLinkProtocol::logWriteFailed(const QString& filename)
+{
+    emit protocolStatusMessage(tr("MAVLink Logging failed"), tr("Could not write to file %1, disabling logging.").arg(filename));
+    // Stop logging
+    enableLogging(false);
+}
+
 void MAVLinkProtocol::setLogfileName(const QString& filename)
 {
-    if (!m_logfile)
-    {
-        m_logfile = new QFile(filename);
-    }
-    else
-    {
-        m_logfile->flush();
-        m_logfile->close();
-    }
-    m_logfile->setFileName(filename);
+    QMutexLocker locker(&receiveMutex);
+    m_logWriter->close();
+    m_logfileName = filename;
     enableLogging(m_loggingEnabled);
 }
 
@@ -37,11 +37,18 @@ This file is part of the QGROUNDCONTROL project
 #include <QFile>
 #include <QMap>
 #include <QByteArray>
+#include <QThread>
 #include "ProtocolInterface.h"
 #include "LinkInterface.h"
+#include "MAVLinkMessageBus.h"
+#include "MAVLinkSender.h"
+#include "MAVLinkLogWriter.h"
+#include "MAVLinkStatistics.h"
 #include "QGCMAVLink.h"
 #include "QGC.h"
 
+class QGCMAVLinkUASFactory;
+
 #ifdef QGC_PROTOBUF_ENABLED
 #include <mavlink_protobuf_manager.hpp>
 #endif
@@ -53,6 +60,10 @@ This file is part of the QGROUNDCONTROL project
  * MAVLink is a generic communication protocol for micro air vehicles.
  * for more information, please see the official website.
  * @ref http://pixhawk.ethz.ch/software/mavlink/
+ *
+ * The protocol object lives in its own thread, so parsing, packet loss
+ * accounting and logging never wait for the GUI. Parsed messages are
+ * handed to their consumers through the message bus.
  **/
 class MAVLinkProtocol : public ProtocolInterface
 {
@@ -120,13 +131,27 @@ public:
     int getActionRetransmissionTimeout() {
         return m_actionRetransmissionTimeout;
     }
+    /** @brief Get the bus distributing the parsed messages */
+    MAVLinkMessageBus* getMessageBus() {
+        return messageBus;
+    }
+    /** @brief Get the link quality statistics, safe to poll from any thread */
+    const MAVLinkStatistics* getStatistics() const {
+        return &statistics;
+    }
 
 public slots:
     /** @brief Receive bytes from a communication interface */
     void receiveBytes(LinkInterface* link, QByteArray b);
-    /** @brief Send MAVLink message through serial interface */
+    /** @brief Receive bytes replayed for a communication interface, identified by its id */
+    void receiveBytes(int linkId, QByteArray b);
+    /** @brief Drain the receive buffer of a communication interface */
+    void receiveBytes(int linkId);
+    /** @brief The system could not be created, accept its next heartbeat again */
+    void uasCreationFailed(int sysid);
+    /** @brief Send MAVLink message on all links, queued to the GUI thread if called from another thread */
     void sendMessage(mavlink_message_t message);
-    /** @brief Send MAVLink message through serial interface */
+    /** @brief Send MAVLink message on one link, queued to the GUI thread if called from another thread */
     void sendMessage(LinkInterface* link, mavlink_message_t message);
     /** @brief Set the rate at which heartbeats are emitted */
     void setHeartbeatRate(int rate);
@@ -160,6 +185,9 @@ public slots:
     /** @brief Set log file name */
     void setLogfileName(const QString& filename);
 
+    /** @brief Stop logging after the log writer failed */
+    void logWriteFailed(const QString& filename);
+
     /** @brief Enable / disable version check */
     void enableVersionCheck(bool enabled);
 
@@ -180,6 +208,14 @@ public slots:
     void storeSettings();
 
 protected:
+    /** @brief Parse a chunk of raw bytes received on a link */
+    void parseBytes(LinkInterface* link, int linkId, const uint8_t* data, int length);
+
+    QThread* protocolThread;   ///< Thread parsing all incoming bytes
+    MAVLinkMessageBus* messageBus; ///< Fan-out of the parsed messages
+    QGCMAVLinkUASFactory* uasFactory; ///< Creates new systems in the GUI thread
+    MAVLinkSender* sender;     ///< Writes the messages of the protocol thread in the GUI thread
+    bool uasPending[256];      ///< System creation requested, but not done yet
     QTimer* heartbeatTimer;    ///< Timer to emit heartbeats
     int heartbeatRate;         ///< Heartbeat rate, controls the timer interval
     bool m_heartbeatsEnabled;  ///< Enabled/disable heartbeat emission
@@ -187,19 +223,17 @@ protected:
     bool m_authEnabled;        ///< Enable authentication token broadcast
     QString m_authKey;         ///< Authentication key
     bool m_loggingEnabled;     ///< Enable/disable packet logging
-    QFile* m_logfile;           ///< Logfile
+    QString m_logfileName;     ///< Name of the packet logfile
+    MAVLinkLogWriter* m_logWriter; ///< Writes the packet log in the background
     bool m_enable_version_check; ///< Enable checking of version match of MAV and QGC
     int m_paramRetransmissionTimeout; ///< Timeout for parameter retransmission
     int m_paramRewriteTimeout;    ///< Timeout for sending re-write request
     bool m_paramGuardEnabled;       ///< Parameter retransmission/rewrite enabled
     bool m_actionGuardEnabled;       ///< Action request retransmission enabled
     int m_actionRetransmissionTimeout; ///< Timeout for parameter retransmission
-    QMutex receiveMutex;       ///< Mutex to protect receiveBytes function
-    int lastIndex[256][256];
-    int totalReceiveCounter;
-    int totalLossCounter;
-    int currReceiveCounter;
-    int currLossCounter;
+    QMutex receiveMutex;       ///< Protects the logfile, which is written from the protocol thread
+    MAVLinkStatistics statistics; ///< Link quality per link, system and component
+    qint64 lastLossUpdate[256]; ///< Time the loss of each system was last emitted
     bool versionMismatchIgnore;
     int systemId;
 #ifdef QGC_PROTOBUF_ENABLED
@@ -207,8 +241,6 @@ protected:
 #endif
 
 signals:
-    /** @brief Message received and directly copied via signal */
-    void messageReceived(LinkInterface* link, mavlink_message_t message);
 #ifdef QGC_PROTOBUF_ENABLED
     /** @brief Message received via signal */
     void extendedMessageReceived(LinkInterface *link, std::tr1::shared_ptr<google::protobuf::Message> message);
@@ -0,0 +1,58 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of class MAVLinkSender
+ *
+ */
+
+#include "MAVLinkSender.h"
+#include "MAVLinkProtocol.h"
+#include "LinkManager.h"
+
+MAVLinkSender::MAVLinkSender(MAVLinkProtocol* protocol) :
+    QObject(),
+    protocol(protocol)
+{
+    qRegisterMetaType<mavlink_message_t>("mavlink_message_t");
+}
+
+void MAVLinkSender::sendMessage(mavlink_message_t message)
+{
+    protocol->sendMessage(message);
+}
+
+void MAVLinkSender::sendMessage(int linkId, mavlink_message_t message)
+{
+    LinkInterface* link = LinkManager::instance()->getLinkForId(linkId);
+    if (link) protocol->sendMessage(link, message);
+}
+
+void MAVLinkSender::forwardMessage(int sourceLinkId, mavlink_message_t message)
+{
+    foreach (LinkInterface* link, LinkManager::instance()->getLinksForProtocol(protocol))
+    {
+        if (link->getId() != sourceLinkId) protocol->sendMessage(link, message);
+    }
+}
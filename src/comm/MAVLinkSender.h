@@ -0,0 +1,70 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Definition of class MAVLinkSender
+ *
+ */
+
+#ifndef MAVLINKSENDER_H
+#define MAVLINKSENDER_H
+
+#include <QObject>
+#include <QMetaType>
+#include "QGCMAVLink.h"
+
+class MAVLinkProtocol;
+
+Q_DECLARE_METATYPE(mavlink_message_t)
+
+/**
+ * @brief Writes the outgoing messages of the protocol thread in the GUI thread
+ *
+ * The links are created, written and deleted in the GUI thread, and the
+ * sequence numbers of a link channel are only advanced there. Messages
+ * sent from the protocol thread, like heartbeats and multiplexed packets,
+ * are queued to this object and refer to their link by id. A link which
+ * has been deleted in the meantime is not found and the message is
+ * dropped.
+ */
+class MAVLinkSender : public QObject
+{
+    Q_OBJECT
+public:
+    /** @brief Has to be created in the GUI thread */
+    explicit MAVLinkSender(MAVLinkProtocol* protocol);
+
+public slots:
+    /** @brief Send a message on all links of the protocol */
+    void sendMessage(mavlink_message_t message);
+    /** @brief Send a message on the link with this id, if it still exists */
+    void sendMessage(int linkId, mavlink_message_t message);
+    /** @brief Send a message on all links of the protocol except the one it was received on */
+    void forwardMessage(int sourceLinkId, mavlink_message_t message);
+
+protected:
+    MAVLinkProtocol* protocol;
+};
+
+#endif // MAVLINKSENDER_H
@@ -670,7 +670,6 @@ void MAVLinkSimulationLink::writeBytes(const char* data, qint64 size)
 {
     // Parse bytes
     mavlink_message_t msg;
-    mavlink_status_t comm;
 
     uint8_t stream[2048];
     int streampointer = 0;
@@ -681,7 +680,7 @@ void MAVLinkSimulationLink::writeBytes(const char* data, qint64 size)
     int i;
     for (i=0; i<size; i++)
     {
-        if (mavlink_parse_char(this->id, data[i], &msg, &comm))
+        if (writeParser.parseChar(data[i], &msg))
         {
             // MESSAGE RECEIVED!
             qDebug() << "SIMULATION LINK RECEIVED MESSAGE!";
@@ -857,7 +856,7 @@ void MAVLinkSimulationLink::writeBytes(const char* data, qint64 size)
     readyBufferMutex.unlock();
 
     // Update comm status
-    status.errors_comm = comm.packet_rx_drop_count;
+    status.errors_comm = writeParser.getErrorCount();
 
 }
 
@@ -874,8 +873,7 @@ void MAVLinkSimulationLink::readBytes()
         *(data + i) = readyBuffer.takeFirst();
     }
 
-    QByteArray b(data, len);
-    emit bytesReceived(this, b);
+    pushReceivedBytes(data, len);
 
     readyBufferMutex.unlock();
 
@@ -43,6 +43,7 @@ This file is part of the QGROUNDCONTROL project
 #include "QGCMAVLink.h"
 
 #include "LinkInterface.h"
+#include "MAVLinkParser.h"
 
 class MAVLinkSimulationLink : public LinkInterface
 {
@@ -126,6 +127,7 @@ protected:
     QQueue<uint8_t> readyBuffer;
 
     int id;
+    MAVLinkParser writeParser; ///< Parses the bytes written to the simulated system
     QString name;
     qint64 timeOffset;
     mavlink_sys_status_t status;
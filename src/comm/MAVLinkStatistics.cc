@@ -0,0 +1,234 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of class MAVLinkStatistics
+ *
+ */
+
+#include <QThread>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <string.h>
+
+#include "MAVLinkStatistics.h"
+#include "QGC.h"
+
+MAVLinkStatistics::MAVLinkStatistics() :
+    lastStream(NULL)
+{
+}
+
+MAVLinkStatistics::~MAVLinkStatistics()
+{
+    qDeleteAll(streams);
+}
+
+/**
+ * The distance of the received to the expected sequence number, modulo
+ * 256, classifies the packet: 0 is in order, up to 127 ahead means the
+ * packets in between were lost, one behind is a duplicate of the last
+ * packet and further behind is a late packet which was counted as lost.
+ */
+void MAVLinkStatistics::update(int linkId, const mavlink_message_t& message)
+{
+    const quint64 streamKey = key(linkId, message.sysid, message.compid);
+    Stream* stream = lastStream;
+    if (!stream || key(stream->linkId, stream->systemId, stream->componentId) != streamKey)
+    {
+        // Only this thread modifies the hash, reading it needs no lock
+        stream = streams.value(streamKey, NULL);
+        if (!stream)
+        {
+            stream = new Stream;
+            stream->sequence = 0;
+            stream->linkId = linkId;
+            stream->systemId = message.sysid;
+            stream->componentId = message.compid;
+            stream->expectedSeq = message.seq;
+            stream->received = 0;
+            stream->lost = 0;
+            stream->duplicates = 0;
+            stream->reordered = 0;
+            stream->bytes = 0;
+            for (int i = 0; i < windowSeconds; ++i)
+            {
+                stream->bucketSecond[i] = -1;
+                stream->bucketReceived[i] = 0;
+                stream->bucketLost[i] = 0;
+                stream->bucketBytes[i] = 0;
+            }
+            QWriteLocker locker(&streamLock);
+            streams.insert(streamKey, stream);
+        }
+        lastStream = stream;
+    }
+
+    const qint64 second = QGC::groundTimeMilliseconds() / 1000;
+    const int bucket = second % windowSeconds;
+    const int length = message.len + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+    const quint8 delta = static_cast<quint8>(message.seq - stream->expectedSeq);
+
+    stream->sequence.fetchAndAddOrdered(1);
+
+    if (stream->bucketSecond[bucket] != second)
+    {
+        stream->bucketSecond[bucket] = second;
+        stream->bucketReceived[bucket] = 0;
+        stream->bucketLost[bucket] = 0;
+        stream->bucketBytes[bucket] = 0;
+    }
+
+    stream->received++;
+    stream->bytes += length;
+    stream->bucketReceived[bucket]++;
+    stream->bucketBytes[bucket] += length;
+
+    if (delta < 128)
+    {
+        // In order or ahead, the packets in between are lost
+        stream->lost += delta;
+        stream->bucketLost[bucket] += delta;
+        stream->expectedSeq = message.seq + 1;
+    }
+    else if (delta == 255)
+    {
+        stream->duplicates++;
+    }
+    else
+    {
+        // Arrived late, it was counted as lost when the gap was seen
+        stream->reordered++;
+        if (stream->lost > 0) stream->lost--;
+        if (stream->bucketLost[bucket] > 0) stream->bucketLost[bucket]--;
+    }
+
+    stream->sequence.fetchAndAddOrdered(1);
+}
+
+MAVLinkStreamStatistics MAVLinkStatistics::read(const Stream* stream, qint64 now)
+{
+    MAVLinkStreamStatistics stats;
+    Stream copy;
+    QAtomicInt& sequence = const_cast<QAtomicInt&>(stream->sequence);
+    forever
+    {
+        int before = sequence.fetchAndAddOrdered(0);
+        if (before & 1)
+        {
+            // Writer is in the middle of an update
+            QThread::yieldCurrentThread();
+            continue;
+        }
+        copy.received = stream->received;
+        copy.lost = stream->lost;
+        copy.duplicates = stream->duplicates;
+        copy.reordered = stream->reordered;
+        copy.bytes = stream->bytes;
+        memcpy(copy.bucketSecond, stream->bucketSecond, sizeof(copy.bucketSecond));
+        memcpy(copy.bucketReceived, stream->bucketReceived, sizeof(copy.bucketReceived));
+        memcpy(copy.bucketLost, stream->bucketLost, sizeof(copy.bucketLost));
+        memcpy(copy.bucketBytes, stream->bucketBytes, sizeof(copy.bucketBytes));
+        if (sequence.fetchAndAddOrdered(0) == before) break;
+    }
+
+    stats.linkId = stream->linkId;
+    stats.systemId = stream->systemId;
+    stats.componentId = stream->componentId;
+    stats.receivedPackets = copy.received;
+    stats.lostPackets = copy.lost;
+    stats.duplicatePackets = copy.duplicates;
+    stats.reorderedPackets = copy.reordered;
+    stats.receivedBytes = copy.bytes;
+
+    // Only completed seconds count, the current one is still filling
+    quint64 received = 0;
+    quint64 lost = 0;
+    quint64 bytes = 0;
+    for (int i = 0; i < windowSeconds; ++i)
+    {
+        if (copy.bucketSecond[i] >= now - windowSeconds && copy.bucketSecond[i] < now)
+        {
+            received += copy.bucketReceived[i];
+            lost += copy.bucketLost[i];
+            bytes += copy.bucketBytes[i];
+        }
+    }
+    stats.windowReceived = received;
+    stats.windowLost = lost;
+    stats.windowBytes = bytes;
+    updateRates(stats);
+    return stats;
+}
+
+void MAVLinkStatistics::updateRates(MAVLinkStreamStatistics& stats)
+{
+    const quint64 received = stats.windowReceived;
+    const quint64 lost = stats.windowLost;
+    stats.packetRate = received / static_cast<double>(windowSeconds);
+    stats.byteRate = stats.windowBytes / static_cast<double>(windowSeconds);
+    stats.loss = (received + lost > 0) ? 100.0 * lost / static_cast<double>(received + lost) : 0.0;
+}
+
+void MAVLinkStatistics::accumulate(MAVLinkStreamStatistics& sum, const MAVLinkStreamStatistics& stats)
+{
+    sum.receivedPackets += stats.receivedPackets;
+    sum.lostPackets += stats.lostPackets;
+    sum.duplicatePackets += stats.duplicatePackets;
+    sum.reorderedPackets += stats.reorderedPackets;
+    sum.receivedBytes += stats.receivedBytes;
+    sum.windowReceived += stats.windowReceived;
+    sum.windowLost += stats.windowLost;
+    sum.windowBytes += stats.windowBytes;
+    updateRates(sum);
+}
+
+QList<MAVLinkStreamStatistics> MAVLinkStatistics::getSnapshot() const
+{
+    const qint64 now = QGC::groundTimeMilliseconds() / 1000;
+    QList<MAVLinkStreamStatistics> snapshot;
+    QReadLocker locker(&streamLock);
+    foreach (const Stream* stream, streams)
+    {
+        snapshot.append(read(stream, now));
+    }
+    return snapshot;
+}
+
+MAVLinkStreamStatistics MAVLinkStatistics::getSystemSnapshot(int systemId) const
+{
+    const qint64 now = QGC::groundTimeMilliseconds() / 1000;
+    MAVLinkStreamStatistics sum;
+    memset(&sum, 0, sizeof(sum));
+    sum.linkId = -1;
+    sum.systemId = systemId;
+    sum.componentId = -1;
+
+    QReadLocker locker(&streamLock);
+    foreach (const Stream* stream, streams)
+    {
+        if (stream->systemId == systemId) accumulate(sum, read(stream, now));
+    }
+    return sum;
+}
@@ -0,0 +1,128 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Definition of class MAVLinkStatistics
+ *
+ */
+
+#ifndef MAVLINKSTATISTICS_H
+#define MAVLINKSTATISTICS_H
+
+#include <QHash>
+#include <QList>
+#include <QAtomicInt>
+#include <QReadWriteLock>
+#include "QGCMAVLink.h"
+
+/**
+ * @brief Snapshot of the statistics of one packet stream
+ *
+ * A stream is identified by the link it is received on and the system
+ * and component id of its sender. Totals count since the first packet,
+ * rates and loss cover the last MAVLinkStatistics::windowSeconds.
+ */
+struct MAVLinkStreamStatistics
+{
+    int linkId;                ///< Link id, -1 if aggregated over links
+    int systemId;
+    int componentId;           ///< Component id, -1 if aggregated over components
+    quint64 receivedPackets;
+    quint64 lostPackets;       ///< Gaps in the sequence numbers
+    quint64 duplicatePackets;  ///< Same sequence number as the previous packet
+    quint64 reorderedPackets;  ///< Late packets, which were already counted as lost
+    quint64 receivedBytes;
+    quint64 windowReceived;    ///< Packets received within the window
+    quint64 windowLost;        ///< Packets lost within the window
+    quint64 windowBytes;       ///< Bytes received within the window
+    double packetRate;         ///< Packets per second over the window
+    double byteRate;           ///< Bytes per second over the window
+    double loss;               ///< Lost packets in percent over the window
+};
+
+/**
+ * @brief Link quality tracking per (link, system, component)
+ *
+ * The protocol thread feeds every parsed packet into update(), which
+ * classifies its sequence number with modulo 256 arithmetic against the
+ * expected one in constant time. Counters are written by that thread
+ * only and published through a sequence lock per stream, so neither the
+ * writer nor the readers ever block on counters. Readers poll consistent
+ * snapshots from any thread whenever they need them, no signal is sent
+ * per packet.
+ */
+class MAVLinkStatistics
+{
+public:
+    MAVLinkStatistics();
+    ~MAVLinkStatistics();
+
+    /** @brief Account one received packet, only to be called from the protocol thread */
+    void update(int linkId, const mavlink_message_t& message);
+
+    /** @brief Snapshots of all streams seen so far, callable from any thread */
+    QList<MAVLinkStreamStatistics> getSnapshot() const;
+    /** @brief Snapshot of one system aggregated over all links and components, callable from any thread */
+    MAVLinkStreamStatistics getSystemSnapshot(int systemId) const;
+
+    static const int windowSeconds = 10; ///< Length of the sliding window for rates and loss
+
+protected:
+    struct Stream
+    {
+        QAtomicInt sequence;   ///< Odd while the writer is updating the stream
+        int linkId;
+        int systemId;
+        int componentId;
+        quint8 expectedSeq;    ///< Sequence number expected next
+        quint64 received;
+        quint64 lost;
+        quint64 duplicates;
+        quint64 reordered;
+        quint64 bytes;
+        // Sliding window, one bucket per second
+        qint64 bucketSecond[windowSeconds];
+        quint32 bucketReceived[windowSeconds];
+        quint32 bucketLost[windowSeconds];
+        quint32 bucketBytes[windowSeconds];
+    };
+
+    /** @brief Consistent copy of a stream as snapshot */
+    static MAVLinkStreamStatistics read(const Stream* stream, qint64 now);
+    /** @brief Add the totals and window counts of a snapshot to another, rates and loss are derived again */
+    static void accumulate(MAVLinkStreamStatistics& sum, const MAVLinkStreamStatistics& stats);
+    /** @brief Derive rates and loss from the window counts */
+    static void updateRates(MAVLinkStreamStatistics& stats);
+
+    static quint64 key(int linkId, int systemId, int componentId)
+    {
+        return (static_cast<quint64>(static_cast<quint32>(linkId)) << 16) | (systemId << 8) | componentId;
+    }
+
+    QHash<quint64, Stream*> streams;  ///< Only modified by the writer
+    mutable QReadWriteLock streamLock; ///< Taken by the writer only to add streams
+    Stream* lastStream;                ///< Cache for bursts of the same stream
+};
+
+#endif // MAVLINKSTATISTICS_H
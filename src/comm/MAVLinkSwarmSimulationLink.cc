@@ -1,12 +1,389 @@
+#include <cmath>
+#include <qmath.h>
+#include <QDebug>
+
 #include "MAVLinkSwarmSimulationLink.h"
+#include "QGC.h"
 
 MAVLinkSwarmSimulationLink::MAVLinkSwarmSimulationLink(QString readFile, QString writeFile, int rate, QObject *parent) :
-    MAVLinkSimulationLink(readFile, writeFile, rate, parent)
+    MAVLinkSimulationLink(readFile, writeFile, rate, parent),
+    vehicleCount(10),
+    packetLoss(0.0f),
+    reorderProbability(0.0f),
+    burstRate(0.0f),
+    burstDuration(0),
+    seed(1),
+    tickLength(qMax(rate, 1)),
+    currentTick(0),
+    burstEnd(0),
+    randomState(1),
+    output(0),
+    outputBytes(0),
+    sentMessages(0),
+    lostMessages(0),
+    droppedMessages(0)
+{
+    // Rates of a typical telemetry link
+    messageRates.insert(MAVLINK_MSG_ID_HEARTBEAT, 1.0f);
+    messageRates.insert(MAVLINK_MSG_ID_SYS_STATUS, 1.0f);
+    messageRates.insert(MAVLINK_MSG_ID_ATTITUDE, 25.0f);
+    messageRates.insert(MAVLINK_MSG_ID_GLOBAL_POSITION_INT, 10.0f);
+    messageRates.insert(MAVLINK_MSG_ID_GPS_RAW_INT, 5.0f);
+    messageRates.insert(MAVLINK_MSG_ID_VFR_HUD, 4.0f);
+
+    reset();
+}
+
+MAVLinkSwarmSimulationLink::~MAVLinkSwarmSimulationLink()
+{
+    disconnect();
+}
+
+void MAVLinkSwarmSimulationLink::setVehicleCount(int count)
+{
+    vehicleCount = qBound(1, count, static_cast<int>(maxVehicleCount));
+}
+
+void MAVLinkSwarmSimulationLink::setMessageRate(int messageId, float rate)
+{
+    if (!messageRates.contains(messageId))
+    {
+        qDebug() << __FILE__ << __LINE__ << "Swarm simulation can not send message" << messageId;
+        return;
+    }
+    messageRates.insert(messageId, qMax(rate, 0.0f));
+}
+
+float MAVLinkSwarmSimulationLink::getMessageRate(int messageId) const
+{
+    return messageRates.value(messageId, 0.0f);
+}
+
+void MAVLinkSwarmSimulationLink::setPacketLoss(float probability)
+{
+    packetLoss = qBound(0.0f, probability, 1.0f);
+}
+
+void MAVLinkSwarmSimulationLink::setReorderProbability(float probability)
+{
+    reorderProbability = qBound(0.0f, probability, 1.0f);
+}
+
+void MAVLinkSwarmSimulationLink::setBursts(float rate, int duration)
+{
+    burstRate = qMax(rate, 0.0f);
+    burstDuration = qMax(duration, 0);
+}
+
+void MAVLinkSwarmSimulationLink::setSeed(quint32 seed)
+{
+    // xorshift never leaves the state zero
+    this->seed = (seed == 0) ? 1 : seed;
+}
+
+void MAVLinkSwarmSimulationLink::reset()
 {
+    currentTick = 0;
+    burstEnd = 0;
+    randomState = seed;
+    pending.clear();
+    heldPacket.clear();
+    sentMessages = 0;
+    lostMessages = 0;
+    droppedMessages = 0;
+    name = QString("Swarm simulation (%1 MAVs)").arg(vehicleCount);
+
+    streams.clear();
+    QMap<int, float>::const_iterator it;
+    for (it = messageRates.constBegin(); it != messageRates.constEnd(); ++it)
+    {
+        if (it.value() <= 0.0f) continue;
+        Stream stream;
+        stream.messageId = it.key();
+        stream.rate = it.value();
+        stream.period = qMax(1, qRound(1000.0f / (stream.rate * tickLength)));
+        streams.append(stream);
+    }
+
+    // Place the circles of the vehicles on a grid
+    const int columns = static_cast<int>(ceil(sqrt(static_cast<double>(vehicleCount))));
+    const double spacing = 400.0;
+    vehicles.resize(vehicleCount);
+    for (int i = 0; i < vehicleCount; ++i)
+    {
+        Vehicle& vehicle = vehicles[i];
+        vehicle.systemId = i + 1;
+        vehicle.north = (i / columns) * spacing;
+        vehicle.east = (i % columns) * spacing;
+        vehicle.radius = 50.0 + 100.0 * randomUniform();
+        vehicle.speed = 8.0 + 12.0 * randomUniform();
+        vehicle.altitude = 50.0 + 100.0 * randomUniform();
+        vehicle.phase = 2.0 * M_PI * randomUniform();
+        vehicle.sequence = 0;
+    }
+
+    // Spread the first message of each stream over its period,
+    // otherwise all vehicles send in the same tick
+    for (int i = 0; i < wheelSize; ++i)
+    {
+        wheel[i].clear();
+    }
+    for (int i = 0; i < vehicles.size(); ++i)
+    {
+        for (int j = 0; j < streams.size(); ++j)
+        {
+            WheelEntry entry;
+            entry.due = nextRandom() % streams.at(j).period;
+            entry.vehicle = i;
+            entry.stream = j;
+            wheel[entry.due % wheelSize].append(entry);
+        }
+    }
 }
 
+qint64 MAVLinkSwarmSimulationLink::generate(quint64 duration, QByteArray* output)
+{
+    const quint64 initialBytes = outputBytes;
+    this->output = output;
+    const quint64 end = currentTick + (duration + tickLength - 1) / tickLength;
+    while (currentTick < end)
+    {
+        mainloop();
+    }
+    this->output = 0;
+    return outputBytes - initialBytes;
+}
+
+/**
+ * The thread sleeps until the next tick is due. If it falls behind, the
+ * missed ticks are run back to back, as a real link would deliver the
+ * delayed packets at once.
+ */
+void MAVLinkSwarmSimulationLink::run()
+{
+    const quint64 start = QGC::groundTimeMilliseconds();
+    while (_isConnected)
+    {
+        const quint64 now = QGC::groundTimeMilliseconds() - start;
+        while (_isConnected && currentTick * tickLength <= now)
+        {
+            mainloop();
+        }
+        const quint64 next = currentTick * tickLength;
+        const quint64 elapsed = QGC::groundTimeMilliseconds() - start;
+        if (next > elapsed) QGC::SLEEP::msleep(next - elapsed);
+    }
+}
 
 void MAVLinkSwarmSimulationLink::mainloop()
 {
+    if (burstRate > 0.0f && currentTick >= burstEnd &&
+        randomUniform() < burstRate * tickLength / 1000.0)
+    {
+        burstEnd = currentTick + qMax(1, burstDuration / tickLength);
+    }
+
+    // Send all messages due in this tick and schedule their successors.
+    // Entries of later rounds of the wheel stay in their slot.
+    QVector<WheelEntry>& slot = wheel[currentTick % wheelSize];
+    const int count = slot.size();
+    int kept = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        WheelEntry entry = slot.at(i);
+        if (entry.due > currentTick)
+        {
+            slot[kept++] = entry;
+            continue;
+        }
+        const Stream& stream = streams.at(entry.stream);
+        sendMessage(vehicles[entry.vehicle], stream.messageId);
+        entry.due += stream.period;
+        // May append to this slot, which is compacted below
+        wheel[entry.due % wheelSize].append(entry);
+    }
+    for (int i = count; i < slot.size(); ++i)
+    {
+        slot[kept++] = slot.at(i);
+    }
+    slot.resize(kept);
+
+    currentTick++;
+    if (currentTick >= burstEnd) flush();
+}
+
+void MAVLinkSwarmSimulationLink::sendMessage(Vehicle& vehicle, int messageId)
+{
+    const quint64 time = currentTick * tickLength;
+    const double seconds = time / 1000.0;
+
+    // Position on the circle and velocity along it
+    const double omega = vehicle.speed / vehicle.radius;
+    const double angle = vehicle.phase + omega * seconds;
+    const double north = vehicle.north + vehicle.radius * cos(angle);
+    const double east = vehicle.east + vehicle.radius * sin(angle);
+    const double velocityNorth = -vehicle.speed * sin(angle);
+    const double velocityEast = vehicle.speed * cos(angle);
+    const double heading = atan2(velocityEast, velocityNorth);
+    const double headingDegrees = fmod(heading * 180.0 / M_PI + 360.0, 360.0);
+
+    const double homeLatitude = 47.376389;
+    const double homeLongitude = 8.548056;
+    const double homeAltitude = 500.0;
+    const double earthRadius = 6378137.0;
+    const double latitude = homeLatitude + north / earthRadius * 180.0 / M_PI;
+    const double longitude = homeLongitude + east / (earthRadius * cos(homeLatitude * M_PI / 180.0)) * 180.0 / M_PI;
+    const double altitude = homeAltitude + vehicle.altitude;
+
+    // Coordinated turn
+    const float roll = atan(vehicle.speed * vehicle.speed / (vehicle.radius * 9.81));
+    const float pitch = 0.05f * sin(seconds);
+    const int voltage = qMax(10500, 12600 - static_cast<int>(seconds * 0.5));
+
+    mavlink_message_t msg;
+    switch (messageId)
+    {
+    case MAVLINK_MSG_ID_HEARTBEAT:
+        mavlink_msg_heartbeat_pack(vehicle.systemId, MAV_COMP_ID_IMU, &msg, MAV_TYPE_FIXED_WING, MAV_AUTOPILOT_GENERIC, MAV_MODE_GUIDED_ARMED, 0, MAV_STATE_ACTIVE);
+        break;
+    case MAVLINK_MSG_ID_SYS_STATUS:
+        mavlink_msg_sys_status_pack(vehicle.systemId, MAV_COMP_ID_IMU, &msg, 0, 0, 0, 500, voltage, -1,
+                                    static_cast<int8_t>((voltage - 10500) / 21), 0, 0, 0, 0, 0, 0);
+        break;
+    case MAVLINK_MSG_ID_ATTITUDE:
+        mavlink_msg_attitude_pack(vehicle.systemId, MAV_COMP_ID_IMU, &msg, time, roll, pitch, heading, 0.0f, 0.0f, omega);
+        break;
+    case MAVLINK_MSG_ID_GLOBAL_POSITION_INT:
+        mavlink_msg_global_position_int_pack(vehicle.systemId, MAV_COMP_ID_IMU, &msg, time,
+                                             latitude * 1E7, longitude * 1E7, altitude * 1000.0, vehicle.altitude * 1000.0,
+                                             velocityNorth * 100.0, velocityEast * 100.0, 0, headingDegrees * 100.0);
+        break;
+    case MAVLINK_MSG_ID_GPS_RAW_INT:
+        mavlink_msg_gps_raw_int_pack(vehicle.systemId, MAV_COMP_ID_IMU, &msg, time * 1000, 3,
+                                     latitude * 1E7, longitude * 1E7, altitude * 1000.0, 100, 150,
+                                     vehicle.speed * 100.0, headingDegrees * 100.0, 10);
+        break;
+    case MAVLINK_MSG_ID_VFR_HUD:
+        mavlink_msg_vfr_hud_pack(vehicle.systemId, MAV_COMP_ID_IMU, &msg, vehicle.speed, vehicle.speed,
+                                 static_cast<int16_t>(headingDegrees), 60, altitude, 0.0f);
+        break;
+    default:
+        return;
+    }
+
+    // The packing functions number the messages of all systems in one
+    // sequence, give each vehicle its own so the receiver sees its losses
+    msg.seq = vehicle.sequence++;
+    uint16_t checksum = crc_calculate(reinterpret_cast<uint8_t*>(&msg.len), msg.len + MAVLINK_CORE_HEADER_LEN);
+#if MAVLINK_CRC_EXTRA
+    static const uint8_t messageCrcs[256] = MAVLINK_MESSAGE_CRCS;
+    crc_accumulate(messageCrcs[msg.msgid], &checksum);
+#endif
+    mavlink_ck_a(&msg) = static_cast<uint8_t>(checksum & 0xFF);
+    mavlink_ck_b(&msg) = static_cast<uint8_t>(checksum >> 8);
+
+    queueMessage(&msg);
+}
+
+void MAVLinkSwarmSimulationLink::queueMessage(mavlink_message_t* msg)
+{
+    sentMessages++;
+    if (packetLoss > 0.0f && randomUniform() < packetLoss)
+    {
+        lostMessages++;
+        return;
+    }
+
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    const int length = mavlink_msg_to_send_buffer(buffer, msg);
+
+    if (heldPacket.isEmpty() && reorderProbability > 0.0f && randomUniform() < reorderProbability)
+    {
+        heldPacket = QByteArray(reinterpret_cast<const char*>(buffer), length);
+        return;
+    }
+    pending.append(reinterpret_cast<const char*>(buffer), length);
+    if (!heldPacket.isEmpty())
+    {
+        pending.append(heldPacket);
+        heldPacket.clear();
+    }
+}
+
+/**
+ * Bytes for the link are only handed over in whole packets which fit into
+ * the receive buffer, the rest waits for the next tick. If the protocol
+ * falls behind for too long, the oldest packets are dropped and counted.
+ */
+void MAVLinkSwarmSimulationLink::flush()
+{
+    if (pending.isEmpty()) return;
+    if (output)
+    {
+        output->append(pending);
+        outputBytes += pending.size();
+        pending.clear();
+        return;
+    }
+
+    const int space = receiveRing.space();
+    int length = 0;
+    while (length < pending.size())
+    {
+        const int next = length + packetLength(length);
+        if (next > space) break;
+        length = next;
+    }
+    if (length > 0)
+    {
+        pushReceivedBytes(pending.constData(), length);
+        outputBytes += length;
+    }
+
+    int drop = 0;
+    while (pending.size() - length - drop > maxPendingBytes)
+    {
+        drop += packetLength(length + drop);
+        droppedMessages++;
+    }
+    pending.remove(0, length + drop);
+}
+
+int MAVLinkSwarmSimulationLink::packetLength(int offset) const
+{
+    // Only complete MAVLink 1.0 packets are queued, the second byte is the payload length
+    return static_cast<quint8>(pending.at(offset + 1)) + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+}
+
+bool MAVLinkSwarmSimulationLink::connect()
+{
+    if (isRunning()) return true;
+
+    reset();
+    _isConnected = true;
+    emit connected();
+    emit connected(true);
 
+    start(LowPriority);
+    return true;
+}
+
+bool MAVLinkSwarmSimulationLink::disconnect()
+{
+    if (isConnected())
+    {
+        _isConnected = false;
+        // The thread notices within one tick
+        wait();
+
+        emit disconnected();
+        emit connected(false);
+    }
+    return true;
+}
+
+void MAVLinkSwarmSimulationLink::writeBytes(const char* data, qint64 size)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(size);
 }
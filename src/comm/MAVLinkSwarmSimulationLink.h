@@ -1,19 +1,176 @@
 #ifndef MAVLINKSWARMSIMULATIONLINK_H
 #define MAVLINKSWARMSIMULATIONLINK_H
 
+#include <QByteArray>
+#include <QVector>
 #include "MAVLinkSimulationLink.h"
 
+/**
+ * @brief Simulation link sending the telemetry of a whole swarm
+ *
+ * All vehicles are simulated by the one thread of the link. Each vehicle
+ * sends one stream per message type at the configured rate, the next due
+ * message of every stream is kept in a timer wheel with one slot per
+ * tick, so a tick only touches the streams which are due.
+ *
+ * The link can lose, reorder and hold back packets in bursts. Everything,
+ * including the impairments, is derived from the simulated time and a
+ * seeded random number generator. With the same configuration and seed
+ * generate() produces the same bytes, which makes the link usable as
+ * headless load generator for the receiving pipeline.
+ *
+ * The simulated vehicles do not react to the ground station, bytes
+ * written to the link are ignored.
+ */
 class MAVLinkSwarmSimulationLink : public MAVLinkSimulationLink
 {
     Q_OBJECT
 public:
+    /**
+     * @param rate Length of one tick of the timer wheel in milliseconds,
+     *             which is also the finest time resolution of the streams
+     */
     MAVLinkSwarmSimulationLink(QString readFile="", QString writeFile="", int rate=5, QObject *parent = 0);
+    ~MAVLinkSwarmSimulationLink();
 
-signals:
+    /* The configuration takes effect on the next connect() or reset() */
+
+    /** @brief Set the number of simulated vehicles, they use the system ids 1..count */
+    void setVehicleCount(int count);
+    int getVehicleCount() const {
+        return vehicleCount;
+    }
+    /** @brief Set the rate in Hz at which every vehicle sends a message, 0 disables it */
+    void setMessageRate(int messageId, float rate);
+    float getMessageRate(int messageId) const;
+    /** @brief Set the probability of a packet to get lost */
+    void setPacketLoss(float probability);
+    /** @brief Set the probability of a packet to be swapped with the next one */
+    void setReorderProbability(float probability);
+    /**
+     * @brief Hold back all packets for a while and release them at once
+     *
+     * @param rate Mean number of bursts per second
+     * @param duration Duration of a burst in milliseconds
+     */
+    void setBursts(float rate, int duration);
+    /** @brief Set the seed of the random number generator */
+    void setSeed(quint32 seed);
+
+    /** @brief Restart the simulation at time zero with the current configuration */
+    void reset();
+    /**
+     * @brief Run the simulation for some time as fast as possible
+     *
+     * Must not be called while the link is connected.
+     *
+     * @param duration Simulated time in milliseconds
+     * @param output Buffer to append the bytes to, if 0 they are received by the link
+     * @return The number of bytes generated
+     */
+    qint64 generate(quint64 duration, QByteArray* output = 0);
+
+    /** @brief Number of messages sent by all vehicles, including the lost ones */
+    quint64 getSentMessages() const {
+        return sentMessages;
+    }
+    /** @brief Number of messages lost on the simulated link */
+    quint64 getLostMessages() const {
+        return lostMessages;
+    }
+    /** @brief Number of messages dropped because the protocol did not keep up with the link */
+    quint64 getDroppedMessages() const {
+        return droppedMessages;
+    }
+
+    void run();
+    bool connect();
+    bool disconnect();
 
 public slots:
+    /** @brief Advance the simulation by one tick */
     void mainloop();
+    void writeBytes(const char* data, qint64 size);
+
+protected:
+    /** @brief One message type sent by every vehicle */
+    struct Stream
+    {
+        int messageId;
+        float rate;          ///< Messages per second
+        int period;          ///< Ticks between two messages
+    };
+
+    /** @brief Next due message of one stream of one vehicle */
+    struct WheelEntry
+    {
+        quint64 due;         ///< Tick the message is due
+        int vehicle;
+        int stream;
+    };
+
+    /** @brief State of one vehicle, flying a circle around its own center */
+    struct Vehicle
+    {
+        int systemId;
+        double north;        ///< Center of the circle, meters north of the base position
+        double east;         ///< Center of the circle, meters east of the base position
+        double radius;       ///< Meters
+        double speed;        ///< Meters per second
+        double altitude;     ///< Meters above home
+        double phase;        ///< Position on the circle at time zero
+        quint8 sequence;     ///< MAVLink sequence number of the next message
+    };
+
+    /** @brief Send the message of one stream of a vehicle */
+    void sendMessage(Vehicle& vehicle, int messageId);
+    /** @brief Apply loss and reordering, then queue a packet for output */
+    void queueMessage(mavlink_message_t* msg);
+    /** @brief Hand the queued bytes to the output */
+    void flush();
+    /** @brief Length of the queued packet starting at this offset */
+    int packetLength(int offset) const;
+
+    /** @brief Pseudo-random number, xorshift */
+    quint32 nextRandom() {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        return randomState;
+    }
+    /** @brief Pseudo-random number in [0, 1) */
+    double randomUniform() {
+        return (nextRandom() >> 8) / 16777216.0;
+    }
+
+    static const int wheelSize = 256;     ///< Slots of the timer wheel
+    static const int maxVehicleCount = 250;
+    static const int maxPendingBytes = 1 << 22; ///< Bytes held back for the protocol before packets are dropped
+
+    // Configuration
+    int vehicleCount;
+    QMap<int, float> messageRates;        ///< Rate per message id
+    float packetLoss;
+    float reorderProbability;
+    float burstRate;
+    int burstDuration;
+    quint32 seed;
+    int tickLength;                       ///< Milliseconds per tick
 
+    // Simulation state
+    QVector<Stream> streams;
+    QVector<Vehicle> vehicles;
+    QVector<WheelEntry> wheel[wheelSize];
+    quint64 currentTick;
+    quint64 burstEnd;                     ///< Tick at which the current burst ends
+    quint32 randomState;
+    QByteArray pending;                   ///< Bytes waiting for output
+    QByteArray heldPacket;                ///< Packet to be sent after the next one
+    QByteArray* output;                   ///< Buffer of generate(), 0 to push to the link
+    quint64 outputBytes;                  ///< Bytes handed to the output so far
+    quint64 sentMessages;
+    quint64 lostMessages;
+    quint64 droppedMessages;              ///< Dropped because the receive buffer stayed full
 };
 
 #endif // MAVLINKSWARMSIMULATIONLINK_H
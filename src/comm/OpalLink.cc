@@ -74,9 +74,8 @@ void OpalLink::writeBytes(const char *bytes, qint64 length)
 {
     /* decode the message */
     mavlink_message_t msg;
-    mavlink_status_t status;
     int decodeSuccess = 0;
-    for (int i=0; (!(decodeSuccess=mavlink_parse_char(this->getId(), bytes[i], &msg, &status))&& i<length); ++i);
+    for (int i=0; i<length && !(decodeSuccess=writeParser.parseChar(bytes[i], &msg)); ++i);
 
     /* perform the appropriate action */
     if (decodeSuccess) {
@@ -260,7 +259,8 @@ void OpalLink::writeBytes(const char *bytes, qint64 length)
 void OpalLink::readBytes()
 {
     receiveDataMutex.lock();
-    emit bytesReceived(this, receiveBuffer->dequeue());
+    QByteArray b = receiveBuffer->dequeue();
+    pushReceivedBytes(b.constData(), b.size());
     receiveDataMutex.unlock();
 
 }
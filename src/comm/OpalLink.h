@@ -41,6 +41,7 @@ This file is part of the QGROUNDCONTROL project
 
 
 #include "LinkInterface.h"
+#include "MAVLinkParser.h"
 #include "LinkManager.h"
 #include "MG.h"
 #include "QGCMAVLink.h"
@@ -122,6 +123,7 @@ protected slots:
 protected:
     QString name;
     int id;
+    MAVLinkParser writeParser; ///< Parses the bytes written to the simulator
     bool connectState;
 
     quint64 bitsSentTotal;
@@ -55,6 +55,16 @@ public:
 
 public slots:
     virtual void receiveBytes(LinkInterface *link, QByteArray b) = 0;
+    /**
+     * @brief Drain the receive buffer of a link
+     *
+     * Connected to LinkInterface::bytesBuffered() through a queued connection,
+     * so only the id of the link crosses the thread boundary. Implementations
+     * resolve it with LinkManager::getLinkForId() while holding
+     * LinkManager::getLinkLock() for reading, the link can neither be removed
+     * nor deleted before the buffer is drained.
+     */
+    virtual void receiveBytes(int linkId) = 0;
 
 signals:
     /** @brief Update the packet loss from one system */
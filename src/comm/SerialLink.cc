@@ -489,8 +489,7 @@ void SerialLink::readBytes()
             if(maxLength < numBytes) numBytes = maxLength;
 
             port->read(data, numBytes);
-            QByteArray b(data, numBytes);
-            emit bytesReceived(this, b);
+            pushReceivedBytes(data, numBytes);
 
             //qDebug() << "SerialLink::readBytes()" << std::hex << data;
             //            int i;
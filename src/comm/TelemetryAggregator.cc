@@ -0,0 +1,244 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of class TelemetryAggregator
+ *
+ */
+
+#include <QCoreApplication>
+#include <QMetaMethod>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QDebug>
+
+#include "TelemetryAggregator.h"
+
+TelemetryAggregator* TelemetryAggregator::instance()
+{
+    static TelemetryAggregator* _instance = 0;
+    if(_instance == 0) {
+        _instance = new TelemetryAggregator();
+
+        /* Set the application as parent to ensure that this object
+         * will be destroyed when the main application exits */
+        _instance->setParent(qApp);
+    }
+    return _instance;
+}
+
+TelemetryAggregator::TelemetryAggregator() :
+    deliveryRate(defaultDeliveryRate)
+{
+    // Make sure the sample list type is registered
+    TelemetryChannelRegistry::instance();
+
+    connect(&deliveryTimer, SIGNAL(timeout()), this, SLOT(deliver()));
+    deliveryTimer.start(1000 / deliveryRate);
+}
+
+TelemetryAggregator::~TelemetryAggregator()
+{
+    qDeleteAll(subscriptions);
+}
+
+void TelemetryAggregator::connectSource(QObject* source, QObject* receiver, const char* member, DeliveryMode mode)
+{
+    if (!source || !receiver || !member) return;
+
+    // Skip the code prepended by the SLOT() macro
+    const QByteArray signature = QMetaObject::normalizedSignature(member + 1);
+    const int methodIndex = receiver->metaObject()->indexOfMethod(signature.constData());
+    if (methodIndex < 0)
+    {
+        qDebug() << __FILE__ << __LINE__ << "No such slot" << signature << "on" << receiver->metaObject()->className();
+        return;
+    }
+
+    if (source->metaObject()->indexOfSignal("samplesReceived(TelemetrySampleList)") >= 0)
+    {
+        connect(source, SIGNAL(samplesReceived(TelemetrySampleList)), this, SLOT(addSamples(TelemetrySampleList)), Qt::UniqueConnection);
+    }
+    else
+    {
+        connect(source, SIGNAL(valueChanged(int,QString,QString,double,quint64)), this, SLOT(addValue(int,QString,QString,double,quint64)), Qt::UniqueConnection);
+        connect(source, SIGNAL(valueChanged(int,QString,QString,int,quint64)), this, SLOT(addValue(int,QString,QString,int,quint64)), Qt::UniqueConnection);
+    }
+    // Direct connections: the subscriptions have to be gone before the objects are,
+    // also when they are destroyed in another thread than the aggregator lives in
+    const Qt::ConnectionType destroyedType = static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::UniqueConnection);
+    connect(source, SIGNAL(destroyed(QObject*)), this, SLOT(objectDestroyed(QObject*)), destroyedType);
+    connect(receiver, SIGNAL(destroyed(QObject*)), this, SLOT(objectDestroyed(QObject*)), destroyedType);
+
+    QMutexLocker locker(&lock);
+    foreach (Subscription* subscription, subscriptions)
+    {
+        if (subscription->source == source && subscription->receiver == receiver && subscription->methodIndex == methodIndex)
+        {
+            subscription->mode = mode;
+            return;
+        }
+    }
+    Subscription* subscription = new Subscription();
+    subscription->source = source;
+    subscription->receiver = receiver;
+    subscription->methodIndex = methodIndex;
+    subscription->mode = mode;
+    subscriptions.append(subscription);
+}
+
+void TelemetryAggregator::disconnectSource(QObject* source, QObject* receiver)
+{
+    QMutexLocker locker(&lock);
+    for (int i = subscriptions.size() - 1; i >= 0; --i)
+    {
+        if (subscriptions.at(i)->source == source && subscriptions.at(i)->receiver == receiver)
+        {
+            delete subscriptions.takeAt(i);
+        }
+    }
+}
+
+void TelemetryAggregator::setDeliveryRate(int rate)
+{
+    if (rate < 1) rate = 1;
+    deliveryRate = rate;
+    deliveryTimer.start(1000 / deliveryRate);
+}
+
+void TelemetryAggregator::addSamples(const TelemetrySampleList& samples)
+{
+    QObject* source = sender();
+    QMutexLocker locker(&lock);
+    for (int i = 0; i < samples.size(); ++i)
+    {
+        queueSample(source, samples.at(i));
+    }
+}
+
+void TelemetryAggregator::addValue(const int uasId, const QString& name, const QString& unit, const double value, const quint64 msec)
+{
+    addNamedValue(sender(), uasId, name, unit, MAVLINK_TYPE_DOUBLE, value, msec);
+}
+
+void TelemetryAggregator::addValue(const int uasId, const QString& name, const QString& unit, const int value, const quint64 msec)
+{
+    addNamedValue(sender(), uasId, name, unit, MAVLINK_TYPE_INT32_T, value, msec);
+}
+
+void TelemetryAggregator::addNamedValue(QObject* source, int uasId, const QString& name, const QString& unit, int type, double value, quint64 msec)
+{
+    TelemetrySample sample;
+    sample.time = msec;
+    sample.value = value;
+
+    const NamedValueKey key(uasId, qMakePair(name, unit));
+    QMutexLocker locker(&lock);
+    sample.channel = namedChannelIds.value(key, -1);
+    if (sample.channel < 0)
+    {
+        // The registry announces new channels, do not hold the lock meanwhile
+        locker.unlock();
+        sample.channel = TelemetryChannelRegistry::instance()->registerChannel(uasId, -1, -1, -1, name, unit, type);
+        locker.relock();
+        namedChannelIds.insert(key, sample.channel);
+    }
+    queueSample(source, sample);
+}
+
+void TelemetryAggregator::queueSample(QObject* source, const TelemetrySample& sample)
+{
+    for (int i = 0; i < subscriptions.size(); ++i)
+    {
+        Subscription* subscription = subscriptions.at(i);
+        if (subscription->source != source) continue;
+
+        if (subscription->mode == LatestValues)
+        {
+            if (sample.channel >= subscription->latest.size()) subscription->latest.resize(sample.channel + 1);
+            int& position = subscription->latest[sample.channel];
+            // Fresh vector entries are zero, check that the position really belongs to this channel
+            if (position < subscription->pending.size() && subscription->pending.at(position).channel == sample.channel)
+            {
+                subscription->pending[position] = sample;
+                continue;
+            }
+            position = subscription->pending.size();
+        }
+        else if (subscription->pending.size() >= maxPendingSamples)
+        {
+            // The receiver does not keep up, drop instead of growing without bound
+            continue;
+        }
+        subscription->pending.append(sample);
+    }
+}
+
+/**
+ * The batches are taken out under the lock and delivered without it,
+ * so receivers may connect or disconnect sources while handling them.
+ */
+void TelemetryAggregator::deliver()
+{
+    QList<QPointer<QObject> > receivers;
+    QList<int> methods;
+    QList<TelemetrySampleList> batches;
+
+    lock.lock();
+    foreach (Subscription* subscription, subscriptions)
+    {
+        if (subscription->pending.isEmpty()) continue;
+        receivers.append(QPointer<QObject>(subscription->receiver));
+        methods.append(subscription->methodIndex);
+        batches.append(subscription->pending);
+        subscription->pending = TelemetrySampleList();
+    }
+    lock.unlock();
+
+    for (int i = 0; i < receivers.size(); ++i)
+    {
+        // A receiver may have been deleted by an earlier one
+        QObject* receiver = receivers.at(i);
+        if (!receiver) continue;
+        QMetaMethod method = receiver->metaObject()->method(methods.at(i));
+        method.invoke(receiver, Qt::AutoConnection, Q_ARG(TelemetrySampleList, batches.at(i)));
+    }
+}
+
+void TelemetryAggregator::objectDestroyed(QObject* object)
+{
+    removeSubscriptions(object);
+}
+
+void TelemetryAggregator::removeSubscriptions(QObject* object)
+{
+    QMutexLocker locker(&lock);
+    for (int i = subscriptions.size() - 1; i >= 0; --i)
+    {
+        if (subscriptions.at(i)->source == object || subscriptions.at(i)->receiver == object)
+        {
+            delete subscriptions.takeAt(i);
+        }
+    }
+}
@@ -0,0 +1,134 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Definition of class TelemetryAggregator
+ *
+ */
+
+#ifndef TELEMETRYAGGREGATOR_H
+#define TELEMETRYAGGREGATOR_H
+
+#include <QObject>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QMutex>
+#include <QTimer>
+#include "TelemetryChannelRegistry.h"
+
+/**
+ * @brief Collects telemetry samples and hands them to widgets at display rate
+ *
+ * Instead of one signal per value, each receiver gets one batch of
+ * samples per frame from every source it is connected to. Receivers
+ * either want every sample (e.g. plots) or only the latest value of
+ * each channel (e.g. gauges), in which case newer samples replace
+ * older ones of the same channel while they wait for delivery.
+ *
+ * Sources either emit samplesReceived(TelemetrySampleList) or the named
+ * valueChanged() signals of UASInterface, named values are registered
+ * as channels of the TelemetryChannelRegistry on the fly.
+ *
+ * Samples can be added from any thread, batches are delivered in the
+ * thread of the aggregator, which is the thread instance() is first
+ * called from (the GUI thread).
+ */
+class TelemetryAggregator : public QObject
+{
+    Q_OBJECT
+public:
+    enum DeliveryMode {
+        LatestValues,  ///< Only the latest value of each channel per batch
+        AllSamples     ///< Every sample, in order
+    };
+
+    static TelemetryAggregator* instance();
+
+    /**
+     * @brief Deliver the samples of a source to a receiver in batches
+     *
+     * @param source Object emitting samplesReceived() or named valueChanged() signals
+     * @param receiver Object to deliver to
+     * @param member Slot taking a const TelemetrySampleList&, as given by SLOT()
+     * @param mode Deliver every sample or only the latest values
+     */
+    void connectSource(QObject* source, QObject* receiver, const char* member, DeliveryMode mode);
+    /** @brief Stop delivering the samples of a source to a receiver */
+    void disconnectSource(QObject* source, QObject* receiver);
+
+    /** @brief Set the number of batches delivered per second */
+    void setDeliveryRate(int rate);
+    int getDeliveryRate() const {
+        return deliveryRate;
+    }
+
+public slots:
+    /** @brief Queue samples of the sending source */
+    void addSamples(const TelemetrySampleList& samples);
+    /** @brief Queue one named value of the sending source */
+    void addValue(const int uasId, const QString& name, const QString& unit, const double value, const quint64 msec);
+    /** @brief Queue one named integer value of the sending source */
+    void addValue(const int uasId, const QString& name, const QString& unit, const int value, const quint64 msec);
+
+protected slots:
+    /** @brief Hand the queued samples to the receivers */
+    void deliver();
+    void objectDestroyed(QObject* object);
+
+protected:
+    TelemetryAggregator();
+    ~TelemetryAggregator();
+
+    struct Subscription
+    {
+        QObject* source;
+        QObject* receiver;
+        int methodIndex;
+        DeliveryMode mode;
+        TelemetrySampleList pending;  ///< Samples waiting for the next delivery
+        QVector<int> latest;          ///< Position of each channel in pending (LatestValues only), may be stale
+    };
+
+    typedef QPair<int, QPair<QString, QString> > NamedValueKey;  ///< System, name and unit
+
+    /** @brief Queue a named value, its channel is only resolved the first time */
+    void addNamedValue(QObject* source, int uasId, const QString& name, const QString& unit, int type, double value, quint64 msec);
+    /** @brief Queue one sample for all receivers of a source, the lock has to be held */
+    void queueSample(QObject* source, const TelemetrySample& sample);
+    void removeSubscriptions(QObject* object);
+
+    static const int defaultDeliveryRate = 30;  ///< Batches per second
+    static const int maxPendingSamples = 1 << 16; ///< Samples kept per receiver if delivery stalls
+
+    QMutex lock;
+    QList<Subscription*> subscriptions;
+    QHash<NamedValueKey, int> namedChannelIds;  ///< Channel ids of the named values seen so far
+    QTimer deliveryTimer;
+    int deliveryRate;
+};
+
+#endif // TELEMETRYAGGREGATOR_H
@@ -0,0 +1,130 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of class TelemetryChannelRegistry
+ *
+ */
+
+#include <QCoreApplication>
+#include <QReadLocker>
+#include <QWriteLocker>
+
+#include "TelemetryChannelRegistry.h"
+
+TelemetryChannelRegistry* TelemetryChannelRegistry::instance()
+{
+    static TelemetryChannelRegistry* _instance = 0;
+    if(_instance == 0) {
+        _instance = new TelemetryChannelRegistry();
+
+        /* Set the application as parent to ensure that this object
+         * will be destroyed when the main application exits */
+        _instance->setParent(qApp);
+    }
+    return _instance;
+}
+
+TelemetryChannelRegistry::TelemetryChannelRegistry()
+{
+    qRegisterMetaType<TelemetrySampleList>("TelemetrySampleList");
+}
+
+int TelemetryChannelRegistry::registerChannel(int systemId, int componentId, int messageId, int field,
+                                              const QString& name, const QString& unit, int type)
+{
+    const quint64 key = channelKey(systemId, componentId, messageId, field);
+    // Shares the strings of the caller, nothing is allocated for a lookup
+    const ContentKey contentKey(key, name, unit);
+    {
+        QReadLocker locker(&lock);
+        if (field >= 0)
+        {
+            QHash<quint64, int>::const_iterator it = fieldChannels.constFind(key);
+            if (it != fieldChannels.constEnd()) return it.value();
+        }
+        else
+        {
+            QHash<ContentKey, int>::const_iterator it = contentChannels.constFind(contentKey);
+            if (it != contentChannels.constEnd()) return it.value();
+        }
+    }
+
+    int channelId;
+    {
+        QWriteLocker locker(&lock);
+        // Another thread may have registered the channel in between
+        if (field >= 0 && fieldChannels.contains(key)) return fieldChannels.value(key);
+        if (field < 0 && contentChannels.contains(contentKey)) return contentChannels.value(contentKey);
+
+        TelemetryChannel channel;
+        channel.systemId = systemId;
+        channel.componentId = componentId;
+        channel.messageId = messageId;
+        channel.field = field;
+        channel.name = name;
+        channel.unit = unit;
+        channel.type = type;
+
+        channelId = channels.size();
+        channels.append(channel);
+        if (field >= 0) fieldChannels.insert(key, channelId);
+        else contentChannels.insert(contentKey, channelId);
+        // Keep the first channel if several of a system share a name
+        const QString namedKey = namedChannelKey(systemId, name, unit);
+        if (!namedChannels.contains(namedKey)) namedChannels.insert(namedKey, channelId);
+    }
+
+    emit channelAdded(channelId, name, unit);
+    return channelId;
+}
+
+void TelemetryChannelRegistry::addChannelAlias(int channelId, const QString& name)
+{
+    QWriteLocker locker(&lock);
+    if (channelId < 0 || channelId >= channels.size()) return;
+    TelemetryChannel& channel = channels[channelId];
+    if (channel.name == name) return;
+    channel.name = name;
+    const QString namedKey = namedChannelKey(channel.systemId, name, channel.unit);
+    if (!namedChannels.contains(namedKey)) namedChannels.insert(namedKey, channelId);
+}
+
+int TelemetryChannelRegistry::findChannel(int systemId, const QString& name, const QString& unit) const
+{
+    QReadLocker locker(&lock);
+    return namedChannels.value(namedChannelKey(systemId, name, unit), -1);
+}
+
+TelemetryChannel TelemetryChannelRegistry::getChannel(int channelId) const
+{
+    QReadLocker locker(&lock);
+    return channels.value(channelId);
+}
+
+int TelemetryChannelRegistry::getChannelCount() const
+{
+    QReadLocker locker(&lock);
+    return channels.size();
+}
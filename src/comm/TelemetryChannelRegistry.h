@@ -0,0 +1,158 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Definition of class TelemetryChannelRegistry
+ *
+ */
+
+#ifndef TELEMETRYCHANNELREGISTRY_H
+#define TELEMETRYCHANNELREGISTRY_H
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QMetaType>
+#include <QReadWriteLock>
+#include "QGCMAVLink.h"
+
+/**
+ * @brief Description of one telemetry channel
+ */
+struct TelemetryChannel
+{
+    TelemetryChannel() :
+        systemId(-1), componentId(-1), messageId(-1), field(-1), type(MAVLINK_TYPE_DOUBLE) {}
+
+    int systemId;     ///< System sending the channel
+    int componentId;  ///< Component sending the channel
+    int messageId;    ///< Message carrying the channel
+    int field;        ///< Field index within the message, -1 for fields named by the message content
+    QString name;     ///< Full name, e.g. "M1:ATTITUDE.roll"
+    QString unit;     ///< Unit or type name
+    int type;         ///< MAVLINK_TYPE_* of the field
+
+    bool isInteger() const {
+        return type != MAVLINK_TYPE_FLOAT && type != MAVLINK_TYPE_DOUBLE;
+    }
+};
+
+/**
+ * @brief One value of a telemetry channel
+ */
+struct TelemetrySample
+{
+    int channel;      ///< Channel id from the TelemetryChannelRegistry
+    quint64 time;     ///< Time in milliseconds
+    double value;
+};
+
+typedef QVector<TelemetrySample> TelemetrySampleList;
+Q_DECLARE_METATYPE(TelemetrySampleList)
+
+/**
+ * @brief Global registry of telemetry channels
+ *
+ * Every value which can be plotted or displayed gets a compact integer
+ * channel id, handed out once for each (system, component, message,
+ * field). Producers emit batches of (channel, time, value) samples and
+ * consumers index their own state by the channel id, names and units
+ * are only looked up when a channel is seen for the first time.
+ *
+ * Channel ids are never reused, registering and looking up is
+ * thread-safe.
+ */
+class TelemetryChannelRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    static TelemetryChannelRegistry* instance();
+
+    /**
+     * @brief Get the id of a channel, registering it if it is new
+     *
+     * Channels with a field index are identified by system, component,
+     * message and field. Channels named by the message content (field -1)
+     * are identified by system, component, message, name and unit.
+     */
+    int registerChannel(int systemId, int componentId, int messageId, int field,
+                        const QString& name, const QString& unit, int type);
+    /**
+     * @brief Give a registered channel a further name
+     *
+     * The description of the channel takes the new name, findChannel()
+     * finds the channel under all of its names.
+     */
+    void addChannelAlias(int channelId, const QString& name);
+    /** @brief Id of the channel of a system with this name and unit, -1 if there is none */
+    int findChannel(int systemId, const QString& name, const QString& unit) const;
+    /** @brief Description of a channel, a default constructed one for unknown ids */
+    TelemetryChannel getChannel(int channelId) const;
+    /** @brief Number of channel ids handed out so far */
+    int getChannelCount() const;
+
+signals:
+    /** @brief A new channel was registered */
+    void channelAdded(int channelId, const QString& name, const QString& unit);
+
+protected:
+    TelemetryChannelRegistry();
+
+    static quint64 channelKey(int systemId, int componentId, int messageId, int field) {
+        return (static_cast<quint64>(systemId & 0xFF) << 56) | (static_cast<quint64>(componentId & 0xFF) << 48) |
+               (static_cast<quint64>(messageId & 0xFF) << 40) | static_cast<quint32>(field);
+    }
+    /** @brief Name and unit are separated by a character which is part of neither */
+    static QString namedChannelKey(int systemId, const QString& name, const QString& unit) {
+        return QString::number(systemId) + '\n' + name + '\n' + unit;
+    }
+
+    /** @brief Key of a channel named by the message content, built without copying the strings */
+    struct ContentKey
+    {
+        ContentKey(quint64 key, const QString& name, const QString& unit) :
+            key(key), name(name), unit(unit) {}
+        quint64 key;
+        QString name;
+        QString unit;
+        bool operator==(const ContentKey& other) const {
+            return key == other.key && name == other.name && unit == other.unit;
+        }
+    };
+    friend uint qHash(const ContentKey& key);
+
+    mutable QReadWriteLock lock;
+    QVector<TelemetryChannel> channels;     ///< Channel descriptions, indexed by channel id
+    QHash<quint64, int> fieldChannels;      ///< Ids of channels with a field index
+    QHash<ContentKey, int> contentChannels; ///< Ids of channels named by the message content
+    QHash<QString, int> namedChannels;      ///< Ids of all channels by system, name and unit
+};
+
+inline uint qHash(const TelemetryChannelRegistry::ContentKey& key)
+{
+    return qHash(key.key) ^ qHash(key.name) ^ (qHash(key.unit) << 1);
+}
+
+#endif // TELEMETRYCHANNELREGISTRY_H
@@ -211,15 +211,15 @@ void UDPLink::readBytes()
 {
     while (socket->hasPendingDatagrams())
     {
-        QByteArray datagram;
-        datagram.resize(socket->pendingDatagramSize());
+        // Reuse the datagram buffer, it only grows
+        const qint64 size = socket->pendingDatagramSize();
+        if (datagramBuffer.size() < size) datagramBuffer.resize(size);
 
         QHostAddress sender;
         quint16 senderPort;
-        socket->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
+        const qint64 length = socket->readDatagram(datagramBuffer.data(), size, &sender, &senderPort);
 
-        // FIXME TODO Check if this method is better than retrieving the data by individual processes
-        emit bytesReceived(this, datagram);
+        pushReceivedBytes(datagramBuffer.constData(), length);
 
 //        // Echo data for debugging purposes
 //        std::cerr << __FILE__ << __LINE__ << "Received datagram:" << std::endl;
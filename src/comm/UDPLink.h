@@ -35,6 +35,7 @@ This file is part of the QGROUNDCONTROL project
 #include <QList>
 #include <QMap>
 #include <QMutex>
+#include <QByteArray>
 #include <QUdpSocket>
 #include <LinkInterface.h>
 #include <configuration.h>
@@ -115,6 +116,7 @@ protected:
     bool connectState;
     QList<QHostAddress> hosts;
     QList<quint16> ports;
+    QByteArray datagramBuffer; ///< Receive buffer reused for all datagrams
 
     quint64 bitsSentTotal;
     quint64 bitsSentCurrent;
@@ -237,14 +237,8 @@ void XbeeLink::readBytes()
 	xbeePkt = xbee_getpacketwait(this->m_xbeeCon);
 	if(!(NULL==xbeePkt))
 	{
-		QByteArray data;
 		unsigned int lengthData(xbeePkt->datalen);
-		for(unsigned int i=0;i<=lengthData;i++)
-		{
-			data.push_back(xbeePkt->data[i]);
-		}
-		qDebug() << data;
-		emit bytesReceived(this,data);
+		this->pushReceivedBytes(reinterpret_cast<const char*>(xbeePkt->data), lengthData+1);
 	}
 }
 
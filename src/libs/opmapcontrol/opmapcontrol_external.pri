@@ -30,6 +30,8 @@ HEADERS += opmapcontrol.h \
            src/core/rawtile.h \
            src/core/size.h \
            src/core/tilecachequeue.h \
+           src/core/tilefetcher.h \
+           src/core/tilepack.h \
            src/core/urlfactory.h \
            src/internals/copyrightstrings.h \
            src/internals/core.h \
@@ -49,9 +51,12 @@ HEADERS += opmapcontrol.h \
            src/mapwidget/mapgraphicitem.h \
            src/mapwidget/mapripform.h \
            src/mapwidget/mapripper.h \
+           src/mapwidget/mapprefetcher.h \
+           src/mapwidget/mappacker.h \
            src/mapwidget/opmapwidget.h \
            src/mapwidget/trailitem.h \
            src/mapwidget/traillineitem.h \
+           src/mapwidget/trailpathitem.h \
            src/mapwidget/uavitem.h \
            src/mapwidget/uavmapfollowtype.h \
            src/mapwidget/uavtrailtype.h \
@@ -79,6 +84,8 @@ SOURCES += src/core/alllayersoftype.cpp \
            src/core/rawtile.cpp \
            src/core/size.cpp \
            src/core/tilecachequeue.cpp \
+           src/core/tilefetcher.cpp \
+           src/core/tilepack.cpp \
            src/core/urlfactory.cpp \
            src/internals/core.cpp \
            src/internals/loadtask.cpp \
@@ -96,9 +103,12 @@ SOURCES += src/core/alllayersoftype.cpp \
            src/mapwidget/mapgraphicitem.cpp \
            src/mapwidget/mapripform.cpp \
            src/mapwidget/mapripper.cpp \
+           src/mapwidget/mapprefetcher.cpp \
+           src/mapwidget/mappacker.cpp \
            src/mapwidget/opmapwidget.cpp \
            src/mapwidget/trailitem.cpp \
            src/mapwidget/traillineitem.cpp \
+           src/mapwidget/trailpathitem.cpp \
            src/mapwidget/uavitem.cpp \
            src/mapwidget/waypointitem.cpp \
            src/internals/projections/lks94projection.cpp \
@@ -10,6 +10,8 @@ SOURCES += opmaps.cpp \
     providerstrings.cpp \
     cacheitemqueue.cpp \
     tilecachequeue.cpp \
+    tilefetcher.cpp \
+    tilepack.cpp \
     alllayersoftype.cpp \
     urlfactory.cpp \
     placemark.cpp \
@@ -30,6 +32,8 @@ HEADERS += opmaps.h \
     providerstrings.h \
     cacheitemqueue.h \
     tilecachequeue.h \
+    tilefetcher.h \
+    tilepack.h \
     alllayersoftype.h \
     urlfactory.h \
     geodecoderstatus.h \
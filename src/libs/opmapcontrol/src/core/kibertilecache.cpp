@@ -26,44 +26,145 @@
 */
 #include "kibertilecache.h"
 
-//TODO add readwrite lock
-
 namespace core {
-    KiberTileCache::KiberTileCache()
+    KiberTileCache::KiberTileCache():
+        _MemoryCacheCapacity(22),
+        hits(0),
+        misses(0),
+        evictions(0)
+    {
+        for(int i=0;i<shardCount;++i)
+            shards[i].bytes=0;
+    }
+
+    KiberTileCache::~KiberTileCache()
     {
-        memoryCacheSize = 0;
-        _MemoryCacheCapacity = 22;
+        Clear();
     }
 
     void KiberTileCache::setMemoryCacheCapacity(const int &value)
     {
-        kiberCacheLock.lockForWrite();
-        _MemoryCacheCapacity=value;
-        kiberCacheLock.unlock();
+        _MemoryCacheCapacity.fetchAndStoreRelaxed(value);
+        RemoveMemoryOverload();
     }
     int KiberTileCache::MemoryCacheCapacity()
     {
-        kiberCacheLock.lockForRead();
-        return _MemoryCacheCapacity;
-        kiberCacheLock.unlock();
+        return _MemoryCacheCapacity.fetchAndAddRelaxed(0);
     }
 
-    void KiberTileCache::RemoveMemoryOverload()
+    qint64 KiberTileCache::ShardCapacity()
     {
-        while(MemoryCacheSize()>MemoryCacheCapacity())
+        return (qint64)MemoryCacheCapacity()*1048576/shardCount;
+    }
+
+    double KiberTileCache::MemoryCacheSize()
+    {
+        // Summed from the shards, a single atomic int would wrap at 2 GB
+        qint64 bytes=0;
+        for(int i=0;i<shardCount;++i)
         {
-            if(cachequeue.count()>0 && list.count()>0)
-            {
+            QReadLocker locker(&shards[i].lock);
+            bytes+=shards[i].bytes;
+        }
+        return bytes/1048576.0;
+    }
+
+    int KiberTileCache::TileCount()
+    {
+        int count=0;
+        for(int i=0;i<shardCount;++i)
+        {
+            QReadLocker locker(&shards[i].lock);
+            count+=shards[i].tiles.count();
+        }
+        return count;
+    }
+
+    QByteArray KiberTileCache::GetTile(const RawTile &tile)
+    {
+        Shard& shard=ShardFor(tile);
+        QReadLocker locker(&shard.lock);
+        Entry* entry=shard.tiles.value(tile,0);
+        if(!entry)
+        {
+            misses.fetchAndAddRelaxed(1);
+            return QByteArray();
+        }
+        // Readers only set the flag, the order is changed by writers
+        entry->referenced.fetchAndStoreRelaxed(1);
+        hits.fetchAndAddRelaxed(1);
+        return entry->pic;
+    }
+
+    void KiberTileCache::AddTile(const RawTile &tile,const QByteArray &pic)
+    {
+        Shard& shard=ShardFor(tile);
+        QWriteLocker locker(&shard.lock);
+        Entry* entry=shard.tiles.value(tile,0);
+        if(entry)
+        {
+            shard.bytes+=pic.size()-entry->pic.size();
+            entry->pic=pic;
+            entry->referenced.fetchAndStoreRelaxed(1);
+        }
+        else
+        {
+            entry=new Entry;
+            entry->pic=pic;
+            entry->referenced=0;
+            shard.tiles.insert(tile,entry);
+            shard.order.enqueue(tile);
+            shard.bytes+=pic.size();
+        }
 #ifdef DEBUG_MEMORY_CACHE
-                qDebug()<<"Cleaning Memory cache="<<" started with "<<cachequeue.count()<<" tile "<<"ocupying "<<memoryCacheSize<<" bytes";
+        qDebug()<<"Current shard memory="<<shard.bytes<<" bytes";
 #endif
-                RawTile first=list.dequeue();
-                memoryCacheSize-=cachequeue.value(first).size();
-                cachequeue.remove(first);
+        Evict(shard,ShardCapacity());
+    }
+
+    void KiberTileCache::Evict(Shard &shard,qint64 capacity)
+    {
+        while(shard.bytes>capacity && !shard.order.isEmpty())
+        {
+            RawTile oldest=shard.order.dequeue();
+            Entry* entry=shard.tiles.value(oldest,0);
+            if(!entry)
+                continue;
+            // Second chance for tiles used since the last pass
+            if(entry->referenced.fetchAndStoreRelaxed(0))
+            {
+                shard.order.enqueue(oldest);
+                continue;
             }
+            shard.bytes-=entry->pic.size();
+            shard.tiles.remove(oldest);
+            delete entry;
+            evictions.fetchAndAddRelaxed(1);
+        }
+    }
+
+    void KiberTileCache::RemoveMemoryOverload()
+    {
+        const qint64 capacity=ShardCapacity();
+        for(int i=0;i<shardCount;++i)
+        {
+            QWriteLocker locker(&shards[i].lock);
+            Evict(shards[i],capacity);
         }
 #ifdef DEBUG_MEMORY_CACHE
-        qDebug()<<"Cleaning Memory cache="<<" ended with "<<cachequeue.count()<<" tile "<<"ocupying "<<memoryCacheSize<<" bytes";
+        qDebug()<<"Cleaning Memory cache="<<" ended with "<<TileCount()<<" tile "<<"ocupying "<<MemoryCacheSize()<<" MB";
 #endif
     }
+
+    void KiberTileCache::Clear()
+    {
+        for(int i=0;i<shardCount;++i)
+        {
+            QWriteLocker locker(&shards[i].lock);
+            qDeleteAll(shards[i].tiles);
+            shards[i].tiles.clear();
+            shards[i].order.clear();
+            shards[i].bytes=0;
+        }
+    }
 }
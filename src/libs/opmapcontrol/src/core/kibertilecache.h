@@ -31,24 +31,76 @@
 #include <QMutex>
 #include <QReadWriteLock>
 #include <QQueue>
+#include <QHash>
+#include <QAtomicInt>
 #include <QDebug>
 #include "debugheader.h"
 namespace core {
+    /**
+    * @brief Memory cache of encoded tiles, bounded in bytes
+    *
+    * The cache is split into shards by tile hash, each with its own lock,
+    * so loader threads working on different tiles do not contend. Lookups
+    * only take the read lock of their shard and mark the tile as recently
+    * used. Eviction follows the second chance (CLOCK) approximation of
+    * LRU: tiles are kept in insertion order, the oldest tile is evicted
+    * unless it was used since it was last looked at, in which case it
+    * moves to the back. Every operation is O(1) amortized.
+    */
     class KiberTileCache
     {
     public:
         KiberTileCache();
+        ~KiberTileCache();
 
+        /**
+        * @brief Sets the capacity in MB, evicts tiles if the cache is larger
+        */
         void setMemoryCacheCapacity(const int &value);
         int MemoryCacheCapacity();
-        double MemoryCacheSize(){return memoryCacheSize/1048576.0;}
+        /**
+        * @brief Memory currently used by tiles in MB
+        */
+        double MemoryCacheSize();
+        /**
+        * @brief Evicts tiles until every shard is within its capacity
+        */
         void RemoveMemoryOverload();
-        QReadWriteLock kiberCacheLock;
-        QHash <RawTile,QByteArray> cachequeue;
-        QQueue <RawTile> list;
-        long memoryCacheSize;
+
+        QByteArray GetTile(const RawTile &tile);
+        void AddTile(const RawTile &tile,const QByteArray &pic);
+        void Clear();
+
+        int Hits(){return hits.fetchAndAddRelaxed(0);}
+        int Misses(){return misses.fetchAndAddRelaxed(0);}
+        int Evictions(){return evictions.fetchAndAddRelaxed(0);}
+        int TileCount();
     private:
-        int _MemoryCacheCapacity;
+        struct Entry
+        {
+            QByteArray pic;
+            QAtomicInt referenced;  ///< Used since the eviction scan last passed it
+        };
+        struct Shard
+        {
+            QReadWriteLock lock;
+            QHash<RawTile,Entry*> tiles;
+            QQueue<RawTile> order;  ///< Eviction order, oldest first
+            qint64 bytes;
+        };
+        static const int shardCount=16;
+        Shard& ShardFor(const RawTile &tile){return shards[qHash(tile)&(shardCount-1)];}
+        /**
+        * @brief Evicts from a shard until it fits, has to be called with the shard write-locked
+        */
+        void Evict(Shard &shard,qint64 capacity);
+        qint64 ShardCapacity();
+
+        Shard shards[shardCount];
+        QAtomicInt _MemoryCacheCapacity;  ///< In MB
+        QAtomicInt hits;
+        QAtomicInt misses;
+        QAtomicInt evictions;
 
     };
 
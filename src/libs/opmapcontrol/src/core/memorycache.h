@@ -43,7 +43,6 @@ namespace core {
         KiberTileCache TilesInMemory;
         QByteArray GetTileFromMemoryCache(const RawTile &tile);
         void AddTileToMemoryCache(const RawTile &tile, const QByteArray &pic);
-        QReadWriteLock kiberCacheLock;
     };
 
 
@@ -55,13 +55,48 @@ namespace core {
 
     QByteArray OPMaps::GetImageFrom(const MapType::Types &type,const Point &pos,const int &zoom)
     {
-#ifdef DEBUG_TIMINGS
-        QTime time;
-        time.restart();
-#endif
 #ifdef DEBUG_GMAPS
         qDebug()<<"Entered GetImageFrom";
 #endif //DEBUG_GMAPS
+        QByteArray ret=GetCachedImage(type,pos,zoom);
+        if(ret.isEmpty() && accessmode!=AccessMode::CacheOnly)
+        {
+            QEventLoop q;
+            QNetworkReply *reply;
+            QNetworkAccessManager network;
+            QTimer tT;
+            tT.setSingleShot(true);
+            connect(&network, SIGNAL(finished(QNetworkReply*)),
+                    &q, SLOT(quit()));
+            connect(&tT, SIGNAL(timeout()), &q, SLOT(quit()));
+            network.setProxy(Proxy);
+#ifdef DEBUG_GMAPS
+            qDebug()<<"Try Tile from the Internet";
+#endif //DEBUG_GMAPS
+            reply=network.get(MakeImageRequest(type,pos,zoom));
+            tT.start(Timeout);
+            q.exec();
+
+            if(!tT.isActive()){
+                ImageFailed(true);
+                return ret;
+            }
+            tT.stop();
+            if( (reply->error()!=QNetworkReply::NoError))
+            {
+                ImageFailed(false);
+                reply->deleteLater();
+                return ret;
+            }
+            ret=reply->readAll();
+            reply->deleteLater();
+            ImageReceived(type,pos,zoom,ret);
+        }
+        return ret;
+    }
+
+    QByteArray OPMaps::GetCachedImage(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
         QByteArray ret;
 
         if(useMemoryCache)
@@ -75,194 +110,159 @@ namespace core {
                 errorvars.lock();
                 ++diag.tilesFromMem;
                 errorvars.unlock();
+                return ret;
             }
-
         }
-        if(ret.isEmpty())
+        if(accessmode != (AccessMode::ServerOnly))
         {
 #ifdef DEBUG_GMAPS
-            qDebug()<<"Tile not in memory";
+            qDebug()<<"Try tile from DataBase";
 #endif //DEBUG_GMAPS
-            if(accessmode != (AccessMode::ServerOnly))
+            ret=Cache::Instance()->ImageCache.GetImageFromCache(type,pos,zoom);
+            if(!ret.isEmpty())
             {
+                errorvars.lock();
+                ++diag.tilesFromDB;
+                errorvars.unlock();
 #ifdef DEBUG_GMAPS
-                qDebug()<<"Try tile from DataBase";
+                qDebug()<<"Tile found in Database";
 #endif //DEBUG_GMAPS
-                ret=Cache::Instance()->ImageCache.GetImageFromCache(type,pos,zoom);
-                if(!ret.isEmpty())
+                if(useMemoryCache)
                 {
-                    errorvars.lock();
-                    ++diag.tilesFromDB;
-                    errorvars.unlock();
-#ifdef DEBUG_GMAPS
-                    qDebug()<<"Tile found in Database";
-#endif //DEBUG_GMAPS
-                    if(useMemoryCache)
-                    {
-#ifdef DEBUG_GMAPS
-                        qDebug()<<"Add Tile to memory";
-#endif //DEBUG_GMAPS
-                        AddTileToMemoryCache(RawTile(type,pos,zoom),ret);
-                    }
-                    return ret;
+                    AddTileToMemoryCache(RawTile(type,pos,zoom),ret);
                 }
             }
-            if(accessmode!=AccessMode::CacheOnly)
+        }
+        return ret;
+    }
+
+    QNetworkRequest OPMaps::MakeImageRequest(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        QNetworkRequest qheader;
+        //url	"http://vec02.maps.yandex.ru/tiles?l=map&v=2.10.2&x=7&y=5&z=3"	string
+        //"http://map3.pergo.com.tr/tile/02/000/000/007/000/000/002.png"
+        qheader.setUrl(QUrl(MakeImageUrl(type,pos,zoom,LanguageStr)));
+        qheader.setRawHeader("User-Agent",UserAgent);
+        qheader.setRawHeader("Accept","*/*");
+        switch(type)
+        {
+        case MapType::GoogleMap:
+        case MapType::GoogleSatellite:
+        case MapType::GoogleLabels:
+        case MapType::GoogleTerrain:
+        case MapType::GoogleHybrid:
             {
-                QEventLoop q;
-                QNetworkReply *reply;
-                QNetworkRequest qheader;
-                QNetworkAccessManager network;
-                QTimer tT;
-                tT.setSingleShot(true);
-                connect(&network, SIGNAL(finished(QNetworkReply*)),
-                        &q, SLOT(quit()));
-                connect(&tT, SIGNAL(timeout()), &q, SLOT(quit()));
-                network.setProxy(Proxy);
-#ifdef DEBUG_GMAPS
-                qDebug()<<"Try Tile from the Internet";
-#endif //DEBUG_GMAPS
-#ifdef DEBUG_TIMINGS
-                qDebug()<<"opmaps before make image url"<<time.elapsed();
-#endif
-                QString url=MakeImageUrl(type,pos,zoom,LanguageStr);
-#ifdef DEBUG_TIMINGS
-                qDebug()<<"opmaps after make image url"<<time.elapsed();
-#endif		//url	"http://vec02.maps.yandex.ru/tiles?l=map&v=2.10.2&x=7&y=5&z=3"	string
-                //"http://map3.pergo.com.tr/tile/02/000/000/007/000/000/002.png"
-                qheader.setUrl(QUrl(url));
-                qheader.setRawHeader("User-Agent",UserAgent);
-                qheader.setRawHeader("Accept","*/*");
-                switch(type)
-                {
-                case MapType::GoogleMap:
-                case MapType::GoogleSatellite:
-                case MapType::GoogleLabels:
-                case MapType::GoogleTerrain:
-                case MapType::GoogleHybrid:
-                    {
-                        qheader.setRawHeader("Referrer", "http://maps.google.com/");
-                    }
-                    break;
+                qheader.setRawHeader("Referrer", "http://maps.google.com/");
+            }
+            break;
 
-                case MapType::GoogleMapChina:
-                case MapType::GoogleSatelliteChina:
-                case MapType::GoogleLabelsChina:
-                case MapType::GoogleTerrainChina:
-                case MapType::GoogleHybridChina:
-                    {
-                        qheader.setRawHeader("Referrer", "http://ditu.google.cn/");
-                    }
-                    break;
+        case MapType::GoogleMapChina:
+        case MapType::GoogleSatelliteChina:
+        case MapType::GoogleLabelsChina:
+        case MapType::GoogleTerrainChina:
+        case MapType::GoogleHybridChina:
+            {
+                qheader.setRawHeader("Referrer", "http://ditu.google.cn/");
+            }
+            break;
 
-                case MapType::BingHybrid:
-                case MapType::BingMap:
-                case MapType::BingSatellite:
-                    {
-                        qheader.setRawHeader("Referrer", "http://www.bing.com/maps/");
-                    }
-                    break;
+        case MapType::BingHybrid:
+        case MapType::BingMap:
+        case MapType::BingSatellite:
+            {
+                qheader.setRawHeader("Referrer", "http://www.bing.com/maps/");
+            }
+            break;
 
-                case MapType::YahooHybrid:
-                case MapType::YahooLabels:
-                case MapType::YahooMap:
-                case MapType::YahooSatellite:
-                    {
-                        qheader.setRawHeader("Referrer", "http://maps.yahoo.com/");
-                    }
-                    break;
+        case MapType::YahooHybrid:
+        case MapType::YahooLabels:
+        case MapType::YahooMap:
+        case MapType::YahooSatellite:
+            {
+                qheader.setRawHeader("Referrer", "http://maps.yahoo.com/");
+            }
+            break;
 
-                case MapType::ArcGIS_MapsLT_Map_Labels:
-                case MapType::ArcGIS_MapsLT_Map:
-                case MapType::ArcGIS_MapsLT_OrtoFoto:
-                case MapType::ArcGIS_MapsLT_Map_Hybrid:
-                    {
-                        qheader.setRawHeader("Referrer", "http://www.maps.lt/map_beta/");
-                    }
-                    break;
+        case MapType::ArcGIS_MapsLT_Map_Labels:
+        case MapType::ArcGIS_MapsLT_Map:
+        case MapType::ArcGIS_MapsLT_OrtoFoto:
+        case MapType::ArcGIS_MapsLT_Map_Hybrid:
+            {
+                qheader.setRawHeader("Referrer", "http://www.maps.lt/map_beta/");
+            }
+            break;
 
-                case MapType::OpenStreetMapSurfer:
-                case MapType::OpenStreetMapSurferTerrain:
-                    {
-                        qheader.setRawHeader("Referrer", "http://www.mapsurfer.net/");
-                    }
-                    break;
+        case MapType::OpenStreetMapSurfer:
+        case MapType::OpenStreetMapSurferTerrain:
+            {
+                qheader.setRawHeader("Referrer", "http://www.mapsurfer.net/");
+            }
+            break;
 
-                case MapType::OpenStreetMap:
-                case MapType::OpenStreetOsm:
-                    {
-                        qheader.setRawHeader("Referrer", "http://www.openstreetmap.org/");
-                    }
-                    break;
+        case MapType::OpenStreetMap:
+        case MapType::OpenStreetOsm:
+            {
+                qheader.setRawHeader("Referrer", "http://www.openstreetmap.org/");
+            }
+            break;
 
-                case MapType::YandexMapRu:
-                    {
-                        qheader.setRawHeader("Referrer", "http://maps.yandex.ru/");
-                    }
-                    break;
-                default:
-                    break;
-                }
-                reply=network.get(qheader);
-                tT.start(Timeout);
-                q.exec();
+        case MapType::YandexMapRu:
+            {
+                qheader.setRawHeader("Referrer", "http://maps.yandex.ru/");
+            }
+            break;
+        default:
+            break;
+        }
+        return qheader;
+    }
 
-                if(!tT.isActive()){
-                    errorvars.lock();
-                    ++diag.timeouts;
-                    errorvars.unlock();
-                    return ret;
-                }
-                tT.stop();
-                if( (reply->error()!=QNetworkReply::NoError))
-                {
-                    errorvars.lock();
-                    ++diag.networkerrors;
-                    errorvars.unlock();
-                    reply->deleteLater();
-                    return ret;
-                }
-                ret=reply->readAll();
-                reply->deleteLater();//TODO can't this be global??
-                if(ret.isEmpty())
-                {
-#ifdef DEBUG_GMAPS
-                    qDebug()<<"Invalid Tile";
-#endif //DEBUG_GMAPS
-                    errorvars.lock();
-                    ++diag.emptytiles;
-                    errorvars.unlock();
-                    return ret;
-                }
-#ifdef DEBUG_GMAPS
-                qDebug()<<"Received Tile from the Internet";
-#endif //DEBUG_GMAPS
-                errorvars.lock();
-                ++diag.tilesFromNet;
-                errorvars.unlock();
-                if (useMemoryCache)
-                {
+    void OPMaps::ImageReceived(const MapType::Types &type,const Point &pos,const int &zoom,const QByteArray &img)
+    {
+        if(img.isEmpty())
+        {
 #ifdef DEBUG_GMAPS
-                    qDebug()<<"Add Tile to memory cache";
+            qDebug()<<"Invalid Tile";
 #endif //DEBUG_GMAPS
-                    AddTileToMemoryCache(RawTile(type,pos,zoom),ret);
-                }
-                if(accessmode!=AccessMode::ServerOnly)
-                {
+            errorvars.lock();
+            ++diag.emptytiles;
+            errorvars.unlock();
+            return;
+        }
 #ifdef DEBUG_GMAPS
-                    qDebug()<<"Add tile to DataBase";
+        qDebug()<<"Received Tile from the Internet";
 #endif //DEBUG_GMAPS
-                    CacheItemQueue * item=new CacheItemQueue(type,pos,ret,zoom);
-                    TileDBcacheQueue.EnqueueCacheTask(item);
-                }
+        errorvars.lock();
+        ++diag.tilesFromNet;
+        errorvars.unlock();
+        if (useMemoryCache)
+        {
+            AddTileToMemoryCache(RawTile(type,pos,zoom),img);
+        }
+        if(accessmode!=AccessMode::ServerOnly)
+        {
+            CacheItemQueue * item=new CacheItemQueue(type,pos,img,zoom);
+            TileDBcacheQueue.EnqueueCacheTask(item);
+        }
+    }
 
+    void OPMaps::StoreImage(const MapType::Types &type,const Point &pos,const int &zoom,const QByteArray &img)
+    {
+        errorvars.lock();
+        ++diag.tilesFromNet;
+        errorvars.unlock();
+        CacheItemQueue * item=new CacheItemQueue(type,pos,img,zoom);
+        TileDBcacheQueue.EnqueueCacheTask(item);
+    }
 
-            }
-        }
-#ifdef DEBUG_GMAPS
-        qDebug()<<"Entered GetImageFrom";
-#endif //DEBUG_GMAPS
-        return ret;
+    void OPMaps::ImageFailed(const bool &timeout)
+    {
+        errorvars.lock();
+        if(timeout)
+            ++diag.timeouts;
+        else
+            ++diag.networkerrors;
+        errorvars.unlock();
     }
 
     bool OPMaps::ExportToGMDB(const QString &file)
@@ -61,7 +61,30 @@ namespace core {
         /// </summary>
 
 
+        /// <summary>
+        /// Tile from the caches or, if missing, from the server. Blocks until the tile arrived
+        /// </summary>
         QByteArray GetImageFrom(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        /// <summary>
+        /// Tile from the memory or database cache only, empty if it has to be fetched
+        /// </summary>
+        QByteArray GetCachedImage(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        /// <summary>
+        /// Server request of a tile with the headers the provider expects
+        /// </summary>
+        QNetworkRequest MakeImageRequest(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        /// <summary>
+        /// Count a tile received from the server and add it to the caches
+        /// </summary>
+        void ImageReceived(const MapType::Types &type,const core::Point &pos,const int &zoom,const QByteArray &img);
+        /// <summary>
+        /// Count a tile received from the server and write it to the database cache only, for prefetching
+        /// </summary>
+        void StoreImage(const MapType::Types &type,const core::Point &pos,const int &zoom,const QByteArray &img);
+        /// <summary>
+        /// Count a failed server request
+        /// </summary>
+        void ImageFailed(const bool &timeout);
         bool UseMemoryCache(){return useMemoryCache;}//TODO
         void setUseMemoryCache(const bool& value){useMemoryCache=value;}
         void setLanguage(const LanguageType::Types& language){Language=language;}//TODO
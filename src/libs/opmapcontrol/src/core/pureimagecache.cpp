@@ -27,19 +27,130 @@
 #include "pureimagecache.h"
 #include <QDateTime>
 #include <QSettings>
+#include <QReadLocker>
 //#define DEBUG_PUREIMAGECACHE
 namespace core {
     qlonglong PureImageCache::ConnCounter=0;
 
-    PureImageCache::PureImageCache()
+    PureImageCache::PureImageCache():generation(0)
     {
 
     }
 
+    PureImageCache::~PureImageCache()
+    {
+        ClosePacks();
+    }
+
+    PureImageCache::Connection::Connection(const QString &name,int generation):
+        name(name),
+        generation(generation),
+        inTransaction(false),
+        getTile(0),
+        hasTile(0),
+        insertTile(0),
+        insertTileData(0)
+    {
+
+    }
+
+    PureImageCache::Connection::~Connection()
+    {
+        // Statements and handle have to be gone before the connection is removed
+        delete getTile;
+        delete hasTile;
+        delete insertTile;
+        delete insertTileData;
+        if(db.isOpen())
+        {
+            if(inTransaction)
+                db.commit();
+            db.close();
+        }
+        db=QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+    }
+
+    bool PureImageCache::Connection::Open(const QString &file)
+    {
+        db=QSqlDatabase::addDatabase("QSQLITE",name);
+        db.setDatabaseName(file);
+        // Wait for the writer instead of failing, shared cache is not used
+        // since its table locks would serialize readers and the writer again
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+        if(!db.open())
+            return false;
+        {
+            QSqlQuery query(db);
+            // Ignored by SQLite versions without WAL support
+            query.exec("PRAGMA journal_mode=WAL");
+            query.exec("PRAGMA synchronous=NORMAL");
+            // Older caches were created without it, every lookup scanned the whole table
+            query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+        }
+        getTile=new QSqlQuery(db);
+        getTile->prepare("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=?)");
+        hasTile=new QSqlQuery(db);
+        hasTile->prepare("SELECT 1 FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=?");
+        insertTile=new QSqlQuery(db);
+        insertTile->prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
+        insertTileData=new QSqlQuery(db);
+        insertTileData->prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
+        return true;
+    }
+
+    PureImageCache::Connection* PureImageCache::ThreadConnection()
+    {
+        if(gtilecache.isEmpty()|gtilecache.isNull())
+            return 0;
+        Connection* cn=connections.localData();
+        if(cn && cn->generation==generation)
+            return cn;
+
+        // First use in this thread or the cache directory changed,
+        // the old connection is deleted by setLocalData
+        Mcounter.lock();
+        qlonglong id=++ConnCounter;
+        Mcounter.unlock();
+        cn=new Connection(QString("PureImageCache%1").arg(id),generation);
+        connections.setLocalData(cn);
+        if(!cn->Open(gtilecache+"Data.qmdb"))
+        {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug()<<"ThreadConnection: Unable to open database"<<cn->db.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+            connections.setLocalData(0);
+            return 0;
+        }
+        return cn;
+    }
+
+    bool PureImageCache::BeginTransaction()
+    {
+        QReadLocker locker(&lock);
+        Connection* cn=ThreadConnection();
+        if(!cn || cn->inTransaction)
+            return false;
+        cn->inTransaction=cn->db.transaction();
+        return cn->inTransaction;
+    }
+
+    bool PureImageCache::CommitTransaction()
+    {
+        QReadLocker locker(&lock);
+        Connection* cn=ThreadConnection();
+        if(!cn || !cn->inTransaction)
+            return false;
+        cn->inTransaction=false;
+        return cn->db.commit();
+    }
+
     void PureImageCache::setGtileCache(const QString &value)
     {
         lock.lockForWrite();
         gtilecache=value;
+        // Connections of all threads reopen on their next use
+        ++generation;
         QDir d;
         if(!d.exists(gtilecache))
         {
@@ -58,12 +169,42 @@ namespace core {
                 CreateEmptyDB(db);
             }
         }
+        LoadPacks();
         lock.unlock();
     }
     QString PureImageCache::GtileCache()
     {
         return gtilecache;
     }
+    QString PureImageCache::PacksLocation()
+    {
+        return gtilecache+"packs"+QDir::separator();
+    }
+    void PureImageCache::LoadPacks()
+    {
+        ClosePacks();
+        if(gtilecache.isEmpty())
+            return;
+        QDir dir(PacksLocation());
+        foreach(QString name,dir.entryList(QStringList()<<"*.tilepack",QDir::Files,QDir::Name))
+        {
+            TilePack* pack=new TilePack;
+            if(!pack->Open(dir.filePath(name)) || packs.contains(pack->Type()))
+            {
+#ifdef DEBUG_PUREIMAGECACHE
+                qDebug()<<"LoadPacks: Ignoring"<<name;
+#endif //DEBUG_PUREIMAGECACHE
+                delete pack;
+                continue;
+            }
+            packs.insert(pack->Type(),pack);
+        }
+    }
+    void PureImageCache::ClosePacks()
+    {
+        qDeleteAll(packs);
+        packs.clear();
+    }
 
 
     bool PureImageCache::CreateEmptyDB(const QString &file)
@@ -171,124 +312,110 @@ namespace core {
     }
     bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type,const Point &pos,const int &zoom)
     {
-        if(gtilecache.isEmpty()|gtilecache.isNull())
-            return false;
-        lock.lockForRead();
+        QReadLocker locker(&lock);
 #ifdef DEBUG_PUREIMAGECACHE
         qDebug()<<"PutImageToCache Start:";//<<pos;
 #endif //DEBUG_PUREIMAGECACHE
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
-        {
-            QSqlDatabase cn;
-            cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-            QString db=gtilecache+"Data.qmdb";
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if(cn.open())
-            {
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                    query.addBindValue(pos.X());
-                    query.addBindValue(pos.Y());
-                    query.addBindValue(zoom);
+        Connection* cn=ThreadConnection();
+        if(!cn)
+            return false;
+        // Both rows or none, and a single sync for both
+        bool ownTransaction=!cn->inTransaction && cn->db.transaction();
 
-                    query.addBindValue((int)type);
-                    query.addBindValue(QDateTime::currentDateTime().toString());
-                    query.exec();
-                }
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                    query.addBindValue(tile);
-                    query.exec();
-                }
-                cn.close();
-            }
+        cn->insertTile->addBindValue(pos.X());
+        cn->insertTile->addBindValue(pos.Y());
+        cn->insertTile->addBindValue(zoom);
+        cn->insertTile->addBindValue((int)type);
+        cn->insertTile->addBindValue(QDateTime::currentDateTime().toString());
+        bool ret=cn->insertTile->exec();
+        if(ret)
+        {
+            cn->insertTileData->addBindValue(tile);
+            ret=cn->insertTileData->exec();
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
-        lock.unlock();
-        return true;
+#ifdef DEBUG_PUREIMAGECACHE
+        if(!ret)
+            qDebug()<<"PutImageToCache: "<<cn->insertTile->lastError().driverText()<<cn->insertTileData->lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+        if(ownTransaction)
+        {
+            if(ret)
+                cn->db.commit();
+            else
+                cn->db.rollback();
+        }
+        return ret;
     }
     QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
     {
-        lock.lockForRead();
+        QReadLocker locker(&lock);
         QByteArray ar;
-        if(gtilecache.isEmpty()|gtilecache.isNull())
-            return ar;
-        QString dir=gtilecache;
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"Cache dir="<<dir<<" Try to GET:"<<pos.X()+","+pos.Y();
+        qDebug()<<"Cache dir="<<gtilecache<<" Try to GET:"<<pos.X()+","+pos.Y();
 #endif //DEBUG_PUREIMAGECACHE
-
-            QString db=dir+"Data.qmdb";
-			{
-				QSqlDatabase cn;
-			
-				cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-
-	            cn.setDatabaseName(db);
-		        cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-			    if(cn.open())
-				{
-					QSqlQuery query(cn);
-					query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int) type));
-					query.next();
-					if(query.isValid())
-					{
-						ar=query.value(0).toByteArray();
-					}
-					cn.close();
-				}
-			}
-			QSqlDatabase::removeDatabase(QString::number(id));
-        lock.unlock();
+        TilePack* pack=packs.value(type);
+        if(pack)
+        {
+            ar=pack->GetImage(pos,zoom);
+            if(!ar.isEmpty())
+                return ar;
+        }
+        Connection* cn=ThreadConnection();
+        if(!cn)
+            return ar;
+        cn->getTile->addBindValue(pos.X());
+        cn->getTile->addBindValue(pos.Y());
+        cn->getTile->addBindValue(zoom);
+        cn->getTile->addBindValue((int) type);
+        if(cn->getTile->exec() && cn->getTile->next())
+        {
+            ar=cn->getTile->value(0).toByteArray();
+        }
+        // Release the read snapshot, the statement stays prepared
+        cn->getTile->finish();
         return ar;
     }
+    bool PureImageCache::HasImage(MapType::Types type, Point pos, int zoom)
+    {
+        QReadLocker locker(&lock);
+        TilePack* pack=packs.value(type);
+        if(pack && pack->HasImage(pos,zoom))
+            return true;
+        Connection* cn=ThreadConnection();
+        if(!cn)
+            return false;
+        cn->hasTile->addBindValue(pos.X());
+        cn->hasTile->addBindValue(pos.Y());
+        cn->hasTile->addBindValue(zoom);
+        cn->hasTile->addBindValue((int) type);
+        bool ret=cn->hasTile->exec() && cn->hasTile->next();
+        cn->hasTile->finish();
+        return ret;
+    }
     void PureImageCache::deleteOlderTiles(int const& days)
     {
-        if(gtilecache.isEmpty()|gtilecache.isNull())
+        QReadLocker locker(&lock);
+        Connection* cn=ThreadConnection();
+        if(!cn)
             return;
         QList<long> add;
-        bool ret=true;
-        QString dir=gtilecache;
         {
-            QString db=dir+"Data.qmdb";
-            ret=QFileInfo(db).exists();
-            if(ret)
+            QSqlQuery query(cn->db);
+            query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
+            while(query.next())
             {
-                QSqlDatabase cn;
-                Mcounter.lock();
-                qlonglong id=++ConnCounter;
-                Mcounter.unlock();
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
-                {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
-                        while(query.next())
-                        {
-                            if(QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime())>days)
-                                add.append(query.value(0).toLongLong());
-                        }
-                        foreach(long i,add)
-                        {
-                            query.exec(QString("DELETE FROM Tiles WHERE id = %1;").arg(i));
-                        }
-                    }
-
-                    cn.close();
-                }
-                QSqlDatabase::removeDatabase(QString::number(id));
+                if(QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime())>days)
+                    add.append(query.value(0).toLongLong());
+            }
+            bool ownTransaction=!cn->inTransaction && cn->db.transaction();
+            query.prepare("DELETE FROM Tiles WHERE id = ?");
+            foreach(long i,add)
+            {
+                query.addBindValue((qlonglong)i);
+                query.exec();
             }
+            if(ownTransaction)
+                cn->db.commit();
         }
     }
     // PureImageCache::ExportMapDataToDB("C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data.qmdb","C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data2.qmdb");
@@ -346,5 +473,65 @@ namespace core {
         return true;
 
     }
+    int PureImageCache::ExportMapDataToPacks(QString sourceFile, QString destDir, volatile bool *cancel)
+    {
+        int written=0;
+        QStringList packFiles;
+        QDir().mkpath(destDir);
+        // Exports of several caches may run at the same time
+        Mcounter.lock();
+        qlonglong id=++ConnCounter;
+        Mcounter.unlock();
+        QString connectionName=QString("PureImageCachePacks%1").arg(id);
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE",connectionName);
+            db.setDatabaseName(sourceFile);
+            if(!db.open())
+                written=-1;
+            else
+            {
+                QList<int> types;
+                {
+                    QSqlQuery query(db);
+                    query.exec("SELECT DISTINCT Type FROM Tiles");
+                    while(query.next())
+                        types.append(query.value(0).toInt());
+                }
+                foreach(int type,types)
+                {
+                    if(cancel && *cancel)
+                        break;
+                    QString name=MapType::StrByType((MapType::Types)type);
+                    if(name.isEmpty())
+                        name=QString::number(type);
+                    QString fileName=QDir(destDir).filePath(name+".tilepack");
+                    if(TilePack::Write(db,(MapType::Types)type,fileName+".tmp",cancel))
+                        packFiles.append(fileName);
+                }
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+        if(packFiles.isEmpty())
+            return written;
+        // Mapped files can not be replaced on Windows, the packs in use are closed meanwhile
+        bool inUse=QDir(destDir)==QDir(PacksLocation());
+        if(inUse)
+        {
+            lock.lockForWrite();
+            ClosePacks();
+        }
+        foreach(QString fileName,packFiles)
+        {
+            if(TilePack::Replace(fileName+".tmp",fileName))
+                ++written;
+        }
+        if(inUse)
+        {
+            LoadPacks();
+            lock.unlock();
+        }
+        return written;
+    }
 
 }
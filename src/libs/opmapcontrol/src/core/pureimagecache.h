@@ -42,24 +42,94 @@
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
+#include <QHash>
+#include "tilepack.h"
 namespace core {
+    /**
+    * Every thread using the cache gets its own database connection, which
+    * stays open together with its prepared statements until the thread
+    * finishes or the cache directory changes. The database runs in WAL
+    * mode so readers do not wait for the tile writer.
+    *
+    * Tile packs in the packs subdirectory of the cache are looked up before
+    * the database, see TilePack.
+    */
     class PureImageCache
     {
 
     public:
         PureImageCache();
+        ~PureImageCache();
         static bool CreateEmptyDB(const QString &file);
         bool PutImageToCache(const QByteArray &tile,const MapType::Types &type,const core::Point &pos, const int &zoom);
         QByteArray GetImageFromCache(MapType::Types type, core::Point pos, int zoom);
+        /**
+        * @brief True if the tile is in the cache, does not read the image
+        */
+        bool HasImage(MapType::Types type, core::Point pos, int zoom);
         QString GtileCache();
         void setGtileCache(const QString &value);
         static bool ExportMapDataToDB(QString sourceFile, QString destFile);
+        /**
+        * @brief Writes one tile pack per map type of a tile cache database into a directory
+        *
+        * All packs are written next to their files first. If destDir is the packs
+        * directory of this cache, the packs in use are closed while the new ones
+        * replace them and are used at once afterwards.
+        *
+        * @param cancel checked between the tiles, stops the export if set
+        * @return number of packs written, -1 if the database could not be opened
+        */
+        int ExportMapDataToPacks(QString sourceFile, QString destDir, volatile bool *cancel=0);
+        /**
+        * @brief Directory of the tile packs used by the cache
+        */
+        QString PacksLocation();
         void deleteOlderTiles(int const& days);
+        /**
+        * @brief Starts a transaction on the connection of the calling thread,
+        * all PutImageToCache calls of this thread until CommitTransaction are written at once
+        */
+        bool BeginTransaction();
+        bool CommitTransaction();
     private:
+        /**
+        * @brief Database connection of one thread
+        */
+        class Connection
+        {
+        public:
+            Connection(const QString &name,int generation);
+            ~Connection();
+            bool Open(const QString &file);
+            QString name;
+            int generation;
+            bool inTransaction;
+            QSqlDatabase db;
+            QSqlQuery* getTile;
+            QSqlQuery* hasTile;
+            QSqlQuery* insertTile;
+            QSqlQuery* insertTileData;
+        };
+        /**
+        * @brief Connection of the calling thread, opened on first use.
+        * Has to be called with lock held, returns NULL if no cache is available
+        */
+        Connection* ThreadConnection();
+        /**
+        * @brief Maps all packs of the packs directory, has to be called with write lock held
+        */
+        void LoadPacks();
+        void ClosePacks();
+
         QString gtilecache;
+        int generation;
         QMutex Mcounter;
         QReadWriteLock lock;
         static qlonglong ConnCounter;
+        QThreadStorage<Connection*> connections;
+        QHash<int,TilePack*> packs;
 
     };
 
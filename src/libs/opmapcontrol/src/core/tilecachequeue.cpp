@@ -25,6 +25,7 @@
 * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 */
 #include "tilecachequeue.h"
+#include <QTime>
 
 
 //#define DEBUG_TILECACHEQUEUE
@@ -85,15 +86,28 @@ void TileCacheQueue::run()
 #endif //DEBUG_TILECACHEQUEUE
         if(tileCacheQueue.count()>0)
         {
-            mutex.lock();
-            task=tileCacheQueue.dequeue();
-            mutex.unlock();
+            // Write tiles in batches, one transaction (and disk sync)
+            // per batchSize tiles or batchInterval milliseconds
+            QTime batchTime;
+            batchTime.start();
+            Cache::Instance()->ImageCache.BeginTransaction();
+            for(int i=0;i<batchSize && batchTime.elapsed()<batchInterval;++i)
+            {
+                mutex.lock();
+                if(tileCacheQueue.isEmpty())
+                {
+                    mutex.unlock();
+                    break;
+                }
+                task=tileCacheQueue.dequeue();
+                mutex.unlock();
 #ifdef DEBUG_TILECACHEQUEUE
-            qDebug()<<"Cache engine Put:"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
+                qDebug()<<"Cache engine Put:"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
 #endif //DEBUG_TILECACHEQUEUE
-            Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(),task->GetMapType(),task->GetPosition(),task->GetZoom());
-            usleep(44);
-            delete task;
+                Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(),task->GetMapType(),task->GetPosition(),task->GetZoom());
+                delete task;
+            }
+            Cache::Instance()->ImageCache.CommitTransaction();
         }
 
         else
@@ -51,6 +51,8 @@ namespace core {
         QQueue<CacheItemQueue*> tileCacheQueue;
     private:
         void run();
+        static const int batchSize=64;       ///< Tiles written per transaction at most
+        static const int batchInterval=100;  ///< Milliseconds a transaction stays open at most
         QMutex mutex;
         QMutex waitmutex;
         QWaitCondition waitc;
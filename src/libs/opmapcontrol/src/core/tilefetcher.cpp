@@ -0,0 +1,304 @@
+/**
+******************************************************************************
+*
+* @file       tilefetcher.cpp
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+* 
+*****************************************************************************/
+/* 
+* This program is free software; you can redistribute it and/or modify 
+* it under the terms of the GNU General Public License as published by 
+* the Free Software Foundation; either version 3 of the License, or 
+* (at your option) any later version.
+* 
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License 
+* for more details.
+* 
+* You should have received a copy of the GNU General Public License along 
+* with this program; if not, write to the Free Software Foundation, Inc., 
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "tilefetcher.h"
+#include "opmaps.h"
+
+namespace core {
+    const int TileFetcher::retryDelay;
+    const int TileFetcher::maxRetryDelay;
+
+    TileFetcher::TileFetcher():versionsReply(0),focusZoom(0),dispatchPosted(false)
+    {
+        connect(&network,SIGNAL(finished(QNetworkReply*)),this,SLOT(OnReplyFinished(QNetworkReply*)));
+        connect(&timeoutTimer,SIGNAL(timeout()),this,SLOT(CheckTimeouts()));
+        timeoutTimer.setInterval(timeoutInterval);
+        connect(&retryTimer,SIGNAL(timeout()),this,SLOT(Dispatch()));
+        retryTimer.setSingleShot(true);
+        // Also when another fetcher or a blocking load resolved them
+        connect(OPMaps::Instance(),SIGNAL(GoogleVersionsResolved()),this,SLOT(Dispatch()));
+    }
+    TileFetcher::~TileFetcher()
+    {
+        Clear();
+        if(versionsReply)
+        {
+            // Resolved with the built in versions, other fetchers must not wait for it forever
+            QNetworkReply *reply=versionsReply;
+            versionsReply=0;
+            reply->abort();
+            OPMaps::Instance()->SetGoogleVersions(QByteArray());
+        }
+    }
+
+    void TileFetcher::Request(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        QMutexLocker locker(&mutex);
+        RawTile tile(type,pos,zoom);
+        if(known.contains(tile) || fetched.contains(tile))
+            return;
+        known.insert(tile);
+        Fetch fetch;
+        fetch.type=type;
+        fetch.pos=pos;
+        fetch.zoom=zoom;
+        fetch.attempts=0;
+        fetch.delay=0;
+        waiting.append(fetch);
+        if(!dispatchPosted)
+        {
+            dispatchPosted=true;
+            QMetaObject::invokeMethod(this,"Dispatch",Qt::QueuedConnection);
+        }
+    }
+    QByteArray TileFetcher::FetchedImage(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        QMutexLocker locker(&mutex);
+        return fetched.value(RawTile(type,pos,zoom));
+    }
+    void TileFetcher::Release(const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        QMutexLocker locker(&mutex);
+        fetched.remove(RawTile(type,pos,zoom));
+    }
+    void TileFetcher::SetFocus(const Point &center,const int &zoom)
+    {
+        QMutexLocker locker(&mutex);
+        focus=center;
+        focusZoom=zoom;
+    }
+    void TileFetcher::CancelOutside(const int &zoom,const QList<Point> &keep)
+    {
+        QSet<Point> visible=keep.toSet();
+        QList<QNetworkReply*> cancel;
+        mutex.lock();
+        for(int i=waiting.count()-1;i>=0;--i)
+        {
+            const Fetch &fetch=waiting.at(i);
+            if(fetch.zoom!=zoom || !visible.contains(fetch.pos))
+            {
+                known.remove(RawTile(fetch.type,fetch.pos,fetch.zoom));
+                waiting.removeAt(i);
+            }
+        }
+        QMutableHashIterator<RawTile,QByteArray> f(fetched);
+        while(f.hasNext())
+        {
+            RawTile tile=f.next().key();
+            if(tile.Zoom()!=zoom || !visible.contains(tile.Pos()))
+                f.remove();
+        }
+        QHash<QNetworkReply*,Fetch>::const_iterator i;
+        for(i=inFlight.constBegin();i!=inFlight.constEnd();++i)
+        {
+            if(i.value().zoom!=zoom || !visible.contains(i.value().pos))
+            {
+                known.remove(RawTile(i.value().type,i.value().pos,i.value().zoom));
+                cancel.append(i.key());
+            }
+        }
+        mutex.unlock();
+        Abort(cancel);
+    }
+    void TileFetcher::Clear()
+    {
+        mutex.lock();
+        waiting.clear();
+        known.clear();
+        fetched.clear();
+        mutex.unlock();
+        Abort(inFlight.keys());
+    }
+    void TileFetcher::Abort(const QList<QNetworkReply*> &list)
+    {
+        // Forgotten first, abort() may report the reply as finished right away
+        foreach(QNetworkReply *reply,list)
+        {
+            inFlight.remove(reply);
+            timedOut.remove(reply);
+        }
+        foreach(QNetworkReply *reply,list)
+        {
+            reply->abort();
+        }
+        if(inFlight.isEmpty() && !versionsReply)
+            timeoutTimer.stop();
+        Dispatch();
+    }
+
+    int TileFetcher::Priority(const Fetch &fetch) const
+    {
+        int dx=fetch.pos.X()-focus.X();
+        int dy=fetch.pos.Y()-focus.Y();
+        int distance=qMin(dx*dx+dy*dy,(1<<20)-1);
+        return (qAbs(fetch.zoom-focusZoom)<<20)+distance;
+    }
+    int TileFetcher::Wait(const Fetch &fetch) const
+    {
+        if(OPMaps::Instance()->GoogleVersionsPending(fetch.type))
+            return -1;
+        if(fetch.delay==0)
+            return 0;
+        return qMax(0,fetch.delay-fetch.started.elapsed());
+    }
+    void TileFetcher::Dispatch()
+    {
+        QList<Fetch> send;
+        bool needVersions=false;
+        int nextRetry=-1;
+        mutex.lock();
+        dispatchPosted=false;
+        while(inFlight.count()+send.count()<maxInFlight)
+        {
+            int best=-1;
+            int bestPriority=0;
+            for(int i=0;i<waiting.count();++i)
+            {
+                if(Wait(waiting.at(i))!=0)
+                    continue;
+                int priority=Priority(waiting.at(i));
+                if(best<0 || priority<bestPriority)
+                {
+                    best=i;
+                    bestPriority=priority;
+                }
+            }
+            if(best<0)
+                break;
+            send.append(waiting.takeAt(best));
+        }
+        foreach(const Fetch &fetch,waiting)
+        {
+            int wait=Wait(fetch);
+            if(wait<0)
+                needVersions=true;
+            else if(wait>0 && (nextRetry<0 || wait<nextRetry))
+                nextRetry=wait;
+        }
+        mutex.unlock();
+
+        if(nextRetry>=0)
+            retryTimer.start(nextRetry);
+        OPMaps *maps=OPMaps::Instance();
+        network.setProxy(maps->Proxy);
+        // Looked up once, the tiles which need it are held back meanwhile
+        if(needVersions && !versionsReply && maps->ClaimGoogleVersions())
+        {
+            versionsReply=network.get(maps->GoogleVersionsRequest());
+            versionsStarted.start();
+            if(!timeoutTimer.isActive())
+                timeoutTimer.start();
+        }
+        if(send.isEmpty())
+            return;
+        foreach(Fetch fetch,send)
+        {
+#ifdef DEBUG_GMAPS
+            qDebug()<<"TileFetcher: requesting"<<fetch.pos.ToString()<<"zoom"<<fetch.zoom;
+#endif //DEBUG_GMAPS
+            fetch.started.start();
+            inFlight.insert(network.get(maps->MakeImageRequest(fetch.type,fetch.pos,fetch.zoom)),fetch);
+        }
+        if(!timeoutTimer.isActive())
+            timeoutTimer.start();
+    }
+    void TileFetcher::CheckTimeouts()
+    {
+        int timeout=OPMaps::Instance()->Timeout;
+        if(versionsReply && versionsStarted.elapsed()>timeout)
+        {
+            // Finishes with an error, the built in versions are used then
+            versionsReply->abort();
+        }
+        QList<QNetworkReply*> expired;
+        QHash<QNetworkReply*,Fetch>::const_iterator i;
+        for(i=inFlight.constBegin();i!=inFlight.constEnd();++i)
+        {
+            if(!timedOut.contains(i.key()) && i.value().started.elapsed()>timeout)
+                expired.append(i.key());
+        }
+        foreach(QNetworkReply *reply,expired)
+        {
+            timedOut.insert(reply);
+            reply->abort();
+        }
+    }
+    void TileFetcher::OnReplyFinished(QNetworkReply *reply)
+    {
+        reply->deleteLater();
+        OPMaps *maps=OPMaps::Instance();
+        if(reply==versionsReply)
+        {
+            versionsReply=0;
+            if(inFlight.isEmpty())
+                timeoutTimer.stop();
+            // Emits GoogleVersionsResolved, which dispatches the held back tiles
+            maps->SetGoogleVersions(reply->error()==QNetworkReply::NoError?reply->readAll():QByteArray());
+            return;
+        }
+        if(!inFlight.contains(reply))
+            return;
+        Fetch fetch=inFlight.take(reply);
+        bool timeout=timedOut.remove(reply);
+        if(inFlight.isEmpty() && !versionsReply)
+            timeoutTimer.stop();
+        RawTile tile(fetch.type,fetch.pos,fetch.zoom);
+
+        if(timeout || reply->error()!=QNetworkReply::NoError)
+        {
+            maps->ImageFailed(timeout);
+            mutex.lock();
+            bool retry=(++fetch.attempts<maps->RetryLoadTile);
+            if(retry)
+            {
+                // Backs off, a failing server is not asked again right away
+                fetch.delay=qMin(retryDelay<<qMin(fetch.attempts-1,16),maxRetryDelay);
+                fetch.started.start();
+                waiting.append(fetch);
+            }
+            else
+                known.remove(tile);
+            mutex.unlock();
+            if(!retry)
+                emit TileFailed(fetch.type,fetch.pos,fetch.zoom);
+        }
+        else
+        {
+            QByteArray img=reply->readAll();
+            maps->ImageReceived(fetch.type,fetch.pos,fetch.zoom,img);
+            mutex.lock();
+            known.remove(tile);
+            if(!img.isEmpty())
+                fetched.insert(tile,img);
+            mutex.unlock();
+            if(img.isEmpty())
+                emit TileFailed(fetch.type,fetch.pos,fetch.zoom);
+            else
+                emit TileReady(fetch.type,fetch.pos,fetch.zoom);
+        }
+        Dispatch();
+    }
+}
@@ -0,0 +1,125 @@
+/**
+******************************************************************************
+*
+* @file       tilefetcher.h
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+* 
+*****************************************************************************/
+/* 
+* This program is free software; you can redistribute it and/or modify 
+* it under the terms of the GNU General Public License as published by 
+* the Free Software Foundation; either version 3 of the License, or 
+* (at your option) any later version.
+* 
+* This program is distributed in the hope that it will be useful, but 
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY 
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License 
+* for more details.
+* 
+* You should have received a copy of the GNU General Public License along 
+* with this program; if not, write to the Free Software Foundation, Inc., 
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef TILEFETCHER_H
+#define TILEFETCHER_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QTime>
+#include <QTimer>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkReply>
+#include "maptype.h"
+#include "point.h"
+#include "rawtile.h"
+
+namespace core {
+    /**
+    * Loads tiles from the server without blocking.
+    *
+    * All requests share one network access manager, so the connections to a
+    * server are kept alive and reused. A tile which is waiting or in flight is
+    * requested only once. Waiting tiles of the focused zoom go first, nearest
+    * to the focus first, with at most maxInFlight requests at the same time.
+    * Tiles which left the view are dropped and their requests aborted.
+    * Failed tiles wait before they are requested again, twice as long after
+    * each failure. Tiles of Google types wait until the current versions of
+    * the Google servers are looked up, which is done once without blocking.
+    *
+    * Received tiles go to the caches of OPMaps and are kept until released,
+    * so they can be used even with all caches disabled.
+    *
+    * Lives in the thread it was created in. Request, SetFocus and the image
+    * lookups may be called from any thread, CancelOutside and Clear only from
+    * the thread of the fetcher.
+    */
+    class TileFetcher:public QObject
+    {
+        Q_OBJECT
+    public:
+        TileFetcher();
+        ~TileFetcher();
+        /// Queue a tile unless it is already waiting, in flight or received
+        void Request(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        /// Received tile not released yet, empty if there is none
+        QByteArray FetchedImage(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        /// Forget a received tile once it is in use
+        void Release(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        /// Tile and zoom the waiting tiles are ordered by
+        void SetFocus(const core::Point &center,const int &zoom);
+        /// Drop all tiles of other zoom levels or not in the list
+        void CancelOutside(const int &zoom,const QList<core::Point> &keep);
+        /// Drop all tiles
+        void Clear();
+    signals:
+        void TileReady(core::MapType::Types type,core::Point pos,int zoom);
+        void TileFailed(core::MapType::Types type,core::Point pos,int zoom);
+    private slots:
+        void Dispatch();
+        void OnReplyFinished(QNetworkReply *reply);
+        void CheckTimeouts();
+    private:
+        struct Fetch
+        {
+            MapType::Types type;
+            core::Point pos;
+            int zoom;
+            int attempts;
+            int delay;                        ///< Milliseconds to wait since started before it is sent again
+            QTime started;
+        };
+        /// Lower goes first
+        int Priority(const Fetch &fetch) const;
+        /// Milliseconds until a waiting tile may be sent, 0 if now, -1 if it waits for the Google versions
+        int Wait(const Fetch &fetch) const;
+        void Abort(const QList<QNetworkReply*> &list);
+
+        static const int maxInFlight=6;       ///< Parallel requests, the usual per host limit of browsers
+        static const int timeoutInterval=250; ///< Milliseconds between two timeout checks
+        static const int retryDelay=500;      ///< Milliseconds before the first retry of a failed tile
+        static const int maxRetryDelay=8000;  ///< Upper bound of the doubled retry delay
+
+        QNetworkAccessManager network;
+        QList<Fetch> waiting;                 ///< Guarded by mutex
+        QSet<RawTile> known;                  ///< Waiting or in flight, guarded by mutex
+        QHash<RawTile,QByteArray> fetched;    ///< Received and not released, guarded by mutex
+        QHash<QNetworkReply*,Fetch> inFlight;
+        QSet<QNetworkReply*> timedOut;
+        QNetworkReply *versionsReply;         ///< Lookup of the Google versions, 0 if none
+        QTime versionsStarted;
+        core::Point focus;
+        int focusZoom;
+        bool dispatchPosted;
+        QTimer timeoutTimer;
+        QTimer retryTimer;                    ///< Dispatches when the next delayed tile is due
+        QMutex mutex;
+    };
+}
+#endif // TILEFETCHER_H
@@ -0,0 +1,285 @@
+/**
+******************************************************************************
+*
+* @file       tilepack.cpp
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      Read-only tile archive of one map type
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "tilepack.h"
+#include <QtEndian>
+#include <QVector>
+#include <QPair>
+#include <QtAlgorithms>
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlError>
+#include <QVariant>
+#include <QDebug>
+#include <string.h>
+#include "debugheader.h"
+#include "../internals/core.h"
+//#define DEBUG_TILEPACK
+namespace core {
+    const int TilePack::HeaderSize;
+    const int TilePack::EntrySize;
+    const quint32 TilePack::Version;
+    const int TilePack::MaxZoom;
+    const int TilePack::CoordinateBits;
+
+    static const char Magic[8]={'O','P','M','A','P','T','P','K'};
+
+    static void AppendU32(QByteArray &out,quint32 value)
+    {
+        uchar b[4];
+        qToLittleEndian(value,b);
+        out.append((const char*)b,4);
+    }
+    static void AppendU64(QByteArray &out,quint64 value)
+    {
+        uchar b[8];
+        qToLittleEndian(value,b);
+        out.append((const char*)b,8);
+    }
+
+    TilePack::TilePack():data(0),size(0),count(0),type(MapType::GoogleMap)
+    {
+
+    }
+    TilePack::~TilePack()
+    {
+        Close();
+    }
+    bool TilePack::Open(const QString &fileName)
+    {
+        Close();
+        file.setFileName(fileName);
+        if(!file.open(QIODevice::ReadOnly))
+            return false;
+        size=file.size();
+        if(size>=HeaderSize)
+            data=file.map(0,size);
+        if(!data || memcmp(data,Magic,sizeof(Magic))!=0 || qFromLittleEndian<quint32>(data+8)!=Version)
+        {
+#ifdef DEBUG_TILEPACK
+            qDebug()<<"TilePack: Not a tile pack"<<fileName;
+#endif //DEBUG_TILEPACK
+            Close();
+            return false;
+        }
+        type=(MapType::Types)qFromLittleEndian<quint32>(data+12);
+        quint32 n=qFromLittleEndian<quint32>(data+16);
+        quint64 dataOffset=qFromLittleEndian<quint64>(data+24);
+        // A truncated copy must not make lookups read beyond the mapping
+        if((quint64)HeaderSize+(quint64)n*EntrySize>dataOffset || dataOffset>(quint64)size || n>0x7fffffff)
+        {
+#ifdef DEBUG_TILEPACK
+            qDebug()<<"TilePack: Damaged index"<<fileName;
+#endif //DEBUG_TILEPACK
+            Close();
+            return false;
+        }
+        count=n;
+        return true;
+    }
+    void TilePack::Close()
+    {
+        if(data)
+            file.unmap(data);
+        data=0;
+        size=0;
+        count=0;
+        file.close();
+    }
+    bool TilePack::Key(const Point &pos,const int &zoom,quint64 &key)
+    {
+        if(zoom<0 || zoom>MaxZoom)
+            return false;
+        qint64 max=(qint64)1<<CoordinateBits;
+        if(pos.X()<0 || pos.Y()<0 || pos.X()>=max || pos.Y()>=max)
+            return false;
+        quint64 x=pos.X();
+        quint64 y=pos.Y();
+        quint64 code=0;
+        for(int i=CoordinateBits-1;i>=0;--i)
+        {
+            code=(code<<2)|(((y>>i)&1)<<1)|((x>>i)&1);
+        }
+        key=((quint64)zoom<<58)|code;
+        return true;
+    }
+    const uchar* TilePack::Find(const quint64 &key)const
+    {
+        int low=0;
+        int high=count-1;
+        while(low<=high)
+        {
+            int mid=low+(high-low)/2;
+            const uchar* entry=data+HeaderSize+(qint64)mid*EntrySize;
+            quint64 k=qFromLittleEndian<quint64>(entry);
+            if(k<key)
+                low=mid+1;
+            else if(k>key)
+                high=mid-1;
+            else
+                return entry;
+        }
+        return 0;
+    }
+    QByteArray TilePack::GetImage(const Point &pos,const int &zoom)const
+    {
+        quint64 key;
+        if(!data || !Key(pos,zoom,key))
+            return QByteArray();
+        const uchar* entry=Find(key);
+        if(!entry)
+            return QByteArray();
+        quint64 offset=qFromLittleEndian<quint64>(entry+8);
+        quint32 length=qFromLittleEndian<quint32>(entry+16);
+        if(offset>(quint64)size || length>(quint64)size-offset)
+            return QByteArray();
+        // Copied, the mapping goes away when the packs are reloaded
+        return QByteArray((const char*)data+offset,length);
+    }
+    bool TilePack::HasImage(const Point &pos,const int &zoom)const
+    {
+        quint64 key;
+        return data && Key(pos,zoom,key) && Find(key);
+    }
+    bool TilePack::Replace(const QString &tmpName,const QString &fileName)
+    {
+        QFile::remove(fileName);
+        if(QFile::rename(tmpName,fileName))
+            return true;
+        QFile::remove(tmpName);
+        return false;
+    }
+    bool TilePack::Write(QSqlDatabase &db,const MapType::Types &type,const QString &fileName,volatile bool *cancel)
+    {
+        // Key and id of every tile, the images are read one by one while writing
+        QVector<QPair<quint64,qlonglong> > tiles;
+        int typeMaxZoom;
+        internals::PureProjection* projection=internals::Core::NewProjection(type,typeMaxZoom);
+        {
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.prepare("SELECT id, X, Y, Zoom FROM Tiles WHERE Type=?");
+            query.addBindValue((int)type);
+            if(!query.exec())
+            {
+#ifdef DEBUG_TILEPACK
+                qDebug()<<"TilePack::Write: "<<query.lastError().driverText();
+#endif //DEBUG_TILEPACK
+                delete projection;
+                return false;
+            }
+            while(query.next())
+            {
+                Point pos(query.value(1).toInt(),query.value(2).toInt());
+                int zoom=query.value(3).toInt();
+                quint64 key;
+                if(!Key(pos,zoom,key))
+                    continue;
+                // Not a tile of this map type
+                Size maxXY=projection->GetTileMatrixMaxXY(zoom);
+                if(pos.X()>maxXY.Width() || pos.Y()>maxXY.Height())
+                    continue;
+                tiles.append(qMakePair(key,query.value(0).toLongLong()));
+            }
+        }
+        delete projection;
+        if(tiles.isEmpty())
+            return false;
+        // The cache may hold a tile more than once, the last one stored wins
+        qSort(tiles);
+        int unique=0;
+        for(int i=0;i<tiles.size();++i)
+        {
+            if(unique>0 && tiles.at(unique-1).first==tiles.at(i).first)
+                tiles[unique-1]=tiles.at(i);
+            else
+                tiles[unique++]=tiles.at(i);
+        }
+        tiles.resize(unique);
+
+        QFile out(fileName);
+        if(!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+        quint64 dataOffset=(quint64)HeaderSize+(quint64)tiles.size()*EntrySize;
+        QByteArray index;
+        index.reserve(tiles.size()*EntrySize);
+        quint32 n=0;
+        bool ok=out.seek(dataOffset);
+        {
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.prepare("SELECT Tile FROM TilesData WHERE id=?");
+            quint64 offset=dataOffset;
+            for(int i=0;ok && i<tiles.size();++i)
+            {
+                if(cancel && *cancel)
+                {
+                    ok=false;
+                    break;
+                }
+                query.addBindValue(tiles.at(i).second);
+                if(!query.exec())
+                {
+                    ok=false;
+                    break;
+                }
+                QByteArray tile;
+                if(query.next())
+                    tile=query.value(0).toByteArray();
+                query.finish();
+                // Empty tiles are not stored, they are loaded again when online
+                if(tile.isEmpty())
+                    continue;
+                ok=out.write(tile)==tile.size();
+                AppendU64(index,tiles.at(i).first);
+                AppendU64(index,offset);
+                AppendU32(index,tile.size());
+                AppendU32(index,0);
+                offset+=tile.size();
+                ++n;
+            }
+        }
+        if(ok)
+        {
+            // Skipped tiles leave a gap between the index and the first image
+            QByteArray header(Magic,sizeof(Magic));
+            AppendU32(header,Version);
+            AppendU32(header,(quint32)type);
+            AppendU32(header,n);
+            AppendU32(header,0);
+            AppendU64(header,dataOffset);
+            ok=out.seek(0) && out.write(header)==header.size() && out.write(index)==index.size();
+        }
+        ok=out.flush() && ok;
+        out.close();
+        ok=ok && n>0;
+        if(!ok)
+            QFile::remove(fileName);
+#ifdef DEBUG_TILEPACK
+        qDebug()<<"TilePack::Write:"<<fileName<<n<<"tiles"<<(ok?"written":"failed");
+#endif //DEBUG_TILEPACK
+        return ok;
+    }
+}
@@ -0,0 +1,119 @@
+/**
+******************************************************************************
+*
+* @file       tilepack.h
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      Read-only tile archive of one map type
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef TILEPACK_H
+#define TILEPACK_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <QtSql/QSqlDatabase>
+#include "maptype.h"
+#include "point.h"
+
+namespace core {
+    /**
+    * Read-only archive of the tiles of one map type for large offline map sets.
+    *
+    * The file holds a header, an index sorted by zoom and position and the
+    * images back to back in index order, so tiles close to each other on the map are
+    * close to each other on disk. The file is mapped into memory, a lookup is
+    * a binary search in the index without any database involved. A 32 bit
+    * build can only open packs which fit into its address space.
+    *
+    * All numbers are little endian.
+    * Header, 32 bytes: magic "OPMAPTPK", version, map type, tile count and a
+    * reserved field (quint32 each), offset of the first image (quint64).
+    * Index entry, 24 bytes: key (quint64), offset of the image in the file
+    * (quint64), size of the image (quint32), reserved (quint32).
+    * The key holds the zoom in the upper 6 bits and the Morton code of the tile
+    * below, the bits of Y and X interleaved, CoordinateBits each. Unlike a
+    * quadkey it also holds the columns of projections with more tiles than
+    * 2^zoom per row, e.g. PlateCarree, and for the square tile matrix of the
+    * Mercator types it is the same as the quadkey.
+    */
+    class TilePack
+    {
+    public:
+        TilePack();
+        ~TilePack();
+        /**
+        * @brief Maps a pack file, returns false if it is missing or no valid pack
+        */
+        bool Open(const QString &fileName);
+        void Close();
+        bool IsOpen()const{return data!=0;}
+        MapType::Types Type()const{return type;}
+        int Count()const{return count;}
+        QString FileName()const{return file.fileName();}
+        /**
+        * @brief Copy of the image of a tile, empty if the pack does not contain it
+        */
+        QByteArray GetImage(const core::Point &pos,const int &zoom)const;
+        bool HasImage(const core::Point &pos,const int &zoom)const;
+
+        /**
+        * @brief Sort key of a tile, returns false if the tile can not be stored in a pack
+        */
+        static bool Key(const core::Point &pos,const int &zoom,quint64 &key);
+        /**
+        * @brief Writes all tiles of one map type of a tile cache database to a pack
+        *
+        * Tiles outside the tile matrix of the projection of the map type are left out.
+        * The pack is written to fileName itself, see Replace. A partial pack is removed on failure.
+        * @param cancel checked between the tiles, stops and removes the partial pack if set
+        * @return false on failure, if cancelled or if the database has no tile of this type
+        */
+        static bool Write(QSqlDatabase &db,const MapType::Types &type,const QString &fileName,volatile bool *cancel=0);
+        /**
+        * @brief Replaces fileName by the pack written to tmpName
+        *
+        * Fails on some systems while fileName is open, so a pack in use has to be closed first.
+        */
+        static bool Replace(const QString &tmpName,const QString &fileName);
+
+        static const int HeaderSize=32;
+        static const int EntrySize=24;
+        static const quint32 Version=1;
+        static const int MaxZoom=29;
+        static const int CoordinateBits=29;  ///< Bits of X and Y in a key
+    private:
+        TilePack(TilePack const&);
+        TilePack& operator=(TilePack const&);
+        /**
+        * @brief Index entry of a key, NULL if not found
+        */
+        const uchar* Find(const quint64 &key)const;
+
+        QFile file;
+        uchar* data;
+        qint64 size;
+        int count;
+        MapType::Types type;
+    };
+
+}
+#endif // TILEPACK_H
@@ -45,9 +45,11 @@ namespace core {
         /// </summary>
         UserAgent = "Mozilla/5.0 (Windows; U; Windows NT 6.0; en-US; rv:1.9.1.7) Gecko/20091221 Firefox/3.5.7";
 
+        TileServerUrl = QString::fromLocal8Bit(qgetenv("OPMAP_TILE_SERVER"));
+
         Timeout = 5 * 1000;
         CorrectGoogleVersions=true;
-        isCorrectedGoogleVersions = false;
+        googleVersions = 0;
         UseGeocoderCache=true;
         UsePlacemarkCache=true;
     }
@@ -80,51 +82,82 @@ namespace core {
     }
     void UrlFactory::setIsCorrectGoogleVersions(bool value)
     {
-        isCorrectedGoogleVersions=value;
+        googleVersions=value?2:0;
     }
 
     bool UrlFactory::IsCorrectGoogleVersions()
     {
-        return isCorrectedGoogleVersions;
+        return googleVersions!=0;
     }
 
-    void UrlFactory::TryCorrectGoogleVersions()
+    bool UrlFactory::GoogleVersionsPending(const MapType::Types &type)
     {
-        QMutexLocker locker(&mutex);
-        if(CorrectGoogleVersions && !IsCorrectGoogleVersions())
+        if(!CorrectGoogleVersions || !TileServerUrl.isEmpty() || googleVersions==2)
+            return false;
+        switch(type)
         {
-            QNetworkReply *reply;
-            QNetworkRequest qheader;
-            QNetworkAccessManager network;
-            QEventLoop q;
-            QTimer tT;
-            tT.setSingleShot(true);
-            connect(&network, SIGNAL(finished(QNetworkReply*)),
-                    &q, SLOT(quit()));
-            connect(&tT, SIGNAL(timeout()), &q, SLOT(quit()));
-            network.setProxy(Proxy);
+        case MapType::GoogleMap:
+        case MapType::GoogleSatellite:
+        case MapType::GoogleLabels:
+        case MapType::GoogleTerrain:
+        case MapType::GoogleMapChina:
+        case MapType::GoogleLabelsChina:
+        case MapType::GoogleTerrainChina:
+            return true;
+        default:
+            return false;
+        }
+    }
+    bool UrlFactory::ClaimGoogleVersions()
+    {
+        return CorrectGoogleVersions && googleVersions.testAndSetOrdered(0,1);
+    }
+    QNetworkRequest UrlFactory::GoogleVersionsRequest()
+    {
+        QNetworkRequest qheader;
+        qheader.setUrl(QUrl("http://maps.google.com"));
+        qheader.setRawHeader("User-Agent",UserAgent);
+        return qheader;
+    }
+
+    void UrlFactory::TryCorrectGoogleVersions()
+    {
+        // Whoever claims the lookup does it, the others go on with the versions they have
+        if(!ClaimGoogleVersions())
+            return;
+        QNetworkReply *reply;
+        QNetworkAccessManager network;
+        QEventLoop q;
+        QTimer tT;
+        tT.setSingleShot(true);
+        connect(&network, SIGNAL(finished(QNetworkReply*)),
+                &q, SLOT(quit()));
+        connect(&tT, SIGNAL(timeout()), &q, SLOT(quit()));
+        network.setProxy(Proxy);
 #ifdef DEBUG_URLFACTORY
-            qDebug()<<"Correct GoogleVersion";
+        qDebug()<<"Correct GoogleVersion";
 #endif //DEBUG_URLFACTORY
-            setIsCorrectGoogleVersions(true);
-            QString url = "http://maps.google.com";
-
-            qheader.setUrl(QUrl(url));
-            qheader.setRawHeader("User-Agent",UserAgent);
-            reply=network.get(qheader);
-            tT.start(Timeout);
-            q.exec();
-            if(!tT.isActive())
-                return;
-            tT.stop();
-            if( (reply->error()!=QNetworkReply::NoError))
-            {
+        reply=network.get(GoogleVersionsRequest());
+        tT.start(Timeout);
+        q.exec();
+        if(!tT.isActive() || reply->error()!=QNetworkReply::NoError)
+        {
 #ifdef DEBUG_URLFACTORY
-                qDebug()<<"Try corrected version withou abort or error:"<<reply->errorString();
+            qDebug()<<"Try corrected version withou abort or error:"<<reply->errorString();
 #endif //DEBUG_URLFACTORY
-                return;
-            }
-            QString html=QString(reply->readAll());
+            SetGoogleVersions(QByteArray());
+            return;
+        }
+        tT.stop();
+        SetGoogleVersions(reply->readAll());
+        reply->deleteLater();
+    }
+    void UrlFactory::SetGoogleVersions(const QByteArray &page)
+    {
+        if(!page.isEmpty())
+        {
+            QMutexLocker locker(&mutex);
+            QString html=QString(page);
             QRegExp reg("\"*http://mt0.google.com/vt/lyrs=m@(\\d*)",Qt::CaseInsensitive);
             if(reg.indexIn(html)!=-1)
             {
@@ -167,10 +200,10 @@ namespace core {
                 qDebug()<<"TryCorrectGoogleVersions, VersionGoogleTerrain: "<<VersionGoogleTerrain;
 #endif //DEBUG_URLFACTORY
             }
-            reply->deleteLater();
-
         }
-
+        // Failures are not retried, the built in versions are used then
+        googleVersions=2;
+        emit GoogleVersionsResolved();
     }
 
     QString UrlFactory::MakeImageUrl(const MapType::Types &type,const Point &pos,const int &zoom,const QString &language)
@@ -178,6 +211,10 @@ namespace core {
 #ifdef DEBUG_URLFACTORY
         qDebug()<<"Entered MakeImageUrl";
 #endif //DEBUG_URLFACTORY
+        if(!TileServerUrl.isEmpty())
+        {
+            return QString(TileServerUrl).replace("{z}",QString::number(zoom)).replace("{x}",QString::number(pos.X())).replace("{y}",QString::number(pos.Y()));
+        }
         switch(type)
         {
         case MapType::GoogleMap:
@@ -42,6 +42,7 @@
 #include "cache.h"
 #include "placemark.h"
 #include <QTextCodec>
+#include <QAtomicInt>
 #include "cmath"
 
 namespace core {
@@ -54,17 +55,38 @@ namespace core {
         /// </summary>
         QByteArray UserAgent;
         QNetworkProxy Proxy;
+        /// <summary>
+        /// If set, all tiles are loaded from this server instead of the provider,
+        /// {z}, {x} and {y} are replaced by the tile, e.g. http://localhost:8080/{z}/{x}/{y}.png.
+        /// Defaults to the OPMAP_TILE_SERVER environment variable.
+        /// </summary>
+        QString TileServerUrl;
         UrlFactory();
         ~UrlFactory();
         QString MakeImageUrl(const MapType::Types &type,const core::Point &pos,const int &zoom,const QString &language);
         internals::PointLatLng GetLatLngFromGeodecoder(const QString &keywords,GeoCoderStatusCode::Types &status);
         Placemark GetPlacemarkFromGeocoder(internals::PointLatLng location);
         int Timeout;
+        /// <summary>
+        /// True while tiles of this type should wait for the current Google versions
+        /// </summary>
+        bool GoogleVersionsPending(const MapType::Types &type);
+        /// <summary>
+        /// Claims looking up the Google versions, false if they are resolved or being resolved
+        /// </summary>
+        bool ClaimGoogleVersions();
+        QNetworkRequest GoogleVersionsRequest();
+        /// <summary>
+        /// Takes the versions from the page of maps.google.com, an empty page keeps the defaults
+        /// </summary>
+        void SetGoogleVersions(const QByteArray &page);
+    signals:
+        void GoogleVersionsResolved();
     private:
         void GetSecGoogleWords(const core::Point &pos,  QString &sec1, QString &sec2);
         int GetServerNum(const core::Point &pos,const int &max) const;
         void TryCorrectGoogleVersions();
-        bool isCorrectedGoogleVersions;
+        QAtomicInt googleVersions;          ///< 0 unresolved, 1 being resolved, 2 resolved
         QString TileXYToQuadKey(const int &tileX,const int &tileY,const int &levelOfDetail) const;
         bool CorrectGoogleVersions;
         bool UseGeocoderCache; //TODO GetSet
@@ -58,6 +58,8 @@ namespace internals {
         CanDragMap=true;
         tilesToload=0;
         OPMaps::Instance();
+        connect(&fetcher,SIGNAL(TileReady(core::MapType::Types,core::Point,int)),this,SLOT(OnTileFetched(core::MapType::Types,core::Point,int)));
+        connect(&fetcher,SIGNAL(TileFailed(core::MapType::Types,core::Point,int)),this,SLOT(OnTileFetchFailed(core::MapType::Types,core::Point,int)));
     }
     Core::~Core()
     {
@@ -122,62 +124,55 @@ namespace internals {
 
                         Tile* t = new Tile(task.Zoom, task.Pos);
                         QVector<MapType::Types> layers= OPMaps::Instance()->GetAllLayersOfType(GetMapType());
+                        bool complete = true;
 
                         foreach(MapType::Types tl,layers)
                         {
-                            int retry = 0;
-                            do
+                            Point pos = ServerTilePos(tl, task.Pos);
+                            QByteArray img = OPMaps::Instance()->GetCachedImage(tl, pos, task.Zoom);
+                            if(img.length()==0)
                             {
-                                QByteArray img;
-
-                                // tile number inversion(BottomLeft -> TopLeft) for pergo maps
-                                if(tl == MapType::PergoTurkeyMap)
-                                {
-                                    img = OPMaps::Instance()->GetImageFrom(tl, Point(task.Pos.X(), maxOfTiles.Height() - task.Pos.Y()), task.Zoom);
-                                }
-                                else // ok
-                                {
-#ifdef DEBUG_CORE
-                                    qDebug()<<"start getting image"<<" ID="<<debug;
-#endif //DEBUG_CORE
-                                    img = OPMaps::Instance()->GetImageFrom(tl, task.Pos, task.Zoom);
+                                img = fetcher.FetchedImage(tl, pos, task.Zoom);
+                            }
 #ifdef DEBUG_CORE
-                                    qDebug()<<"Core::run:gotimage size:"<<img.count()<<" ID="<<debug<<" time="<<t.elapsed();
+                            qDebug()<<"Core::run:gotimage size:"<<img.count()<<" ID="<<debug;
 #endif //DEBUG_CORE
-                                }
 
-                                if(img.length()!=0)
+                            if(img.length()!=0)
+                            {
+                                Moverlays.lock();
                                 {
-                                    Moverlays.lock();
-                                    {
-                                        t->Overlays.append(img);
+                                    t->Overlays.append(img);
 #ifdef DEBUG_CORE
-                                        qDebug()<<"Core::run append img:"<<img.length()<<" to tile:"<<t->GetPos().ToString()<<" now has "<<t->Overlays.count()<<" overlays"<<" ID="<<debug;
+                                    qDebug()<<"Core::run append img:"<<img.length()<<" to tile:"<<t->GetPos().ToString()<<" now has "<<t->Overlays.count()<<" overlays"<<" ID="<<debug;
 #endif //DEBUG_CORE
 
-                                    }
-                                    Moverlays.unlock();
-
-                                    break;
                                 }
-                                else if(OPMaps::Instance()->RetryLoadTile > 0)
+                                Moverlays.unlock();
+                            }
+                            else
+                            {
+                                // the task is queued again once the tile arrived
+                                complete = false;
+                                if(OPMaps::Instance()->GetAccessMode() != AccessMode::CacheOnly && task.Zoom == Zoom())
                                 {
-#ifdef DEBUG_CORE
-                                    qDebug()<<"ProcessLoadTask: " << task.ToString()<< " -> empty tile, retry " << retry<<" ID="<<debug;;
-#endif //DEBUG_CORE
-                                    {
-                                        QWaitCondition wait;
-                                        QMutex m;
-                                        m.lock();
-                                        wait.wait(&m,500);
-                                    }
+                                    fetcher.Request(tl, pos, task.Zoom);
                                 }
                             }
-                            while(++retry < OPMaps::Instance()->RetryLoadTile);
+                        }
+                        if(!complete && OPMaps::Instance()->GetAccessMode() != AccessMode::CacheOnly)
+                        {
+                            // show nothing until all layers are there
+                            t->Overlays.clear();
                         }
 
                         if(t->Overlays.count() > 0)
                         {
+                            foreach(MapType::Types tl,layers)
+                            {
+                                fetcher.Release(tl, ServerTilePos(tl, task.Pos), task.Zoom);
+                            }
+                            t->DecodeOverlays();
                             Matrix.SetTileAt(task.Pos,t);
                             emit OnNeedInvalidation();
 
@@ -204,9 +199,7 @@ namespace internals {
                     // last buddy cleans stuff ;}
                     if(last)
                     {
-                        OPMaps::Instance()->kiberCacheLock.lockForWrite();
                         OPMaps::Instance()->TilesInMemory.RemoveMemoryOverload();
-                        OPMaps::Instance()->kiberCacheLock.unlock();
 
                         MtileDrawingList.lock();
                         {
@@ -236,6 +229,35 @@ namespace internals {
         --runningThreads;
         MrunningThreads.unlock();
     }
+    void Core::OnTileFetched(core::MapType::Types type,core::Point pos,int zoom)
+    {
+        if(zoom != Zoom())
+            return;
+        Point p = ServerTilePos(type, pos);
+        bool visible;
+        MtileDrawingList.lock();
+        {
+            visible = tileDrawingList.contains(p);
+        }
+        MtileDrawingList.unlock();
+        if(visible)
+        {
+            EnqueueLoadTask(LoadTask(p, zoom));
+        }
+    }
+    void Core::OnTileFetchFailed(core::MapType::Types type,core::Point pos,int zoom)
+    {
+        emit OnEmptyTileError(zoom, ServerTilePos(type, pos));
+    }
+    Point Core::ServerTilePos(MapType::Types const& type,Point const& pos)
+    {
+        // tile number inversion(BottomLeft -> TopLeft) for pergo maps
+        if(type == MapType::PergoTurkeyMap)
+        {
+            return Point(pos.X(), maxOfTiles.Height() - pos.Y());
+        }
+        return pos;
+    }
     diagnostics Core::GetDiagnostics()
     {
         MrunningThreads.lock();
@@ -262,6 +284,7 @@ namespace internals {
                 tilesToload=0;
                 MtileToload.unlock();
                 Matrix.Clear();
+                emit OnTilesCleared();
                 GoToCurrentPositionOnZoom();
                 UpdateBounds();
                 emit OnMapDrag();
@@ -295,6 +318,37 @@ namespace internals {
             }
         }
     }
+    PureProjection* Core::NewProjection(const MapType::Types &type,int &maxZoom)
+    {
+        switch(type)
+        {
+        case MapType::ArcGIS_Map:
+        case MapType::ArcGIS_Satellite:
+        case MapType::ArcGIS_ShadedRelief:
+        case MapType::ArcGIS_Terrain:
+            maxZoom=13;
+            return new PlateCarreeProjection();
+
+        case MapType::ArcGIS_MapsLT_Map_Hybrid:
+        case MapType::ArcGIS_MapsLT_Map_Labels:
+        case MapType::ArcGIS_MapsLT_Map:
+        case MapType::ArcGIS_MapsLT_OrtoFoto:
+            maxZoom=11;
+            return new LKS94Projection();
+
+        case MapType::PergoTurkeyMap:
+            maxZoom=17;
+            return new PlateCarreeProjectionPergo();
+
+        case MapType::YandexMapRu:
+            maxZoom=13;
+            return new MercatorProjectionYandex();
+
+        default:
+            maxZoom=21;
+            return new MercatorProjection();
+        }
+    }
     void Core::SetMapType(const MapType::Types &value)
     {
 
@@ -302,65 +356,16 @@ namespace internals {
         {
             mapType = value;
 
-            switch(value)
+            int typeMaxZoom;
+            PureProjection* typeProjection=NewProjection(value,typeMaxZoom);
+            if(Projection()->Type()!=typeProjection->Type())
             {
-
-
-            case MapType::ArcGIS_Map:
-            case MapType::ArcGIS_Satellite:
-            case MapType::ArcGIS_ShadedRelief:
-            case MapType::ArcGIS_Terrain:
-                {
-                    if(Projection()->Type()!="PlateCarreeProjection")
-                    {
-                        SetProjection(new PlateCarreeProjection());
-                        maxzoom=13;
-                    }
-                }
-                break;
-
-            case MapType::ArcGIS_MapsLT_Map_Hybrid:
-            case MapType::ArcGIS_MapsLT_Map_Labels:
-            case MapType::ArcGIS_MapsLT_Map:
-            case MapType::ArcGIS_MapsLT_OrtoFoto:
-                {
-                    if(Projection()->Type()!="LKS94Projection")
-                    {
-                        SetProjection(new LKS94Projection());
-                        maxzoom=11;
-                    }
-                }
-                break;
-
-            case MapType::PergoTurkeyMap:
-                {
-                    if(Projection()->Type()!="PlateCarreeProjectionPergo")
-                    {
-                        SetProjection(new PlateCarreeProjectionPergo());
-                        maxzoom=17;
-                    }
-                }
-                break;
-
-            case MapType::YandexMapRu:
-                {
-                    if(Projection()->Type()!="MercatorProjectionYandex")
-                    {
-                        SetProjection(new MercatorProjectionYandex());
-                        maxzoom=13;
-                    }
-                }
-                break;
-
-            default:
-                {
-                    if(Projection()->Type()!="MercatorProjection")
-                    {
-                        SetProjection(new MercatorProjection());
-                        maxzoom=21;
-                    }
-                }
-                break;
+                SetProjection(typeProjection);
+                maxzoom=typeMaxZoom;
+            }
+            else
+            {
+                delete typeProjection;
             }
 
             minOfTiles = Projection()->GetTileMatrixMinXY(Zoom());
@@ -511,7 +516,9 @@ namespace internals {
             MtileToload.lock();
             tilesToload=0;
             MtileToload.unlock();
+            fetcher.Clear();
             Matrix.Clear();
+            emit OnTilesCleared();
 
             emit OnNeedInvalidation();
 
@@ -620,6 +627,7 @@ namespace internals {
             MtileToload.lock();
             tilesToload=0;
             MtileToload.unlock();
+            fetcher.Clear();
             //  ProcessLoadTaskCallback.waitForDone();
         }
     }
@@ -635,33 +643,41 @@ namespace internals {
 
             emit OnTileLoadStart();
 
-
+            // nearest tiles of the new view first, the rest is not needed anymore
+            QList<Point> keep;
             foreach(Point p,tileDrawingList)
             {
-                LoadTask task = LoadTask(p, Zoom());
-                {
-                    MtileLoadQueue.lock();
-                    {
-                        if(!tileLoadQueue.contains(task))
-                        {
-                            MtileToload.lock();
-                            ++tilesToload;
-                            MtileToload.unlock();
-                            tileLoadQueue.enqueue(task);
-#ifdef DEBUG_CORE
-                            qDebug()<<"Core::UpdateBounds new Task"<<task.Pos.ToString();
-#endif //DEBUG_CORE
-                            ProcessLoadTaskCallback.start(this);
-                        }
-                    }
-                    MtileLoadQueue.unlock();
-                }
+                keep.append(ServerTilePos(GetMapType(), p));
+            }
+            fetcher.SetFocus(ServerTilePos(GetMapType(), centerTileXYLocation), Zoom());
+            fetcher.CancelOutside(Zoom(), keep);
 
+            foreach(Point p,tileDrawingList)
+            {
+                EnqueueLoadTask(LoadTask(p, Zoom()));
             }
         }
         MtileDrawingList.unlock();
         UpdateGroundResolution();
     }
+    void Core::EnqueueLoadTask(const LoadTask &task)
+    {
+        MtileLoadQueue.lock();
+        {
+            if(!tileLoadQueue.contains(task))
+            {
+                MtileToload.lock();
+                ++tilesToload;
+                MtileToload.unlock();
+                tileLoadQueue.enqueue(task);
+#ifdef DEBUG_CORE
+                qDebug()<<"Core::EnqueueLoadTask new Task"<<task.Pos.ToString();
+#endif //DEBUG_CORE
+                ProcessLoadTaskCallback.start(this);
+            }
+        }
+        MtileLoadQueue.unlock();
+    }
     void Core::FindTilesAround(QList<Point> &list)
     {
         list.clear();;
@@ -49,6 +49,7 @@
 #include "../internals/projections/platecarreeprojectionpergo.h"
 #include "../core/geodecoderstatus.h"
 #include "../core/opmaps.h"
+#include "../core/tilefetcher.h"
 #include "../core/diagnostics.h"
 
 #include <QSemaphore>
@@ -149,6 +150,12 @@ namespace internals {
 
         MapType::Types GetMapType(){return mapType;}
         void SetMapType(MapType::Types const& value);
+        /**
+        * @brief Creates the projection of a map type, the caller owns it
+        *
+        * @param maxZoom set to the last zoom level of the map type
+        */
+        static PureProjection* NewProjection(MapType::Types const& type,int &maxZoom);
 
         void StartSystem();
 
@@ -203,8 +210,20 @@ namespace internals {
         void OnMapTypeChanged(MapType::Types type);
         void OnEmptyTileError(int zoom, core::Point pos);
         void OnNeedInvalidation();
+        /**
+        * @brief All tiles of the matrix were removed, e.g. on reload, zoom or map type change
+        */
+        void OnTilesCleared();
+
+    private slots:
+        void OnTileFetched(core::MapType::Types type,core::Point pos,int zoom);
+        void OnTileFetchFailed(core::MapType::Types type,core::Point pos,int zoom);
 
     private:
+        /// Queue a tile of the current view for loading unless it is queued already
+        void EnqueueLoadTask(const LoadTask &task);
+        /// Tile number on the server, pergo maps count from the bottom left
+        core::Point ServerTilePos(MapType::Types const& type,core::Point const& pos);
 
 
         PointLatLng currentPosition;
@@ -255,6 +274,7 @@ namespace internals {
         QSemaphore loaderLimit;
 
         QThreadPool ProcessLoadTaskCallback;
+        core::TileFetcher fetcher;
         QMutex MtileToload;
         int tilesToload;
 
@@ -25,6 +25,7 @@
 * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 */
 #include "tile.h"
+#include <QPainter>
 
  
 namespace internals {
@@ -44,8 +45,39 @@ void Tile::Clear()
         img.~QByteArray();
     }
     Overlays.clear();
+    Image = QImage();
     mutex.unlock();
 }
+void Tile::DecodeOverlays()
+{
+    // Decoding and drawing into a QImage is safe outside of the GUI thread,
+    // the premultiplied format makes the later conversion to a pixmap cheap
+    QImage image;
+    foreach(QByteArray img, Overlays)
+    {
+        QImage layer = QImage::fromData(img);
+        if(layer.isNull())
+            continue;
+        if(image.isNull())
+        {
+            image = layer.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        }
+        else
+        {
+            QPainter painter(&image);
+            painter.drawImage(0, 0, layer);
+        }
+    }
+    mutex.lock();
+    Image = image;
+    mutex.unlock();
+}
+QImage Tile::GetImage()
+{
+    // Implicitly shared, only the reference is taken under the lock
+    QMutexLocker locker(&mutex);
+    return Image;
+}
 Tile::Tile():zoom(0),pos(0,0)
 {
 
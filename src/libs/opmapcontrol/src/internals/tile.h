@@ -53,7 +53,19 @@ public:
         this->pos=cSource.pos;
     }
     bool HasValue(){return !(zoom==0);}
+    /**
+    * @brief Decodes the overlays into Image, to be called by the loader before the tile is drawn
+    */
+    void DecodeOverlays();
     QList<QByteArray> Overlays;
+    /**
+    * @brief All overlays decoded and drawn on top of each other, null if none could be decoded
+    */
+    QImage Image;
+    /**
+    * @brief Copy of Image taken under the lock of the tile, for readers outside the loader
+    */
+    QImage GetImage();
 protected:
 
     QMutex mutex;
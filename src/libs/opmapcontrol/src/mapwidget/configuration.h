@@ -146,6 +146,34 @@ public:
     */
     void SetTileMemorySize(int const& value){core::OPMaps::Instance()->TilesInMemory.setMemoryCacheCapacity(value);}
 
+    /**
+    * @brief  Returns the size of the memory for tiles
+    *
+    * @return size in Mb used for tiles at most
+    */
+    int TileMemorySize()const{return core::OPMaps::Instance()->TilesInMemory.MemoryCacheCapacity();}
+
+    /**
+    * @brief  Returns the number of tiles found in the memory cache
+    *
+    * @return
+    */
+    int TileMemoryHits()const{return core::OPMaps::Instance()->TilesInMemory.Hits();}
+
+    /**
+    * @brief  Returns the number of tiles not found in the memory cache
+    *
+    * @return
+    */
+    int TileMemoryMisses()const{return core::OPMaps::Instance()->TilesInMemory.Misses();}
+
+    /**
+    * @brief  Returns the number of tiles evicted from the memory cache
+    *
+    * @return
+    */
+    int TileMemoryEvictions()const{return core::OPMaps::Instance()->TilesInMemory.Evictions();}
+
     /**
     * @brief Sets the location for the SQLite Database used for caching and the geocoding cache files
     *
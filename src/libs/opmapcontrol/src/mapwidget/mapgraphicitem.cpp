@@ -43,6 +43,8 @@ namespace mapcontrol
         isSelected(false)
     {
         dragons.load(QString::fromUtf8(":/markers/images/dragons1.jpg"));
+        // 64 MB, 256 tiles of 256x256 pixels
+        tilePixmaps.setMaxCost(64*1024);
         showTileGridLines=false;
         isMouseOverMarker=false;
         maprect=QRectF(0,0,1022,680);
@@ -50,6 +52,7 @@ namespace mapcontrol
         core->SetMapType(MapType::GoogleHybrid);
         this->SetZoom(2);
         connect(core,SIGNAL(OnNeedInvalidation()),this,SLOT(Core_OnNeedInvalidation()));
+        connect(core,SIGNAL(OnTilesCleared()),this,SLOT(Core_OnTilesCleared()));
         connect(core,SIGNAL(OnMapDrag()),this,SLOT(ChildPosRefresh()));
         connect(core,SIGNAL(OnMapZoomChanged()),this,SLOT(ChildPosRefresh()));
         //resize();
@@ -83,6 +86,10 @@ namespace mapcontrol
         const int Margin = 1;
         return maprect.adjusted(-Margin, -Margin, +Margin, +Margin);
     }
+    void MapGraphicItem::Core_OnTilesCleared()
+    {
+        tilePixmaps.clear();
+    }
     void MapGraphicItem::Core_OnNeedInvalidation()
     {
         this->update();
@@ -360,7 +367,7 @@ namespace mapcontrol
     }
     void MapGraphicItem::DrawMap2D(QPainter *painter)
     {
-        painter->drawImage(this->boundingRect(),dragons.toImage());
+        painter->drawPixmap(this->boundingRect(),dragons,dragons.rect());
          if(!lastimage.isNull())
             painter->drawImage(core->GetrenderOffset().X()-lastimagepoint.X(),core->GetrenderOffset().Y()-lastimagepoint.Y(),lastimage);
 
@@ -385,17 +392,12 @@ namespace mapcontrol
                             //lock(t.Overlays)
                             if(t!=0)
                             {
-                                foreach(QByteArray img,t->Overlays)
+                                QPixmap* pixmap = TilePixmap(t);
+                                if(pixmap)
                                 {
-                                    if(img.count()!=0)
-                                    {
-                                        if(!found)
-                                            found = true;
-                                        {
-                                            painter->drawPixmap(core->tileRect.X(),core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height(),PureImageProxy::FromStream(img));
-                                           // qDebug()<<"tile:"<<core->tileRect.X()<<core->tileRect.Y();
-                                        }
-                                    }
+                                    found = true;
+                                    painter->drawPixmap(core->tileRect.X(),core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height(),*pixmap);
+                                   // qDebug()<<"tile:"<<core->tileRect.X()<<core->tileRect.Y();
                                 }
                             }
 
@@ -427,23 +429,24 @@ namespace mapcontrol
                                 // raise error
 
                             }
-                            if(!SelectedArea().IsEmpty())
-                            {
-                                core::Point p1 = FromLatLngToLocal(SelectedArea().LocationTopLeft());
-                                core::Point p2 = FromLatLngToLocal(SelectedArea().LocationRightBottom());
-                                int x1 = p1.X();
-                                int y1 = p1.Y();
-                                int x2 = p2.X();
-                                int y2 = p2.Y();
-                                painter->setPen(Qt::black);
-                                painter->setBrush(QBrush(QColor(50,50,100,20)));
-                                painter->drawRect(x1,y1,x2-x1,y2-y1);
-                            }
                         }
                     }
                 }
             }
         }
+        // The selection does not depend on the tiles, draw it once on top
+        if(!SelectedArea().IsEmpty())
+        {
+            core::Point p1 = FromLatLngToLocal(SelectedArea().LocationTopLeft());
+            core::Point p2 = FromLatLngToLocal(SelectedArea().LocationRightBottom());
+            int x1 = p1.X();
+            int y1 = p1.Y();
+            int x2 = p2.X();
+            int y2 = p2.Y();
+            painter->setPen(Qt::black);
+            painter->setBrush(QBrush(QColor(50,50,100,20)));
+            painter->drawRect(x1,y1,x2-x1,y2-y1);
+        }
         // painter->drawRect(core->GetrenderOffset().X()-lastimagepoint.X()-3,core->GetrenderOffset().Y()-lastimagepoint.Y()-3,lastimage.width(),lastimage.height());
 //        painter->setPen(Qt::red);
 //        painter->drawLine(-10,-10,10,10);
@@ -452,6 +455,33 @@ namespace mapcontrol
     }
 
 
+    QPixmap* MapGraphicItem::TilePixmap(internals::Tile* tile)
+    {
+        TilePixmapKey key;
+        key.type = core->GetMapType();
+        key.x = tile->GetPos().X();
+        key.y = tile->GetPos().Y();
+        key.zoom = tile->GetZoom();
+        // The loader threads may replace the image meanwhile
+        QImage image = tile->GetImage();
+        TilePixmapEntry* entry = tilePixmaps.object(key);
+        if(entry && !image.isNull() && entry->imageKey==image.cacheKey())
+            return &entry->pixmap;
+        // The tile was replaced by Matrix.SetTileAt() or cleared
+        if(entry)
+            tilePixmaps.remove(key);
+        if(image.isNull())
+            return 0;
+        // Pixmaps may only be created in the GUI thread, so this is done on the first paint
+        entry = new TilePixmapEntry;
+        entry->pixmap = QPixmap::fromImage(image);
+        entry->imageKey = image.cacheKey();
+        const int cost = qMax(1, entry->pixmap.width()*entry->pixmap.height()*4/1024);
+        if(!tilePixmaps.insert(key, entry, cost))
+            return 0;
+        return &entry->pixmap;
+    }
+
     core::Point MapGraphicItem::FromLatLngToLocal(internals::PointLatLng const& point)
     {
         core::Point ret = core->FromLatLngToLocal(point);
@@ -38,12 +38,31 @@
 #include <QBrush>
 #include <QFont>
 #include <QObject>
+#include <QCache>
 #include "waypointitem.h"
 //#include "uavitem.h"
 namespace mapcontrol
 {
     class OPMapWidget;
     /**
+    * @brief Identifies the pixmap of a tile position, the image key tells if the tile was replaced since
+    */
+    struct TilePixmapKey
+    {
+        int type;
+        int x;
+        int y;
+        int zoom;
+        bool operator==(TilePixmapKey const& other)const
+        {
+            return type==other.type && x==other.x && y==other.y && zoom==other.zoom;
+        }
+    };
+    inline uint qHash(TilePixmapKey const& key)
+    {
+        return ((uint)key.type<<27) ^ ((uint)key.zoom<<22) ^ ((uint)key.x<<11) ^ (uint)key.y;
+    }
+    /**
     * @brief The main graphicsItem used on the widget, contains the map and map logic
     *
     * @class MapGraphicItem mapgraphicitem.h "mapgraphicitem.h"
@@ -175,6 +194,28 @@ namespace mapcontrol
         bool isSelected;
         bool isMouseOverMarker;
         QPixmap dragons;
+        /**
+        * @brief Pixmap of a decoded tile and the cache key of the image it was made from
+        */
+        struct TilePixmapEntry
+        {
+            QPixmap pixmap;
+            qint64 imageKey;
+        };
+        /**
+        * @brief Pixmaps of the decoded tiles, the cost is the size in KB
+        */
+        QCache<TilePixmapKey,TilePixmapEntry> tilePixmaps;
+        /**
+        * @brief Returns the cached pixmap of a tile, converting its image on the first call
+        *
+        * A pixmap made from an image which the tile does not hold anymore is
+        * dropped and converted again.
+        *
+        * @param tile a tile with decoded image
+        * @return QPixmap* 0 if the tile has no image
+        */
+        QPixmap* TilePixmap(internals::Tile* tile);
         void SetIsMouseOverMarker(bool const& value){isMouseOverMarker = value;}
 
 
@@ -214,6 +255,10 @@ namespace mapcontrol
         void SetMapType(MapType::Types const& value){core->SetMapType(value);}
     private slots:
         void Core_OnNeedInvalidation();
+        /**
+        * @brief Drops all pixmaps, the tiles they were made from are gone
+        */
+        void Core_OnTilesCleared();
         void ChildPosRefresh();
     public slots:
         /**
@@ -0,0 +1,57 @@
+/**
+******************************************************************************
+*
+* @file       mappacker.cpp
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      Builds tile packs from the tile cache in the background
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "mappacker.h"
+#include "../core/cache.h"
+namespace mapcontrol
+{
+    MapPacker::MapPacker(QString const& destDir,QObject* parent):QThread(parent),destDir(destDir),cancel(false)
+    {
+    }
+    MapPacker::~MapPacker()
+    {
+        Cancel();
+        wait();
+    }
+    void MapPacker::Cancel()
+    {
+        cancel=true;
+    }
+    void MapPacker::run()
+    {
+        core::PureImageCache& cache=core::Cache::Instance()->ImageCache;
+        emit StatusChanged(tr("Writing tile packs to %1").arg(destDir));
+        // Packs written to the packs directory of the cache are used at once
+        int written=cache.ExportMapDataToPacks(cache.GtileCache()+"Data.qmdb",destDir,&cancel);
+        if(written<0)
+            emit StatusChanged(tr("Could not read the tile cache"));
+        else if(cancel)
+            emit StatusChanged(tr("Cancelled, %1 tile packs written").arg(written));
+        else
+            emit StatusChanged(tr("%1 tile packs written to %2").arg(written).arg(destDir));
+        emit PacksWritten(written);
+    }
+}
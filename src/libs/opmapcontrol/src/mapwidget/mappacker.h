@@ -0,0 +1,67 @@
+/**
+******************************************************************************
+*
+* @file       mappacker.h
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      Builds tile packs from the tile cache in the background
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef MAPPACKER_H
+#define MAPPACKER_H
+
+#include <QThread>
+#include <QObject>
+#include <QString>
+
+namespace mapcontrol
+{
+    /**
+    * @brief Writes one tile pack per map type of the tile cache database into a directory
+    *
+    * Packs are read-only and much faster to look up than the database, they are
+    * meant for large offline map sets. Copy them into the packs directory of the
+    * cache of the ground station which should use them.
+    */
+    class MapPacker:public QThread
+    {
+        Q_OBJECT
+    public:
+        MapPacker(QString const& destDir,QObject* parent=0);
+        ~MapPacker();
+        void run();
+        QString DestDir()const{return destDir;}
+    signals:
+        void StatusChanged(QString const& status);
+        /**
+        * @brief Emitted when done, -1 if the cache could not be read
+        */
+        void PacksWritten(int const& count);
+    public slots:
+        /**
+        * @brief Stops after the current tile, the pack being written is dropped
+        */
+        void Cancel();
+    private:
+        QString destDir;
+        volatile bool cancel;
+    };
+}
+#endif // MAPPACKER_H
@@ -0,0 +1,333 @@
+/**
+******************************************************************************
+*
+* @file       mapprefetcher.cpp
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      Caches the tiles of an area for offline use in the background
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "mapprefetcher.h"
+#include <QPainterPath>
+#include <QPolygonF>
+#include <QSettings>
+#include <QStringList>
+#include <QFile>
+namespace mapcontrol
+{
+    PrefetchPlanner::PrefetchPlanner(internals::PureProjection* projection,core::MapType::Types const& type,
+                                     QList<internals::PointLatLng> const& polygon,int const& minZoom,int const& maxZoom):
+        total(0),projection(projection),type(type),polygon(polygon),minZoom(minZoom),maxZoom(maxZoom),cancel(false)
+    {
+    }
+    PrefetchPlanner::~PrefetchPlanner()
+    {
+        delete projection;
+    }
+
+    void PrefetchPlanner::run()
+    {
+        QVector<core::MapType::Types> layers=OPMaps::Instance()->GetAllLayersOfType(type);
+        core::Size tileSize=projection->TileSize();
+        const int padding=1;
+        for(int zoom=minZoom;zoom<=maxZoom;++zoom)
+        {
+            QPolygonF pixels;
+            foreach(internals::PointLatLng coord,polygon)
+            {
+                core::Point p=projection->FromLatLngToPixel(coord,zoom);
+                pixels<<QPointF(p.X(),p.Y());
+            }
+            QRectF bounds=pixels.boundingRect();
+            QPainterPath area;
+            if(pixels.count()<3)
+                area.addRect(bounds.adjusted(-1,-1,1,1));
+            else
+                area.addPolygon(pixels);
+            area.closeSubpath();
+
+            core::Size maxTiles=projection->GetTileMatrixMaxXY(zoom);
+            core::Point first=projection->FromPixelToTileXY(core::Point((int)bounds.left(),(int)bounds.top()));
+            core::Point last=projection->FromPixelToTileXY(core::Point((int)bounds.right(),(int)bounds.bottom()));
+            for(int x=qMax(first.X()-padding,0);x<=qMin(last.X()+padding,maxTiles.Width());++x)
+            {
+                for(int y=qMax(first.Y()-padding,0);y<=qMin(last.Y()+padding,maxTiles.Height());++y)
+                {
+                    if(cancel)
+                        return;
+                    QRectF rect(x*tileSize.Width(),y*tileSize.Height(),tileSize.Width(),tileSize.Height());
+                    if(!area.intersects(rect.adjusted(-padding*tileSize.Width(),-padding*tileSize.Height(),padding*tileSize.Width(),padding*tileSize.Height())))
+                        continue;
+                    foreach(core::MapType::Types layer,layers)
+                    {
+                        PrefetchTile tile;
+                        tile.type=layer;
+                        // tile number inversion(BottomLeft -> TopLeft) for pergo maps
+                        tile.pos=core::Point(x,(layer==core::MapType::PergoTurkeyMap)?maxTiles.Height()-y:y);
+                        tile.zoom=zoom;
+                        tile.attempts=0;
+                        ++total;
+                        if(!Cache::Instance()->ImageCache.HasImage(tile.type,tile.pos,tile.zoom))
+                            tiles.append(tile);
+                    }
+                }
+            }
+        }
+    }
+
+    MapPrefetcher::MapPrefetcher(internals::Core* core):core(core),planner(0),versionsReply(0),total(0),missing(0),downloaded(0),failed(0),
+        maxDownloads(4),running(false)
+    {
+        connect(&network,SIGNAL(finished(QNetworkReply*)),this,SLOT(OnReplyFinished(QNetworkReply*)));
+        connect(&timeoutTimer,SIGNAL(timeout()),this,SLOT(CheckTimeouts()));
+        timeoutTimer.setInterval(timeoutInterval);
+        connect(OPMaps::Instance(),SIGNAL(GoogleVersionsResolved()),this,SLOT(Dispatch()));
+    }
+    MapPrefetcher::~MapPrefetcher()
+    {
+        Stop();
+        if(versionsReply)
+        {
+            // Resolved with the built in versions, the map must not wait for it forever
+            QNetworkReply* reply=versionsReply;
+            versionsReply=0;
+            reply->abort();
+            OPMaps::Instance()->SetGoogleVersions(QByteArray());
+        }
+    }
+
+    QString MapPrefetcher::JobFile()
+    {
+        return Cache::Instance()->ImageCache.GtileCache()+"prefetch.job";
+    }
+    bool MapPrefetcher::HasUnfinishedJob()
+    {
+        // The job is kept in cache only mode, it is offered again once downloads are possible
+        return OPMaps::Instance()->GetAccessMode()!=core::AccessMode::CacheOnly && QFile::exists(JobFile());
+    }
+
+    void MapPrefetcher::Start(QList<internals::PointLatLng> const& polygon,int const& minZoom,int const& maxZoom)
+    {
+        QStringList corners;
+        foreach(internals::PointLatLng coord,polygon)
+        {
+            corners<<QString::number(coord.Lat(),'f',8)+" "+QString::number(coord.Lng(),'f',8);
+        }
+        QSettings job(JobFile(),QSettings::IniFormat);
+        job.setValue("Type",(int)core->GetMapType());
+        job.setValue("MinZoom",minZoom);
+        job.setValue("MaxZoom",maxZoom);
+        job.setValue("Polygon",corners);
+        job.sync();
+        Run(core->GetMapType(),polygon,minZoom,maxZoom);
+    }
+    bool MapPrefetcher::Resume()
+    {
+        if(!HasUnfinishedJob())
+            return false;
+        QSettings job(JobFile(),QSettings::IniFormat);
+        QList<internals::PointLatLng> polygon;
+        foreach(QString corner,job.value("Polygon").toStringList())
+        {
+            QStringList coord=corner.split(" ");
+            if(coord.count()==2)
+                polygon.append(internals::PointLatLng(coord.at(0).toDouble(),coord.at(1).toDouble()));
+        }
+        if(polygon.isEmpty())
+            return false;
+        Run((core::MapType::Types)job.value("Type").toInt(),polygon,job.value("MinZoom").toInt(),job.value("MaxZoom").toInt());
+        return true;
+    }
+    void MapPrefetcher::Run(core::MapType::Types const& type,QList<internals::PointLatLng> const& polygon,int const& minZoom,int const& maxZoom)
+    {
+        Stop();
+        running=true;
+        total=0;
+        missing=0;
+        downloaded=0;
+        failed=0;
+        emit StatusChanged(tr("Checking the cache for %1 from zoom level %2 to %3").arg(core::MapType::StrByType(type)).arg(minZoom).arg(maxZoom));
+        // The job may be of another map type than the one shown
+        int typeMaxZoom;
+        internals::PureProjection* projection=internals::Core::NewProjection(type,typeMaxZoom);
+        planner=new PrefetchPlanner(projection,type,polygon,minZoom,qMin(maxZoom,typeMaxZoom));
+        connect(planner,SIGNAL(finished()),this,SLOT(OnPlanned()));
+        planner->start(QThread::LowPriority);
+    }
+    void MapPrefetcher::Stop()
+    {
+        if(planner)
+        {
+            planner->disconnect(this);
+            planner->Cancel();
+            planner->wait();
+            delete planner;
+            planner=0;
+        }
+        waiting.clear();
+        QList<QNetworkReply*> replies=inFlight.keys();
+        inFlight.clear();
+        timedOut.clear();
+        foreach(QNetworkReply* reply,replies)
+        {
+            reply->abort();
+        }
+        // A running lookup of the Google versions is left to finish, the map tiles wait for it too
+        if(!versionsReply)
+            timeoutTimer.stop();
+        if(running)
+        {
+            running=false;
+            emit StatusChanged(tr("Stopped, %1 of %2 tiles cached").arg(total-missing+downloaded).arg(total));
+            emit Finished(failed);
+        }
+    }
+
+    void MapPrefetcher::OnPlanned()
+    {
+        waiting=planner->tiles;
+        total=planner->total;
+        missing=waiting.count();
+        planner->deleteLater();
+        planner=0;
+        if(OPMaps::Instance()->GetAccessMode()==core::AccessMode::CacheOnly && missing>0)
+        {
+            emit StatusChanged(tr("%1 tiles missing, downloads are disabled in cache only mode").arg(missing));
+            failed=missing;
+            running=false;
+            emit Finished(failed);
+            return;
+        }
+        emit StatusChanged(tr("Downloading %1 of %2 tiles").arg(missing).arg(total));
+        elapsed.start();
+        ReportProgress();
+        Dispatch();
+    }
+    void MapPrefetcher::Dispatch()
+    {
+        // The tiles are not known before the planner finished, OnPlanned() dispatches them
+        if(!running || planner)
+            return;
+        OPMaps* maps=OPMaps::Instance();
+        network.setProxy(maps->Proxy);
+        // Tiles of Google types wait for the current versions, they are looked up once without blocking
+        bool needVersions=false;
+        for(int i=0;inFlight.count()<maxDownloads && i<waiting.count();)
+        {
+            if(maps->GoogleVersionsPending(waiting.at(i).type))
+            {
+                needVersions=true;
+                ++i;
+                continue;
+            }
+            PrefetchTile tile=waiting.takeAt(i);
+            tile.started.start();
+            inFlight.insert(network.get(maps->MakeImageRequest(tile.type,tile.pos,tile.zoom)),tile);
+        }
+        if(needVersions && !versionsReply && maps->ClaimGoogleVersions())
+        {
+            versionsReply=network.get(maps->GoogleVersionsRequest());
+            versionsStarted.start();
+        }
+        if((!inFlight.isEmpty() || versionsReply) && !timeoutTimer.isActive())
+            timeoutTimer.start();
+        if(inFlight.isEmpty() && waiting.isEmpty())
+            Finish();
+    }
+    void MapPrefetcher::CheckTimeouts()
+    {
+        int timeout=OPMaps::Instance()->Timeout;
+        if(versionsReply && versionsStarted.elapsed()>timeout)
+        {
+            // Finishes with an error, the built in versions are used then
+            versionsReply->abort();
+        }
+        QList<QNetworkReply*> expired;
+        QHash<QNetworkReply*,PrefetchTile>::const_iterator i;
+        for(i=inFlight.constBegin();i!=inFlight.constEnd();++i)
+        {
+            if(!timedOut.contains(i.key()) && i.value().started.elapsed()>timeout)
+                expired.append(i.key());
+        }
+        foreach(QNetworkReply* reply,expired)
+        {
+            timedOut.insert(reply);
+            reply->abort();
+        }
+    }
+    void MapPrefetcher::OnReplyFinished(QNetworkReply* reply)
+    {
+        reply->deleteLater();
+        OPMaps* maps=OPMaps::Instance();
+        if(reply==versionsReply)
+        {
+            versionsReply=0;
+            if(inFlight.isEmpty())
+                timeoutTimer.stop();
+            // Emits GoogleVersionsResolved, which dispatches the held back tiles
+            maps->SetGoogleVersions(reply->error()==QNetworkReply::NoError?reply->readAll():QByteArray());
+            return;
+        }
+        if(!inFlight.contains(reply))
+            return;
+        PrefetchTile tile=inFlight.take(reply);
+        bool timeout=timedOut.remove(reply);
+        if(inFlight.isEmpty() && !versionsReply)
+            timeoutTimer.stop();
+        QByteArray img;
+        if(!timeout && reply->error()==QNetworkReply::NoError)
+            img=reply->readAll();
+        if(!img.isEmpty())
+        {
+            maps->StoreImage(tile.type,tile.pos,tile.zoom,img);
+            ++downloaded;
+        }
+        else
+        {
+            maps->ImageFailed(timeout);
+            // Try again after all others
+            if(++tile.attempts<maps->RetryLoadTile)
+                waiting.append(tile);
+            else
+                ++failed;
+        }
+        ReportProgress();
+        Dispatch();
+    }
+    void MapPrefetcher::ReportProgress()
+    {
+        int remaining=missing-downloaded-failed;
+        int secondsLeft=-1;
+        if(downloaded>0)
+            secondsLeft=(int)((qint64)elapsed.elapsed()*remaining/downloaded/1000);
+        emit ProgressChanged(total-remaining-failed,total,secondsLeft);
+    }
+    void MapPrefetcher::Finish()
+    {
+        running=false;
+        if(!versionsReply)
+            timeoutTimer.stop();
+        // Failed tiles are left for a resume
+        if(failed==0)
+            QFile::remove(JobFile());
+        emit StatusChanged(tr("%1 of %2 tiles cached, %3 failed").arg(total-missing+downloaded).arg(total).arg(failed));
+        emit Finished(failed);
+    }
+}
@@ -0,0 +1,176 @@
+/**
+******************************************************************************
+*
+* @file       mapprefetcher.h
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      Caches the tiles of an area for offline use in the background
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef MAPPREFETCHER_H
+#define MAPPREFETCHER_H
+
+#include <QThread>
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QTime>
+#include <QTimer>
+#include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkReply>
+#include "../internals/core.h"
+
+namespace mapcontrol
+{
+    /**
+    * @brief One tile of a prefetch job
+    */
+    struct PrefetchTile
+    {
+        core::MapType::Types type;
+        core::Point pos;
+        int zoom;
+        int attempts;
+        QTime started;
+    };
+
+    /**
+    * @brief Finds the tiles of a prefetch job which are not in the database cache yet
+    *
+    * Runs in its own thread since the cache has to be asked for every tile of the area.
+    * Owns the projection, which is the one of the job's map type, not the one
+    * of the map shown.
+    */
+    class PrefetchPlanner:public QThread
+    {
+        Q_OBJECT
+    public:
+        PrefetchPlanner(internals::PureProjection* projection,core::MapType::Types const& type,
+                        QList<internals::PointLatLng> const& polygon,int const& minZoom,int const& maxZoom);
+        ~PrefetchPlanner();
+        void run();
+        void Cancel(){cancel=true;}
+        QList<PrefetchTile> tiles;  ///< Tiles missing in the cache, valid once the thread finished
+        int total;                  ///< Tiles of the area including the cached ones
+    private:
+        internals::PureProjection* projection;
+        core::MapType::Types type;
+        QList<internals::PointLatLng> polygon;
+        int minZoom;
+        int maxZoom;
+        volatile bool cancel;
+    };
+
+    /**
+    * @brief Caches the tiles of an area for offline use in the background
+    *
+    * The area is a polygon, e.g. the hull of a mission, and is cached for a range
+    * of zoom levels including one tile around it. Tiles already in the database
+    * cache are skipped, the others are downloaded with at most MaxDownloads
+    * requests at the same time over one network access manager and written to
+    * the database cache only.
+    *
+    * The job is stored next to the cache until it is complete, so an interrupted
+    * job can be resumed later, even after a restart, and only downloads the tiles
+    * still missing.
+    */
+    class MapPrefetcher:public QObject
+    {
+        Q_OBJECT
+    public:
+        MapPrefetcher(internals::Core* core);
+        ~MapPrefetcher();
+        /**
+        * @brief Starts caching an area of the current map type
+        *
+        * @param polygon corners of the area
+        * @param minZoom first zoom level
+        * @param maxZoom last zoom level
+        */
+        void Start(QList<internals::PointLatLng> const& polygon,int const& minZoom,int const& maxZoom);
+        /**
+        * @brief Continues the stored job
+        *
+        * @return false if there is no unfinished job
+        */
+        bool Resume();
+        /**
+        * @brief Returns true if an interrupted job is stored and can be resumed
+        *
+        * Always false in cache only mode, the job could not download anything.
+        */
+        static bool HasUnfinishedJob();
+        bool IsRunning()const{return running;}
+        void SetMaxDownloads(int const& value){maxDownloads=qMax(1,value);}
+        int MaxDownloads()const{return maxDownloads;}
+    public slots:
+        /**
+        * @brief Stops the job, it stays stored and can be resumed
+        */
+        void Stop();
+    signals:
+        void StatusChanged(QString const& status);
+        /**
+        * @brief Fires after every tile
+        *
+        * @param done tiles in the cache
+        * @param total tiles of the area
+        * @param secondsLeft estimated time until the job is complete, -1 if unknown
+        */
+        void ProgressChanged(int const& done,int const& total,int const& secondsLeft);
+        /**
+        * @brief Fires when the job is complete or stopped
+        *
+        * @param failed number of tiles which could not be downloaded
+        */
+        void Finished(int const& failed);
+    private slots:
+        void OnPlanned();
+        void Dispatch();
+        void OnReplyFinished(QNetworkReply* reply);
+        void CheckTimeouts();
+    private:
+        static QString JobFile();
+        void Run(core::MapType::Types const& type,QList<internals::PointLatLng> const& polygon,int const& minZoom,int const& maxZoom);
+        void Finish();
+        void ReportProgress();
+
+        static const int timeoutInterval=250;  ///< Milliseconds between two timeout checks
+
+        internals::Core* core;
+        PrefetchPlanner* planner;
+        QNetworkAccessManager network;
+        QList<PrefetchTile> waiting;
+        QHash<QNetworkReply*,PrefetchTile> inFlight;
+        QSet<QNetworkReply*> timedOut;
+        QNetworkReply* versionsReply;  ///< Lookup of the Google versions, 0 if none
+        QTime versionsStarted;
+        QTimer timeoutTimer;
+        int total;
+        int missing;      ///< Tiles not in the cache when the job started
+        int downloaded;   ///< Tiles downloaded since the job started
+        int failed;
+        QTime elapsed;
+        int maxDownloads;
+        bool running;
+    };
+}
+#endif // MAPPREFETCHER_H
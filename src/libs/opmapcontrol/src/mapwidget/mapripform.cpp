@@ -33,6 +33,7 @@ MapRipForm::MapRipForm(QWidget *parent) :
     ui(new Ui::MapRipForm)
 {
     ui->setupUi(this);
+    connect(ui->cancelButton,SIGNAL(clicked()),this,SIGNAL(Cancelled()));
 }
 
 MapRipForm::~MapRipForm()
@@ -51,3 +52,15 @@ void MapRipForm::SetNumberOfTiles(const int &total, const int &actual)
 {
     ui->statuslabel->setText(QString("Downloading tile %1 of %2").arg(actual).arg(total));
 }
+void MapRipForm::SetStatus(const QString &status)
+{
+    ui->mainlabel->setText(status);
+}
+void MapRipForm::SetProgress(const int &done, const int &total, const int &secondsLeft)
+{
+    ui->progressBar->setValue(total>0 ? (int)((qint64)done*100/total) : 100);
+    QString text=QString("%1 of %2 tiles cached").arg(done).arg(total);
+    if(secondsLeft>=0)
+        text+=QString(", about %1:%2 left").arg(secondsLeft/60).arg(secondsLeft%60,2,10,QChar('0'));
+    ui->statuslabel->setText(text);
+}
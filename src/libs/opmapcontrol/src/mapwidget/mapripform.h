@@ -44,6 +44,10 @@ public slots:
     void SetPercentage(int const& perc);
     void SetProvider(QString const& prov,int const& zoom);
     void SetNumberOfTiles(int const& total,int const& actual);
+    void SetStatus(QString const& status);
+    void SetProgress(int const& done,int const& total,int const& secondsLeft);
+signals:
+    void Cancelled();
 private:
     Ui::MapRipForm *ui;
 };
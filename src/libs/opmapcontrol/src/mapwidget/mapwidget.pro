@@ -14,7 +14,10 @@ SOURCES += mapgraphicitem.cpp \
     homeitem.cpp \
     mapripform.cpp \
     mapripper.cpp \
-    traillineitem.cpp
+    mapprefetcher.cpp \
+    mappacker.cpp \
+    traillineitem.cpp \
+    trailpathitem.cpp
 
 LIBS += -L../build \
     -lcore \
@@ -39,7 +42,10 @@ HEADERS += mapgraphicitem.h \
     homeitem.h \
     mapripform.h \
     mapripper.h \
-    traillineitem.h
+    mapprefetcher.h \
+    mappacker.h \
+    traillineitem.h \
+    trailpathitem.h
 QT += opengl
 QT += network
 QT += sql
@@ -44,7 +44,11 @@ namespace mapcontrol
         showhome(false),
         diagTimer(0),
         showDiag(false),
-        diagGraphItem(0)
+        diagGraphItem(0),
+        prefetcher(0),
+        prefetchForm(0),
+        packer(0),
+        packForm(0)
     {
         setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Preferred);
         core=new internals::Core;
@@ -231,6 +235,11 @@ namespace mapcontrol
     }
     OPMapWidget::~OPMapWidget()
     {
+        // Stops the job before the core is gone, it can be resumed
+        delete prefetcher;
+        delete prefetchForm;
+        delete packer;
+        delete packForm;
         delete UAV;
 
         foreach(UAVItem* uav, this->UAVS)
@@ -458,6 +467,73 @@ namespace mapcontrol
     {
         new MapRipper(core,map->SelectedArea());
     }
+    void OPMapWidget::PrefetchArea(QList<internals::PointLatLng> const& polygon,int const& minZoom,int const& maxZoom)
+    {
+        ShowPrefetchProgress();
+        prefetcher->Start(polygon,minZoom,maxZoom);
+    }
+    bool OPMapWidget::ResumePrefetch()
+    {
+        if(!MapPrefetcher::HasUnfinishedJob())
+            return false;
+        ShowPrefetchProgress();
+        return prefetcher->Resume();
+    }
+    void OPMapWidget::ShowPrefetchProgress()
+    {
+        if(!prefetcher)
+        {
+            prefetcher=new MapPrefetcher(core);
+            connect(prefetcher,SIGNAL(Finished(int)),this,SLOT(PrefetchFinished(int)));
+        }
+        if(!prefetchForm)
+        {
+            prefetchForm=new MapRipForm;
+            prefetchForm->setWindowTitle(tr("Caching map for offline use"));
+            connect(prefetcher,SIGNAL(StatusChanged(QString)),prefetchForm,SLOT(SetStatus(QString)));
+            connect(prefetcher,SIGNAL(ProgressChanged(int,int,int)),prefetchForm,SLOT(SetProgress(int,int,int)));
+            connect(prefetchForm,SIGNAL(Cancelled()),prefetcher,SLOT(Stop()));
+        }
+        prefetchForm->SetProgress(0,0,-1);
+        prefetchForm->show();
+    }
+    void OPMapWidget::PrefetchFinished(int const& failed)
+    {
+        // Keep the form open if tiles are missing, so the result can be read
+        if(failed==0 && prefetchForm)
+            prefetchForm->close();
+    }
+    void OPMapWidget::ExportTilePacks(QString const& destDir)
+    {
+        if(packer && packer->isRunning())
+            return;
+        delete packer;
+        packer=new MapPacker(destDir);
+        if(!packForm)
+        {
+            packForm=new MapRipForm;
+            packForm->setWindowTitle(tr("Building tile packs"));
+            connect(packForm,SIGNAL(Cancelled()),this,SLOT(PackCancelled()));
+        }
+        connect(packer,SIGNAL(StatusChanged(QString)),packForm,SLOT(SetStatus(QString)));
+        connect(packer,SIGNAL(PacksWritten(int)),this,SLOT(PacksWritten(int)));
+        packForm->SetPercentage(0);
+        packForm->show();
+        packer->start(QThread::LowPriority);
+    }
+    void OPMapWidget::PacksWritten(int const& count)
+    {
+        Q_UNUSED(count);
+        if(packForm)
+            packForm->SetPercentage(100);
+    }
+    void OPMapWidget::PackCancelled()
+    {
+        if(packer && packer->isRunning())
+            packer->Cancel();
+        else if(packForm)
+            packForm->close();
+    }
 
 
 #define deg_to_rad          ((double)M_PI / 180.0)
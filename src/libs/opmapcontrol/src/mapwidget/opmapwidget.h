@@ -42,6 +42,8 @@
 #include "homeitem.h"
 #include "waypointlineitem.h"
 #include "mapripper.h"
+#include "mapprefetcher.h"
+#include "mappacker.h"
 #include "uavtrailtype.h"
 namespace mapcontrol
 {
@@ -377,6 +379,34 @@ namespace mapcontrol
         bool ShowHome()const{return showhome;}
         void SetShowDiagnostics(bool const& value);
         void SetUavPic(QString UAVPic);
+        /**
+        * @brief Caches the tiles of an area for offline use in the background and shows the progress
+        *
+        * @param polygon corners of the area
+        * @param minZoom first zoom level
+        * @param maxZoom last zoom level
+        */
+        void PrefetchArea(QList<internals::PointLatLng> const& polygon,int const& minZoom,int const& maxZoom);
+        /**
+        * @brief Continues an interrupted PrefetchArea job
+        *
+        * @return false if there is none
+        */
+        bool ResumePrefetch();
+        /**
+        * @brief Returns true if an interrupted PrefetchArea job is stored
+        */
+        bool HasUnfinishedPrefetch()const{return MapPrefetcher::HasUnfinishedJob();}
+        /**
+        * @brief Writes the tile cache as one read-only tile pack per map type in the background
+        *
+        * @param destDir directory of the packs, packs in TilePacksLocation are used at once
+        */
+        void ExportTilePacks(QString const& destDir);
+        /**
+        * @brief Directory of the tile packs looked up before the tile cache database
+        */
+        QString TilePacksLocation(){return ::core::Cache::Instance()->ImageCache.PacksLocation();}
                 QMap<int, UAVItem*> UAVS;
     private:
         internals::Core *core;
@@ -393,9 +423,17 @@ namespace mapcontrol
         QTimer * diagTimer;
         bool showDiag;
         QGraphicsTextItem * diagGraphItem;
+        MapPrefetcher* prefetcher;
+        MapRipForm* prefetchForm;
+        void ShowPrefetchProgress();
+        MapPacker* packer;
+        MapRipForm* packForm;
 
     private slots:
         void diagRefresh();
+        void PrefetchFinished(int const& failed);
+        void PacksWritten(int const& count);
+        void PackCancelled();
         //   WayPointItem* item;//apagar
     protected:
         MapGraphicItem *map;
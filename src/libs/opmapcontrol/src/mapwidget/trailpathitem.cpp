@@ -0,0 +1,276 @@
+/**
+******************************************************************************
+*
+* @file       trailpathitem.cpp
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      A graphicsItem drawing the whole trail of a UAV
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#include "trailpathitem.h"
+#include "mapgraphicitem.h"
+#include <QPair>
+
+namespace mapcontrol
+{
+    TrailPathItem::TrailPathItem(MapGraphicItem* map,int const& maxPoints):QGraphicsItem(map),map(map),points(qMax(maxPoints,0)),head(0),count(0),
+        dropped(0),simplifiedEnd(0),simplifiedZoom(-1),appended(0),color(Qt::red),showdots(true),showline(true)
+    {
+    }
+
+    void TrailPathItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+    {
+        Q_UNUSED(option);
+        Q_UNUSED(widget);
+        if(showline && path.elementCount()>1)
+        {
+            QPen pen;
+            pen.setBrush(color);
+            pen.setWidth(1);
+            painter->setPen(pen);
+            painter->setBrush(Qt::NoBrush);
+            painter->drawPath(path);
+        }
+        if(showdots)
+        {
+            painter->setPen(QPen());
+            painter->setBrush(color);
+            for(int i=0;i<path.elementCount();++i)
+            {
+                const QPainterPath::Element& e=path.elementAt(i);
+                painter->drawEllipse(QRectF(e.x-2,e.y-2,4,4));
+            }
+        }
+    }
+    QRectF TrailPathItem::boundingRect()const
+    {
+        return bounds;
+    }
+    int TrailPathItem::type()const
+    {
+        return Type;
+    }
+
+    void TrailPathItem::AddPoint(internals::PointLatLng const& coord,QColor const& color)
+    {
+        this->color=color;
+        if(points.isEmpty())
+            return;
+        TrailPoint point;
+        point.lat=coord.Lat();
+        point.lng=coord.Lng();
+        if(count<points.size())
+        {
+            points[(head+count)%points.size()]=point;
+            ++count;
+        }
+        else
+        {
+            // full, replace the oldest point
+            points[head]=point;
+            head=(head+1)%points.size();
+            ++dropped;
+        }
+
+        if(simplifiedZoom!=(int)map->ZoomTotal())
+        {
+            simplifiedZoom=-1;
+            RefreshPos();
+            return;
+        }
+        if(++appended>=simplifyInterval)
+        {
+            SimplifyTail();
+            RefreshPos();
+            return;
+        }
+        // Extend the simplified trail until the next simplification
+        visible.append(coord);
+        visibleNumbers.append(dropped+count-1);
+        core::Point local=map->FromLatLngToLocal(coord);
+        prepareGeometryChange();
+        if(path.elementCount()==0)
+            path.moveTo(local.X(),local.Y());
+        else
+            path.lineTo(local.X(),local.Y());
+        bounds=path.boundingRect().adjusted(-3,-3,3,3);
+        update();
+    }
+    void TrailPathItem::Clear()
+    {
+        head=0;
+        count=0;
+        dropped=0;
+        simplifiedZoom=-1;
+        RefreshPos();
+    }
+    void TrailPathItem::SetMaxPoints(int const& value)
+    {
+        int size=qMax(value,0);
+        if(size==points.size())
+            return;
+        // Keep the newest points
+        int keep=qMin(count,size);
+        QVector<TrailPoint> resized(size);
+        for(int i=0;i<keep;++i)
+            resized[i]=At(count-keep+i);
+        points=resized;
+        dropped+=count-keep;
+        head=0;
+        count=keep;
+        simplifiedZoom=-1;
+        RefreshPos();
+    }
+    void TrailPathItem::SetShowDots(bool const& value)
+    {
+        showdots=value;
+        update();
+    }
+    void TrailPathItem::SetShowLine(bool const& value)
+    {
+        showline=value;
+        update();
+    }
+
+    void TrailPathItem::RefreshPos()
+    {
+        if(simplifiedZoom!=(int)map->ZoomTotal())
+            Simplify();
+        prepareGeometryChange();
+        path=QPainterPath();
+        for(int i=0;i<visible.size();++i)
+        {
+            core::Point local=map->FromLatLngToLocal(visible.at(i));
+            if(i==0)
+                path.moveTo(local.X(),local.Y());
+            else
+                path.lineTo(local.X(),local.Y());
+        }
+        bounds=path.boundingRect().adjusted(-3,-3,3,3);
+        update();
+    }
+
+    void TrailPathItem::Simplify()
+    {
+        simplifiedZoom=(int)map->ZoomTotal();
+        visible.clear();
+        visibleNumbers.clear();
+        SimplifyRange(0);
+    }
+    void TrailPathItem::SimplifyTail()
+    {
+        // Points appended unsimplified since the last run
+        int size=visibleNumbers.size();
+        while(size>0 && visibleNumbers.at(size-1)>=simplifiedEnd)
+            --size;
+        // The end of the last run was only kept for being the end, unless the tail got too long
+        if(size>1 && visibleNumbers.at(size-1)==simplifiedEnd-1 && visibleNumbers.at(size-1)-visibleNumbers.at(size-2)<maxTailPoints)
+            --size;
+        visible.resize(size);
+        visibleNumbers.resize(size);
+        // Points dropped from the ring meanwhile, the oldest point left starts the trail
+        int gone=0;
+        while(gone<size && visibleNumbers.at(gone)<dropped)
+            ++gone;
+        visible.remove(0,gone);
+        visibleNumbers.remove(0,gone);
+        if(count>0 && (visibleNumbers.isEmpty() || visibleNumbers.first()>dropped))
+        {
+            visible.prepend(internals::PointLatLng(At(0).lat,At(0).lng));
+            visibleNumbers.prepend(dropped);
+        }
+        // The last settled point starts the tail
+        int from=0;
+        if(!visibleNumbers.isEmpty())
+        {
+            from=(int)(visibleNumbers.last()-dropped);
+            visible.pop_back();
+            visibleNumbers.pop_back();
+        }
+        SimplifyRange(from);
+    }
+    void TrailPathItem::SimplifyRange(int const& from)
+    {
+        int zoom=simplifiedZoom;
+        appended=0;
+        simplifiedEnd=dropped+count;
+        int n=count-from;
+        if(n<=0)
+            return;
+
+        QVector<QPointF> pixels(n);
+        for(int i=0;i<n;++i)
+        {
+            TrailPoint const& point=At(from+i);
+            core::Point p=map->Projection()->FromLatLngToPixel(point.lat,point.lng,zoom);
+            pixels[i]=QPointF(p.X(),p.Y());
+        }
+
+        // Douglas-Peucker without recursion, long straight legs would nest deep
+        const double tolerance2=1.0;
+        QBitArray keep(n);
+        keep.setBit(0);
+        keep.setBit(n-1);
+        QVector<QPair<int,int> > ranges;
+        ranges.append(qMakePair(0,n-1));
+        while(!ranges.isEmpty())
+        {
+            QPair<int,int> range=ranges.last();
+            ranges.pop_back();
+            const QPointF a=pixels.at(range.first);
+            const QPointF d=pixels.at(range.second)-a;
+            const double length2=d.x()*d.x()+d.y()*d.y();
+            double farthest2=tolerance2;
+            int farthest=-1;
+            for(int i=range.first+1;i<range.second;++i)
+            {
+                QPointF v=pixels.at(i)-a;
+                if(length2>0)
+                {
+                    // distance to the segment, not to the infinite line
+                    double t=qBound(0.0,(v.x()*d.x()+v.y()*d.y())/length2,1.0);
+                    v-=t*d;
+                }
+                double distance2=v.x()*v.x()+v.y()*v.y();
+                if(distance2>farthest2)
+                {
+                    farthest2=distance2;
+                    farthest=i;
+                }
+            }
+            if(farthest>=0)
+            {
+                keep.setBit(farthest);
+                ranges.append(qMakePair(range.first,farthest));
+                ranges.append(qMakePair(farthest,range.second));
+            }
+        }
+
+        for(int i=0;i<n;++i)
+        {
+            if(keep.testBit(i))
+            {
+                TrailPoint const& point=At(from+i);
+                visible.append(internals::PointLatLng(point.lat,point.lng));
+                visibleNumbers.append(dropped+from+i);
+            }
+        }
+    }
+}
@@ -0,0 +1,129 @@
+/**
+******************************************************************************
+*
+* @file       trailpathitem.h
+* @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
+* @brief      A graphicsItem drawing the whole trail of a UAV
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   OPMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+#ifndef TRAILPATHITEM_H
+#define TRAILPATHITEM_H
+
+#include <QGraphicsItem>
+#include <QPainter>
+#include <QPainterPath>
+#include <QVector>
+#include <QBitArray>
+#include "../internals/pointlatlng.h"
+
+namespace mapcontrol
+{
+    class MapGraphicItem;
+    /**
+    * @brief The trail of one UAV as a single item
+    *
+    * The trail points are kept in a ring buffer of at most MaxPoints points,
+    * the oldest point is dropped for each new one once it is full. Only the
+    * points needed at the current zoom are drawn, the trail is simplified
+    * with the Douglas-Peucker algorithm to a tolerance of one pixel whenever
+    * the zoom changes. After every simplifyInterval new points only the tail
+    * behind the last settled point is simplified again, the tail is cut at
+    * maxTailPoints so a long straight leg does not make each run longer.
+    *
+    * @class TrailPathItem trailpathitem.h "trailpathitem.h"
+    */
+    class TrailPathItem:public QGraphicsItem
+    {
+    public:
+                enum { Type = UserType + 8 };
+        TrailPathItem(MapGraphicItem* map,int const& maxPoints=10000);
+        void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                    QWidget *widget);
+        QRectF boundingRect() const;
+        int type() const;
+        /**
+        * @brief Appends a point to the trail
+        *
+        * @param coord position of the point
+        * @param color color of the whole trail
+        */
+        void AddPoint(internals::PointLatLng const& coord,QColor const& color);
+        /**
+        * @brief Deletes all trail points
+        */
+        void Clear();
+        /**
+        * @brief Returns the number of stored trail points
+        */
+        int Count()const{return count;}
+        /**
+        * @brief Sets the maximum number of stored trail points, keeps the newest ones
+        */
+        void SetMaxPoints(int const& value);
+        int MaxPoints()const{return points.size();}
+        /**
+        * @brief Sets if a dot is drawn at each point of the simplified trail
+        */
+        void SetShowDots(bool const& value);
+        /**
+        * @brief Sets if the points are connected by a line
+        */
+        void SetShowLine(bool const& value);
+        /**
+        * @brief Moves the trail to the current map position and zoom
+        */
+        void RefreshPos();
+    private:
+        struct TrailPoint
+        {
+            double lat;
+            double lng;
+        };
+        /// Point number i, counted from the oldest one
+        TrailPoint const& At(int const& i)const{return points.at((head+i)%points.size());}
+        /// Selects the points needed at the current zoom
+        void Simplify();
+        /// Simplifies the points appended since the last run, keeps the settled part
+        void SimplifyTail();
+        /// Appends the points needed from point number from to the newest one to visible
+        void SimplifyRange(int const& from);
+
+        static const int simplifyInterval=64;   ///< New points appended as they are before the trail is simplified again
+        static const int maxTailPoints=512;     ///< Longest tail simplified again, the point it ends at is settled beyond
+
+        MapGraphicItem* map;
+        QVector<TrailPoint> points;             ///< Ring buffer
+        int head;                               ///< Index of the oldest point
+        int count;
+        qint64 dropped;                         ///< Points dropped so far, the number of the oldest point since the start
+        QVector<internals::PointLatLng> visible;///< Simplified trail
+        QVector<qint64> visibleNumbers;         ///< Number of each visible point since the start
+        qint64 simplifiedEnd;                   ///< Number of the first point not seen by the last simplification
+        int simplifiedZoom;                     ///< Zoom of the last simplification, -1 if it is outdated
+        int appended;                           ///< Points appended since the last simplification
+        QPainterPath path;
+        QRectF bounds;
+        QColor color;
+        bool showdots;
+        bool showline;
+    };
+}
+#endif // TRAILPATHITEM_H
@@ -39,10 +39,7 @@ namespace mapcontrol
         localposition=map->FromLatLngToLocal(mapwidget->CurrentPosition());
         this->setPos(localposition.X(),localposition.Y());
         this->setZValue(4);
-        trail=new QGraphicsItemGroup();
-        trail->setParentItem(map);
-        trailLine=new QGraphicsItemGroup();
-        trailLine->setParentItem(map);
+        trailPath=new TrailPathItem(map);
         this->setFlag(QGraphicsItem::ItemIgnoresTransformations,true);
         mapfollowtype=UAVMapFollowType::None;
         trailtype=UAVTrailType::ByDistance;
@@ -50,7 +47,7 @@ namespace mapcontrol
     }
     UAVItem::~UAVItem()
     {
-        delete trail;
+        delete trailPath;
     }
 
     void UAVItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
@@ -76,10 +73,7 @@ namespace mapcontrol
             {
                 if(timer.elapsed()>trailtime*1000)
                 {
-                    trail->addToGroup(new TrailItem(position,altitude,color,this));
-                    if(!lasttrailline.IsEmpty())
-                        trailLine->addToGroup((new TrailLineItem(lasttrailline,position,color,map)));
-                    lasttrailline=position;
+                    trailPath->AddPoint(position,color);
                     timer.restart();
                 }
 
@@ -88,10 +82,7 @@ namespace mapcontrol
             {
                 if(qAbs(internals::PureProjection::DistanceBetweenLatLng(lastcoord,position)*1000)>traildistance)
                 {
-                    trail->addToGroup(new TrailItem(position,altitude,color,this));
-                    if(!lasttrailline.IsEmpty())
-                        trailLine->addToGroup((new TrailLineItem(lasttrailline,position,color,map)));
-                    lasttrailline=position;
+                    trailPath->AddPoint(position,color);
                     lastcoord=position;
                 }
             }
@@ -170,19 +161,7 @@ namespace mapcontrol
     {
         localposition=map->FromLatLngToLocal(coord);
         this->setPos(localposition.X(),localposition.Y());
-        foreach(QGraphicsItem* i,trail->childItems())
-        {
-            TrailItem* w=qgraphicsitem_cast<TrailItem*>(i);
-            if(w)
-                w->setPos(map->FromLatLngToLocal(w->coord).X(),map->FromLatLngToLocal(w->coord).Y());
-        }
-        foreach(QGraphicsItem* i,trailLine->childItems())
-        {
-            TrailLineItem* ww=qgraphicsitem_cast<TrailLineItem*>(i);
-            if(ww)
-                ww->setLine(map->FromLatLngToLocal(ww->coord1).X(),map->FromLatLngToLocal(ww->coord1).Y(),map->FromLatLngToLocal(ww->coord2).X(),map->FromLatLngToLocal(ww->coord2).Y());
-        }
-
+        trailPath->RefreshPos();
     }
     void UAVItem::SetTrailType(const UAVTrailType::Types &value)
     {
@@ -193,20 +172,17 @@ namespace mapcontrol
     void UAVItem::SetShowTrail(const bool &value)
     {
         showtrail=value;
-        trail->setVisible(value);
+        trailPath->SetShowDots(value);
     }
     void UAVItem::SetShowTrailLine(const bool &value)
     {
         showtrailline=value;
-        trailLine->setVisible(value);
+        trailPath->SetShowLine(value);
     }
 
     void UAVItem::DeleteTrail()const
     {
-        foreach(QGraphicsItem* i,trail->childItems())
-            delete i;
-        foreach(QGraphicsItem* i,trailLine->childItems())
-            delete i;
+        trailPath->Clear();
     }
     double UAVItem::Distance3D(const internals::PointLatLng &coord, const int &altitude)
     {
@@ -38,8 +38,7 @@
 #include "uavtrailtype.h"
 #include <QtSvg/QSvgRenderer>
 #include "opmapwidget.h"
-#include "trailitem.h"
-#include "traillineitem.h"
+#include "trailpathitem.h"
 namespace mapcontrol
 {
     class WayPointItem;
@@ -166,6 +165,18 @@ namespace mapcontrol
         */
         void DeleteTrail()const;
         /**
+        * @brief Sets the maximum number of trail points kept, the oldest ones are dropped first
+        *
+        * @param value number of points
+        */
+        void SetTrailMaxPoints(int const& value){trailPath->SetMaxPoints(value);}
+        /**
+        * @brief Returns the maximum number of trail points kept
+        *
+        * @return int
+        */
+        int TrailMaxPoints()const{return trailPath->MaxPoints();}
+        /**
         * @brief Returns true if the UAV automaticaly sets WP reached value (changing its color)
         *
         * @return bool
@@ -207,9 +218,7 @@ namespace mapcontrol
         internals::PointLatLng lastcoord;
         core::Point localposition;
         OPMapWidget* mapwidget;
-        QGraphicsItemGroup* trail;
-        QGraphicsItemGroup * trailLine;
-        internals::PointLatLng lasttrailline;
+        TrailPathItem* trailPath;
         QTime timer;
         bool showtrail;
         bool showtrailline;
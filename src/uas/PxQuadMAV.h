@@ -33,8 +33,6 @@ class PxQuadMAV : public UAS
 public:
     PxQuadMAV(MAVLinkProtocol* mavlink, int id);
 public slots:
-    /** @brief Receive a MAVLink message from this MAV */
-    void receiveMessage(LinkInterface* link, mavlink_message_t message);
 #ifdef QGC_PROTOBUF_ENABLED
     /** @brief Receive a Protobuf message from this MAV */
     void receiveExtendedMessage(LinkInterface* link, std::tr1::shared_ptr<google::protobuf::Message> message);
@@ -45,6 +43,16 @@ signals:
     void watchdogReceived(int systemId, int watchdogId, unsigned int processCount);
     void processReceived(int systemId, int watchdogId, int processId, QString name, QString arguments, int timeout);
     void processChanged(int systemId, int watchdogId, int processId, int state, bool muted, int crashed, int pid);
+
+protected:
+#ifdef MAVLINK_ENABLED_PIXHAWK
+    void handleRawAux(const mavlink_message_t& message);
+    void handleImageTriggered(const mavlink_message_t& message);
+    void handlePatternDetected(const mavlink_message_t& message);
+    void handleWatchdogHeartbeat(const mavlink_message_t& message);
+    void handleWatchdogProcessInfo(const mavlink_message_t& message);
+    void handleWatchdogProcessStatus(const mavlink_message_t& message);
+#endif
 };
 
 #endif // PXQUADMAV_H
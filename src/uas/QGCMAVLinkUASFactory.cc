@@ -1,11 +1,46 @@
 #include "QGCMAVLinkUASFactory.h"
 #include "UASManager.h"
+#include "LinkManager.h"
 
 QGCMAVLinkUASFactory::QGCMAVLinkUASFactory(QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    protocol(NULL)
 {
 }
 
+QGCMAVLinkUASFactory::QGCMAVLinkUASFactory(MAVLinkProtocol* mavlink, QObject *parent) :
+    QObject(parent),
+    protocol(mavlink)
+{
+}
+
+void QGCMAVLinkUASFactory::createUAS(int linkId, MAVLinkMessagePtr heartbeatMessage)
+{
+    if (!protocol) return;
+    // The link may have been deleted while the request was queued
+    LinkInterface* link = LinkManager::instance()->getLinkForId(linkId);
+    if (!link)
+    {
+        emit uasCreationFailed(heartbeatMessage->sysid);
+        return;
+    }
+
+    // The protocol thread may have asked twice before this request was handled
+    if (UASManager::instance()->getUASForId(heartbeatMessage->sysid) != NULL) return;
+
+    mavlink_heartbeat_t heartbeat;
+    mavlink_msg_heartbeat_decode(heartbeatMessage.data(), &heartbeat);
+    UAS* uas = dynamic_cast<UAS*>(createUAS(protocol, link, heartbeatMessage->sysid, &heartbeat));
+    if (!uas)
+    {
+        emit uasCreationFailed(heartbeatMessage->sysid);
+        return;
+    }
+
+    // The heartbeat which triggered the creation is the first message of this system
+    uas->receiveSharedMessage(linkId, heartbeatMessage);
+}
+
 UASInterface* QGCMAVLinkUASFactory::createUAS(MAVLinkProtocol* mavlink, LinkInterface* link, int sysid, mavlink_heartbeat_t* heartbeat, QObject* parent)
 {
     QPointer<QObject> p;
@@ -29,7 +64,7 @@ UASInterface* QGCMAVLinkUASFactory::createUAS(MAVLinkProtocol* mavlink, LinkInte
         // Set the system type
         mav->setSystemType((int)heartbeat->type);
         // Connect this robot to the UAS object
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
+        mavlink->getMessageBus()->subscribe(mav, SLOT(receiveSharedMessage(int,MAVLinkMessagePtr)), sysid);
 #ifdef QGC_PROTOBUF_ENABLED
         connect(mavlink, SIGNAL(extendedMessageReceived(LinkInterface*, std::tr1::shared_ptr<google::protobuf::Message>)), mav, SLOT(receiveExtendedMessage(LinkInterface*, std::tr1::shared_ptr<google::protobuf::Message>)));
 #endif
@@ -45,7 +80,7 @@ UASInterface* QGCMAVLinkUASFactory::createUAS(MAVLinkProtocol* mavlink, LinkInte
         // it is IMPORTANT here to use the right object type,
         // else the slot of the parent object is called (and thus the special
         // packets never reach their goal)
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
+        mavlink->getMessageBus()->subscribe(mav, SLOT(receiveSharedMessage(int,MAVLinkMessagePtr)), sysid);
 #ifdef QGC_PROTOBUF_ENABLED
         connect(mavlink, SIGNAL(extendedMessageReceived(LinkInterface*, std::tr1::shared_ptr<google::protobuf::Message>)), mav, SLOT(receiveExtendedMessage(LinkInterface*, std::tr1::shared_ptr<google::protobuf::Message>)));
 #endif
@@ -61,7 +96,7 @@ UASInterface* QGCMAVLinkUASFactory::createUAS(MAVLinkProtocol* mavlink, LinkInte
         // it is IMPORTANT here to use the right object type,
         // else the slot of the parent object is called (and thus the special
         // packets never reach their goal)
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
+        mavlink->getMessageBus()->subscribe(mav, SLOT(receiveSharedMessage(int,MAVLinkMessagePtr)), sysid);
         uas = mav;
     }
     break;
@@ -74,7 +109,7 @@ UASInterface* QGCMAVLinkUASFactory::createUAS(MAVLinkProtocol* mavlink, LinkInte
         // it is IMPORTANT here to use the right object type,
         // else the slot of the parent object is called (and thus the special
         // packets never reach their goal)
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
+        mavlink->getMessageBus()->subscribe(mav, SLOT(receiveSharedMessage(int,MAVLinkMessagePtr)), sysid);
         uas = mav;
     }
     break;
@@ -83,7 +118,7 @@ UASInterface* QGCMAVLinkUASFactory::createUAS(MAVLinkProtocol* mavlink, LinkInte
 		{
 			senseSoarMAV* mav = new senseSoarMAV(mavlink,sysid);
 			mav->setSystemType((int)heartbeat->type);
-			connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
+			mavlink->getMessageBus()->subscribe(mav, SLOT(receiveSharedMessage(int,MAVLinkMessagePtr)), sysid);
 			uas = mav;
 			break;
 		}
@@ -96,7 +131,7 @@ UASInterface* QGCMAVLinkUASFactory::createUAS(MAVLinkProtocol* mavlink, LinkInte
         // it is IMPORTANT here to use the right object type,
         // else the slot of the parent object is called (and thus the special
         // packets never reach their goal)
-        connect(mavlink, SIGNAL(messageReceived(LinkInterface*, mavlink_message_t)), mav, SLOT(receiveMessage(LinkInterface*, mavlink_message_t)));
+        mavlink->getMessageBus()->subscribe(mav, SLOT(receiveSharedMessage(int,MAVLinkMessagePtr)), sysid);
         uas = mav;
     }
     break;
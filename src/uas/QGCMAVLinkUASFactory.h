@@ -20,13 +20,22 @@ class QGCMAVLinkUASFactory : public QObject
     Q_OBJECT
 public:
     explicit QGCMAVLinkUASFactory(QObject *parent = 0);
+    /** @brief Factory creating systems for this protocol, has to live in the GUI thread */
+    explicit QGCMAVLinkUASFactory(MAVLinkProtocol* mavlink, QObject *parent = 0);
 
     /** @brief Create a new UAS object using MAVLink as protocol */
     static UASInterface* createUAS(MAVLinkProtocol* mavlink, LinkInterface* link, int sysid, mavlink_heartbeat_t* heartbeat, QObject* parent=NULL);
 
 signals:
+    /** @brief No system was created for this heartbeat, e.g. because its link is gone */
+    void uasCreationFailed(int sysid);
 
 public slots:
+    /** @brief Create a new UAS object for the heartbeat received by the protocol thread */
+    void createUAS(int linkId, MAVLinkMessagePtr heartbeatMessage);
+
+protected:
+    MAVLinkProtocol* protocol;
 
 };
 
@@ -0,0 +1,187 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of the on-disk parameter store
+ *
+ */
+
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QStringList>
+#include <QDebug>
+
+#include "QGCUASParamCache.h"
+#include "QGCMAVLink.h"
+
+QGCUASParamCache::QGCUASParamCache() :
+    autopilotType(-1),
+    systemType(-1)
+{
+}
+
+QString QGCUASParamCache::fileName(int uasId)
+{
+    return QString("parameters_%1.txt").arg(uasId);
+}
+
+bool QGCUASParamCache::load(const QString& fileName)
+{
+    clear();
+    setType(-1, -1);
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        const QString line = in.readLine();
+        if (line.startsWith("# TYPE\t"))
+        {
+            const QStringList fields = line.split("\t");
+            if (fields.size() == 3) setType(fields.at(1).toInt(), fields.at(2).toInt());
+            continue;
+        }
+        if (line.startsWith("#")) continue;
+        const QStringList fields = line.split("\t");
+        if (fields.size() != 6) continue;
+
+        const int component = fields.at(0).toInt();
+        const int count = fields.at(1).toInt();
+        const int index = fields.at(2).toInt();
+        QVariant value;
+        switch (fields.at(5).toUInt())
+        {
+        case MAVLINK_TYPE_FLOAT:
+            value = fields.at(4).toFloat();
+            break;
+        case MAVLINK_TYPE_UINT32_T:
+            value = fields.at(4).toUInt();
+            break;
+        case MAVLINK_TYPE_INT32_T:
+            value = fields.at(4).toInt();
+            break;
+        default:
+            continue;
+        }
+        setCount(component, count);
+        setParameter(component, index, fields.at(3), value);
+    }
+    file.close();
+    return true;
+}
+
+bool QGCUASParamCache::save(const QString& fileName) const
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+    {
+        qDebug() << "COULD NOT WRITE PARAMETER CACHE" << fileName;
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "# Last known onboard parameters\n";
+    out << "# TYPE\t" << autopilotType << "\t" << systemType << "\n";
+    out << "# COMPONENT ID  PARAM COUNT  PARAM INDEX  PARAM NAME  VALUE  TYPE\n";
+    QMap<int, Component>::const_iterator i;
+    for (i = components.constBegin(); i != components.constEnd(); ++i)
+    {
+        const Component& component = i.value();
+        for (int index = 0; index < component.values.size(); ++index)
+        {
+            const QVariant& value = component.values.at(index);
+            QString paramValue("%1");
+            int paramType;
+            switch (value.type())
+            {
+            case QVariant::Int:
+                paramValue = paramValue.arg(value.toInt());
+                paramType = MAVLINK_TYPE_INT32_T;
+                break;
+            case QVariant::UInt:
+                paramValue = paramValue.arg(value.toUInt());
+                paramType = MAVLINK_TYPE_UINT32_T;
+                break;
+            case QMetaType::Float:
+                paramValue = paramValue.arg(value.toDouble(), 0, 'g', 12);
+                paramType = MAVLINK_TYPE_FLOAT;
+                break;
+            default:
+                // Unknown index
+                continue;
+            }
+            out << i.key() << "\t" << component.values.size() << "\t" << index << "\t"
+                << component.names.at(index) << "\t" << paramValue << "\t" << paramType << "\n";
+        }
+    }
+    file.close();
+    return true;
+}
+
+bool QGCUASParamCache::contains(int component, int index) const
+{
+    QMap<int, Component>::const_iterator i = components.find(component);
+    return i != components.constEnd() && index >= 0 && index < i.value().values.size() && i.value().values.at(index).isValid();
+}
+
+QString QGCUASParamCache::getName(int component, int index) const
+{
+    if (!contains(component, index)) return QString();
+    return components.value(component).names.at(index);
+}
+
+QVariant QGCUASParamCache::getValue(int component, int index) const
+{
+    if (!contains(component, index)) return QVariant();
+    return components.value(component).values.at(index);
+}
+
+void QGCUASParamCache::setCount(int component, int count)
+{
+    if (count <= 0) return;
+    Component& entry = components[component];
+    if (entry.names.size() == count) return;
+    entry.names = QVector<QString>(count);
+    entry.values = QVector<QVariant>(count);
+}
+
+void QGCUASParamCache::setParameter(int component, int index, const QString& name, const QVariant& value)
+{
+    QMap<int, Component>::iterator i = components.find(component);
+    if (i == components.end() || index < 0 || index >= i.value().values.size()) return;
+    i.value().names[index] = name;
+    i.value().values[index] = value;
+}
+
+void QGCUASParamCache::setParameter(int component, const QString& name, const QVariant& value)
+{
+    QMap<int, Component>::iterator i = components.find(component);
+    if (i == components.end()) return;
+    const int index = i.value().names.indexOf(name);
+    if (index >= 0) i.value().values[index] = value;
+}
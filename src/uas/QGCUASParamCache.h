@@ -0,0 +1,115 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Definition of the on-disk parameter store
+ *
+ */
+
+#ifndef QGCUASPARAMCACHE_H
+#define QGCUASPARAMCACHE_H
+
+#include <QMap>
+#include <QVector>
+#include <QString>
+#include <QVariant>
+
+/**
+ * @brief Last known onboard parameters of one vehicle, by component and index
+ *
+ * The file of a vehicle is named after its system id and records the
+ * autopilot and system type the parameters belong to, so a vehicle flashed
+ * with a different firmware or reconfigured as another airframe can start
+ * with an empty store.
+ *
+ * The file is a text file with one parameter per line:
+ * component, parameter count, index, name, value and MAVLink type, separated
+ * by tabs. Lines starting with # are comments, except for the line starting
+ * with "# TYPE" which holds the autopilot and system type.
+ */
+class QGCUASParamCache
+{
+public:
+    QGCUASParamCache();
+
+    /** @brief Name of the file of a vehicle in the cache directory */
+    static QString fileName(int uasId);
+
+    /** @brief Replace the content with the file, returns false if it could not be read */
+    bool load(const QString& fileName);
+    /** @brief Write the content to a file, returns false on failure */
+    bool save(const QString& fileName) const;
+    void clear() {
+        components.clear();
+    }
+    bool isEmpty() const {
+        return components.isEmpty();
+    }
+
+    /** @brief MAV_AUTOPILOT of the vehicle the parameters belong to, -1 if unknown */
+    int getAutopilotType() const {
+        return autopilotType;
+    }
+    /** @brief MAV_TYPE of the vehicle the parameters belong to, -1 if unknown */
+    int getSystemType() const {
+        return systemType;
+    }
+    void setType(int autopilotType, int systemType) {
+        this->autopilotType = autopilotType;
+        this->systemType = systemType;
+    }
+
+    QList<int> getComponents() const {
+        return components.keys();
+    }
+    /** @brief Number of parameters of a component, 0 if unknown */
+    int getCount(int component) const {
+        return components.value(component).names.size();
+    }
+    /** @brief True if the parameter with this index is known */
+    bool contains(int component, int index) const;
+    QString getName(int component, int index) const;
+    QVariant getValue(int component, int index) const;
+
+    /** @brief Set the number of parameters of a component, forgets all of them if it changed */
+    void setCount(int component, int count);
+    /** @brief Store a parameter with known index */
+    void setParameter(int component, int index, const QString& name, const QVariant& value);
+    /** @brief Update the value of a known parameter by name */
+    void setParameter(int component, const QString& name, const QVariant& value);
+
+protected:
+    /** @brief Parameters of one component, an invalid value marks an unknown index */
+    struct Component
+    {
+        QVector<QString> names;
+        QVector<QVariant> values;
+    };
+
+    QMap<int, Component> components;
+    int autopilotType;
+    int systemType;
+};
+
+#endif // QGCUASPARAMCACHE_H
@@ -3,13 +3,7 @@
 
 QGCUASParamManager::QGCUASParamManager(UASInterface* uas, QWidget *parent) :
     QWidget(parent),
-    mav(uas),
-    transmissionListMode(false),
-    transmissionActive(false),
-    transmissionTimeout(0),
-    retransmissionTimeout(350),
-    rewriteTimeout(500),
-    retransmissionBurstRequestSize(2)
+    mav(uas)
 {
     uas->setParamManager(this);
 }
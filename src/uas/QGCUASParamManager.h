@@ -3,7 +3,6 @@
 
 #include <QWidget>
 #include <QMap>
-#include <QTimer>
 #include <QVariant>
 
 class UASInterface;
@@ -51,17 +50,6 @@ protected:
     UASInterface* mav;   ///< The MAV this widget is controlling
     QMap<int, QMap<QString, QVariant>* > changedValues; ///< Changed values
     QMap<int, QMap<QString, QVariant>* > parameters; ///< All parameters
-    QVector<bool> received; ///< Successfully received parameters
-    QMap<int, QList<int>* > transmissionMissingPackets; ///< Missing packets
-    QMap<int, QMap<QString, QVariant>* > transmissionMissingWriteAckPackets; ///< Missing write ACK packets
-    bool transmissionListMode;       ///< Currently requesting list
-    QMap<int, bool> transmissionListSizeKnown;  ///< List size initialized?
-    bool transmissionActive;         ///< Missing packets, working on list?
-    quint64 transmissionTimeout;     ///< Timeout
-    QTimer retransmissionTimer;      ///< Timer handling parameter retransmission
-    int retransmissionTimeout; ///< Retransmission request timeout, in milliseconds
-    int rewriteTimeout; ///< Write request timeout, in milliseconds
-    int retransmissionBurstRequestSize; ///< Number of packets requested for retransmission per burst
 
 };
 
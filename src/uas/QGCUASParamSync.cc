@@ -0,0 +1,476 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Implementation of the parameter transfer handler
+ *
+ */
+
+#include <QSettings>
+#include <QDesktopServices>
+#include <QDebug>
+#include <cmath>
+
+#include "QGCUASParamSync.h"
+#include "UAS.h"
+#include "QGC.h"
+
+const int QGCUASParamSync::minRetransmissionTimeout;
+const int QGCUASParamSync::maxRetransmissionTimeout;
+
+QGCUASParamSync::QGCUASParamSync(UAS* _uas) :
+    uas(_uas),
+    listMode(false),
+    streaming(false),
+    verifying(false),
+    verified(false),
+    active(false),
+    listRequested(0),
+    lastReceived(0),
+    lastProgress(0),
+    lastBackoff(0),
+    srtt(-1.0),
+    rttvar(0.0),
+    rto(350),
+    retransmissionTimeout(350),
+    rewriteTimeout(500),
+    timer(this)
+{
+    connect(&timer, SIGNAL(timeout()), this, SLOT(tick()));
+}
+
+void QGCUASParamSync::loadSettings()
+{
+    QSettings settings;
+    settings.beginGroup("QGC_MAVLINK_PROTOCOL");
+    bool ok;
+    int temp = settings.value("PARAMETER_RETRANSMISSION_TIMEOUT", retransmissionTimeout).toInt(&ok);
+    if (ok) retransmissionTimeout = temp;
+    temp = settings.value("PARAMETER_REWRITE_TIMEOUT", rewriteTimeout).toInt(&ok);
+    if (ok) rewriteTimeout = temp;
+    settings.endGroup();
+}
+
+/**
+ * The round trip time measured in earlier transfers is kept, the configured
+ * retransmission timeout is only used until the first measurement.
+ */
+void QGCUASParamSync::requestList()
+{
+    if (!uas) return;
+    loadSettings();
+    if (srtt < 0) rto = qBound(minRetransmissionTimeout, retransmissionTimeout, maxRetransmissionTimeout);
+
+    listMode = true;
+    verified = false;
+    const quint64 now = QGC::groundTimeMilliseconds();
+    lastReceived = now;
+    lastProgress = now;
+    if (loadCache())
+    {
+        listRequested = now;
+        startVerification();
+    }
+    else
+    {
+        startFullList(now);
+    }
+    activate();
+}
+
+/**
+ * The autopilot and system type are only known after the first heartbeat,
+ * until then the store is neither read nor written. Parameters received
+ * before are kept in memory and saved once the type is known.
+ */
+bool QGCUASParamSync::bindCache()
+{
+    const int autopilotType = uas->getAutopilotType();
+    if (autopilotType < 0) return false;
+    const int systemType = uas->getSystemType();
+
+    // The store is only read once, afterwards it is kept up to date in memory
+    if (cacheFile.isEmpty())
+    {
+        cacheFile = QDesktopServices::storageLocation(QDesktopServices::DataLocation) + "/parameters/" +
+                QGCUASParamCache::fileName(uas->getUASID());
+        if (cache.isEmpty()) cache.load(cacheFile);
+    }
+    // Stored for another autopilot or airframe, start over
+    if (cache.getAutopilotType() != autopilotType || cache.getSystemType() != systemType)
+    {
+        if (cache.getAutopilotType() >= 0) cache.clear();
+        cache.setType(autopilotType, systemType);
+    }
+    return true;
+}
+
+bool QGCUASParamSync::loadCache()
+{
+    return bindCache() && !cache.isEmpty();
+}
+
+void QGCUASParamSync::saveCache()
+{
+    if (bindCache()) cache.save(cacheFile);
+}
+
+void QGCUASParamSync::startFullList(quint64 now)
+{
+    lists.clear();
+    verifying = false;
+    streaming = true;
+    listRequested = now;
+    uas->requestParameters();
+}
+
+/**
+ * The sample takes every n-th index from a random offset, so repeated
+ * connections check different parameters.
+ */
+void QGCUASParamSync::startVerification()
+{
+    lists.clear();
+    verifying = true;
+    streaming = false;
+    foreach (int component, cache.getComponents())
+    {
+        ComponentList list;
+        list.count = cache.getCount(component);
+        list.received = QBitArray(list.count, true);
+        list.receivedCount = list.count;
+        list.nextIndex = 0;
+        const int stride = qMax(1, list.count / verifySampleSize);
+        const int offset = qrand() % stride;
+        for (int index = 0; index < list.count; ++index)
+        {
+            if (cache.contains(component, index))
+            {
+                emit parameterLoaded(uas->getUASID(), component, cache.getName(component, index), cache.getValue(component, index));
+                if (index % stride != offset) continue;
+            }
+            // Unknown or part of the sample
+            list.received.clearBit(index);
+            list.receivedCount--;
+        }
+        lists.insert(component, list);
+    }
+}
+
+bool QGCUASParamSync::matchesCache(int component, int paramCount, int paramId, const QString& parameterName, const QVariant& value) const
+{
+    if (!lists.contains(component) || lists.value(component).count != paramCount) return false;
+    if (!cache.contains(component, paramId)) return true;
+    return cache.getName(component, paramId) == parameterName && cache.getValue(component, paramId) == value;
+}
+
+void QGCUASParamSync::writeParameter(int component, const QString& parameterName, const QVariant& value)
+{
+    if (!uas) return;
+    uas->setParameter(component, parameterName, value);
+
+    PendingWrite write;
+    write.value = value;
+    write.sent = QGC::groundTimeMilliseconds();
+    writes[component].insert(parameterName, write);
+    lastProgress = write.sent;
+    activate();
+}
+
+void QGCUASParamSync::handleParamValue(int component, int paramCount, int paramId, const QString& parameterName, const QVariant& value)
+{
+    const quint64 now = QGC::groundTimeMilliseconds();
+    lastReceived = now;
+
+    // Write acknowledgement
+    bool justWritten = false;
+    if (writes.contains(component) && writes.value(component).contains(parameterName))
+    {
+        justWritten = true;
+        const QVariant sentValue = writes[component].take(parameterName).value;
+        if (writes.value(component).isEmpty()) writes.remove(component);
+        lastProgress = now;
+        emit parameterWritten(component, parameterName, sentValue, value, sentValue == value, getMissingWriteCount());
+    }
+
+    // List transfer, only the first packet of each component sets the list size
+    if (listMode && paramCount > 0)
+    {
+        if (verifying && !justWritten && !matchesCache(component, paramCount, paramId, parameterName, value))
+        {
+            startFullList(now);
+        }
+        if (!lists.contains(component))
+        {
+            ComponentList list;
+            list.count = paramCount;
+            list.received.resize(paramCount);
+            list.receivedCount = 0;
+            list.nextIndex = 0;
+            lists.insert(component, list);
+        }
+        ComponentList& list = lists[component];
+        if (paramId >= 0 && paramId < list.count && !list.received.testBit(paramId))
+        {
+            list.received.setBit(paramId);
+            list.receivedCount++;
+            lastProgress = now;
+            // Karn: answers to repeated requests are ambiguous and not sampled
+            if (list.requests.contains(paramId) && list.attempts.value(paramId) == 1)
+            {
+                addRttSample(now - list.requests.value(paramId));
+            }
+            list.requests.remove(paramId);
+            list.attempts.remove(paramId);
+        }
+        // Keep the window full
+        if (!streaming) fillWindow(component, list, now);
+    }
+
+    // Remember for the next connection
+    if (paramId >= 0 && paramId < paramCount)
+    {
+        cache.setCount(component, paramCount);
+        cache.setParameter(component, paramId, parameterName, value);
+    }
+    else
+    {
+        cache.setParameter(component, parameterName, value);
+    }
+
+    if (!justWritten)
+    {
+        emit parameterRead(component, paramId, paramCount, parameterName, value, getMissingCount());
+    }
+    checkFinished();
+}
+
+int QGCUASParamSync::getParameterCount() const
+{
+    int count = 0;
+    foreach (const ComponentList& list, lists)
+    {
+        count += list.count;
+    }
+    return count;
+}
+
+int QGCUASParamSync::getMissingCount() const
+{
+    if (!listMode) return 0;
+    int missing = 0;
+    foreach (const ComponentList& list, lists)
+    {
+        missing += list.count - list.receivedCount;
+    }
+    return missing;
+}
+
+int QGCUASParamSync::getMissingWriteCount() const
+{
+    int missing = 0;
+    foreach (int component, writes.keys())
+    {
+        missing += writes.value(component).count();
+    }
+    return missing;
+}
+
+void QGCUASParamSync::tick()
+{
+    const quint64 now = QGC::groundTimeMilliseconds();
+
+    // Give up if nothing arrives any more
+    if (now - lastProgress > stallTimeout())
+    {
+        const int missingReads = getMissingCount();
+        const int missingWrites = getMissingWriteCount();
+        listMode = false;
+        streaming = false;
+        verifying = false;
+        writes.clear();
+        active = false;
+        timer.stop();
+        saveCache();
+        emit transmissionTimeout(missingReads, missingWrites);
+        return;
+    }
+
+    if (listMode)
+    {
+        if (lists.isEmpty())
+        {
+            // No component has answered the list request yet
+            if (now - listRequested >= static_cast<quint64>(4 * rto))
+            {
+                backoff(now);
+                listRequested = now;
+                uas->requestParameters();
+            }
+        }
+        else if (streaming)
+        {
+            // The MAV sends the whole list on its own, wait until it is through
+            if (now - lastReceived >= static_cast<quint64>(rto)) streaming = false;
+        }
+
+        if (!streaming)
+        {
+            bool expired = false;
+            QMap<int, ComponentList>::iterator i;
+            for (i = lists.begin(); i != lists.end(); ++i)
+            {
+                ComponentList& list = i.value();
+                QMap<int, quint64>::iterator request = list.requests.begin();
+                while (request != list.requests.end())
+                {
+                    if (now - request.value() >= static_cast<quint64>(rto))
+                    {
+                        request = list.requests.erase(request);
+                        expired = true;
+                    }
+                    else
+                    {
+                        ++request;
+                    }
+                }
+                fillWindow(i.key(), list, now);
+            }
+            if (expired) backoff(now);
+        }
+    }
+
+    // Write again what has not been reported back, at most a window at once
+    const quint64 writeTimeout = qMax(rto, rewriteTimeout);
+    int rewrites = 0;
+    QMap<int, QMap<QString, PendingWrite> >::iterator component;
+    for (component = writes.begin(); component != writes.end() && rewrites < windowSize; ++component)
+    {
+        QMap<QString, PendingWrite>::iterator write;
+        for (write = component.value().begin(); write != component.value().end() && rewrites < windowSize; ++write)
+        {
+            if (now - write.value().sent < writeTimeout) continue;
+            write.value().sent = now;
+            uas->setParameter(component.key(), write.key(), write.value().value);
+            emit rewriteRequested(component.key(), write.key(), write.value().value);
+            rewrites++;
+        }
+    }
+}
+
+/**
+ * Missing indices are searched round robin from the last requested one, so
+ * repeated requests are spread over all missing parameters.
+ */
+void QGCUASParamSync::fillWindow(int component, ComponentList& list, quint64 now)
+{
+    while (list.requests.size() < windowSize && list.receivedCount + list.requests.size() < list.count)
+    {
+        int index = list.nextIndex;
+        while (list.received.testBit(index) || list.requests.contains(index))
+        {
+            index = (index + 1) % list.count;
+        }
+        list.nextIndex = (index + 1) % list.count;
+        list.requests.insert(index, now);
+        list.attempts[index]++;
+        uas->requestParameter(component, index);
+        emit retransmissionRequested(component, index);
+    }
+}
+
+void QGCUASParamSync::addRttSample(quint64 rtt)
+{
+    if (srtt < 0)
+    {
+        srtt = rtt;
+        rttvar = rtt / 2.0;
+    }
+    else
+    {
+        rttvar = 0.75 * rttvar + 0.25 * fabs(srtt - rtt);
+        srtt = 0.875 * srtt + 0.125 * rtt;
+    }
+    rto = qBound(minRetransmissionTimeout, static_cast<int>(srtt + 4 * rttvar + 0.5), maxRetransmissionTimeout);
+}
+
+/**
+ * Requests sent in the same window time out together, this counts as
+ * one timeout only.
+ */
+void QGCUASParamSync::backoff(quint64 now)
+{
+    if (now - lastBackoff < static_cast<quint64>(rto)) return;
+    lastBackoff = now;
+    rto = qMin(2 * rto, maxRetransmissionTimeout);
+}
+
+void QGCUASParamSync::activate()
+{
+    active = true;
+    if (!timer.isActive()) timer.start(tickInterval);
+}
+
+void QGCUASParamSync::checkFinished()
+{
+    if (!active) return;
+
+    if (listMode)
+    {
+        if (lists.isEmpty()) return;
+        foreach (const ComponentList& list, lists)
+        {
+            if (list.receivedCount < list.count) return;
+        }
+        listMode = false;
+        streaming = false;
+        if (verifying)
+        {
+            verifying = false;
+            verified = true;
+            // The store now holds the onboard values, also the ones only loaded from disk
+            foreach (int component, cache.getComponents())
+            {
+                const int count = cache.getCount(component);
+                for (int index = 0; index < count; ++index)
+                {
+                    if (!cache.contains(component, index)) continue;
+                    emit parameterVerified(component, count, index, cache.getName(component, index), cache.getValue(component, index));
+                }
+            }
+            emit cacheVerified();
+        }
+    }
+    if (!writes.isEmpty()) return;
+
+    active = false;
+    timer.stop();
+    saveCache();
+    emit transmissionFinished();
+}
+
+quint64 QGCUASParamSync::stallTimeout() const
+{
+    return 10 * qMax(rto, retransmissionTimeout);
+}
@@ -0,0 +1,200 @@
+/*=====================================================================
+
+QGroundControl Open Source Ground Control Station
+
+(c) 2009, 2010 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+
+This file is part of the QGROUNDCONTROL project
+
+    QGROUNDCONTROL is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    QGROUNDCONTROL is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with QGROUNDCONTROL. If not, see <http://www.gnu.org/licenses/>.
+
+======================================================================*/
+
+/**
+ * @file
+ *   @brief Definition of the parameter transfer handler
+ *
+ */
+
+#ifndef QGCUASPARAMSYNC_H
+#define QGCUASPARAMSYNC_H
+
+#include <QObject>
+#include <QMap>
+#include <QBitArray>
+#include <QTimer>
+#include <QVariant>
+#include "QGCUASParamCache.h"
+class UAS;
+
+/**
+ * @brief Reliable transfer of the onboard parameters of one MAV
+ *
+ * After a list request the MAV streams all parameters on its own. Once the
+ * stream has gone quiet, every index which has not arrived yet is requested
+ * again with PARAM_REQUEST_READ. Up to windowSize of these requests are kept
+ * in flight per component, a new one is sent as soon as an answer arrives.
+ *
+ * The retransmission timeout follows the measured round trip time of the
+ * requests (smoothed mean plus four times the mean deviation, like TCP),
+ * answers to repeated requests are not used as samples. Each timeout doubles
+ * the retransmission timeout until the next sample.
+ *
+ * Written parameters are tracked until the MAV reports them back and are
+ * written again after the rewrite timeout.
+ *
+ * All received parameters are kept in a store on disk. If the vehicle is
+ * known, a list request shows the stored values at once and only fetches
+ * the unknown indices plus a sample spread over the list. If the sample
+ * agrees with the store, the stored values are verified, otherwise the full
+ * list is fetched in the background.
+ *
+ * The UAS owns one instance and forwards all PARAM_VALUE messages to it, so
+ * transfers continue independent of any view.
+ */
+class QGCUASParamSync : public QObject
+{
+    Q_OBJECT
+public:
+    QGCUASParamSync(UAS* uas = NULL);
+
+    /** @brief Request the full parameter list of all components */
+    void requestList();
+    /** @brief Write one parameter and track it until the MAV reports it back */
+    void writeParameter(int component, const QString& parameterName, const QVariant& value);
+    /** @brief Handle a PARAM_VALUE message, called by the UAS */
+    void handleParamValue(int component, int paramCount, int paramId, const QString& parameterName, const QVariant& value);
+
+    /** @brief True while a list transfer or a write is not finished */
+    bool isActive() const {
+        return active;
+    }
+    /** @brief True while stored values are checked against the MAV */
+    bool isVerifying() const {
+        return verifying;
+    }
+    /** @brief True if the last list request has been answered from the store */
+    bool isVerified() const {
+        return verified;
+    }
+    /** @brief Number of parameters of all components with known list size */
+    int getParameterCount() const;
+    /** @brief Number of parameters of the current list transfer still missing */
+    int getMissingCount() const;
+    /** @brief Number of written parameters not reported back yet */
+    int getMissingWriteCount() const;
+    /** @brief Current retransmission timeout in milliseconds */
+    int getRetransmissionTimeout() const {
+        return rto;
+    }
+
+public slots:
+    /** @brief Retransmit timed out requests and refill the request windows */
+    void tick();
+
+signals:
+    /** @brief A parameter of the list has been received */
+    void parameterRead(int component, int paramId, int paramCount, QString parameterName, QVariant value, int missing);
+    /** @brief A written parameter has been reported back, success is false if the onboard value differs */
+    void parameterWritten(int component, QString parameterName, QVariant sentValue, QVariant onboardValue, bool success, int missingWrites);
+    /** @brief A missing parameter has been requested again */
+    void retransmissionRequested(int component, int paramId);
+    /** @brief A parameter has been written again */
+    void rewriteRequested(int component, QString parameterName, QVariant value);
+    /** @brief The transfer made no progress for too long and was given up */
+    void transmissionTimeout(int missingReads, int missingWrites);
+    /** @brief All requested and written parameters have been received */
+    void transmissionFinished();
+    /** @brief A parameter has been loaded from the store */
+    void parameterLoaded(int uas, int component, QString parameterName, QVariant value);
+    /** @brief A stored parameter is confirmed by the MAV, emitted for each of them before cacheVerified() */
+    void parameterVerified(int component, int parameterCount, int parameterId, QString parameterName, QVariant value);
+    /** @brief The stored parameters agree with the MAV */
+    void cacheVerified();
+
+protected:
+    /** @brief Transfer state of the list of one component */
+    struct ComponentList
+    {
+        int count;                     ///< Number of parameters, from the first packet
+        QBitArray received;            ///< One bit per index
+        int receivedCount;
+        int nextIndex;                 ///< Index to continue the search for missing ones
+        QMap<int, quint64> requests;   ///< Send time of the outstanding requests by index
+        QMap<int, int> attempts;       ///< Number of requests sent by index
+    };
+
+    /** @brief A written parameter waiting to be reported back */
+    struct PendingWrite
+    {
+        QVariant value;
+        quint64 sent;                  ///< Time of the last write
+    };
+
+    /** @brief Load the timeouts from the settings */
+    void loadSettings();
+    /** @brief Attach the store to the file of the vehicle, returns false before the first heartbeat */
+    bool bindCache();
+    /** @brief Load the store of the vehicle, returns false if nothing is known */
+    bool loadCache();
+    /** @brief Write the store of the vehicle to disk */
+    void saveCache();
+    /** @brief Request the whole list, the MAV streams it */
+    void startFullList(quint64 now);
+    /** @brief Show the stored values and fetch the unknown and a sample of the known ones */
+    void startVerification();
+    /** @brief True if a received parameter agrees with the store */
+    bool matchesCache(int component, int paramCount, int paramId, const QString& parameterName, const QVariant& value) const;
+    /** @brief Request missing parameters of a component until its window is full */
+    void fillWindow(int component, ComponentList& list, quint64 now);
+    /** @brief Add a round trip time sample in milliseconds */
+    void addRttSample(quint64 rtt);
+    /** @brief Double the retransmission timeout after a timeout */
+    void backoff(quint64 now);
+    /** @brief Start the tick timer if it is not running */
+    void activate();
+    /** @brief Stop when nothing is left to do */
+    void checkFinished();
+    /** @brief Time after which a transfer without progress is given up */
+    quint64 stallTimeout() const;
+
+    static const int windowSize = 8;           ///< Outstanding requests per component
+    static const int tickInterval = 20;        ///< Milliseconds between two ticks
+    static const int minRetransmissionTimeout = 40;
+    static const int maxRetransmissionTimeout = 3000;
+    static const int verifySampleSize = 16;    ///< Known parameters checked per component
+
+    UAS* uas;
+    QMap<int, ComponentList> lists;            ///< List transfer state by component
+    QMap<int, QMap<QString, PendingWrite> > writes; ///< Written parameters by component and name
+    bool listMode;                             ///< A list has been requested and is not complete
+    bool streaming;                            ///< The MAV is still sending the requested list on its own
+    bool verifying;                            ///< The list is answered from the store, checking a sample
+    bool verified;                             ///< The store agreed with the MAV
+    bool active;
+    quint64 listRequested;                     ///< Time of the last list request
+    quint64 lastReceived;                      ///< Time of the last PARAM_VALUE
+    quint64 lastProgress;                      ///< Time a missing parameter or write ACK last arrived
+    quint64 lastBackoff;                       ///< Time the retransmission timeout was last doubled
+    double srtt;                               ///< Smoothed round trip time, negative until the first sample
+    double rttvar;                             ///< Mean deviation of the round trip time
+    int rto;                                   ///< Retransmission timeout in milliseconds
+    int retransmissionTimeout;                 ///< Initial retransmission timeout from the settings
+    int rewriteTimeout;                        ///< Write timeout from the settings
+    QGCUASParamCache cache;                    ///< Last known parameters of the vehicle
+    QString cacheFile;                         ///< File of the store, empty until the vehicle type is known
+    QTimer timer;
+};
+
+#endif // QGCUASPARAMSYNC_H
@@ -56,9 +56,6 @@ public:
     SlugsMAV(MAVLinkProtocol* mavlink, int id = 0);
 
 public slots:
-    /** @brief Receive a MAVLink message from this MAV */
-    void receiveMessage(LinkInterface* link, mavlink_message_t message);
-
     void emitSignals (void);
 
 signals:
@@ -116,6 +113,9 @@ protected:
 
 
     // Standart messages MAVLINK used by SLUGS
+    /** @brief Keep the latest SLUGS messages for the widget updates */
+    void handleSlugsMessage(const mavlink_message_t& message);
+
 private:
 
 
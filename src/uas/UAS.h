@@ -148,12 +148,14 @@ protected: //COMMENTS FOR TEST UNIT
     QString name;                 ///< Human-friendly name of the vehicle, e.g. bravo
     int autopilot;                ///< Type of the Autopilot: -1: None, 0: Generic, 1: PIXHAWK, 2: SLUGS, 3: Ardupilot (up to 15 types), defined in MAV_AUTOPILOT_TYPE ENUM
     QList<LinkInterface*>* links; ///< List of links this UAS can be reached by
+    LinkInterface* lastLink;      ///< Link of the last message, known to be in links
     QList<int> unknownPackets;    ///< Packet IDs which are unknown and have been received
     MAVLinkProtocol* mavlink;     ///< Reference to the MAVLink instance
     BatteryType batteryType;      ///< The battery type
     int cells;                    ///< Number of cells
 
     UASWaypointManager waypointManager;
+    QGCUASParamSync paramSync;
 
     QList<double> actuatorValues;
     QList<QString> actuatorNames;
@@ -256,6 +258,9 @@ public:
     UASWaypointManager* getWaypointManager() {
         return &waypointManager;
     }
+    QGCUASParamSync* getParamSync() {
+        return &paramSync;
+    }
     /** @brief Get reference to the param manager **/
     QGCUASParamManager* getParamManager() const {
         return paramManager;
@@ -463,8 +468,10 @@ public slots:
     /** @brief Remove a link associated with this robot */
     void removeLink(QObject* object);
 
-    /** @brief Receive a message from one of the communication links. */
-    virtual void receiveMessage(LinkInterface* link, mavlink_message_t message);
+    /** @brief Receive a message from one of the communication links, dispatches it to the registered handler */
+    virtual void receiveMessage(LinkInterface* link, const mavlink_message_t& message);
+    /** @brief Receive a message shared by the message bus of the protocol, dropped if the link is gone */
+    void receiveSharedMessage(int linkId, MAVLinkMessagePtr message);
 
 #ifdef QGC_PROTOBUF_ENABLED
     /** @brief Receive a message from one of the communication links. */
@@ -571,11 +578,60 @@ protected:
     int componentID[256];
     bool componentMulti[256];
 
+    /** @brief Handles one message id of this system, see registerMessageHandler() */
+    typedef void (UAS::*MessageHandler)(const mavlink_message_t& message);
+    /**
+     * @brief Install the handler for a message id, replacing the previous one
+     *
+     * Subclasses register their handlers in their constructor, casting them
+     * with static_cast<MessageHandler>(). To extend a message handled by UAS,
+     * call the UAS handler from the new one.
+     */
+    void registerMessageHandler(int msgid, MessageHandler handler);
+    /** @brief Install the handlers of the default message set */
+    void registerMessageHandlers();
+    MessageHandler messageHandlers[256]; ///< Handler for each message id
+
+    void ignoreMessage(const mavlink_message_t& message);
+    void handleUnknownMessage(const mavlink_message_t& message);
+    void handleHeartbeat(const mavlink_message_t& message);
+    void handleSysStatus(const mavlink_message_t& message);
+    void handleAttitude(const mavlink_message_t& message);
+    void handleHilControls(const mavlink_message_t& message);
+    void handleVfrHud(const mavlink_message_t& message);
+    void handleLocalPositionNed(const mavlink_message_t& message);
+    void handleGlobalPositionInt(const mavlink_message_t& message);
+    void handleGpsRawInt(const mavlink_message_t& message);
+    void handleGpsStatus(const mavlink_message_t& message);
+    void handleGpsGlobalOrigin(const mavlink_message_t& message);
+    void handleRcChannelsRaw(const mavlink_message_t& message);
+    void handleRcChannelsScaled(const mavlink_message_t& message);
+    void handleParamValue(const mavlink_message_t& message);
+    void handleCommandAck(const mavlink_message_t& message);
+    void handleRollPitchYawThrustSetpoint(const mavlink_message_t& message);
+    void handleMissionCount(const mavlink_message_t& message);
+    void handleMissionItem(const mavlink_message_t& message);
+    void handleMissionAck(const mavlink_message_t& message);
+    void handleMissionRequest(const mavlink_message_t& message);
+    void handleMissionItemReached(const mavlink_message_t& message);
+    void handleMissionCurrent(const mavlink_message_t& message);
+    void handleLocalPositionSetpoint(const mavlink_message_t& message);
+    void handleStatusText(const mavlink_message_t& message);
+#ifdef MAVLINK_ENABLED_PIXHAWK
+    void handleDataTransmissionHandshake(const mavlink_message_t& message);
+    void handleEncapsulatedData(const mavlink_message_t& message);
+#endif
+#ifdef MAVLINK_ENABLED_UALBERTA
+    void handleRadioCalibration(const mavlink_message_t& message);
+#endif
+
 protected slots:
     /** @brief Write settings to disk */
     void writeSettings();
     /** @brief Read settings from disk */
     void readSettings();
+    /** @brief Take over a stored parameter the MAV has confirmed, as if it had been received */
+    void addVerifiedParameter(int component, int parameterCount, int parameterId, QString parameterName, QVariant value);
 
 //    // MESSAGE RECEPTION
 //    /** @brief Receive a named value message */
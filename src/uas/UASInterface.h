@@ -41,6 +41,7 @@ This file is part of the QGROUNDCONTROL project
 #include "LinkInterface.h"
 #include "ProtocolInterface.h"
 #include "UASWaypointManager.h"
+#include "QGCUASParamSync.h"
 #include "QGCUASParamManager.h"
 #include "RadioCalibration/RadioCalibrationData.h"
 
@@ -106,6 +107,8 @@ public:
 
     /** @brief Get reference to the waypoint manager **/
     virtual UASWaypointManager* getWaypointManager(void) = 0;
+    /** @brief Get reference to the parameter transfer handler **/
+    virtual QGCUASParamSync* getParamSync(void) = 0;
     /** @brief Get reference to the param manager **/
     virtual QGCUASParamManager* getParamManager() const = 0;
     // TODO Will be removed
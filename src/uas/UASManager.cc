@@ -237,6 +237,9 @@ UASManager::UASManager() :
         homeAlt(470.0),
         homeFrame(MAV_FRAME_GLOBAL)
 {
+    for (int i = 0; i < 256; i++) {
+        systemTable[i] = NULL;
+    }
     loadSettings();
     setLocalNEDSafetyBorders(1, -1, 0, -1, 1, -1);
 }
@@ -266,6 +269,9 @@ void UASManager::addUAS(UASInterface* uas)
     // Only execute if there is no UAS at this index
     if (!systems.contains(uas)) {
         systems.append(uas);
+        // Publish to the lookup table last, the system is complete by now
+        int id = uas->getUASID();
+        if (id >= 0 && id < 256) systemTable[id].fetchAndStoreOrdered(uas);
         connect(uas, SIGNAL(destroyed(QObject*)), this, SLOT(removeUAS(QObject*)));
         // Set home position on UAV if set in UI
         // - this is done on a per-UAV basis
@@ -282,6 +288,14 @@ void UASManager::addUAS(UASInterface* uas)
 
 void UASManager::removeUAS(QObject* uas)
 {
+    // Compare as QObject, the system might already be partially destroyed
+    for (int i = 0; i < 256; i++) {
+        UASInterface* entry = systemTable[i];
+        if (entry && static_cast<QObject*>(entry) == uas) {
+            systemTable[i].testAndSetOrdered(entry, NULL);
+        }
+    }
+
     UASInterface* mav = qobject_cast<UASInterface*>(uas);
 
     if (mav) {
@@ -379,20 +393,6 @@ void UASManager::configureActiveUAS()
     }
 }
 
-UASInterface* UASManager::getUASForId(int id)
-{
-    UASInterface* system = NULL;
-
-    foreach(UASInterface* sys, systems) {
-        if (sys->getUASID() == id) {
-            system = sys;
-        }
-    }
-
-    // Return NULL if not found
-    return system;
-}
-
 void UASManager::setActiveUAS(UASInterface* uas)
 {
     if (uas != NULL) {
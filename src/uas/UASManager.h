@@ -34,6 +34,7 @@ This file is part of the QGROUNDCONTROL project
 #include <QThread>
 #include <QList>
 #include <QMutex>
+#include <QAtomicPointer>
 #include <UASInterface.h>
 #include "Eigen/Eigen"
 #include "QGCGeo.h"
@@ -63,12 +64,16 @@ public:
      * @brief Get the UAS with this id
      *
      * Although not enforced by this implementation, the IDs are constrained to be
-     * in the range of 1 - 127 by the MAVLINK protocol.
+     * in the range of 1 - 127 by the MAVLINK protocol. This is a single table
+     * lookup without any lock, safe to call from any thread.
      *
      * @param id unique system / aircraft id
      * @return UAS with the given ID, NULL pointer else
      **/
-    UASInterface* getUASForId(int id);
+    UASInterface* getUASForId(int id) {
+        if (id < 0 || id > 255) return NULL;
+        return systemTable[id];
+    }
 
     QList<UASInterface*> getUASList();
     /** @brief Get home position latitude */
@@ -243,6 +248,7 @@ public slots:
 protected:
     UASManager();
     QList<UASInterface*> systems;
+    QAtomicPointer<UASInterface> systemTable[256]; ///< Systems indexed by id, read without lock
     UASInterface* activeUAS;
     QMutex activeUASMutex;
     double homeLat;
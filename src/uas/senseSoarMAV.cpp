@@ -11,7 +11,7 @@ senseSoarMAV::~senseSoarMAV(void)
 {
 }
 
-void senseSoarMAV::receiveMessage(LinkInterface *link, mavlink_message_t message)
+void senseSoarMAV::receiveMessage(LinkInterface *link, const mavlink_message_t& message)
 {
 #ifdef MAVLINK_ENABLED_SENSESOAR
 	if (message.sysid == uasId)  // make sure the message is for the right UAV
@@ -18,7 +18,7 @@ public:
 	~senseSoarMAV(void);
 public slots:
     /** @brief Receive a MAVLink message from this MAV */
-    void receiveMessage(LinkInterface* link, mavlink_message_t message);
+    void receiveMessage(LinkInterface* link, const mavlink_message_t& message);
 protected:
 	float m_rotVel[3]; // Rotational velocity in the body frame
 	uint8_t senseSoarState;
@@ -261,9 +261,10 @@ void DebugConsole::setAutoHold(bool hold)
 void DebugConsole::receiveTextMessage(int id, int component, int severity, QString text)
 {
     Q_UNUSED(severity);
-    if (isVisible())
+    UASInterface* uas = UASManager::instance()->getUASForId(id);
+    if (isVisible() && uas)
     {
-        QString name = UASManager::instance()->getUASForId(id)->getUASName();
+        QString name = uas->getUASName();
         QString comp;
         // Get a human readable name if possible
         switch (component) {
@@ -285,7 +286,7 @@ void DebugConsole::receiveTextMessage(int id, int component, int severity, QStri
             break;
         }
 
-        m_ui->receiveText->appendHtml(QString("<font color=\"%1\">(%2:%3) %4</font>\n").arg(UASManager::instance()->getUASForId(id)->getColor().name(), name, comp, text));
+        m_ui->receiveText->appendHtml(QString("<font color=\"%1\">(%2:%3) %4</font>\n").arg(uas->getColor().name(), name, comp, text));
         // Ensure text area scrolls correctly
         m_ui->receiveText->ensureCursorVisible();
     }
@@ -20,6 +20,7 @@
 #include <QSettings>
 #include <qmath.h>
 #include "UASManager.h"
+#include "TelemetryAggregator.h"
 #include "HDDisplay.h"
 #include "ui_HDDisplay.h"
 #include "MG.h"
@@ -283,6 +284,7 @@ void HDDisplay::removeItemByAction()
 
 void HDDisplay::addGauge()
 {
+    flushChannels();
     QStringList items;
     for (int i = 0; i < values.count(); ++i) {
         QString key = values.keys().at(i);
@@ -418,6 +420,7 @@ void HDDisplay::setTitle()
 
 void HDDisplay::renderOverlay()
 {
+    flushChannels();
     if (!valuesChanged || !isVisible()) return;
 
 #if (QGC_EVENTLOOP_DEBUG)
@@ -480,14 +483,12 @@ void HDDisplay::setActiveUAS(UASInterface* uas)
 {
     if (this->uas != NULL) {
         // Disconnect any previously connected active MAV
-        disconnect(this->uas, SIGNAL(valueChanged(int,QString,QString,double,quint64)), this, SLOT(updateValue(int,QString,QString,double,quint64)));
-        disconnect(this->uas, SIGNAL(valueChanged(int,QString,QString,int,quint64)), this, SLOT(updateValue(int,QString,QString,int,quint64)));
+        TelemetryAggregator::instance()->disconnectSource(this->uas, this);
     }
 
     // Now connect the new UAS
-    // Setup communication
-    connect(uas, SIGNAL(valueChanged(int,QString,QString,double,quint64)), this, SLOT(updateValue(int,QString,QString,double,quint64)));
-    connect(uas, SIGNAL(valueChanged(int,QString,QString,int,quint64)), this, SLOT(updateValue(int,QString,QString,int,quint64)));
+    // Setup communication, only the latest value per frame is shown
+    TelemetryAggregator::instance()->connectSource(uas, this, SLOT(updateSamples(TelemetrySampleList)), TelemetryAggregator::LatestValues);
     this->uas = uas;
 }
 
@@ -849,11 +850,7 @@ void HDDisplay::addSource(QObject* obj)
 //    if (plots.size() > 0)
 //    {
         // Connect generic source
-        connect(obj, SIGNAL(valueChanged(int,QString,QString,int,quint64)), this, SLOT(updateValue(int,QString,QString,int,quint64)));
-        connect(obj, SIGNAL(valueChanged(int,QString,QString,unsigned int,quint64)), this, SLOT(updateValue(int,QString,QString,unsigned int,quint64)));
-        connect(obj, SIGNAL(valueChanged(int,QString,QString,quint64,quint64)), this, SLOT(updateValue(int,QString,QString,quint64,quint64)));
-        connect(obj, SIGNAL(valueChanged(int,QString,QString,qint64,quint64)), this, SLOT(updateValue(int,QString,QString,qint64,quint64)));
-        connect(obj, SIGNAL(valueChanged(int,QString,QString,double,quint64)), this, SLOT(updateValue(int,QString,QString,double,quint64)));
+        TelemetryAggregator::instance()->connectSource(obj, this, SLOT(updateSamples(TelemetrySampleList)), TelemetryAggregator::LatestValues);
 //    }
 }
 
@@ -897,6 +894,55 @@ void HDDisplay::updateValue(const int uasId, const QString& name, const QString&
     lastUpdate.insert(name, msec);
 }
 
+/**
+ * The statistics are kept per channel, the value maps keyed by name are
+ * only updated once per frame in flushChannels().
+ */
+void HDDisplay::updateSamples(const TelemetrySampleList& samples)
+{
+    for (int i = 0; i < samples.size(); ++i)
+    {
+        const TelemetrySample& sample = samples.at(i);
+        if (sample.channel >= channels.size()) channels.resize(sample.channel + 1);
+        GaugeChannel& channel = channels[sample.channel];
+        if (!channel.resolved)
+        {
+            const TelemetryChannel info = TelemetryChannelRegistry::instance()->getChannel(sample.channel);
+            channel.name = info.name;
+            channel.unit = info.unit;
+            channel.integer = info.isInteger();
+            channel.resolved = true;
+        }
+
+        // Update mean
+        channel.mean = (channel.mean * channel.count + sample.value) / (channel.count + 1);
+        channel.count++;
+        channel.dot = (sample.value - channel.value) / ((sample.time - channel.lastUpdate)/1000.0f);
+        channel.value = sample.value;
+        channel.lastUpdate = sample.time;
+        channel.changed = true;
+    }
+}
+
+void HDDisplay::flushChannels()
+{
+    for (int i = 0; i < channels.size(); ++i)
+    {
+        GaugeChannel& channel = channels[i];
+        if (!channel.changed) continue;
+        const QString& name = channel.name;
+        if (channel.integer && !intValues.contains(name)) intValues.insert(name, true);
+        valuesMean.insert(name, channel.mean);
+        valuesCount.insert(name, channel.count);
+        valuesDot.insert(name, channel.dot);
+        if (values.value(name, 0.0) != channel.value) valuesChanged = true;
+        values.insert(name, channel.value);
+        units.insert(name, channel.unit);
+        lastUpdate.insert(name, channel.lastUpdate);
+        channel.changed = false;
+    }
+}
+
 /**
  * @param y coordinate in pixels to be converted to reference mm units
  * @return the screen coordinate relative to the QGLWindow origin
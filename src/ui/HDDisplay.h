@@ -37,11 +37,13 @@ This file is part of the QGROUNDCONTROL project
 #include <QTimer>
 #include <QFontDatabase>
 #include <QMap>
+#include <QVector>
 #include <QContextMenuEvent>
 #include <QPair>
 #include <cmath>
 
 #include "UASInterface.h"
+#include "TelemetryChannelRegistry.h"
 
 namespace Ui
 {
@@ -74,6 +76,8 @@ public slots:
     void updateValue(const int uasId, const QString& name, const QString& unit, const qint64 value, const quint64 msec);
     /** @brief Update a HDD integer value */
     void updateValue(const int uasId, const QString& name, const QString& unit, const quint64 value, const quint64 msec);
+    /** @brief Update the HDD values of a batch of telemetry channels */
+    void updateSamples(const TelemetrySampleList& samples);
     virtual void setActiveUAS(UASInterface* uas);
     void addSource(QObject* obj);
 
@@ -159,6 +163,26 @@ protected:
     QMap<QString, QString> customNames; ///< Custom names for the data names
     QMap<QString, QPair<float, float> > goodRanges; ///< The range of good values
     QMap<QString, QPair<float, float> > critRanges; ///< The range of critical values
+
+    /** @brief Values of one telemetry channel, moved into the value maps once per frame */
+    struct GaugeChannel
+    {
+        GaugeChannel() : resolved(false), integer(false), changed(false), value(0), dot(0), mean(0), count(0), lastUpdate(0) {}
+        bool resolved;      ///< Name and unit are known
+        QString name;
+        QString unit;
+        bool integer;       ///< Integer-valued channel
+        bool changed;       ///< Updated since the last frame
+        double value;
+        float dot;
+        float mean;
+        int count;
+        quint64 lastUpdate;
+    };
+    QVector<GaugeChannel> channels;  ///< Channel values by channel id
+    /** @brief Move the channel values updated since the last frame into the value maps */
+    void flushChannels();
+
     double scalingFactor;      ///< Factor used to scale all absolute values to screen coordinates
     float xCenterOffset, yCenterOffset; ///< Offset from center of window in mm coordinates
     float vwidth;              ///< Virtual width of this window, 200 mm per default. This allows to hardcode positions and aspect ratios. This virtual image plane is then scaled to the window size.
@@ -1,17 +1,48 @@
+#include <string.h>
 #include "MAVLinkDecoder.h"
 #include "UASManager.h"
 
+/** @brief Read one element of a field, the wire layout gives no alignment guarantee */
+template <typename T> static T readElement(const char* field, int element)
+{
+    T value;
+    memcpy(&value, field + element * sizeof(T), sizeof(T));
+    return value;
+}
+
+static const char* typeName(int type)
+{
+    switch (type)
+    {
+    case MAVLINK_TYPE_CHAR: return "char";
+    case MAVLINK_TYPE_UINT8_T: return "uint8_t";
+    case MAVLINK_TYPE_INT8_T: return "int8_t";
+    case MAVLINK_TYPE_UINT16_T: return "uint16_t";
+    case MAVLINK_TYPE_INT16_T: return "int16_t";
+    case MAVLINK_TYPE_UINT32_T: return "uint32_t";
+    case MAVLINK_TYPE_INT32_T: return "int32_t";
+    case MAVLINK_TYPE_UINT64_T: return "uint64_t";
+    case MAVLINK_TYPE_INT64_T: return "int64_t";
+    case MAVLINK_TYPE_FLOAT: return "float";
+    case MAVLINK_TYPE_DOUBLE: return "double";
+    }
+    return "";
+}
+
 MAVLinkDecoder::MAVLinkDecoder(MAVLinkProtocol* protocol, QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    slotCount(0),
+    emitNamedValues(false),
+    messagesSinceReceiverUpdate(0),
+    messageBus(protocol->getMessageBus())
 {
-    mavlink_message_info_t msg[256] = MAVLINK_MESSAGE_INFO;
-    memcpy(messageInfo, msg, sizeof(mavlink_message_info_t)*256);
-    memset(receivedMessages, 0, sizeof(mavlink_message_t)*256);
-    for (unsigned int i = 0; i<255;++i)
+    for (unsigned int i = 0; i < 256; ++i)
     {
         componentID[i] = -1;
         componentMulti[i] = false;
         onboardTimeOffset[i] = 0;
+        onboardToGCSUnixTimeOffsetAndDelay[i] = 0;
+        firstOnboardTime[i] = 0;
     }
 
 
@@ -38,61 +69,399 @@ MAVLinkDecoder::MAVLinkDecoder(MAVLinkProtocol* protocol, QObject *parent) :
     textMessageFilter.insert(MAVLINK_MSG_ID_NAMED_VALUE_FLOAT, false);
     textMessageFilter.insert(MAVLINK_MSG_ID_NAMED_VALUE_INT, false);
 
-    connect(protocol, SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)), this, SLOT(receiveMessage(LinkInterface*,mavlink_message_t)));
+    buildPlans();
+
+    messageBus->subscribe(this, SLOT(receiveMessage(int,MAVLinkMessagePtr)));
+}
+
+MAVLinkDecoder::~MAVLinkDecoder()
+{
+    // Stop the protocol thread from queueing messages for this decoder
+    messageBus->unsubscribe(this);
 }
 
-void MAVLinkDecoder::receiveMessage(LinkInterface* link,mavlink_message_t message)
+/**
+ * All name, type and time field decisions are taken here once per
+ * message id, so decoding never has to look at MAVLINK_MESSAGE_INFO
+ * or compare field names again.
+ */
+void MAVLinkDecoder::buildPlans()
 {
-    Q_UNUSED(link);
-    memcpy(receivedMessages+message.msgid, &message, sizeof(mavlink_message_t));
+    static const mavlink_message_info_t messageInfo[256] = MAVLINK_MESSAGE_INFO;
+
+    slotCount = 0;
+    for (int msgid = 0; msgid < 256; ++msgid)
+    {
+        const mavlink_message_info_t& info = messageInfo[msgid];
+        MessagePlan& plan = plans[msgid];
+        plan.valid = (info.num_fields > 0 && !messageFilter.contains(msgid));
+        plan.name = QString(info.name);
+        plan.emitText = !textMessageFilter.contains(msgid);
+        plan.timeType = MessagePlan::TimeNone;
+        plan.timeOffset = 0;
+        plan.nameType = MessagePlan::NameStatic;
+        plan.nameOffset = 0;
+        plan.nameLength = 0;
+        plan.fields.clear();
+        if (!plan.valid) continue;
+
+        const int firstSlot = slotCount;
+
+        // See if first value is a time value
+        unsigned int first = 0;
+        const mavlink_field_info_t& timeField = info.fields[0];
+        if (strcmp(timeField.name, "time_boot_ms") == 0 && timeField.type == MAVLINK_TYPE_UINT32_T)
+        {
+            plan.timeType = MessagePlan::TimeBootMs;
+            plan.timeOffset = timeField.wire_offset;
+            first = 1;
+        }
+        else if (strstr(timeField.name, "usec") != NULL && timeField.type == MAVLINK_TYPE_UINT64_T)
+        {
+            plan.timeType = MessagePlan::TimeUsec;
+            plan.timeOffset = timeField.wire_offset;
+            first = 1;
+        }
+
+        // Debug values are named after their content
+        if (msgid == MAVLINK_MSG_ID_DEBUG)
+        {
+            plan.nameType = MessagePlan::NameFromIndex;
+        }
+        else if (msgid == MAVLINK_MSG_ID_DEBUG_VECT || msgid == MAVLINK_MSG_ID_NAMED_VALUE_FLOAT || msgid == MAVLINK_MSG_ID_NAMED_VALUE_INT)
+        {
+            plan.nameType = MessagePlan::NameFromString;
+        }
+
+        for (unsigned int i = first; i < info.num_fields; ++i)
+        {
+            const mavlink_field_info_t& fieldInfo = info.fields[i];
+            if (plan.nameType == MessagePlan::NameFromIndex && strcmp(fieldInfo.name, "ind") == 0)
+            {
+                plan.nameOffset = fieldInfo.wire_offset;
+                plan.nameLength = 1;
+            }
+            if (plan.nameType == MessagePlan::NameFromString && strcmp(fieldInfo.name, "name") == 0)
+            {
+                plan.nameOffset = fieldInfo.wire_offset;
+                plan.nameLength = fieldInfo.array_length;
+            }
+
+            FieldPlan field;
+            field.offset = fieldInfo.wire_offset;
+            field.type = fieldInfo.type;
+            field.arrayLength = fieldInfo.array_length;
+            field.slot = slotCount;
+            field.index = slotCount - firstSlot;
+            field.name = QString(fieldInfo.name);
+            field.unit = QString(typeName(fieldInfo.type));
+            if (field.arrayLength > 0 && field.type != MAVLINK_TYPE_CHAR)
+            {
+                field.unit += QString("[%1]").arg(field.arrayLength);
+            }
+            slotCount += (field.arrayLength > 0) ? field.arrayLength : 1;
+            plan.fields.append(field);
+        }
+    }
+}
 
-    uint8_t msgid = message.msgid;
+void MAVLinkDecoder::receiveMessage(int linkId, MAVLinkMessagePtr sharedMessage)
+{
+    Q_UNUSED(linkId);
+    const mavlink_message_t& message = *sharedMessage;
+    const uint8_t msgid = message.msgid;
 
     // Handle time sync message
-    if (message.msgid == MAVLINK_MSG_ID_SYSTEM_TIME && message.compid == 200)
+    if (msgid == MAVLINK_MSG_ID_SYSTEM_TIME && message.compid == 200)
     {
         mavlink_system_time_t timebase;
         mavlink_msg_system_time_decode(&message, &timebase);
         onboardTimeOffset[message.sysid] = timebase.time_unix_usec/1000 - timebase.time_boot_ms;
         onboardToGCSUnixTimeOffsetAndDelay[message.sysid] = static_cast<qint64>(QGC::groundTimeMilliseconds() - timebase.time_unix_usec/1000);
+        return;
+    }
+
+    // Store component ID
+    if (componentID[msgid] == -1)
+    {
+        componentID[msgid] = message.compid;
+    }
+    else if (componentID[msgid] != message.compid)
+    {
+        // Got this message already from another component
+        componentMulti[msgid] = true;
+    }
+
+    const MessagePlan& plan = plans[msgid];
+    if (!plan.valid) return;
+
+    const char* payload = _MAV_PAYLOAD(&message);
+    quint64 time = 0;
+    if (plan.timeType == MessagePlan::TimeBootMs)
+    {
+        time = readElement<quint32>(payload + plan.timeOffset, 0);
+    }
+    else if (plan.timeType == MessagePlan::TimeUsec)
+    {
+        time = readElement<quint64>(payload + plan.timeOffset, 0) / 1000; // Scale to milliseconds
+    }
+
+    // Raw bytes of the name field, the channel name is only built for new channels
+    QByteArray content;
+    if (plan.nameType == MessagePlan::NameStatic)
+    {
+        // Align time to global time
+        time = getUnixTimeFromMs(message.sysid, time);
+    }
+    else if (plan.nameType == MessagePlan::NameFromString)
+    {
+        // Named values keep their onboard time
+        const char* name = payload + plan.nameOffset;
+        content = QByteArray::fromRawData(name, qstrnlen(name, plan.nameLength));
     }
     else
     {
+        content = QByteArray::fromRawData(payload + plan.nameOffset, plan.nameLength);
+    }
 
-        QString messageName("%1 (#%2)");
-        messageName = messageName.arg(messageInfo[msgid].name).arg(msgid);
+    // Only build the named signals for the receivers still using them.
+    // Connects and disconnects update the flag right away, deleted
+    // receivers are caught by counting again now and then
+    if (++messagesSinceReceiverUpdate >= 1024)
+    {
+        updateNamedReceivers();
+    }
 
-        // See if first value is a time value
-        quint64 time = 0;
-        uint8_t fieldid = 0;
-        uint8_t* m = ((uint8_t*)(receivedMessages+msgid))+8;
-        if (QString(messageInfo[msgid].fields[fieldid].name) == QString("time_boot_ms") && messageInfo[msgid].fields[fieldid].type == MAVLINK_TYPE_UINT32_T)
+    const int uasId = message.sysid;
+    samples.reserve(plan.fields.size());
+    for (int i = 0; i < plan.fields.size(); ++i)
+    {
+        const FieldPlan& field = plan.fields.at(i);
+        const char* data = payload + field.offset;
+
+        if (field.type == MAVLINK_TYPE_CHAR && field.arrayLength > 0)
         {
-            time = *((quint32*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
+            if (plan.emitText)
+            {
+                // The string is not null-terminated if it fills the whole field
+                const QString text = QString::fromLatin1(data, qstrnlen(data, field.arrayLength));
+                const int channelId = getChannelId(message, plan, field, 0, content);
+                emit textMessageReceived(message.sysid, message.compid, 0, channelNames.at(channelId) + ": " + text);
+            }
+            continue;
         }
-        else if (QString(messageInfo[msgid].fields[fieldid].name).contains("usec") && messageInfo[msgid].fields[fieldid].type == MAVLINK_TYPE_UINT64_T)
+
+        const int count = (field.arrayLength > 0) ? field.arrayLength : 1;
+        for (int j = 0; j < count; ++j)
         {
-            time = *((quint64*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            time = time/1000; // Scale to milliseconds
+            const int channelId = getChannelId(message, plan, field, j, content);
+            switch (field.type)
+            {
+            case MAVLINK_TYPE_CHAR:
+                emitValue(uasId, channelId, static_cast<int>(readElement<char>(data, j)), time);
+                break;
+            case MAVLINK_TYPE_UINT8_T:
+                emitValue(uasId, channelId, static_cast<int>(readElement<quint8>(data, j)), time);
+                break;
+            case MAVLINK_TYPE_INT8_T:
+                emitValue(uasId, channelId, static_cast<int>(readElement<qint8>(data, j)), time);
+                break;
+            case MAVLINK_TYPE_UINT16_T:
+                emitValue(uasId, channelId, static_cast<int>(readElement<quint16>(data, j)), time);
+                break;
+            case MAVLINK_TYPE_INT16_T:
+                emitValue(uasId, channelId, static_cast<int>(readElement<qint16>(data, j)), time);
+                break;
+            case MAVLINK_TYPE_UINT32_T:
+                emitValue(uasId, channelId, static_cast<unsigned int>(readElement<quint32>(data, j)), time);
+                break;
+            case MAVLINK_TYPE_INT32_T:
+                emitValue(uasId, channelId, static_cast<int>(readElement<qint32>(data, j)), time);
+                break;
+            case MAVLINK_TYPE_FLOAT:
+                emitValue(uasId, channelId, static_cast<double>(readElement<float>(data, j)), time);
+                break;
+            case MAVLINK_TYPE_DOUBLE:
+                emitValue(uasId, channelId, readElement<double>(data, j), time);
+                break;
+            case MAVLINK_TYPE_UINT64_T:
+                emitValue(uasId, channelId, readElement<quint64>(data, j), time);
+                break;
+            case MAVLINK_TYPE_INT64_T:
+                emitValue(uasId, channelId, readElement<qint64>(data, j), time);
+                break;
+            }
+        }
+    }
+
+    if (!samples.isEmpty())
+    {
+        emit samplesReceived(samples);
+        samples.clear();
+    }
+
+    // Send out combined math expressions
+    // FIXME XXX TODO
+}
+
+/**
+ * Fields named by the message itself are cached per system / component
+ * and slot, the registry is only asked the first time a slot is seen.
+ * Fields named after the message content are cached by the raw bytes of
+ * the name field in addition, without building the name.
+ */
+int MAVLinkDecoder::getChannelId(const mavlink_message_t& msg, const MessagePlan& plan, const FieldPlan& field, int element, const QByteArray& content)
+{
+    const int slot = field.slot + element;
+    const bool multiComponent = componentMulti[msg.msgid];
+    const quint64 key = (static_cast<quint64>(multiComponent) << 48) | (static_cast<quint64>(msg.sysid) << 40) |
+                        (static_cast<quint64>(msg.compid) << 32) | static_cast<quint32>(slot);
+
+    if (plan.nameType == MessagePlan::NameStatic)
+    {
+        if (!multiComponent)
+        {
+            QVector<int>& ids = systemChannelIds[msg.sysid];
+            if (ids.isEmpty()) ids.fill(-1, slotCount);
+            if (ids.at(slot) >= 0) return ids.at(slot);
         }
         else
         {
-            // First value is not time, send out value 0
-            emitFieldValue(&message, fieldid, getUnixTimeFromMs(message.sysid, 0));
+            QHash<quint64, int>::const_iterator it = componentChannelIds.constFind(key);
+            if (it != componentChannelIds.constEnd()) return it.value();
         }
+    }
+    else
+    {
+        // The content refers to the message payload, no copy is made for the lookup
+        QHash<QPair<quint64, QByteArray>, int>::const_iterator it = contentChannelIds.constFind(qMakePair(key, content));
+        if (it != contentChannelIds.constEnd()) return it.value();
+    }
 
-        // Align time to global time
-        time = getUnixTimeFromMs(message.sysid, time);
+    QString baseName;
+    if (plan.nameType == MessagePlan::NameFromString)
+    {
+        baseName = QString::fromLatin1(content.constData(), content.size());
+    }
+    else if (plan.nameType == MessagePlan::NameFromIndex)
+    {
+        baseName = QString("debug.%1").arg(static_cast<quint8>(content.at(0)));
+    }
 
-        // Send out field values from 1..n
-        for (unsigned int i = 1; i < messageInfo[msgid].num_fields; ++i)
+    QString name;
+    if (plan.nameType == MessagePlan::NameStatic)
+    {
+        name = QString("%1.%2").arg(plan.name, field.name);
+    }
+    else if (plan.nameType == MessagePlan::NameFromString)
+    {
+        name = QString("%1.%2").arg(baseName, field.name);
+    }
+    else
+    {
+        name = baseName;
+    }
+    if (field.arrayLength > 0 && field.type != MAVLINK_TYPE_CHAR) name += QString(".%1").arg(element);
+    if (multiComponent) name.prepend(QString("C%1:").arg(msg.compid));
+    name.prepend(QString("M%1:").arg(msg.sysid));
+
+    // Debug values share names between fields, the registry tells them apart by unit
+    const int channelId = TelemetryChannelRegistry::instance()->registerChannel(msg.sysid, msg.compid, msg.msgid,
+                                                                                (plan.nameType == MessagePlan::NameStatic) ? field.index + element : -1,
+                                                                                name, field.unit, field.type);
+    if (channelId >= channelNames.size())
+    {
+        channelNames.resize(channelId + 1);
+        channelUnits.resize(channelId + 1);
+    }
+    else if (!channelNames.at(channelId).isEmpty() && channelNames.at(channelId) != name)
+    {
+        // A second component showed up, the channel carries the component prefix from now on
+        TelemetryChannelRegistry::instance()->addChannelAlias(channelId, name);
+    }
+    channelNames[channelId] = name;
+    channelUnits[channelId] = field.unit;
+
+    if (plan.nameType == MessagePlan::NameStatic)
+    {
+        if (!multiComponent)
+        {
+            systemChannelIds[msg.sysid][slot] = channelId;
+        }
+        else
         {
-            emitFieldValue(&message, i, time);
+            componentChannelIds.insert(key, channelId);
         }
     }
+    else
+    {
+        contentChannelIds.insert(qMakePair(key, QByteArray(content.constData(), content.size())), channelId);
+    }
+    return channelId;
+}
 
-    // Send out combined math expressions
-    // FIXME XXX TODO
+void MAVLinkDecoder::emitValue(int uasId, int channelId, int value, quint64 time)
+{
+    const TelemetrySample sample = {channelId, time, static_cast<double>(value)};
+    samples.append(sample);
+    if (emitNamedValues) emit valueChanged(uasId, channelNames.at(channelId), channelUnits.at(channelId), value, time);
+}
+
+void MAVLinkDecoder::emitValue(int uasId, int channelId, unsigned int value, quint64 time)
+{
+    const TelemetrySample sample = {channelId, time, static_cast<double>(value)};
+    samples.append(sample);
+    if (emitNamedValues) emit valueChanged(uasId, channelNames.at(channelId), channelUnits.at(channelId), value, time);
+}
+
+void MAVLinkDecoder::emitValue(int uasId, int channelId, qint64 value, quint64 time)
+{
+    const TelemetrySample sample = {channelId, time, static_cast<double>(value)};
+    samples.append(sample);
+    if (emitNamedValues) emit valueChanged(uasId, channelNames.at(channelId), channelUnits.at(channelId), value, time);
+}
+
+void MAVLinkDecoder::emitValue(int uasId, int channelId, quint64 value, quint64 time)
+{
+    const TelemetrySample sample = {channelId, time, static_cast<double>(value)};
+    samples.append(sample);
+    if (emitNamedValues) emit valueChanged(uasId, channelNames.at(channelId), channelUnits.at(channelId), value, time);
+}
+
+void MAVLinkDecoder::emitValue(int uasId, int channelId, double value, quint64 time)
+{
+    const TelemetrySample sample = {channelId, time, value};
+    samples.append(sample);
+    if (emitNamedValues) emit valueChanged(uasId, channelNames.at(channelId), channelUnits.at(channelId), value, time);
+}
+
+void MAVLinkDecoder::connectNotify(const char* signal)
+{
+    QObject::connectNotify(signal);
+    if (signal && qstrncmp(signal + 1, "valueChanged(", 13) == 0)
+    {
+        updateNamedReceivers();
+    }
+}
+
+void MAVLinkDecoder::disconnectNotify(const char* signal)
+{
+    QObject::disconnectNotify(signal);
+    // No signal means all signals were disconnected
+    if (!signal || qstrncmp(signal + 1, "valueChanged(", 13) == 0)
+    {
+        updateNamedReceivers();
+    }
+}
+
+void MAVLinkDecoder::updateNamedReceivers()
+{
+    messagesSinceReceiverUpdate = 0;
+    emitNamedValues = (receivers(SIGNAL(valueChanged(int,QString,QString,double,quint64))) > 0 ||
+                       receivers(SIGNAL(valueChanged(int,QString,QString,int,quint64))) > 0 ||
+                       receivers(SIGNAL(valueChanged(int,QString,QString,unsigned int,quint64))) > 0 ||
+                       receivers(SIGNAL(valueChanged(int,QString,QString,quint64,quint64))) > 0 ||
+                       receivers(SIGNAL(valueChanged(int,QString,QString,qint64,quint64))) > 0);
 }
 
 quint64 MAVLinkDecoder::getUnixTimeFromMs(int systemID, quint64 time)
@@ -140,272 +509,3 @@ quint64 MAVLinkDecoder::getUnixTimeFromMs(int systemID, quint64 time)
 
     return ret;
 }
-
-void MAVLinkDecoder::emitFieldValue(mavlink_message_t* msg, int fieldid, quint64 time)
-{
-    bool multiComponentSourceDetected = false;
-    bool wrongComponent = false;
-
-    // Store component ID
-    if (componentID[msg->msgid] == -1)
-    {
-        componentID[msg->msgid] = msg->compid;
-    }
-    else
-    {
-        // Got this message already
-        if (componentID[msg->msgid] != msg->compid)
-        {
-            componentMulti[msg->msgid] = true;
-            wrongComponent = true;
-        }
-    }
-
-    if (componentMulti[msg->msgid] == true) multiComponentSourceDetected = true;
-
-    // Add field tree widget item
-    uint8_t msgid = msg->msgid;
-    if (messageFilter.contains(msgid)) return;
-    QString fieldName(messageInfo[msgid].fields[fieldid].name);
-    QString fieldType;
-    uint8_t* m = ((uint8_t*)(receivedMessages+msgid))+8;
-    QString name("%1.%2");
-    QString unit("");
-
-    // Debug vector messages
-    if (msgid == MAVLINK_MSG_ID_DEBUG_VECT)
-    {
-        mavlink_debug_vect_t debug;
-        mavlink_msg_debug_vect_decode(msg, &debug);
-        name = name.arg(QString(debug.name), fieldName);
-        time = debug.time_usec / 1000;
-    }
-    else if (msgid == MAVLINK_MSG_ID_DEBUG)
-    {
-        mavlink_debug_t debug;
-        mavlink_msg_debug_decode(msg, &debug);
-        name = name.arg(QString("debug")).arg(debug.ind);
-        time = debug.time_boot_ms;
-    }
-    else if (msgid == MAVLINK_MSG_ID_NAMED_VALUE_FLOAT)
-    {
-        mavlink_named_value_float_t debug;
-        mavlink_msg_named_value_float_decode(msg, &debug);
-        name = name.arg(debug.name).arg(fieldName);
-        time = debug.time_boot_ms;
-    }
-    else if (msgid == MAVLINK_MSG_ID_NAMED_VALUE_INT)
-    {
-        mavlink_named_value_int_t debug;
-        mavlink_msg_named_value_int_decode(msg, &debug);
-        name = name.arg(debug.name).arg(fieldName);
-        time = debug.time_boot_ms;
-    }
-    else
-    {
-        name = name.arg(messageInfo[msgid].name, fieldName);
-    }
-
-    if (multiComponentSourceDetected) name.prepend(QString("C%1:").arg(msg->compid));
-    name.prepend(QString("M%1:").arg(msg->sysid));
-    switch (messageInfo[msgid].fields[fieldid].type)
-    {
-    case MAVLINK_TYPE_CHAR:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            char* str = (char*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            // Enforce null termination
-            str[messageInfo[msgid].fields[fieldid].array_length-1] = '\0';
-            QString string(name + ": " + str);
-            if (!textMessageFilter.contains(msgid)) emit textMessageReceived(msg->sysid, msg->compid, 0, string);
-        }
-        else
-        {
-            // Single char
-            char b = *((char*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            unit = QString("char[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            emit valueChanged(msg->sysid, name, unit, b, time);
-        }
-        break;
-    case MAVLINK_TYPE_UINT8_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            uint8_t* nums = m+messageInfo[msgid].fields[fieldid].wire_offset;
-            fieldType = QString("uint8_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[fieldid].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            uint8_t u = *(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = "uint8_t";
-            emit valueChanged(msg->sysid, name, fieldType, u, time);
-        }
-        break;
-    case MAVLINK_TYPE_INT8_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            int8_t* nums = (int8_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("int8_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[j].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            int8_t n = *((int8_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "int8_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_UINT16_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            uint16_t* nums = (uint16_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("uint16_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[j].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            uint16_t n = *((uint16_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "uint16_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_INT16_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            int16_t* nums = (int16_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("int16_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[j].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            int16_t n = *((int16_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "int16_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_UINT32_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            uint32_t* nums = (uint32_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("uint32_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[j].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            float n = *((uint32_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "uint32_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_INT32_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            int32_t* nums = (int32_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("int32_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[j].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            int32_t n = *((int32_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "int32_t";
-            emit valueChanged(msg->sysid, name, fieldType, n, time);
-        }
-        break;
-    case MAVLINK_TYPE_FLOAT:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            float* nums = (float*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("float[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[j].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            float f = *((float*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "float";
-            emit valueChanged(msg->sysid, name, fieldType, f, time);
-        }
-        break;
-    case MAVLINK_TYPE_DOUBLE:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            double* nums = (double*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("double[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[j].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            double f = *((double*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "double";
-            emit valueChanged(msg->sysid, name, fieldType, f, time);
-        }
-        break;
-    case MAVLINK_TYPE_UINT64_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            uint64_t* nums = (uint64_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("uint64_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[j].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, (quint64) nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            uint64_t n = *((uint64_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "uint64_t";
-            emit valueChanged(msg->sysid, name, fieldType, (quint64) n, time);
-        }
-        break;
-    case MAVLINK_TYPE_INT64_T:
-        if (messageInfo[msgid].fields[fieldid].array_length > 0)
-        {
-            int64_t* nums = (int64_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset);
-            fieldType = QString("int64_t[%1]").arg(messageInfo[msgid].fields[fieldid].array_length);
-            for (unsigned int j = 0; j < messageInfo[msgid].fields[j].array_length; ++j)
-            {
-                emit valueChanged(msg->sysid, QString("%1.%2").arg(name).arg(j), fieldType, (qint64) nums[j], time);
-            }
-        }
-        else
-        {
-            // Single value
-            int64_t n = *((int64_t*)(m+messageInfo[msgid].fields[fieldid].wire_offset));
-            fieldType = "int64_t";
-            emit valueChanged(msg->sysid, name, fieldType, (qint64) n, time);
-        }
-        break;
-    }
-}
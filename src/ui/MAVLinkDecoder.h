@@ -2,16 +2,45 @@
 #define MAVLINKDECODER_H
 
 #include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+#include <QByteArray>
+#include <QString>
 #include "MAVLinkProtocol.h"
+#include "TelemetryChannelRegistry.h"
 
+/**
+ * @brief Generic decoder emitting every field of every received message
+ *
+ * The layout of each message is looked up once in MAVLINK_MESSAGE_INFO
+ * and stored as extraction plan, decoding a message only walks its plan.
+ * Every emitted value (one per array element) is a channel of the
+ * TelemetryChannelRegistry. The channel is registered, and its name
+ * built, the first time a system / component sends the field, after
+ * that the values of a message go out as one batch of samples.
+ */
 class MAVLinkDecoder : public QObject
 {
     Q_OBJECT
 public:
     MAVLinkDecoder(MAVLinkProtocol* protocol, QObject *parent = 0);
+    ~MAVLinkDecoder();
+
+    /** @brief Full name of a channel, e.g. "M1:ATTITUDE.roll" */
+    QString getChannelName(int channelId) const {
+        return channelNames.value(channelId);
+    }
+    /** @brief Unit / type of a channel, e.g. "float" */
+    QString getChannelUnit(int channelId) const {
+        return channelUnits.value(channelId);
+    }
 
 signals:
     void textMessageReceived(int uasid, int componentid, int severity, const QString& text);
+    /** @brief All values of one message, by TelemetryChannelRegistry channel id */
+    void samplesReceived(const TelemetrySampleList& samples);
+    /* The named signals are only emitted while they are connected */
     void valueChanged(const int uasId, const QString& name, const QString& unit, const double value, const quint64 msec);
     void valueChanged(const int uasId, const QString& name, const QString& unit, const int value, const quint64 msec);
     void valueChanged(const int uasId, const QString& name, const QString& unit, const unsigned int value, const quint64 msec);
@@ -21,15 +50,68 @@ signals:
 
 public slots:
     /** @brief Receive one message from the protocol and decode it */
-    void receiveMessage(LinkInterface* link,mavlink_message_t message);
+    void receiveMessage(int linkId, MAVLinkMessagePtr message);
 protected:
-    /** @brief Emit the value of one message field */
-    void emitFieldValue(mavlink_message_t* msg, int fieldid, quint64 time);
+    /** @brief Precomputed extraction of one message field */
+    struct FieldPlan
+    {
+        int offset;          ///< Wire offset in the payload
+        int type;            ///< MAVLINK_TYPE_* of the field
+        int arrayLength;     ///< Number of elements, 0 for single values
+        int slot;            ///< Slot of the first element, arrays take one slot per element
+        int index;           ///< Index of the first element within the message
+        QString name;        ///< Name of the field in the message
+        QString unit;        ///< Type name, with array length for arrays
+    };
+
+    /** @brief Precomputed extraction of all fields of one message */
+    struct MessagePlan
+    {
+        enum TimeType { TimeNone, TimeBootMs, TimeUsec };
+        enum NameType {
+            NameStatic,      ///< Fields are named after the message
+            NameFromString,  ///< Fields are named after a string field (named values)
+            NameFromIndex    ///< Fields are named after an index field (debug)
+        };
+        bool valid;          ///< The message is known and not filtered
+        QString name;        ///< Name of the message
+        bool emitText;       ///< String fields are sent out as text message
+        TimeType timeType;
+        int timeOffset;      ///< Wire offset of the time field
+        NameType nameType;
+        int nameOffset;      ///< Wire offset of the field carrying the name
+        int nameLength;
+        QVector<FieldPlan> fields;  ///< Fields to emit, without the time field
+    };
+
+    /** @brief Keep track of the receivers of the named signals */
+    void connectNotify(const char* signal);
+    void disconnectNotify(const char* signal);
+    /** @brief Count the receivers of the named signals again */
+    void updateNamedReceivers();
+    /** @brief Build the extraction plans for all message ids */
+    void buildPlans();
+    /** @brief Channel id of one field element as sent by this system / component */
+    int getChannelId(const mavlink_message_t& msg, const MessagePlan& plan, const FieldPlan& field, int element, const QByteArray& content);
+    /** @brief Queue the value of one field element, emit it to the named receivers */
+    void emitValue(int uasId, int channelId, int value, quint64 time);
+    void emitValue(int uasId, int channelId, unsigned int value, quint64 time);
+    void emitValue(int uasId, int channelId, qint64 value, quint64 time);
+    void emitValue(int uasId, int channelId, quint64 value, quint64 time);
+    void emitValue(int uasId, int channelId, double value, quint64 time);
     /** @brief Shift a timestamp in Unix time if necessary */
     quint64 getUnixTimeFromMs(int systemID, quint64 time);
 
-    mavlink_message_t receivedMessages[256]; ///< Available / known messages
-    mavlink_message_info_t messageInfo[256]; ///< Message information
+    MessagePlan plans[256];                           ///< Extraction plan per message id
+    int slotCount;                                    ///< Number of slots over all plans
+    QVector<QString> channelNames;                    ///< Name per channel id, for the named signals
+    QVector<QString> channelUnits;                    ///< Unit per channel id, for the named signals
+    QVector<int> systemChannelIds[256];               ///< Channel id per slot and system, -1 if not registered yet
+    QHash<quint64, int> componentChannelIds;          ///< Channel ids of systems with multiple components
+    QHash<QPair<quint64, QByteArray>, int> contentChannelIds; ///< Channel ids of fields named by the message content, by raw name
+    TelemetrySampleList samples;                      ///< Values of the message being decoded
+    bool emitNamedValues;                             ///< The named signals are connected
+    int messagesSinceReceiverUpdate;                  ///< Receivers destroyed without disconnecting are only noticed by counting again
     QMap<uint16_t, bool> messageFilter;               ///< Message/field names not to emit
     QMap<uint16_t, bool> textMessageFilter;           ///< Message/field names not to emit in text mode
     int componentID[256];                             ///< Multi component detection
@@ -37,6 +119,7 @@ protected:
     quint64 onboardTimeOffset[256];                   ///< Offset of onboard time from Unix epoch (of the receiving GCS)
     qint64 onboardToGCSUnixTimeOffsetAndDelay[256];   ///< Offset of onboard time and GCS Unix time
     quint64 firstOnboardTime[256];                    ///< First seen onboard time
+    MAVLinkMessageBus* messageBus;                    ///< Delivers the messages to decode
 
 };
 
@@ -11,6 +11,7 @@ const unsigned int QGCMAVLinkInspector::updateInterval = 1000U;
 
 QGCMAVLinkInspector::QGCMAVLinkInspector(MAVLinkProtocol* protocol, QWidget *parent) :
     QWidget(parent),
+    messageBus(protocol->getMessageBus()),
     ui(new Ui::QGCMAVLinkInspector)
 {
     ui->setupUi(this);
@@ -22,7 +23,7 @@ QGCMAVLinkInspector::QGCMAVLinkInspector(MAVLinkProtocol* protocol, QWidget *par
     memcpy(messageInfo, msg, sizeof(mavlink_message_info_t)*256);
     memset(receivedMessages, 0, sizeof(mavlink_message_t)*256);
 
-    connect(protocol, SIGNAL(messageReceived(LinkInterface*,mavlink_message_t)), this, SLOT(receiveMessage(LinkInterface*,mavlink_message_t)));
+    messageBus->subscribe(this, SLOT(receiveMessage(int,MAVLinkMessagePtr)));
     QStringList header;
     header << tr("Name");
     header << tr("Value");
@@ -73,11 +74,12 @@ void QGCMAVLinkInspector::refreshView()
     }
 }
 
-void QGCMAVLinkInspector::receiveMessage(LinkInterface* link,mavlink_message_t message)
+void QGCMAVLinkInspector::receiveMessage(int linkId, MAVLinkMessagePtr sharedMessage)
 {
-    Q_UNUSED(link);
+    Q_UNUSED(linkId);
     // Only overwrite if system filter is set
-    memcpy(receivedMessages+message.msgid, &message, sizeof(mavlink_message_t));
+    memcpy(receivedMessages+sharedMessage->msgid, sharedMessage.data(), sizeof(mavlink_message_t));
+    const mavlink_message_t& message = receivedMessages[sharedMessage->msgid];
 
     quint64 receiveTime = QGC::groundTimeMilliseconds();
     if (lastMessageUpdate.contains(message.msgid))
@@ -91,6 +93,8 @@ void QGCMAVLinkInspector::receiveMessage(LinkInterface* link,mavlink_message_t m
 
 QGCMAVLinkInspector::~QGCMAVLinkInspector()
 {
+    // Stop the protocol thread from queueing messages for this widget
+    messageBus->unsubscribe(this);
     delete ui;
 }
 
@@ -22,7 +22,7 @@ public:
     ~QGCMAVLinkInspector();
 
 public slots:
-    void receiveMessage(LinkInterface* link,mavlink_message_t message);
+    void receiveMessage(int linkId, MAVLinkMessagePtr message);
     void refreshView();
 
 protected:
@@ -33,6 +33,7 @@ protected:
     QMap<int, QTreeWidgetItem*> treeWidgetItems;   ///< Available tree widget items
     QTimer updateTimer; ///< Only update at 1 Hz to not overload the GUI
     mavlink_message_info_t messageInfo[256];
+    MAVLinkMessageBus* messageBus; ///< Delivers the messages, the subscription ends with this widget
 
     // Update one message field
     void updateField(int msgid, int fieldid, QTreeWidgetItem* item);
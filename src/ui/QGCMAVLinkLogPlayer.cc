@@ -19,6 +19,8 @@ QGCMAVLinkLogPlayer::QGCMAVLinkLogPlayer(MAVLinkProtocol* mavlink, QWidget *pare
     logLink(NULL),
     loopCounter(0),
     mavlinkLogFormat(true),
+    currentPacket(0),
+    maxSpeed(false),
     binaryBaudRate(57600),
     isPlaying(false),
     currPacketCount(0),
@@ -28,10 +30,14 @@ QGCMAVLinkLogPlayer::QGCMAVLinkLogPlayer(MAVLinkProtocol* mavlink, QWidget *pare
     ui->gridLayout->setAlignment(Qt::AlignTop);
 
     // Connect protocol
-    connect(this, SIGNAL(bytesReady(LinkInterface*,QByteArray)), mavlink, SLOT(receiveBytes(LinkInterface*,QByteArray)));
+    connect(this, SIGNAL(bytesReady(int,QByteArray)), mavlink, SLOT(receiveBytes(int,QByteArray)));
 
     // Setup timer
     connect(&loopTimer, SIGNAL(timeout()), this, SLOT(logLoop()));
+    connect(&logReader, SIGNAL(fastReplayProgress(int)), this, SLOT(fastReplayProgress(int)));
+    connect(&logReader, SIGNAL(fastReplayFinished()), this, SLOT(fastReplayFinished()));
+    connect(&logReader, SIGNAL(indexReady()), this, SLOT(logIndexReady()));
+    connect(&logReader, SIGNAL(indexProgress(int)), this, SLOT(logIndexProgress(int)));
 
     // Setup buttons
     connect(ui->selectFileButton, SIGNAL(clicked()), this, SLOT(selectLogFile()));
@@ -76,7 +82,12 @@ void QGCMAVLinkLogPlayer::playPauseToggle()
 
 void QGCMAVLinkLogPlayer::play()
 {
-    if (logFile.isOpen())
+    if (logFile.isOpen() && mavlinkLogFormat && !logReader.isIndexed())
+    {
+        ui->playButton->setChecked(false);
+        ui->logStatsLabel->setText(tr("Please wait until the log is indexed.."));
+    }
+    else if (logFile.isOpen())
     {
         ui->selectFileButton->setEnabled(false);
         if (logLink)
@@ -88,7 +99,12 @@ void QGCMAVLinkLogPlayer::play()
         logLink = new MAVLinkSimulationLink("");
 
         // Start timer
-        if (mavlinkLogFormat)
+        if (mavlinkLogFormat && maxSpeed)
+        {
+            // No timing at all, the protocol parses as fast as it can
+            logReader.startFastReplay(mavlink, logLink->getId(), currentPacket);
+        }
+        else if (mavlinkLogFormat)
         {
             loopTimer.start(1);
         }
@@ -123,6 +139,12 @@ void QGCMAVLinkLogPlayer::pause()
 {
     isPlaying = false;
     loopTimer.stop();
+    if (logReader.isFastReplayRunning())
+    {
+        // Continue where the fast replay stopped
+        logReader.stopFastReplay();
+        currentPacket = logReader.getFastReplayIndex();
+    }
     ui->playButton->setIcon(QIcon(":images/actions/media-playback-start.svg"));
     ui->selectFileButton->setEnabled(true);
     if (logLink)
@@ -138,7 +160,19 @@ bool QGCMAVLinkLogPlayer::reset(int packetIndex)
 {
     // Reset only for valid values
     const unsigned int packetSize = timeLen + packetLen;
-    if (packetIndex >= 0 && packetIndex*packetSize <= logFile.size() - packetSize)
+    if (mavlinkLogFormat && logReader.isIndexed() && packetIndex >= 0 && packetIndex < logReader.getPacketCount())
+    {
+        pause();
+        loopCounter = 0;
+        // Random access through the index, no need to touch the file
+        currentPacket = packetIndex;
+
+        ui->playButton->setIcon(QIcon(":images/actions/media-playback-start.svg"));
+        updatePositionSlider(packetIndex / (double)logReader.getPacketCount());
+        startTime = 0;
+        return true;
+    }
+    else if (!mavlinkLogFormat && packetIndex >= 0 && packetIndex*packetSize <= logFile.size() - packetSize)
     {
         bool result = true;
         pause();
@@ -154,10 +188,7 @@ bool QGCMAVLinkLogPlayer::reset(int packetIndex)
         }
 
         ui->playButton->setIcon(QIcon(":images/actions/media-playback-start.svg"));
-        ui->positionSlider->blockSignals(true);
-        int sliderVal = (packetIndex / (double)(logFile.size()/packetSize)) * (ui->positionSlider->maximum() - ui->positionSlider->minimum());
-        ui->positionSlider->setValue(sliderVal);
-        ui->positionSlider->blockSignals(false);
+        updatePositionSlider(packetIndex / (double)(logFile.size()/packetSize));
         startTime = 0;
         return result;
     }
@@ -167,6 +198,13 @@ bool QGCMAVLinkLogPlayer::reset(int packetIndex)
     }
 }
 
+void QGCMAVLinkLogPlayer::updatePositionSlider(double fraction)
+{
+    ui->positionSlider->blockSignals(true);
+    ui->positionSlider->setValue(ui->positionSlider->minimum() + fraction * (ui->positionSlider->maximum() - ui->positionSlider->minimum()));
+    ui->positionSlider->blockSignals(false);
+}
+
 bool QGCMAVLinkLogPlayer::selectLogFile()
 {
     QString fileName = QFileDialog::getOpenFileName(this, tr("Specify MAVLink log file name to replay"), QDesktopServices::storageLocation(QDesktopServices::DesktopLocation), tr("MAVLink or Binary Logfile (*.mavlink *.bin *.log)"));
@@ -182,10 +220,23 @@ bool QGCMAVLinkLogPlayer::selectLogFile()
 }
 
 /**
- * @param factor 0: 0.01X, 50: 1.0X, 100: 100.0X
+ * @param factor 1: 0.01X, 50: 1.0X, 100: as fast as possible (MAVLink logs)
  */
 void QGCMAVLinkLogPlayer::setAccelerationFactorInt(int factor)
 {
+    // The far right of the slider replays MAVLink logs without any timing
+    bool fast = (factor >= ui->speedSlider->maximum());
+    if (fast != maxSpeed)
+    {
+        maxSpeed = fast;
+        if (isPlaying && mavlinkLogFormat)
+        {
+            // Restart in the new mode at the current position
+            pause();
+            play();
+        }
+    }
+
     float f = factor+1.0f;
     f -= 50.0f;
 
@@ -213,7 +264,14 @@ void QGCMAVLinkLogPlayer::setAccelerationFactorInt(int factor)
 
     //qDebug() << "FACTOR:" << accelerationFactor;
 
-    ui->speedLabel->setText(tr("Speed: %1X").arg(accelerationFactor, 5, 'f', 2, '0'));
+    if (maxSpeed && mavlinkLogFormat)
+    {
+        ui->speedLabel->setText(tr("Speed: MAX"));
+    }
+    else
+    {
+        ui->speedLabel->setText(tr("Speed: %1X").arg(accelerationFactor, 5, 'f', 2, '0'));
+    }
 }
 
 bool QGCMAVLinkLogPlayer::loadLogFile(const QString& file)
@@ -251,31 +309,17 @@ bool QGCMAVLinkLogPlayer::loadLogFile(const QString& file)
 
         if (mavlinkLogFormat)
         {
-            // Get the time interval from the logfile
-            QByteArray timestamp = logFile.read(timeLen);
-
-            // First timestamp
-            quint64 starttime = *((quint64*)(timestamp.constData()));
-
-            // Last timestamp
-            logFile.seek(logFile.size()-packetLen-timeLen);
-            QByteArray timestamp2 = logFile.read(timeLen);
-            quint64 endtime = *((quint64*)(timestamp2.constData()));
-            // Reset everything
-            logFile.reset();
-
-            qDebug() << "Starttime:" << starttime << "End:" << endtime;
-
-            // WARNING: Order matters in this computation
-            int seconds = (endtime - starttime)/1000000;
-            int minutes = seconds / 60;
-            int hours = minutes / 60;
-            seconds -= 60*minutes;
-            minutes -= 60*hours;
-
-            QString timelabel = tr("%1h:%2m:%3s").arg(hours, 2).arg(minutes, 2).arg(seconds, 2);
-            currPacketCount = logFileInfo.size()/(MAVLINK_MAX_PACKET_LEN+sizeof(quint64));
-            ui->logStatsLabel->setText(tr("%2 MB, %3 packets, %4").arg(logFileInfo.size()/1000000.0f, 0, 'f', 2).arg(currPacketCount).arg(timelabel));
+            // Map the file, the packet index is built or loaded in the background
+            if (!logReader.open(file))
+            {
+                MainWindow::instance()->showCriticalMessage(tr("The selected logfile is unreadable"), tr("Please make sure that the file %1 is readable or select a different file").arg(file));
+                logFile.close();
+                logFile.setFileName("");
+                return false;
+            }
+            ui->logStatsLabel->setText(tr("Indexing log.."));
+            // Positioned once the index is ready
+            return true;
         }
         else
         {
@@ -313,25 +357,67 @@ bool QGCMAVLinkLogPlayer::loadLogFile(const QString& file)
     }
 }
 
+void QGCMAVLinkLogPlayer::logIndexReady()
+{
+    // A log closed before the index was announced
+    if (!mavlinkLogFormat || !logReader.isIndexed()) return;
+
+    quint64 starttime = logReader.getStartTime();
+    quint64 endtime = logReader.getEndTime();
+
+    qDebug() << "Starttime:" << starttime << "End:" << endtime;
+
+    // WARNING: Order matters in this computation
+    int seconds = (endtime - starttime)/1000000;
+    int minutes = seconds / 60;
+    int hours = minutes / 60;
+    seconds -= 60*minutes;
+    minutes -= 60*hours;
+
+    QString timelabel = tr("%1h:%2m:%3s").arg(hours, 2).arg(minutes, 2).arg(seconds, 2);
+    currPacketCount = logReader.getPacketCount();
+    ui->logStatsLabel->setText(tr("%2 MB, %3 packets, %4").arg(logFile.size()/1000000.0f, 0, 'f', 2).arg(currPacketCount).arg(timelabel));
+
+    // Reset current state, an empty log has no packet to position at
+    currentPacket = 0;
+    reset(0);
+}
+
+void QGCMAVLinkLogPlayer::logIndexProgress(int percent)
+{
+    ui->logStatsLabel->setText(tr("Indexing log.. %1%").arg(percent));
+}
+
 /**
- * Jumps to the current percentage of the position slider
+ * Jumps to the current percentage of the position slider. MAVLink logs
+ * are positioned by time, binary logs by byte position.
  */
 void QGCMAVLinkLogPlayer::jumpToSliderVal(int slidervalue)
 {
     loopTimer.stop();
-    // Set the logfile to the correct percentage and
-    // align to the timestamp values
-    int packetCount = logFile.size() / (packetLen + timeLen);
-    int packetIndex = (packetCount - 1) * (slidervalue / (double)(ui->positionSlider->maximum() - ui->positionSlider->minimum()));
+    double fraction = (slidervalue - ui->positionSlider->minimum()) / (double)(ui->positionSlider->maximum() - ui->positionSlider->minimum());
 
-    // Do only accept valid jumps
-    if (reset(packetIndex))
+    if (mavlinkLogFormat)
     {
-        if (mavlinkLogFormat)
+        if (!logReader.isIndexed()) return;
+        quint64 start = logReader.getStartTime();
+        quint64 time = start + fraction * (logReader.getEndTime() - start);
+        int packetIndex = qMin(logReader.getIndexForTime(time), logReader.getPacketCount() - 1);
+
+        // Do only accept valid jumps
+        if (reset(packetIndex))
         {
-            ui->logStatsLabel->setText(tr("Jumped to packet %1").arg(packetIndex));
+            ui->logStatsLabel->setText(tr("Jumped to %1 s, packet %2").arg((time - start)/1000000.0, 0, 'f', 1).arg(packetIndex));
         }
     }
+    else
+    {
+        // Set the logfile to the correct percentage and
+        // align to the timestamp values
+        int packetCount = logFile.size() / (packetLen + timeLen);
+        int packetIndex = (packetCount - 1) * fraction;
+        reset(packetIndex);
+    }
 }
 
 /**
@@ -346,49 +432,43 @@ void QGCMAVLinkLogPlayer::logLoop()
 {
     if (mavlinkLogFormat)
     {
-        bool ok;
+        const int packetCount = logReader.getPacketCount();
+        if (currentPacket >= packetCount)
+        {
+            // Reached end of file
+            reset();
+
+            QString status = tr("Reached end of MAVLink log file.");
+            ui->logStatsLabel->setText(status);
+            MainWindow::instance()->showStatusMessage(status);
+            return;
+        }
 
         // First check initialization
         if (startTime == 0)
         {
-            QByteArray startBytes = logFile.read(timeLen);
-
-            // Check if the correct number of bytes could be read
-            if (startBytes.length() != timeLen)
-            {
-                ui->logStatsLabel->setText(tr("Error reading first %1 bytes").arg(timeLen));
-                MainWindow::instance()->showCriticalMessage(tr("Failed loading MAVLink Logfile"), tr("Error reading first %1 bytes from logfile. Got %2 instead of %1 bytes. Is the logfile readable?").arg(timeLen).arg(startBytes.length()));
-                reset();
-                return;
-            }
-
-            // Convert data to timestamp
-            startTime = *((quint64*)(startBytes.constData()));
+            startTime = logReader.getTime(currentPacket);
             currentStartTime = QGC::groundTimeUsecs();
-            ok = true;
-
-            //qDebug() << "START TIME: " << startTime;
-
-            // Check if these bytes could be correctly decoded
-            if (!ok)
-            {
-                ui->logStatsLabel->setText(tr("Error decoding first timestamp, aborting."));
-                MainWindow::instance()->showCriticalMessage(tr("Failed loading MAVLink Logfile"), tr("Could not load initial timestamp from file %1. Is the file corrupted?").arg(logFile.fileName()));
-                reset();
-                return;
-            }
         }
 
+        // Collect all packets which are due now (within 2 ms) and emit them at once
+        QByteArray packets;
+        int nextExecutionTime = 0;
+        do
+        {
+            logReader.appendPackets(currentPacket, currentPacket+1, &packets);
+            currentPacket++;
+            if (currentPacket >= packetCount) break;
 
-        // Initialization seems fine, load next chunk
-        QByteArray chunk = logFile.read(timeLen+packetLen);
-        QByteArray packet = chunk.mid(0, packetLen);
+            // Offset of the next packet
+            qint64 timediff = (logReader.getTime(currentPacket) - startTime)/accelerationFactor;
+            nextExecutionTime = (((qint64)currentStartTime + (qint64)timediff) - (qint64)QGC::groundTimeUsecs())/1000;
+        }
+        while (nextExecutionTime < 2);
 
-        // Emit this packet
-        emit bytesReady(logLink, packet);
+        emit bytesReady(logLink->getId(), packets);
 
-        // Check if reached end of file before reading next timestamp
-        if (chunk.length() < timeLen+packetLen || logFile.atEnd())
+        if (currentPacket >= packetCount)
         {
             // Reached end of file
             reset();
@@ -399,45 +479,7 @@ void QGCMAVLinkLogPlayer::logLoop()
             return;
         }
 
-        // End of file not reached, read next timestamp
-        QByteArray rawTime = chunk.mid(packetLen);
-
-        // This is the timestamp of the next packet
-        quint64 time = *((quint64*)(rawTime.constData()));
-        ok = true;
-        if (!ok)
-        {
-            // Convert it to 64bit number
-            QString status = tr("Time conversion error during log replay. Continuing..");
-            ui->logStatsLabel->setText(status);
-            MainWindow::instance()->showStatusMessage(status);
-        }
-        else
-        {
-            // Normal processing, passed all checks
-            // start timer to match time offset between
-            // this and next packet
-
-
-            // Offset in ms
-            qint64 timediff = (time - startTime)/accelerationFactor;
-
-            // Immediately load any data within
-            // a 3 ms interval
-
-            int nextExecutionTime = (((qint64)currentStartTime + (qint64)timediff) - (qint64)QGC::groundTimeUsecs())/1000;
-
-            //qDebug() << "nextExecutionTime:" << nextExecutionTime << "QGC START TIME:" << currentStartTime << "LOG START TIME:" << startTime;
-
-            if (nextExecutionTime < 2)
-            {
-                logLoop();
-            }
-            else
-            {
-                loopTimer.start(nextExecutionTime);
-            }
-        }
+        loopTimer.start(nextExecutionTime);
     }
     else
     {
@@ -446,7 +488,7 @@ void QGCMAVLinkLogPlayer::logLoop()
         QByteArray chunk = logFile.read(len);
 
         // Emit this packet
-        emit bytesReady(logLink, chunk);
+        emit bytesReady(logLink->getId(), chunk);
 
         // Check if reached end of file before reading next timestamp
         if (chunk.length() < len || logFile.atEnd())
@@ -467,16 +509,36 @@ void QGCMAVLinkLogPlayer::logLoop()
     // Update progress bar
     if (loopCounter % 40 == 0 || currPacketCount < 500)
     {
-        QFileInfo logFileInfo(logFile);
-        int progress = (ui->positionSlider->maximum()-ui->positionSlider->minimum())*(logFile.pos()/static_cast<float>(logFileInfo.size()));
-        //qDebug() << "Progress:" << progress;
-        ui->positionSlider->blockSignals(true);
-        ui->positionSlider->setValue(progress);
-        ui->positionSlider->blockSignals(false);
+        if (mavlinkLogFormat)
+        {
+            updatePositionSlider(currentPacket / static_cast<double>(logReader.getPacketCount()));
+        }
+        else
+        {
+            updatePositionSlider(logFile.pos() / static_cast<double>(logFile.size()));
+        }
     }
     loopCounter++;
 }
 
+void QGCMAVLinkLogPlayer::fastReplayProgress(int index)
+{
+    currentPacket = index;
+    if (logReader.getPacketCount() > 0)
+    {
+        updatePositionSlider(index / static_cast<double>(logReader.getPacketCount()));
+    }
+}
+
+void QGCMAVLinkLogPlayer::fastReplayFinished()
+{
+    reset();
+
+    QString status = tr("Reached end of MAVLink log file.");
+    ui->logStatsLabel->setText(status);
+    MainWindow::instance()->showStatusMessage(status);
+}
+
 void QGCMAVLinkLogPlayer::changeEvent(QEvent *e)
 {
     QWidget::changeEvent(e);
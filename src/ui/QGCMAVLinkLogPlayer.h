@@ -5,6 +5,7 @@
 #include <QFile>
 
 #include "MAVLinkProtocol.h"
+#include "MAVLinkLogReader.h"
 #include "LinkInterface.h"
 #include "MAVLinkSimulationLink.h"
 
@@ -58,10 +59,18 @@ public slots:
     void logLoop();
     /** @brief Set acceleration factor in percent */
     void setAccelerationFactorInt(int factor);
+    /** @brief Update the position during a replay at maximum speed */
+    void fastReplayProgress(int index);
+    /** @brief Replay at maximum speed reached the end of the log */
+    void fastReplayFinished();
+    /** @brief Show the length of the log once its index is complete */
+    void logIndexReady();
+    /** @brief Show the progress of the indexing */
+    void logIndexProgress(int percent);
 
 signals:
     /** @brief Send ready bytes */
-    void bytesReady(LinkInterface* link, const QByteArray& bytes);
+    void bytesReady(int linkId, const QByteArray& bytes);
 
 protected:
     int lineCounter;
@@ -76,12 +85,17 @@ protected:
     QTimer loopTimer;
     int loopCounter;
     bool mavlinkLogFormat;
+    MAVLinkLogReader logReader; ///< Indexed access to MAVLink logs
+    int currentPacket;          ///< Index of the next packet to replay from a MAVLink log
+    bool maxSpeed;              ///< Replay as fast as the protocol is able to parse
     int binaryBaudRate;
     bool isPlaying;
     unsigned int currPacketCount;
     static const int packetLen = MAVLINK_MAX_PACKET_LEN;
     static const int timeLen = sizeof(quint64);
     void changeEvent(QEvent *e);
+    /** @brief Move the position slider without triggering a jump */
+    void updatePositionSlider(double fraction);
 
 private:
     Ui::QGCMAVLinkLogPlayer *ui;
@@ -31,7 +31,6 @@ This file is part of the QGROUNDCONTROL project
 #include <QFileDialog>
 #include <QFile>
 #include <QList>
-#include <QSettings>
 #include <QMessageBox>
 #include <QApplication>
 
@@ -48,9 +47,6 @@ QGCParamWidget::QGCParamWidget(UASInterface* uas, QWidget *parent) :
     QGCUASParamManager(uas, parent),
     components(new QMap<int, QTreeWidgetItem*>())
 {
-    // Load settings
-    loadSettings();
-
     // Load default values and tooltips
     loadParameterInfoCSV(uas->getAutopilotTypeName(), uas->getSystemTypeName());
 
@@ -125,28 +121,20 @@ QGCParamWidget::QGCParamWidget(UASInterface* uas, QWidget *parent) :
     tree->setExpandsOnDoubleClick(true);
 
     // Connect signals/slots
-    connect(this, SIGNAL(parameterChanged(int,QString,QVariant)), mav, SLOT(setParameter(int,QString,QVariant)));
     connect(tree, SIGNAL(itemChanged(QTreeWidgetItem*,int)), this, SLOT(parameterItemChanged(QTreeWidgetItem*,int)));
 
     // New parameters from UAS
-    connect(uas, SIGNAL(parameterChanged(int,int,int,int,QString,QVariant)), this, SLOT(addParameter(int,int,int,int,QString,QVariant)));
-
-    // Connect retransmission guard
-    connect(this, SIGNAL(requestParameter(int,QString)), uas, SLOT(requestParameter(int,QString)));
-    connect(this, SIGNAL(requestParameter(int,int)), uas, SLOT(requestParameter(int,int)));
-    connect(&retransmissionTimer, SIGNAL(timeout()), this, SLOT(retransmissionGuardTick()));
-}
-
-void QGCParamWidget::loadSettings()
-{
-    QSettings settings;
-    settings.beginGroup("QGC_MAVLINK_PROTOCOL");
-    bool ok;
-    int temp = settings.value("PARAMETER_RETRANSMISSION_TIMEOUT", retransmissionTimeout).toInt(&ok);
-    if (ok) retransmissionTimeout = temp;
-    temp = settings.value("PARAMETER_REWRITE_TIMEOUT", rewriteTimeout).toInt(&ok);
-    if (ok) rewriteTimeout = temp;
-    settings.endGroup();
+    connect(uas, SIGNAL(parameterChanged(int,int,QString,QVariant)), this, SLOT(addParameter(int,int,QString,QVariant)));
+
+    // Transfer status, the transfer itself is handled by the UAS
+    QGCUASParamSync* sync = uas->getParamSync();
+    connect(sync, SIGNAL(parameterRead(int,int,int,QString,QVariant,int)), this, SLOT(updateReadStatus(int,int,int,QString,QVariant,int)));
+    connect(sync, SIGNAL(parameterWritten(int,QString,QVariant,QVariant,bool,int)), this, SLOT(updateWriteStatus(int,QString,QVariant,QVariant,bool,int)));
+    connect(sync, SIGNAL(retransmissionRequested(int,int)), this, SLOT(showRetransmission(int,int)));
+    connect(sync, SIGNAL(rewriteRequested(int,QString,QVariant)), this, SLOT(showRewrite(int,QString,QVariant)));
+    connect(sync, SIGNAL(transmissionTimeout(int,int)), this, SLOT(showTimeout(int,int)));
+    connect(sync, SIGNAL(parameterLoaded(int,int,QString,QVariant)), this, SLOT(addParameter(int,int,QString,QVariant)));
+    connect(sync, SIGNAL(cacheVerified()), this, SLOT(showCacheVerified()));
 }
 
 void QGCParamWidget::loadParameterInfoCSV(const QString& autopilot, const QString& airframe)
@@ -317,134 +305,78 @@ void QGCParamWidget::addComponent(int uas, int component, QString componentName)
     }
 }
 
+void QGCParamWidget::setStatusColor(const QColor& color)
+{
+    QPalette pal = statusLabel->palette();
+    pal.setColor(backgroundRole(), color);
+    statusLabel->setPalette(pal);
+}
+
 /**
- * @param uas System which has the component
  * @param component id of the component
- * @param parameterName human friendly name of the parameter
+ * @param paramId index of the parameter
+ * @param paramCount number of parameters of the component
+ * @param missing number of parameters of the list still missing
  */
-void QGCParamWidget::addParameter(int uas, int component, int paramCount, int paramId, QString parameterName, QVariant value)
+void QGCParamWidget::updateReadStatus(int component, int paramId, int paramCount, QString parameterName, QVariant value, int missing)
 {
-    addParameter(uas, component, parameterName, value);
-
-    // Missing packets list has to be instantiated for all components
-    if (!transmissionMissingPackets.contains(component)) {
-        transmissionMissingPackets.insert(component, new QList<int>());
-    }
-
-    // List mode is different from single parameter transfers
-    if (transmissionListMode) {
-        // Only accept the list size once on the first packet from
-        // each component
-        if (!transmissionListSizeKnown.contains(component))
-        {
-            // Mark list size as known
-            transmissionListSizeKnown.insert(component, true);
-
-            // Mark all parameters as missing
-            for (int i = 0; i < paramCount; ++i)
-            {
-                if (!transmissionMissingPackets.value(component)->contains(i))
-                {
-                    transmissionMissingPackets.value(component)->append(i);
-                }
-            }
-
-            // There is only one transmission timeout for all components
-            // since components do not manage their transmission,
-            // the longest timeout is safe for all components.
-            quint64 thisTransmissionTimeout = QGC::groundTimeMilliseconds() + ((paramCount/retransmissionBurstRequestSize+5)*retransmissionTimeout);
-            if (thisTransmissionTimeout > transmissionTimeout)
-            {
-                transmissionTimeout = thisTransmissionTimeout;
-            }
-        }
-
-        // Start retransmission guard
-        // or reset timer
-        setRetransmissionGuardEnabled(true);
-    }
-
-    // Mark this parameter as received in read list
-    int index = transmissionMissingPackets.value(component)->indexOf(paramId);
-    // If the MAV sent the parameter without request, it wont be in missing list
-    if (index != -1) transmissionMissingPackets.value(component)->removeAt(index);
-
-    bool justWritten = false;
-    bool writeMismatch = false;
-    //bool lastWritten = false;
-    // Mark this parameter as received in write ACK list
-    QMap<QString, QVariant>* map = transmissionMissingWriteAckPackets.value(component);
-    if (map && map->contains(parameterName))
-    {
-        justWritten = true;
-        if (map->value(parameterName) != value)
-        {
-            writeMismatch = true;
-        }
-        map->remove(parameterName);
-    }
-
-    int missCount = 0;
-    foreach (int key, transmissionMissingPackets.keys())
-    {
-        missCount +=  transmissionMissingPackets.value(key)->count();
-    }
-
-    int missWriteCount = 0;
-    foreach (int key, transmissionMissingWriteAckPackets.keys())
-    {
-        missWriteCount += transmissionMissingWriteAckPackets.value(key)->count();
-    }
+    Q_UNUSED(component);
+    setStatusColor((missing > 0) ? QGC::colorOrange : QGC::colorGreen);
+    statusLabel->setText(tr("Got %2 (#%1/%5): %3 (%4 missing)").arg(paramId+1).arg(parameterName).arg(value.toDouble()).arg(missing).arg(paramCount));
+}
 
-    if (justWritten && !writeMismatch && missWriteCount == 0)
+/**
+ * @param component id of the component
+ * @param parameterName name of the parameter
+ * @param sentValue value written by this widget
+ * @param onboardValue value reported back by the MAV
+ * @param success false if the values do not match
+ * @param missingWrites number of written parameters not reported back yet
+ */
+void QGCParamWidget::updateWriteStatus(int component, QString parameterName, QVariant sentValue, QVariant onboardValue, bool success, int missingWrites)
+{
+    Q_UNUSED(component);
+    if (success && missingWrites == 0)
     {
-        // Just wrote one and count went to 0 - this was the last missing write parameter
+        // This was the last missing write parameter
+        setStatusColor(QGC::colorGreen);
         statusLabel->setText(tr("SUCCESS: WROTE ALL PARAMETERS"));
-        QPalette pal = statusLabel->palette();
-        pal.setColor(backgroundRole(), QGC::colorGreen);
-        statusLabel->setPalette(pal);
-    } else if (justWritten && !writeMismatch)
-    {
-        statusLabel->setText(tr("SUCCESS: Wrote %2 (#%1/%4): %3").arg(paramId+1).arg(parameterName).arg(value.toDouble()).arg(paramCount));
-        QPalette pal = statusLabel->palette();
-        pal.setColor(backgroundRole(), QGC::colorGreen);
-        statusLabel->setPalette(pal);
-    } else if (justWritten && writeMismatch)
+    }
+    else if (success)
     {
-        // Mismatch, tell user
-        QPalette pal = statusLabel->palette();
-        pal.setColor(backgroundRole(), QGC::colorRed);
-        statusLabel->setPalette(pal);
-        statusLabel->setText(tr("FAILURE: Wrote %1: sent %2 != onboard %3").arg(parameterName).arg(map->value(parameterName).toDouble()).arg(value.toDouble()));
+        setStatusColor(QGC::colorGreen);
+        statusLabel->setText(tr("SUCCESS: Wrote %1: %2 (%3 missing)").arg(parameterName).arg(onboardValue.toDouble()).arg(missingWrites));
     }
     else
     {
-        if (missCount > 0)
-        {
-            QPalette pal = statusLabel->palette();
-            pal.setColor(backgroundRole(), QGC::colorOrange);
-            statusLabel->setPalette(pal);
-        }
-        else
-        {
-            QPalette pal = statusLabel->palette();
-            pal.setColor(backgroundRole(), QGC::colorGreen);
-            statusLabel->setPalette(pal);
-        }
-        statusLabel->setText(tr("Got %2 (#%1/%5): %3 (%4 missing)").arg(paramId+1).arg(parameterName).arg(value.toDouble()).arg(missCount).arg(paramCount));
+        // Mismatch, tell user
+        setStatusColor(QGC::colorRed);
+        statusLabel->setText(tr("FAILURE: Wrote %1: sent %2 != onboard %3").arg(parameterName).arg(sentValue.toDouble()).arg(onboardValue.toDouble()));
     }
+}
 
-    // Check if last parameter was received
-    if (missCount == 0 && missWriteCount == 0)
-    {
-        this->transmissionActive = false;
-        this->transmissionListMode = false;
-        transmissionListSizeKnown.clear();
-        foreach (int key, transmissionMissingPackets.keys())
-        {
-            transmissionMissingPackets.value(key)->clear();
-        }
-    }
+void QGCParamWidget::showRetransmission(int component, int paramId)
+{
+    Q_UNUSED(component);
+    statusLabel->setText(tr("Requested retransmission of #%1").arg(paramId+1));
+}
+
+void QGCParamWidget::showRewrite(int component, QString parameterName, QVariant value)
+{
+    Q_UNUSED(component);
+    statusLabel->setText(tr("Requested rewrite of: %1: %2").arg(parameterName).arg(value.toDouble()));
+}
+
+void QGCParamWidget::showTimeout(int missingReads, int missingWrites)
+{
+    setStatusColor(QGC::colorRed);
+    statusLabel->setText(tr("TIMEOUT! MISSING: %1 read, %2 write.").arg(missingReads).arg(missingWrites));
+}
+
+void QGCParamWidget::showCacheVerified()
+{
+    setStatusColor(QGC::colorGreen);
+    statusLabel->setText(tr("SUCCESS: Stored parameters match the onboard parameters"));
 }
 
 /**
@@ -590,32 +522,20 @@ void QGCParamWidget::addParameter(int uas, int component, QString parameterName,
  */
 void QGCParamWidget::requestParameterList()
 {
-    qDebug() << "LOADING PARAM LIST";
     if (!mav) return;
-    // FIXME This call does not belong here
-    // Once the comm handling is moved to a new
-    // Param manager class the settings can be directly
-    // loaded from MAVLink protocol
-    loadSettings();
-    // End of FIXME
 
     // Clear view and request param list
     clear();
     parameters.clear();
-    received.clear();
-    // Clear transmission state
-    transmissionListMode = true;
-    transmissionListSizeKnown.clear();
-    foreach (int key, transmissionMissingPackets.keys()) {
-        transmissionMissingPackets.value(key)->clear();
-    }
-    transmissionActive = true;
 
     // Set status text
     statusLabel->setText(tr("Requested param list.. waiting"));
 
-    // Request twice as mean of forward error correction
-    mav->requestParameters();
+    mav->getParamSync()->requestList();
+    if (mav->getParamSync()->isVerifying())
+    {
+        statusLabel->setText(tr("Showing stored parameters, checking for changes.."));
+    }
 }
 
 void QGCParamWidget::parameterItemChanged(QTreeWidgetItem* current, int column)
@@ -797,124 +717,6 @@ void QGCParamWidget::loadParameters()
 
 }
 
-/**
- * Enabling the retransmission guard enables the parameter widget to track
- * dropped parameters and to re-request them. This works for both individual
- * parameter reads as well for whole list requests.
- *
- * @param enabled True if retransmission checking should be enabled, false else
- */
-void QGCParamWidget::setRetransmissionGuardEnabled(bool enabled)
-{
-    if (enabled) {
-        retransmissionTimer.start(retransmissionTimeout);
-    } else {
-        retransmissionTimer.stop();
-    }
-}
-
-void QGCParamWidget::retransmissionGuardTick()
-{
-    if (transmissionActive) {
-        qDebug() << __FILE__ << __LINE__ << "RETRANSMISSION GUARD ACTIVE, CHECKING FOR DROPS..";
-
-        // Check for timeout
-        // stop retransmission attempts on timeout
-        if (QGC::groundTimeMilliseconds() > transmissionTimeout) {
-            setRetransmissionGuardEnabled(false);
-            transmissionActive = false;
-
-            // Empty read retransmission list
-            // Empty write retransmission list
-            int missingReadCount = 0;
-            QList<int> readKeys = transmissionMissingPackets.keys();
-            foreach (int component, readKeys) {
-                missingReadCount += transmissionMissingPackets.value(component)->count();
-                transmissionMissingPackets.value(component)->clear();
-            }
-
-            // Empty write retransmission list
-            int missingWriteCount = 0;
-            QList<int> writeKeys = transmissionMissingWriteAckPackets.keys();
-            foreach (int component, writeKeys) {
-                missingWriteCount += transmissionMissingWriteAckPackets.value(component)->count();
-                transmissionMissingWriteAckPackets.value(component)->clear();
-            }
-            statusLabel->setText(tr("TIMEOUT! MISSING: %1 read, %2 write.").arg(missingReadCount).arg(missingWriteCount));
-        }
-
-        // Re-request at maximum retransmissionBurstRequestSize parameters at once
-        // to prevent link flooding
-        QMap<int, QMap<QString, QVariant>*>::iterator i;
-        for (i = parameters.begin(); i != parameters.end(); ++i) {
-            // Iterate through the parameters of the component
-            int component = i.key();
-            // Request n parameters from this component (at maximum)
-            QList<int> * paramList = transmissionMissingPackets.value(component, NULL);
-            if (paramList) {
-                int count = 0;
-                foreach (int id, *paramList) {
-                    if (count < retransmissionBurstRequestSize) {
-                        qDebug() << __FILE__ << __LINE__ << "RETRANSMISSION GUARD REQUESTS RETRANSMISSION OF PARAM #" << id << "FROM COMPONENT #" << component;
-                        emit requestParameter(component, id);
-                        statusLabel->setText(tr("Requested retransmission of #%1").arg(id+1));
-                        count++;
-                    } else {
-                        break;
-                    }
-                }
-            }
-        }
-
-        // Re-request at maximum retransmissionBurstRequestSize parameters at once
-        // to prevent write-request link flooding
-        // Empty write retransmission list
-        QList<int> writeKeys = transmissionMissingWriteAckPackets.keys();
-        foreach (int component, writeKeys) {
-            int count = 0;
-            QMap <QString, QVariant>* missingParams = transmissionMissingWriteAckPackets.value(component);
-            foreach (QString key, missingParams->keys()) {
-                if (count < retransmissionBurstRequestSize) {
-                    // Re-request write operation
-                    QVariant value = missingParams->value(key);
-                    switch (parameters.value(component)->value(key).type())
-                    {
-                    case QVariant::Int:
-                        {
-                            QVariant fixedValue(value.toInt());
-                            emit parameterChanged(component, key, fixedValue);
-                        }
-                        break;
-                    case QVariant::UInt:
-                        {
-                            QVariant fixedValue(value.toUInt());
-                            emit parameterChanged(component, key, fixedValue);
-                        }
-                        break;
-                    case QMetaType::Float:
-                        {
-                            QVariant fixedValue(value.toFloat());
-                            emit parameterChanged(component, key, fixedValue);
-                        }
-                        break;
-                    default:
-                        qCritical() << "ABORTED PARAM RETRANSMISSION, NO VALID QVARIANT TYPE";
-                        return;
-                    }
-                    statusLabel->setText(tr("Requested rewrite of: %1: %2").arg(key).arg(missingParams->value(key).toDouble()));
-                    count++;
-                } else {
-                    break;
-                }
-            }
-        }
-    } else {
-        qDebug() << __FILE__ << __LINE__ << "STOPPING RETRANSMISSION GUARD GRACEFULLY";
-        setRetransmissionGuardEnabled(false);
-    }
-}
-
-
 /**
  * The .. signal is emitted
  */
@@ -942,52 +744,27 @@ void QGCParamWidget::setParameter(int component, QString parameterName, QVariant
         return;
     }
 
+    QVariant fixedValue;
     switch (parameters.value(component)->value(parameterName).type())
     {
     case QVariant::Int:
-        {
-            QVariant fixedValue(value.toInt());
-            emit parameterChanged(component, parameterName, fixedValue);
-            qDebug() << "PARAM WIDGET SENT:" << fixedValue;
-        }
+        fixedValue = QVariant(value.toInt());
         break;
     case QVariant::UInt:
-        {
-            QVariant fixedValue(value.toUInt());
-            emit parameterChanged(component, parameterName, fixedValue);
-            qDebug() << "PARAM WIDGET SENT:" << fixedValue;
-        }
+        fixedValue = QVariant(value.toUInt());
         break;
     case QMetaType::Float:
-        {
-            QVariant fixedValue(value.toFloat());
-            emit parameterChanged(component, parameterName, fixedValue);
-            qDebug() << "PARAM WIDGET SENT:" << fixedValue;
-        }
+        fixedValue = QVariant(value.toFloat());
         break;
     default:
         qCritical() << "ABORTED PARAM SEND, NO VALID QVARIANT TYPE";
         return;
     }
 
-    // Wait for parameter to be written back
-    // mark it therefore as missing
-    if (!transmissionMissingWriteAckPackets.contains(component))
-    {
-        transmissionMissingWriteAckPackets.insert(component, new QMap<QString, QVariant>());
-    }
-
-    // Insert it in missing write ACK list
-    transmissionMissingWriteAckPackets.value(component)->insert(parameterName, value);
-
-    // Set timeouts
-    transmissionActive = true;
-    quint64 newTransmissionTimeout = QGC::groundTimeMilliseconds() + 5*rewriteTimeout;
-    if (newTransmissionTimeout > transmissionTimeout) {
-        transmissionTimeout = newTransmissionTimeout;
-    }
-    // Enable guard / reset timeouts
-    setRetransmissionGuardEnabled(true);
+    // The parameter is written again until the MAV reports it back
+    mav->getParamSync()->writeParameter(component, parameterName, fixedValue);
+    emit parameterChanged(component, parameterName, fixedValue);
+    qDebug() << "PARAM WIDGET SENT:" << fixedValue;
 }
 
 /**
@@ -1016,14 +793,6 @@ void QGCParamWidget::setParameters()
         statusLabel->setText(tr("No transmission: No changed values."));
     } else {
         statusLabel->setText(tr("Transmitting %1 parameters.").arg(parametersSent));
-        // Set timeouts
-        transmissionActive = true;
-        quint64 newTransmissionTimeout = QGC::groundTimeMilliseconds() + (parametersSent/retransmissionBurstRequestSize+5)*rewriteTimeout;
-        if (newTransmissionTimeout > transmissionTimeout) {
-            transmissionTimeout = newTransmissionTimeout;
-        }
-        // Enable guard
-        setRetransmissionGuardEnabled(true);
     }
 }
 
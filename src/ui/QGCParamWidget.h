@@ -61,15 +61,9 @@ public:
 signals:
     /** @brief A parameter was changed in the widget, NOT onboard */
     //void parameterChanged(int component, QString parametername, float value); // defined in QGCUASParamManager already
-    /** @brief Request a single parameter */
-    void requestParameter(int component, int parameter);
-    /** @brief Request a single parameter by name */
-    void requestParameter(int component, const QString& parameter);
 public slots:
     /** @brief Add a component to the list */
     void addComponent(int uas, int component, QString componentName);
-    /** @brief Add a parameter to the list with retransmission / safety checks */
-    void addParameter(int uas, int component, int paramCount, int paramId, QString parameterName, QVariant value);
     /** @brief Add a parameter to the list */
     void addParameter(int uas, int component, QString parameterName, QVariant value);
     /** @brief Request list of parameters from MAV */
@@ -94,8 +88,18 @@ public slots:
     /** @brief Load parameters from a file */
     void loadParameters();
 
-    /** @brief Check for missing parameters */
-    void retransmissionGuardTick();
+    /** @brief Show the progress of the parameter list transfer */
+    void updateReadStatus(int component, int paramId, int paramCount, QString parameterName, QVariant value, int missing);
+    /** @brief Show the result of a parameter write */
+    void updateWriteStatus(int component, QString parameterName, QVariant sentValue, QVariant onboardValue, bool success, int missingWrites);
+    /** @brief Show a retransmission request */
+    void showRetransmission(int component, int paramId);
+    /** @brief Show a repeated write */
+    void showRewrite(int component, QString parameterName, QVariant value);
+    /** @brief Show a failed transfer */
+    void showTimeout(int missingReads, int missingWrites);
+    /** @brief Show that the stored parameters are up to date */
+    void showCacheVerified();
 
 protected:
     QTreeWidget* tree;   ///< The parameter tree
@@ -110,10 +114,8 @@ protected:
     QMap<QString, double> paramDefault; ///< Default param values
     QMap<QString, double> paramMax; ///< Minimum param values
 
-    /** @brief Activate / deactivate parameter retransmission */
-    void setRetransmissionGuardEnabled(bool enabled);
-    /** @brief Load  settings */
-    void loadSettings();
+    /** @brief Set the background color of the status line */
+    void setStatusColor(const QColor& color);
     /** @brief Load meta information from CSV */
     void loadParameterInfoCSV(const QString& autopilot, const QString& airframe);
 };
@@ -260,6 +260,7 @@ void QGCToolBar::updateArmingState(bool armed)
 
 void QGCToolBar::updateView()
 {
+    updateLinkQuality();
     if (!changed) return;
     toolBarDistLabel->setText(tr("%1 m").arg(wpDistance, 6, 'f', 2, '0'));
     toolBarWpLabel->setText(tr("WP%1").arg(wpId));
@@ -284,6 +285,28 @@ void QGCToolBar::updateView()
     changed = false;
 }
 
+/**
+ * The statistics are polled from the protocol, one line per link and
+ * component of the active system, so radio links can be compared.
+ */
+void QGCToolBar::updateLinkQuality()
+{
+    MAVLinkProtocol* mavlink = MainWindow::instance()->getMAVLink();
+    if (!mav || !mavlink) return;
+
+    QStringList lines;
+    foreach (const MAVLinkStreamStatistics& stats, mavlink->getStatistics()->getSnapshot())
+    {
+        if (stats.systemId != mav->getUASID()) continue;
+        lines.append(tr("Link %1, component %2: %3 packets/s, %4 bytes/s, %5% lost (%6 lost, %7 duplicate, %8 late)")
+                     .arg(stats.linkId).arg(stats.componentId)
+                     .arg(stats.packetRate, 0, 'f', 1).arg(stats.byteRate, 0, 'f', 0).arg(stats.loss, 0, 'f', 1)
+                     .arg(stats.lostPackets).arg(stats.duplicatePackets).arg(stats.reorderedPackets));
+    }
+    lines.sort();
+    toolBarNameLabel->setToolTip(lines.join("\n"));
+}
+
 void QGCToolBar::updateWaypointDistance(double distance)
 {
     if (wpDistance != distance) changed = true;
@@ -73,6 +73,8 @@ public slots:
 
 protected:
     void createCustomWidgets();
+    /** @brief Show the link quality of the active system as tooltip of its name */
+    void updateLinkQuality();
 
     QAction* toggleLoggingAction;
     QAction* logReplayAction;
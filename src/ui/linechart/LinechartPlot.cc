@@ -115,6 +115,8 @@ LinechartPlot::LinechartPlot(QWidget *parent, int plotid, quint64 interval): Qwt
     // Set canvas background
     setCanvasBackground(QColor(40, 40, 40));
 
+    canvas()->setWhatsThis(tr("The last %1 samples of each curve are plotted at full resolution, older samples as their minimum and maximum per pixel.").arg(TimeSeriesData::getFullResolutionCount()));
+
     // Enable zooming
     //zoomer = new Zoomer(canvas());
     zoomer = new ScrollZoomer(canvas());
@@ -228,12 +230,18 @@ void LinechartPlot::setActive(bool active)
 
 void LinechartPlot::removeTimedOutCurves()
 {
+    datalock.lock();
+    // Curves may be deleted below, channels have to resolve them again
+    resetChannels();
+    datalock.unlock();
+
     foreach(QString key, lastUpdate.keys())
     {
         quint64 time = lastUpdate.value(key);
         if (QGC::groundTimeMilliseconds() - time > 10000)
         {
             // Remove this curve
+            lastUpdate.remove(key);
             // Delete curves
             QwtPlotCurve* curve = curves.take(key);
             // Delete the object
@@ -286,8 +294,37 @@ void LinechartPlot::appendData(QString dataname, quint64 ms, double value)
     }
 
     // Add new value
-    TimeSeriesData* dataset = data.value(dataname);
+    quint64 time = appendToDataset(data.value(dataname), curves.value(dataname), ms, value);
+    lastUpdate.insert(dataname, time);
+
+    datalock.unlock();
+}
+
+void LinechartPlot::appendData(int channel, const QString& dataname, quint64 ms, double value)
+{
+    /* Lock resource to ensure data integrity */
+    datalock.lock();
+
+    if (channel >= channels.size()) channels.resize(channel + 1);
+    PlotChannel& plotChannel = channels[channel];
+    if (!plotChannel.dataset)
+    {
+        if(!data.contains(dataname)) {
+            addCurve(dataname);
+            enforceGroundTime(m_groundTime);
+        }
+        plotChannel.name = dataname;
+        plotChannel.dataset = data.value(dataname);
+        plotChannel.curve = curves.value(dataname);
+    }
+
+    plotChannel.lastUpdate = appendToDataset(plotChannel.dataset, plotChannel.curve, ms, value);
+
+    datalock.unlock();
+}
 
+quint64 LinechartPlot::appendToDataset(TimeSeriesData* dataset, QwtPlotCurve* curve, quint64 ms, double value)
+{
     quint64 time;
 
     // Append data
@@ -302,8 +339,6 @@ void LinechartPlot::appendData(QString dataname, quint64 ms, double value)
     }
     dataset->append(time, value);
 
-    lastUpdate.insert(dataname, time);
-
     // Scaling values
     if(ms < minTime) minTime = ms;
     if(ms > maxTime) maxTime = ms;
@@ -321,12 +356,24 @@ void LinechartPlot::appendData(QString dataname, quint64 ms, double value)
     valueInterval = maxValue - minValue;
 
     // Assign dataset to curve
-    QwtPlotCurve* curve = curves.value(dataname);
     curve->setRawData(dataset->getPlotX(), dataset->getPlotY(), dataset->getPlotCount());
 
     //    qDebug() << "mintime" << minTime << "maxtime" << maxTime << "last max time" << "window position" << getWindowPosition();
 
-    datalock.unlock();
+    return time;
+}
+
+void LinechartPlot::resetChannels()
+{
+    for (int i = 0; i < channels.size(); ++i)
+    {
+        const PlotChannel& plotChannel = channels.at(i);
+        if (plotChannel.dataset && plotChannel.lastUpdate > lastUpdate.value(plotChannel.name, 0))
+        {
+            lastUpdate.insert(plotChannel.name, plotChannel.lastUpdate);
+        }
+    }
+    channels.clear();
 }
 
 /**
@@ -770,6 +817,7 @@ void LinechartPlot::paintRealtime()
 void LinechartPlot::removeAllData()
 {
     datalock.lock();
+    channels.clear();
     // Delete curves
     QMap<QString, QwtPlotCurve*>::iterator i;
     for(i = curves.begin(); i != curves.end(); ++i)
@@ -801,15 +849,192 @@ void LinechartPlot::removeAllData()
 }
 
 
+WindowStatistics::WindowStatistics(int windowSize) :
+    windowPos(0),
+    windowCount(0),
+    added(0),
+    n(0),
+    mean(0.0),
+    m2(0.0),
+    lowSize(0),
+    highSize(0)
+{
+    window.resize(qMax(1, windowSize));
+}
+
+void WindowStatistics::setWindowSize(int windowSize)
+{
+    window.resize(qMax(1, windowSize));
+    clear();
+}
+
+void WindowStatistics::clear()
+{
+    windowPos = 0;
+    windowCount = 0;
+    added = 0;
+    n = 0;
+    mean = 0.0;
+    m2 = 0.0;
+    low = std::priority_queue<Entry>();
+    high = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> >();
+    lowSize = 0;
+    highSize = 0;
+    delayed.clear();
+}
+
+void WindowStatistics::add(double value)
+{
+    if (windowCount == window.size())
+    {
+        double old = window.at(windowPos);
+        if (!isnan(old) && !isinf(old)) removeValue(Entry(old, added - windowCount));
+    }
+    else
+    {
+        windowCount++;
+    }
+    window[windowPos] = value;
+    windowPos = (windowPos + 1) % window.size();
+    if (!isnan(value) && !isinf(value)) insertValue(Entry(value, added));
+    added++;
+
+    if (static_cast<int>(low.size() + high.size()) > 2 * (lowSize + highSize) + 64) rebuild();
+}
+
+double WindowStatistics::getMedian() const
+{
+    if (lowSize == 0) return 0.0;
+    if (lowSize > highSize) return low.top().first;
+    return (low.top().first + high.top().first) / 2.0;
+}
+
+void WindowStatistics::insertValue(const Entry& entry)
+{
+    const double value = entry.first;
+
+    // Welford update
+    n++;
+    double delta = value - mean;
+    mean += delta / n;
+    m2 += delta * (value - mean);
+
+    if (lowSize == 0 || entry < low.top())
+    {
+        low.push(entry);
+        lowSize++;
+    }
+    else
+    {
+        high.push(entry);
+        highSize++;
+    }
+    rebalance();
+}
+
+void WindowStatistics::removeValue(const Entry& entry)
+{
+    const double value = entry.first;
+
+    // Inverse Welford update
+    if (n <= 1)
+    {
+        n = 0;
+        mean = 0.0;
+        m2 = 0.0;
+    }
+    else
+    {
+        double oldMean = mean;
+        mean = (n * mean - value) / (n - 1);
+        m2 -= (value - oldMean) * (value - mean);
+        if (m2 < 0.0) m2 = 0.0;
+        n--;
+    }
+
+    // Lazy deletion, the value is dropped once it reaches the top of its heap
+    delayed.insert(entry.second);
+    if (entry <= low.top())
+    {
+        lowSize--;
+        if (entry == low.top()) prune(low);
+    }
+    else
+    {
+        highSize--;
+        if (entry == high.top()) prune(high);
+    }
+    rebalance();
+}
+
+void WindowStatistics::rebalance()
+{
+    if (lowSize > highSize + 1)
+    {
+        high.push(low.top());
+        low.pop();
+        lowSize--;
+        highSize++;
+        prune(low);
+    }
+    else if (lowSize < highSize)
+    {
+        low.push(high.top());
+        high.pop();
+        highSize--;
+        lowSize++;
+        prune(high);
+    }
+}
+
+template <typename Heap>
+void WindowStatistics::prune(Heap& heap)
+{
+    while (!heap.empty() && delayed.remove(heap.top().second))
+    {
+        heap.pop();
+    }
+}
+
+void WindowStatistics::rebuild()
+{
+    low = std::priority_queue<Entry>();
+    high = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> >();
+    lowSize = 0;
+    highSize = 0;
+    delayed.clear();
+
+    // Re-insert the finite values of the window, the Welford state stays valid
+    int oldest = (windowPos - windowCount + window.size()) % window.size();
+    for (int i = 0; i < windowCount; ++i)
+    {
+        Entry entry(window.at((oldest + i) % window.size()), added - windowCount + i);
+        if (isnan(entry.first) || isinf(entry.first)) continue;
+        if (lowSize == 0 || entry < low.top())
+        {
+            low.push(entry);
+            lowSize++;
+        }
+        else
+        {
+            high.push(entry);
+            highSize++;
+        }
+        rebalance();
+    }
+}
+
 TimeSeriesData::TimeSeriesData(QwtPlot* plot, QString friendlyName, quint64 plotInterval, quint64 maxInterval, double zeroValue):
     minValue(DBL_MAX),
     maxValue(DBL_MIN),
     zeroValue(0),
     count(0),
-    mean(0.0),
-    median(0.0),
-    variance(0.0),
-    averageWindow(50)
+    first(0),
+    capacity(initialCapacity),
+    statistics(50),
+    plotLevel(-1),
+    plotFirstBucket(0),
+    plotPoints(0)
 {
     this->plot = plot;
     this->friendlyName = friendlyName;
@@ -822,6 +1047,21 @@ TimeSeriesData::TimeSeriesData(QwtPlot* plot, QString friendlyName, quint64 plot
     stopTime = QUINT64_MIN;
 
     plotCount = 0;
+
+    ms.resize(2 * capacity);
+    value.resize(2 * capacity);
+
+    for (int i = 0; i < detailLevels; ++i) {
+        DetailLevel& level = levels[i];
+        level.shift = 2 * (i + 1);
+        level.capacity = minLevelCapacity;
+        level.first = 0;
+        level.end = 0;
+        level.min = level.max = 0.0;
+        level.minTime = level.maxTime = 0.0;
+        level.x.resize(4 * level.capacity);
+        level.y.resize(4 * level.capacity);
+    }
 }
 
 TimeSeriesData::~TimeSeriesData()
@@ -832,73 +1072,227 @@ TimeSeriesData::~TimeSeriesData()
 void TimeSeriesData::setInterval(quint64 ms)
 {
     plotInterval = ms;
+
+    // The window might have grown, count again which samples it contains.
+    // Spilled samples are counted a whole pyramid bucket at a time
+    plotCount = 0;
+    const quint64 stored = count - oldest();
+    while (plotCount < stored) {
+        quint64 begin, end;
+        double time = sampleTime(count - plotCount - 1, begin, end);
+        if (stopTime > plotInterval && time < stopTime - plotInterval) break;
+        plotCount = count - begin;
+    }
+    selectPlotLevel();
 }
 
 void TimeSeriesData::setAverageWindowSize(int windowSize)
 {
-    this->averageWindow = windowSize;
+    statistics.setWindowSize(windowSize);
+    // Fill the window with the samples it would contain by now
+    quint64 stored = count - first;
+    quint64 fill = qMin(stored, static_cast<quint64>(qMax(windowSize, 0)));
+    for (quint64 i = count - fill; i < count; ++i) {
+        statistics.add(value[slot(i)]);
+    }
+}
+
+void TimeSeriesData::grow()
+{
+    const int newCapacity = capacity * 2;
+    QwtArray<double> newMs(2 * newCapacity);
+    QwtArray<double> newValue(2 * newCapacity);
+    const quint64 newMask = static_cast<quint64>(newCapacity - 1);
+    for (quint64 i = first; i < count; ++i) {
+        int newSlot = static_cast<int>(i & newMask);
+        newMs[newSlot] = newMs[newSlot + newCapacity] = ms[slot(i)];
+        newValue[newSlot] = newValue[newSlot + newCapacity] = value[slot(i)];
+    }
+    ms = newMs;
+    value = newValue;
+    capacity = newCapacity;
+}
+
+void TimeSeriesData::growLevel(DetailLevel& level)
+{
+    const int newCapacity = level.capacity * 2;
+    QwtArray<double> newX(4 * newCapacity);
+    QwtArray<double> newY(4 * newCapacity);
+    const quint64 oldMask = static_cast<quint64>(level.capacity - 1);
+    const quint64 newMask = static_cast<quint64>(newCapacity - 1);
+    for (quint64 b = level.first; b < level.end; ++b) {
+        int oldSlot = 2 * static_cast<int>(b & oldMask);
+        int newSlot = 2 * static_cast<int>(b & newMask);
+        for (int p = 0; p < 2; ++p) {
+            newX[newSlot + p] = newX[newSlot + p + 2 * newCapacity] = level.x[oldSlot + p];
+            newY[newSlot + p] = newY[newSlot + p + 2 * newCapacity] = level.y[oldSlot + p];
+        }
+    }
+    level.x = newX;
+    level.y = newY;
+    level.capacity = newCapacity;
+}
+
+void TimeSeriesData::appendToLevel(DetailLevel& level, quint64 index, double ms, double value)
+{
+    const quint64 bucket = index >> level.shift;
+    if (bucket >= level.end) {
+        // Start a new bucket
+        if (bucket - level.first >= static_cast<quint64>(level.capacity)) {
+            // All levels hold the same number of buckets, coarser levels
+            // reach further back than finer ones
+            if (level.capacity < maxLevelCapacity) {
+                growLevel(level);
+            } else {
+                level.first = bucket - level.capacity + 1;
+            }
+        }
+        level.end = bucket + 1;
+        level.min = level.max = value;
+        level.minTime = level.maxTime = ms;
+    } else if (isnan(level.min) || value < level.min) {
+        level.min = value;
+        level.minTime = ms;
+    } else if (value > level.max || isnan(level.max)) {
+        level.max = value;
+        level.maxTime = ms;
+    }
+
+    // Write both extremes in time order
+    const int s = 2 * static_cast<int>(bucket & static_cast<quint64>(level.capacity - 1));
+    const int mirror = 2 * level.capacity;
+    const bool minFirst = (level.minTime <= level.maxTime);
+    level.x[s] = level.x[s + mirror] = minFirst ? level.minTime : level.maxTime;
+    level.y[s] = level.y[s + mirror] = minFirst ? level.min : level.max;
+    level.x[s + 1] = level.x[s + 1 + mirror] = minFirst ? level.maxTime : level.minTime;
+    level.y[s + 1] = level.y[s + 1 + mirror] = minFirst ? level.max : level.min;
+}
+
+quint64 TimeSeriesData::oldest() const
+{
+    // Samples only spill while the ring is full, otherwise anything
+    // before the ring has been removed by time
+    quint64 index = first;
+    if (count - first < static_cast<quint64>(capacity)) return index;
+    for (int i = 0; i < detailLevels; ++i) {
+        const DetailLevel& level = levels[i];
+        if (level.end > level.first) index = qMin(index, level.first << level.shift);
+    }
+    return index;
+}
+
+double TimeSeriesData::sampleTime(quint64 index, quint64& begin, quint64& end) const
+{
+    if (index >= first) {
+        begin = index;
+        end = index + 1;
+        return ms[slot(index)];
+    }
+    for (int i = 0; i < detailLevels; ++i) {
+        const DetailLevel& level = levels[i];
+        const quint64 bucket = index >> level.shift;
+        if (bucket < level.first || bucket >= level.end) continue;
+        begin = bucket << level.shift;
+        end = qMin((bucket + 1) << level.shift, first);
+        // The two points of a bucket are in time order
+        return level.x[2 * static_cast<int>(bucket & static_cast<quint64>(level.capacity - 1))];
+    }
+    // Not stored anymore, treat it like the oldest sample in the ring
+    begin = index;
+    end = first;
+    return ms[slot(first)];
+}
+
+/**
+ * Picks the coarsest pyramid level which still has at least one bucket
+ * per pixel of the plot canvas in the plot window. If the window reaches
+ * back before the ring, only levels which cover all of it qualify and the
+ * finest of them is used if none has enough buckets.
+ */
+void TimeSeriesData::selectPlotLevel()
+{
+    plotLevel = -1;
+    plotPoints = 0;
+    if (plotCount == 0) return;
+    const quint64 start = count - plotCount;
+    const bool spilled = (start < first);
+    int width = (plot && plot->canvas()) ? plot->canvas()->width() : 0;
+    if (width <= 0) {
+        if (!spilled) return;
+        width = 1;
+    }
+
+    int covering = -1;
+    for (int i = detailLevels - 1; i >= 0; --i) {
+        const DetailLevel& level = levels[i];
+        if (level.end <= level.first) continue;
+        const bool covers = ((start >> level.shift) >= level.first);
+        if (covers) covering = i;
+        if ((plotCount >> level.shift) < static_cast<quint64>(width)) continue;
+        if (spilled && !covers) continue;
+
+        selectLevel(i);
+        return;
+    }
+    if (spilled && covering >= 0) selectLevel(covering);
+}
+
+void TimeSeriesData::selectLevel(int i)
+{
+    const DetailLevel& level = levels[i];
+    quint64 firstBucket = (count - plotCount) >> level.shift;
+    if (firstBucket < level.first) firstBucket = level.first;
+    plotLevel = i;
+    plotFirstBucket = firstBucket;
+    plotPoints = 2 * static_cast<int>(level.end - firstBucket);
 }
 
 /**
  * @brief Append a data point to this data set
  *
+ * Amortized O(1), the statistics are updated in O(log n) of the average window.
+ *
  * @param ms The time in milliseconds
  * @param value The data value
  **/
 void TimeSeriesData::append(quint64 ms, double value)
 {
-    dataMutex.lock();
-    // Pre- allocate new space
-    // FIXME Check this for validity
-    if(static_cast<quint64>(size()) < (count + 100)) {
-        this->ms.resize(size() + 10000);
-        this->value.resize(size() + 10000);
-    }
-    this->ms[count] = ms;
-    this->value[count] = value;
-    this->lastValue = value;
-    this->mean = 0;
-    //QList<double> medianList = QList<double>();
-    for (unsigned int i = 0; (i < averageWindow) && (((int)count - (int)i) >= 0); ++i) {
-        this->mean += this->value[count-i];
-        //medianList.append(this->value[count-i]);
+    if (count - first == static_cast<quint64>(capacity)) {
+        if (capacity < maxCapacity) {
+            grow();
+        } else {
+            // Ring is full, the oldest sample lives on in the pyramid
+            first++;
+        }
     }
-    this->mean = mean / static_cast<double>(qMin(averageWindow,static_cast<unsigned int>(count)));
 
-    this->variance = 0;
-    for (unsigned int i = 0; (i < averageWindow) && (((int)count - (int)i) >= 0); ++i) {
-        this->variance += (this->value[count-i] - mean) * (this->value[count-i] - mean);
+    // Store the sample twice to keep every range contiguous
+    int s = slot(count);
+    this->ms[s] = this->ms[s + capacity] = ms;
+    this->value[s] = this->value[s + capacity] = value;
+    this->lastValue = value;
+    statistics.add(value);
+    for (int i = 0; i < detailLevels; ++i) {
+        appendToLevel(levels[i], count, ms, value);
     }
-    this->variance = this->variance / static_cast<double>(qMin(averageWindow,static_cast<unsigned int>(count)));
-
-//    qSort(medianList);
-
-//    if (medianList.count() > 2)
-//    {
-//        if (medianList.count() % 2 == 0)
-//        {
-//            median = (medianList.at(medianList.count()/2) + medianList.at(medianList.count()/2+1)) / 2.0;
-//        }
-//        else
-//        {
-//            median = medianList.at(medianList.count()/2+1);
-//        }
-//    }
 
     // Update statistical values
     if(ms < startTime) startTime = ms;
     if(ms > stopTime) stopTime = ms;
     interval = stopTime - startTime;
 
+    count++;
+    plotCount++;
+
+    // Drop samples which left the plot window
     if (interval > plotInterval) {
-        while (this->ms[count - plotCount] < stopTime - plotInterval) {
-            plotCount--;
+        while (plotCount > 0) {
+            quint64 begin, end;
+            if (sampleTime(count - plotCount, begin, end) >= stopTime - plotInterval) break;
+            plotCount = count - end;
         }
     }
 
-    count++;
-    plotCount++;
-
     if(minValue > value) minValue = value;
     if(maxValue < value) maxValue = value;
 
@@ -906,18 +1300,27 @@ void TimeSeriesData::append(quint64 ms, double value)
     if(maxInterval > 0) {
         // maxInterval = 0 means infinite
 
-        if(interval > maxInterval && !this->ms.isEmpty() && !this->value.isEmpty()) {
+        if(interval > maxInterval) {
             // The time at which this time series should be cut
             double minTime = stopTime - maxInterval;
-            // Delete elements from the start of the list as long the time
+            // Delete elements from the start of the ring as long the time
             // value of this elements is before the cut time
-            while(this->ms.first() < minTime) {
-                this->ms.pop_front();
-                this->value.pop_front();
+            while(first < count && this->ms[slot(first)] < minTime) {
+                first++;
+            }
+            // Same for the pyramid buckets which start before the cut time
+            for (int i = 0; i < detailLevels; ++i) {
+                DetailLevel& level = levels[i];
+                while (level.end - level.first > 1 &&
+                       level.x[2 * static_cast<int>(level.first & static_cast<quint64>(level.capacity - 1))] < minTime) {
+                    level.first++;
+                }
             }
         }
     }
-    dataMutex.unlock();
+    if (plotCount > count - oldest()) plotCount = count - oldest();
+
+    selectPlotLevel();
 }
 
 /**
@@ -955,7 +1358,7 @@ double TimeSeriesData::getMaxValue()
  */
 double TimeSeriesData::getMean()
 {
-    return mean;
+    return statistics.getMean();
 }
 
 /**
@@ -963,7 +1366,7 @@ double TimeSeriesData::getMean()
  */
 double TimeSeriesData::getMedian()
 {
-    return median;
+    return statistics.getMedian();
 }
 
 /**
@@ -971,7 +1374,7 @@ double TimeSeriesData::getMedian()
  */
 double TimeSeriesData::getVariance()
 {
-    return variance;
+    return statistics.getVariance();
 }
 
 double TimeSeriesData::getCurrentValue()
@@ -1008,7 +1411,7 @@ void TimeSeriesData::setZeroValue(double zeroValue)
  **/
 int TimeSeriesData::getCount() const
 {
-    return count;
+    return static_cast<int>(count - first);
 }
 
 /**
@@ -1018,20 +1421,21 @@ int TimeSeriesData::getCount() const
  **/
 int TimeSeriesData::getPlotCount() const
 {
+    if (plotLevel >= 0) return plotPoints;
     return plotCount;
 }
 
 /**
- * @brief Get the data array size
- * The data array size is \e NOT equal to the number of items in the data set, as
- * array space is pre-allocated. Use getCount() to get the number of data points.
+ * @brief Get the ring size
+ * The ring size is \e NOT equal to the number of items in the data set, as
+ * ring space is pre-allocated. Use getCount() to get the number of data points.
  *
- * @return The data array size
+ * @return The number of samples the ring can hold before it grows
  * @see getCount()
  **/
 int TimeSeriesData::size() const
 {
-    return ms.size();
+    return capacity;
 }
 
 /**
@@ -1041,12 +1445,16 @@ int TimeSeriesData::size() const
  **/
 const double* TimeSeriesData::getX() const
 {
-    return ms.data();
+    return ms.data() + slot(first);
 }
 
 const double* TimeSeriesData::getPlotX() const
 {
-    return ms.data() + (count - plotCount);
+    if (plotLevel >= 0) {
+        const DetailLevel& level = levels[plotLevel];
+        return level.x.data() + 2 * static_cast<int>(plotFirstBucket & static_cast<quint64>(level.capacity - 1));
+    }
+    return ms.data() + slot(count - plotCount);
 }
 
 /**
@@ -1056,10 +1464,14 @@ const double* TimeSeriesData::getPlotX() const
  **/
 const double* TimeSeriesData::getY() const
 {
-    return value.data();
+    return value.data() + slot(first);
 }
 
 const double* TimeSeriesData::getPlotY() const
 {
-    return value.data() + (count - plotCount);
+    if (plotLevel >= 0) {
+        const DetailLevel& level = levels[plotLevel];
+        return level.y.data() + 2 * static_cast<int>(plotFirstBucket & static_cast<quint64>(level.capacity - 1));
+    }
+    return value.data() + slot(count - plotCount);
 }
@@ -37,6 +37,8 @@ This file is part of the PIXHAWK project
 
 #include <QMap>
 #include <QList>
+#include <QVector>
+#include <QSet>
 #include <QMutex>
 #include <QTime>
 #include <QTimer>
@@ -50,6 +52,11 @@ This file is part of the PIXHAWK project
 #include <ScrollZoomer.h>
 #include "MG.h"
 
+#include <queue>
+#include <vector>
+#include <utility>
+#include <functional>
+
 class TimeScaleDraw: public QwtScaleDraw
 {
 public:
@@ -99,9 +106,90 @@ public:
  */
 class QwtPlotCurve;
 
+/**
+ * @brief Sliding window mean, variance and median
+ *
+ * Mean and variance are updated with Welford's algorithm as values enter
+ * and leave the window, the median is kept in two heaps (lower half in a
+ * max-heap, upper half in a min-heap) with lazy deletion. Heap entries
+ * carry the sequence number of their value, so equal values stay
+ * distinguishable when they are deleted. Adding a value
+ * is O(log n) in the window size. NaN and infinite values occupy a window
+ * slot but do not enter the statistics.
+ */
+class WindowStatistics
+{
+public:
+    WindowStatistics(int windowSize = 50);
+
+    /** @brief Change the window size, clears the window */
+    void setWindowSize(int windowSize);
+    int getWindowSize() const {
+        return window.size();
+    }
+    /** @brief Add a value, removing the oldest one if the window is full */
+    void add(double value);
+    void clear();
+
+    double getMean() const {
+        return mean;
+    }
+    /** @brief Population variance of the window */
+    double getVariance() const {
+        return (n > 0) ? m2 / n : 0.0;
+    }
+    double getMedian() const;
+
+protected:
+    /** @brief Value and sequence number */
+    typedef std::pair<double, quint64> Entry;
+
+    void insertValue(const Entry& entry);
+    void removeValue(const Entry& entry);
+    void rebalance();
+    /** @brief Rebuild the heaps from the window once deleted entries pile up */
+    void rebuild();
+    template <typename Heap> void prune(Heap& heap);
+
+    QVector<double> window; ///< Ring of the last values
+    int windowPos;          ///< Next slot to write in the ring
+    int windowCount;        ///< Number of valid slots in the ring
+    quint64 added;          ///< Number of values added so far
+
+    int n;                  ///< Number of finite values in the window
+    double mean;
+    double m2;              ///< Sum of squared differences from the mean
+
+    std::priority_queue<Entry> low;                                             ///< Lower half, max on top
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > high;  ///< Upper half, min on top
+    int lowSize;            ///< Valid entries in low
+    int highSize;           ///< Valid entries in high
+    QSet<quint64> delayed;  ///< Sequence numbers of removed entries still in one of the heaps
+};
+
 /**
  * @brief Container class for the time series data
  *
+ * Samples are kept in a ring buffer which grows up to maxCapacity. Samples
+ * are only removed by time, when a maximum interval is set. Every sample
+ * is stored twice, at its slot and at slot + capacity, so any range of up
+ * to capacity consecutive samples is contiguous in memory and can be handed
+ * to Qwt without copying.
+ *
+ * On top of the samples a min/max pyramid is built while appending:
+ * a bucket on level k covers 4^(k+1) samples and is stored as two points,
+ * the minimum and the maximum at their original times. The plot view
+ * uses the coarsest level which still has one bucket per horizontal
+ * pixel, so the repaint cost depends on the plot width rather than the
+ * length of the plotted interval, and spikes stay visible.
+ *
+ * Every level holds up to maxLevelCapacity buckets, so each level covers
+ * four times the span of the next finer one. Once the ring is full the
+ * oldest samples spill into the pyramid: they are no longer plotted at
+ * full resolution, but windows reaching back before the ring are still
+ * drawn from the levels which cover them.
+ *
+ * Not thread-safe, LinechartPlot serializes all access.
  **/
 class TimeSeriesData
 {
@@ -119,8 +207,11 @@ public:
     const double* getX() const;
     const double* getY() const;
 
+    /** @brief Time values handed to the plot, raw samples or pyramid points */
     const double* getPlotX() const;
+    /** @brief Data values handed to the plot, raw samples or pyramid points */
     const double* getPlotY() const;
+    /** @brief Number of points handed to the plot */
     int getPlotCount() const;
 
     int getID();
@@ -140,6 +231,11 @@ public:
     void setInterval(quint64 ms);
     void setAverageWindowSize(int windowSize);
 
+    /** @brief Number of most recent samples kept at full resolution */
+    static int getFullResolutionCount() {
+        return maxCapacity;
+    }
+
 protected:
     QwtPlot* plot;
     quint64 startTime;
@@ -156,22 +252,76 @@ protected:
     double maxValue;  ///< The largest value in the dataset
     double zeroValue; ///< The expected value in the dataset
 
-    QMutex dataMutex;
-
     QwtScaleMap* scaleMap;
 
     void updateScaleMap();
 
+    static const int initialCapacity = 1024;   ///< Initial ring size in samples
+    static const int maxCapacity = 1 << 17;    ///< Largest ring size, about 40 minutes at 50 Hz
+    static const int detailLevels = 8;         ///< Pyramid levels, the coarsest bucket covers 4^8 samples
+    static const int minLevelCapacity = 16;    ///< Smallest ring size of a pyramid level in buckets
+    static const int maxLevelCapacity = 1 << 17; ///< Largest ring size of a pyramid level, the coarsest covers years at 50 Hz
+
+    /**
+     * @brief One level of the min/max pyramid
+     *
+     * Bucket b covers the samples [b << shift, (b+1) << shift) and is
+     * stored as the two points 2*slot and 2*slot+1, mirrored like the
+     * samples. The newest bucket is updated in place while it fills.
+     */
+    struct DetailLevel
+    {
+        int shift;             ///< log2 of the samples per bucket
+        int capacity;          ///< Ring size in buckets, a power of two
+        quint64 first;         ///< Index of the oldest stored bucket
+        quint64 end;           ///< Index after the newest (possibly incomplete) bucket
+        double min;            ///< Minimum of the newest bucket
+        double max;            ///< Maximum of the newest bucket
+        double minTime;
+        double maxTime;
+        QwtArray<double> x;    ///< Point times, mirrored
+        QwtArray<double> y;    ///< Point values, mirrored
+    };
+
 private:
-    quint64 count;
-    QwtArray<double> ms;
-    QwtArray<double> value;
-    double mean;
-    double median;
-    double variance;
-    unsigned int averageWindow;
-    QwtArray<double> outputMs;
-    QwtArray<double> outputValue;
+    /** @brief Double the ring size, keeping all stored samples */
+    void grow();
+    /** @brief Add the sample with this index to a pyramid level */
+    void appendToLevel(DetailLevel& level, quint64 index, double ms, double value);
+    /** @brief Double the ring size of a pyramid level */
+    void growLevel(DetailLevel& level);
+    /** @brief Choose the pyramid level for the current plot window and width */
+    void selectPlotLevel();
+    /** @brief Plot the window from this pyramid level */
+    void selectLevel(int i);
+    /** @brief Index of the oldest sample in the ring or in one of the pyramid levels */
+    quint64 oldest() const;
+    /**
+     * @brief Time of a sample
+     *
+     * Samples which spilled out of the ring are represented by the finest
+     * pyramid bucket holding them, all samples of that bucket get the time
+     * of its first point.
+     * @param begin Set to the first sample with the same time representation
+     * @param end Set to the sample after the last one with the same time representation
+     */
+    double sampleTime(quint64 index, quint64& begin, quint64& end) const;
+    /** @brief Position of a sample in the ring */
+    int slot(quint64 index) const {
+        return static_cast<int>(index & static_cast<quint64>(capacity - 1));
+    }
+
+    quint64 count;   ///< Number of samples appended so far
+    quint64 first;   ///< Index of the oldest stored sample
+    int capacity;    ///< Ring size in samples, a power of two
+    QwtArray<double> ms;     ///< Time ring, mirrored
+    QwtArray<double> value;  ///< Value ring, mirrored
+    WindowStatistics statistics;
+
+    DetailLevel levels[detailLevels];
+    int plotLevel;           ///< Pyramid level in the plot view, -1 for raw samples
+    quint64 plotFirstBucket; ///< First bucket in the plot view
+    int plotPoints;          ///< Number of pyramid points in the plot view
 };
 
 
@@ -238,6 +388,16 @@ public slots:
      * @param value value of the data point
      */
     void appendData(QString dataname, quint64 ms, double value);
+    /**
+     * @brief Append data to the curve of a telemetry channel
+     *
+     * The curve is looked up by its name only the first time the channel
+     * is seen, afterwards by the channel id.
+     *
+     * @param channel channel id from the TelemetryChannelRegistry
+     * @param dataname name of the curve of this channel
+     */
+    void appendData(int channel, const QString& dataname, quint64 ms, double value);
     void hideCurve(QString id);
     void showCurve(QString id);
     /** @brief Enable auto-refreshing of plot */
@@ -288,6 +448,22 @@ protected:
     QMap<QString, TimeSeriesData*> data;
     QMap<QString, QwtScaleMap*> scaleMaps;
     QMap<QString, quint64> lastUpdate;
+
+    /** @brief Curve and dataset of one telemetry channel */
+    struct PlotChannel
+    {
+        PlotChannel() : dataset(NULL), curve(NULL), lastUpdate(0) {}
+        QString name;
+        TimeSeriesData* dataset;
+        QwtPlotCurve* curve;
+        quint64 lastUpdate;    ///< Kept here instead of lastUpdate until curves time out
+    };
+    QVector<PlotChannel> channels; ///< Curves by channel id, reset whenever curves are removed
+
+    /** @brief Append one value to a dataset, returns the time the value was stored with */
+    quint64 appendToDataset(TimeSeriesData* dataset, QwtPlotCurve* curve, quint64 ms, double value);
+    /** @brief Move the channel update times into lastUpdate and forget the channel curves */
+    void resetChannels();
     ScrollZoomer* zoomer;
 
     QList<QColor> colors;
@@ -383,9 +383,6 @@ void LinechartWidget::appendData(int uasId, const QString& curve, const QString&
             intData.insert(curve+unit, 0);
             addCurve(curve, unit);
         }
-
-        // Add int data
-        intData.insert(curve+unit, value);
     }
 
     // Log data
@@ -418,9 +415,6 @@ void LinechartWidget::appendData(int uasId, const QString& curve, const QString&
             intData.insert(curve+unit, 0);
             addCurve(curve, unit);
         }
-
-        // Add int data
-        intData.insert(curve+unit, value);
     }
 
     // Log data
@@ -439,6 +433,61 @@ void LinechartWidget::appendData(int uasId, const QString& curve, const QString&
     }
 }
 
+/**
+ * Channels are resolved through the TelemetryChannelRegistry the first
+ * time they are seen, after that no curve names are looked up or
+ * compared per value.
+ */
+void LinechartWidget::appendSamples(const TelemetrySampleList& samples)
+{
+    const bool visible = isVisible();
+    for (int i = 0; i < samples.size(); ++i)
+    {
+        const TelemetrySample& sample = samples.at(i);
+        if (sample.channel >= channelCurves.size()) channelCurves.resize(sample.channel + 1);
+        ChannelCurve& channel = channelCurves[sample.channel];
+        if (channel.systemId < 0)
+        {
+            const TelemetryChannel info = TelemetryChannelRegistry::instance()->getChannel(sample.channel);
+            channel.systemId = info.systemId;
+            channel.name = info.name;
+            channel.unit = info.unit;
+            channel.curve = info.name + info.unit;
+            channel.integer = info.isInteger();
+        }
+
+        if (visible && (selectedMAV == -1 || selectedMAV == channel.systemId))
+        {
+            // Order matters here, first append to plot, then update curve list
+            activePlot->appendData(sample.channel, channel.curve, sample.time, sample.value);
+            if (!channel.listed)
+            {
+                // Make sure the curve will be created if it does not yet exist
+                if (!curveLabels->contains(channel.curve))
+                {
+                    if (channel.integer) intData.insert(channel.curve, 0);
+                    addCurve(channel.name, channel.unit);
+                }
+                channel.listed = true;
+            }
+        }
+
+        // Log data
+        if (logging)
+        {
+            quint64 usec = sample.time;
+            if (usec == 0) usec = QGC::groundTimeMilliseconds();
+            if (logStartTime == 0) logStartTime = usec;
+            qint64 time = usec - logStartTime;
+            if (time < 0) time = 0;
+
+            const QString value = channel.integer ? QString::number(static_cast<qint64>(sample.value)) : QString::number(sample.value,'g',18);
+            logFile->write(QString(QString::number(time) + "\t" + QString::number(channel.systemId) + "\t" + channel.name + "\t" + value + "\n").toLatin1());
+            logFile->flush();
+        }
+    }
+}
+
 void LinechartWidget::refresh()
 {
     setUpdatesEnabled(false);
@@ -447,7 +496,7 @@ void LinechartWidget::refresh()
     QMap<QString, QLabel*>::iterator i;
     for (i = curveLabels->begin(); i != curveLabels->end(); ++i) {
         if (intData.contains(i.key())) {
-            str.sprintf("% 11i", intData.value(i.key()));
+            str.sprintf("% 11i", static_cast<int>(activePlot->getCurrentValue(i.key())));
         } else {
             double val = activePlot->getCurrentValue(i.key());
             int intval = static_cast<int>(val);
@@ -751,6 +800,12 @@ void LinechartWidget::removeCurve(QString curve)
 //    curvesWidgetLayout->removeWidget(colorIcons->take(curve));
     widget->deleteLater();
 //    intData->remove(curve);
+
+    // Channels have to check the curve list again
+    for (int i = 0; i < channelCurves.size(); ++i)
+    {
+        channelCurves[i].listed = false;
+    }
 }
 
 void LinechartWidget::recolor()
@@ -50,6 +50,7 @@ This file is part of the PIXHAWK project
 #include <qwt_plot_curve.h>
 
 #include "LinechartPlot.h"
+#include "TelemetryChannelRegistry.h"
 #include "UASInterface.h"
 #include "ui_Linechart.h"
 
@@ -89,6 +90,8 @@ public slots:
     void appendData(int uasId, const QString& curve, const QString& unit, qint64 value, quint64 usec);
     /** @brief Append data as uint64 with unit */
     void appendData(int uasId, const QString& curve, const QString& unit, quint64 value, quint64 usec);
+    /** @brief Append a batch of telemetry channel values */
+    void appendSamples(const TelemetrySampleList& samples);
     void takeButtonClick(bool checked);
     void setPlotWindowPosition(int scrollBarValue);
     void setPlotWindowPosition(quint64 position);
@@ -141,7 +144,20 @@ protected:
     QMap<QString, QLabel*>* curveMeans;   ///< References to the curve means
     QMap<QString, QLabel*>* curveMedians; ///< References to the curve medians
     QMap<QString, QLabel*>* curveVariances; ///< References to the curve variances
-    QMap<QString, int> intData;           ///< Current values for integer-valued curves
+    QMap<QString, int> intData;           ///< Integer-valued curves
+
+    /** @brief Curve of one telemetry channel, resolved on first use */
+    struct ChannelCurve
+    {
+        ChannelCurve() : systemId(-1), integer(false), listed(false) {}
+        int systemId;     ///< System sending the channel, -1 if not resolved yet
+        QString name;     ///< Curve name without unit
+        QString unit;
+        QString curve;    ///< Curve name and unit, identifies the curve
+        bool integer;     ///< Integer-valued channel
+        bool listed;      ///< The curve list has an entry for this channel
+    };
+    QVector<ChannelCurve> channelCurves; ///< Curves by channel id
     QMap<QString, QWidget*> colorIcons;    ///< Reference to color icons
 
     QWidget* curvesWidget;                ///< The QWidget containing the curve selection button
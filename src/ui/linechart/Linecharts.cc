@@ -2,6 +2,7 @@
 
 #include "Linecharts.h"
 #include "UASManager.h"
+#include "TelemetryAggregator.h"
 
 #include "MainWindow.h"
 
@@ -93,12 +94,8 @@ void Linecharts::addSystem(UASInterface* uas)
         LinechartWidget* widget = new LinechartWidget(uas->getUASID(), this);
         addWidget(widget);
         plots.insert(uas->getUASID(), widget);
-        // Values without unit
-        //connect(uas, SIGNAL(valueChanged(int,QString,double,quint64)), widget, SLOT(appendData(int,QString,double,quint64)));
-        // Values with unit as double
-        connect(uas, SIGNAL(valueChanged(int,QString,QString,double,quint64)), widget, SLOT(appendData(int,QString,QString,double,quint64)));
-        // Values with unit as integer
-        connect(uas, SIGNAL(valueChanged(int,QString,QString,int,quint64)), widget, SLOT(appendData(int,QString,QString,int,quint64)));
+        // Values with unit, as double and integer, batched per frame
+        TelemetryAggregator::instance()->connectSource(uas, widget, SLOT(appendSamples(TelemetrySampleList)), TelemetryAggregator::AllSamples);
 
         connect(widget, SIGNAL(logfileWritten(QString)), this, SIGNAL(logfileWritten(QString)));
         // Set system active if this is the only system
@@ -110,11 +107,7 @@ void Linecharts::addSystem(UASInterface* uas)
                 // Connect generic sources
                 for (int i = 0; i < genericSources.count(); ++i)
                 {
-                    connect(genericSources[i], SIGNAL(valueChanged(int,QString,QString,int,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,int,quint64)));
-                    connect(genericSources[i], SIGNAL(valueChanged(int,QString,QString,unsigned int,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,unsigned int,quint64)));
-                    connect(genericSources[i], SIGNAL(valueChanged(int,QString,QString,quint64,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,quint64,quint64)));
-                    connect(genericSources[i], SIGNAL(valueChanged(int,QString,QString,qint64,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,qint64,quint64)));
-                    connect(genericSources[i], SIGNAL(valueChanged(int,QString,QString,double,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,double,quint64)));
+                    connectSource(genericSources[i], plots.values().first());
                 }
                 // Select system
                 selectSystem(uas->getUASID());
@@ -130,10 +123,14 @@ void Linecharts::addSource(QObject* obj)
     if (plots.size() > 0)
     {
         // Connect generic source
-        connect(obj, SIGNAL(valueChanged(int,QString,QString,int,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,int,quint64)));
-        connect(obj, SIGNAL(valueChanged(int,QString,QString,unsigned int,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,unsigned int,quint64)));
-        connect(obj, SIGNAL(valueChanged(int,QString,QString,quint64,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,quint64,quint64)));
-        connect(obj, SIGNAL(valueChanged(int,QString,QString,qint64,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,qint64,quint64)));
-        connect(obj, SIGNAL(valueChanged(int,QString,QString,double,quint64)), plots.values().first(), SLOT(appendData(int,QString,QString,double,quint64)));
+        connectSource(obj, plots.values().first());
     }
 }
+
+/**
+ * Plots need every sample, the aggregator hands them over once per frame.
+ */
+void Linecharts::connectSource(QObject* source, LinechartWidget* widget)
+{
+    TelemetryAggregator::instance()->connectSource(source, widget, SLOT(appendSamples(TelemetrySampleList)), TelemetryAggregator::AllSamples);
+}
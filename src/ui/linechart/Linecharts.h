@@ -28,6 +28,8 @@ public slots:
     void addSource(QObject* obj);
 
 protected:
+    /** @brief Connect a generic source to a plot */
+    void connectSource(QObject* source, LinechartWidget* widget);
 
     QMap<int, LinechartWidget*> plots;
     QVector<QObject*> genericSources;
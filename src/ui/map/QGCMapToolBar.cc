@@ -118,6 +118,8 @@ void QGCMapToolBar::setMap(QGCMapWidget* map)
             updateTimesGroup->addAction(action);
         }
         optionsMenu.addMenu(&updateTimesMenu);
+        optionsMenu.addAction(tr("&Cache mission area for offline use"), map, SLOT(cacheMissionArea()));
+        optionsMenu.addAction(tr("&Build offline tile packs.."), map, SLOT(buildTilePacks()));
 
 
         ui->optionsButton->setMenu(&optionsMenu);
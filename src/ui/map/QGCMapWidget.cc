@@ -1,3 +1,5 @@
+#include <QFileDialog>
+
 #include "QGCMapWidget.h"
 #include "QGCMapToolBar.h"
 #include "UASInterface.h"
@@ -6,6 +8,17 @@
 #include "Waypoint2DIcon.h"
 #include "UASWaypointManager.h"
 
+static bool lessThanXY(const QPointF& a, const QPointF& b)
+{
+    return (a.x() < b.x()) || (a.x() == b.x() && a.y() < b.y());
+}
+
+/** @brief Cross product of OA and OB, positive for a counter-clockwise turn */
+static qreal cross(const QPointF& o, const QPointF& a, const QPointF& b)
+{
+    return (a.x() - o.x()) * (b.y() - o.y()) - (a.y() - o.y()) * (b.x() - o.x());
+}
+
 QGCMapWidget::QGCMapWidget(QWidget *parent) :
     mapcontrol::OPMapWidget(parent),
     currWPManager(NULL),
@@ -14,6 +27,8 @@ QGCMapWidget::QGCMapWidget(QWidget *parent) :
     followUAVEnabled(false),
     trailType(mapcontrol::UAVTrailType::ByTimeElapsed),
     trailInterval(2.0f),
+    trailMaxPoints(10000),
+    cacheZoomLevels(4),
     followUAVID(0),
     mapInitialized(false)
 {
@@ -75,6 +90,7 @@ void QGCMapWidget::showEvent(QShowEvent* event)
         connect(&updateTimer, SIGNAL(timeout()), this, SLOT(updateGlobalPosition()));
         mapInitialized = true;
         QTimer::singleShot(800, this, SLOT(loadSettings()));
+        QTimer::singleShot(1000, this, SLOT(resumeCaching()));
     }
     updateTimer.start(maxUpdateInterval*1000);
     // Update all UAV positions
@@ -108,8 +124,15 @@ void QGCMapWidget::loadSettings(bool changePosition)
     }
     trailType = static_cast<mapcontrol::UAVTrailType::Types>(settings.value("TRAIL_TYPE", trailType).toInt());
     trailInterval = settings.value("TRAIL_INTERVAL", trailInterval).toFloat();
+    trailMaxPoints = settings.value("TRAIL_MAX_POINTS", trailMaxPoints).toInt();
+    cacheZoomLevels = settings.value("CACHE_ZOOM_LEVELS", cacheZoomLevels).toInt();
+    // The visible tiles of a high resolution screen alone need more than the default
+    int tileMemorySize = settings.value("TILE_MEMORY_SIZE", 96).toInt();
     settings.endGroup();
 
+    // SET TILE MEMORY CACHE SIZE (MB)
+    configuration->SetTileMemorySize(tileMemorySize);
+
     // SET TRAIL TYPE
     foreach (mapcontrol::UAVItem* uav, GetUAVS())
     {
@@ -124,6 +147,7 @@ void QGCMapWidget::loadSettings(bool changePosition)
         {
             uav->SetTrailTime(trailInterval);
         }
+        uav->SetTrailMaxPoints(trailMaxPoints);
     }
 
     // SET INITIAL POSITION AND ZOOM
@@ -142,6 +166,9 @@ void QGCMapWidget::storeSettings()
     settings.setValue("LAST_ZOOM", ZoomReal());
     settings.setValue("TRAIL_TYPE", static_cast<int>(trailType));
     settings.setValue("TRAIL_INTERVAL", trailInterval);
+    settings.setValue("TRAIL_MAX_POINTS", trailMaxPoints);
+    settings.setValue("CACHE_ZOOM_LEVELS", cacheZoomLevels);
+    settings.setValue("TILE_MEMORY_SIZE", configuration->TileMemorySize());
     settings.endGroup();
     settings.sync();
 }
@@ -241,6 +268,7 @@ void QGCMapWidget::updateGlobalPosition(UASInterface* uas, double lat, double lo
             uav->SetTrailTime(1);
             uav->SetTrailDistance(5);
             uav->SetTrailType(mapcontrol::UAVTrailType::ByTimeElapsed);
+            uav->SetTrailMaxPoints(trailMaxPoints);
         }
 
         // Set new lat/lon position of UAV icon
@@ -272,6 +300,7 @@ void QGCMapWidget::updateGlobalPosition()
             uav->SetTrailTime(1);
             uav->SetTrailDistance(5);
             uav->SetTrailType(mapcontrol::UAVTrailType::ByTimeElapsed);
+            uav->SetTrailMaxPoints(trailMaxPoints);
         }
 
         // Set new lat/lon position of UAV icon
@@ -382,12 +411,106 @@ void QGCMapWidget::cacheVisibleRegion()
     }
     else
     {
-        RipMap();
+        QList<internals::PointLatLng> polygon;
+        polygon.append(internals::PointLatLng(rect.Top(), rect.Left()));
+        polygon.append(internals::PointLatLng(rect.Top(), rect.Right()));
+        polygon.append(internals::PointLatLng(rect.Bottom(), rect.Right()));
+        polygon.append(internals::PointLatLng(rect.Bottom(), rect.Left()));
+        int zoom = static_cast<int>(ZoomReal());
+        PrefetchArea(polygon, zoom, qMin(MaxZoom(), zoom + cacheZoomLevels));
         // Set empty area = unselect area
         map->SetSelectedArea(internals::RectLatLng());
     }
 }
 
+/**
+ * Caches the convex hull of the waypoints, so a mission can be flown
+ * without network connection after planning it.
+ */
+void QGCMapWidget::cacheMissionArea()
+{
+    QList<QPointF> points;
+    if (currWPManager)
+    {
+        foreach (Waypoint* wp, currWPManager->getGlobalFrameAndNavTypeWaypointList())
+        {
+            points.append(QPointF(wp->getLongitude(), wp->getLatitude()));
+        }
+    }
+
+    if (points.isEmpty())
+    {
+        QMessageBox msgBox(this);
+        msgBox.setIcon(QMessageBox::Information);
+        msgBox.setText("Cannot cache tiles for offline use");
+        msgBox.setInformativeText("The active system has no waypoints in the global frame.");
+        msgBox.setStandardButtons(QMessageBox::Ok);
+        msgBox.setDefaultButton(QMessageBox::Ok);
+        msgBox.exec();
+        return;
+    }
+
+    // Convex hull with the monotone chain algorithm
+    qSort(points.begin(), points.end(), lessThanXY);
+    QList<QPointF> hull;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        const int start = hull.size();
+        for (int i = 0; i < points.size(); ++i)
+        {
+            const QPointF& p = (pass == 0) ? points.at(i) : points.at(points.size() - 1 - i);
+            while (hull.size() >= start + 2 && cross(hull.at(hull.size() - 2), hull.last(), p) <= 0)
+            {
+                hull.removeLast();
+            }
+            hull.append(p);
+        }
+        // The last point is the first one of the other half
+        hull.removeLast();
+    }
+
+    QList<internals::PointLatLng> polygon;
+    foreach (const QPointF& p, hull)
+    {
+        polygon.append(internals::PointLatLng(p.y(), p.x()));
+    }
+    if (polygon.isEmpty())
+    {
+        polygon.append(internals::PointLatLng(points.first().y(), points.first().x()));
+    }
+    int zoom = static_cast<int>(ZoomReal());
+    PrefetchArea(polygon, zoom, qMin(MaxZoom(), zoom + cacheZoomLevels));
+}
+
+void QGCMapWidget::resumeCaching()
+{
+    if (!HasUnfinishedPrefetch()) return;
+
+    QMessageBox msgBox(this);
+    msgBox.setIcon(QMessageBox::Question);
+    msgBox.setText("Caching of map tiles was interrupted");
+    msgBox.setInformativeText("Do you want to continue caching the remaining tiles for offline use?");
+    msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+    msgBox.setDefaultButton(QMessageBox::Yes);
+    if (msgBox.exec() == QMessageBox::Yes)
+    {
+        ResumePrefetch();
+    }
+}
+
+/**
+ * Packs written to the packs directory of the cache are used at once,
+ * packs written elsewhere can be copied there on other ground stations.
+ */
+void QGCMapWidget::buildTilePacks()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Select the directory of the tile packs"), TilePacksLocation());
+    if (!dir.isEmpty())
+    {
+        ExportTilePacks(dir);
+    }
+}
+
 
 // WAYPOINT MAP INTERACTION FUNCTIONS
 
@@ -32,6 +32,10 @@ public:
     int getTrailType() { return static_cast<int>(trailType); }
     /** @brief Get the trail interval */
     float getTrailInterval() { return trailInterval; }
+    /** @brief Get the maximum number of trail points per MAV */
+    int getTrailMaxPoints() { return trailMaxPoints; }
+    /** @brief Get the number of zoom levels cached below the current zoom */
+    int getCacheZoomLevels() { return cacheZoomLevels; }
 
 signals:
     void homePositionChanged(double latitude, double longitude, double altitude);
@@ -62,8 +66,16 @@ public slots:
     void updateHomePosition(double latitude, double longitude, double altitude);
     /** @brief Set update rate limit */
     void setUpdateRateLimit(float seconds);
-    /** @brief Cache visible region to harddisk */
+    /** @brief Cache the selected region to harddisk in the background */
     void cacheVisibleRegion();
+    /** @brief Cache the area around the waypoints of the active system to harddisk in the background */
+    void cacheMissionArea();
+    /** @brief Offer to continue an interrupted caching job */
+    void resumeCaching();
+    /** @brief Write the cached tiles as read-only tile packs for offline map sets */
+    void buildTilePacks();
+    /** @brief Set the number of zoom levels cached below the current zoom */
+    void setCacheZoomLevels(int levels) { cacheZoomLevels = levels; }
     /** @brief Set follow mode */
     void setFollowUAVEnabled(bool enabled) { followUAVEnabled = enabled; }
     /** @brief Set trail to time mode and set time @param seconds The minimum time between trail dots in seconds. If set to a value < 0, trails will be disabled*/
@@ -98,6 +110,15 @@ public slots:
             }
         }
     }
+    /** @brief Set the maximum number of trail points kept per MAV, older points are dropped */
+    void setTrailMaxPoints(int points)
+    {
+        trailMaxPoints = points;
+        foreach(mapcontrol::UAVItem* uav, GetUAVS())
+        {
+            uav->SetTrailMaxPoints(points);
+        }
+    }
     /** @brief Delete all trails */
     void deleteTrails()
     {
@@ -143,6 +164,8 @@ protected:
     bool followUAVEnabled;              ///< Does the map follow the UAV?
     mapcontrol::UAVTrailType::Types trailType; ///< Time or distance based trail dots
     float trailInterval;                ///< Time or distance between trail items
+    int trailMaxPoints;                 ///< Trail points kept per MAV
+    int cacheZoomLevels;                ///< Zoom levels cached below the current zoom
     int followUAVID;                    ///< Which UAV should be tracked?
     bool mapInitialized;                ///< Map initialized?
 